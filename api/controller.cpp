@@ -1,37 +1,90 @@
+// set version to Windows Vista to get the WSAPoll definitions
+#ifdef _WIN32_WINNT
+#undef _WIN32_WINNT
+#endif
+#define _WIN32_WINNT 0x0600
+
+// used by the select fallback on systems without WSAPoll
+#define FD_SETSIZE 1024
+
 #include <winsock2.h>
 #include <ws2tcpip.h>
 
 #include "controller.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <utility>
 
 #include "cfg/configurator.h"
 #include "external/rapidjson/document.h"
 #include "util/crypt.h"
+#include "util/libutils.h"
 #include "util/logging.h"
+#include "util/time.h"
 #include "util/utils.h"
 
 #include "module.h"
-#include "modules/analogs.h"
-#include "modules/buttons.h"
-#include "modules/card.h"
-#include "modules/capture.h"
-#include "modules/coin.h"
-#include "modules/control.h"
-#include "modules/drs.h"
-#include "modules/iidx.h"
-#include "modules/info.h"
-#include "modules/keypads.h"
-#include "modules/lcd.h"
-#include "modules/lights.h"
-#include "modules/memory.h"
-#include "modules/touch.h"
+#include "msgpack.h"
 #include "request.h"
 #include "response.h"
 
 using namespace rapidjson;
 using namespace api;
 
+// WSAPoll is resolved at runtime since it does not exist on Windows XP
+typedef int (WSAAPI *WSAPoll_t)(LPWSAPOLLFD, ULONG, INT);
+static WSAPoll_t WSAPoll_orig = nullptr;
+
+static int poll_sockets(WSAPOLLFD *fds, ULONG count, INT timeout) {
+    if (WSAPoll_orig != nullptr) {
+        return WSAPoll_orig(fds, count, timeout);
+    }
+
+    // select fallback
+    fd_set read_set, write_set, except_set;
+    FD_ZERO(&read_set);
+    FD_ZERO(&write_set);
+    FD_ZERO(&except_set);
+    for (ULONG i = 0; i < count; i++) {
+        if (fds[i].events & POLLRDNORM) {
+            FD_SET(fds[i].fd, &read_set);
+        }
+        if (fds[i].events & POLLWRNORM) {
+            FD_SET(fds[i].fd, &write_set);
+        }
+        FD_SET(fds[i].fd, &except_set);
+    }
+    timeval tv {
+        .tv_sec = timeout / 1000,
+        .tv_usec = (timeout % 1000) * 1000,
+    };
+    int result = select(0, &read_set, &write_set, &except_set, timeout < 0 ? nullptr : &tv);
+    if (result <= 0) {
+        return result;
+    }
+
+    // convert result
+    int ready = 0;
+    for (ULONG i = 0; i < count; i++) {
+        fds[i].revents = 0;
+        if (FD_ISSET(fds[i].fd, &read_set)) {
+            fds[i].revents |= POLLRDNORM;
+        }
+        if (FD_ISSET(fds[i].fd, &write_set)) {
+            fds[i].revents |= POLLWRNORM;
+        }
+        if (FD_ISSET(fds[i].fd, &except_set)) {
+            fds[i].revents |= POLLERR;
+        }
+        if (fds[i].revents) {
+            ready++;
+        }
+    }
+    return ready;
+}
+
 Controller::Controller(unsigned short port, std::string password, bool pretty)
     : port(port), password(std::move(password)), pretty(pretty)
 {
@@ -51,6 +104,11 @@ Controller::Controller(unsigned short port, std::string password, bool pretty)
         return;
     }
 
+    // resolve WSAPoll
+    if (WSAPoll_orig == nullptr) {
+        WSAPoll_orig = libutils::try_proc<WSAPoll_t>(libutils::try_module("ws2_32.dll"), "WSAPoll");
+    }
+
     // create socket
     this->server = socket(AF_INET, SOCK_STREAM, 0);
     if (this->server == INVALID_SOCKET) {
@@ -101,8 +159,35 @@ Controller::Controller(unsigned short port, std::string password, bool pretty)
         return;
     }
 
-    // start workers
+    // listener must never block the poll loop
+    u_long opt_nonblocking = 1;
+    if (ioctlsocket(this->server, FIONBIO, &opt_nonblocking) != 0) {
+        log_warning("api", "could not set listener to non-blocking: {}", get_last_error_string());
+    }
+
+    // create wakeup socket used by the workers to interrupt the poll loop
+    this->server_wakeup = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (this->server_wakeup != INVALID_SOCKET) {
+        sockaddr_in wakeup_address {};
+        int wakeup_address_size = sizeof(wakeup_address);
+        wakeup_address.sin_family = AF_INET;
+        wakeup_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        wakeup_address.sin_port = 0;
+        if (bind(this->server_wakeup, (sockaddr *) &wakeup_address, sizeof(wakeup_address)) == -1
+            || getsockname(this->server_wakeup, (sockaddr *) &wakeup_address, &wakeup_address_size) == -1
+            || connect(this->server_wakeup, (sockaddr *) &wakeup_address, sizeof(wakeup_address)) == -1
+            || ioctlsocket(this->server_wakeup, FIONBIO, &opt_nonblocking) != 0) {
+            log_warning("api", "could not set up wakeup socket: {}", get_last_error_string());
+            closesocket(this->server_wakeup);
+            this->server_wakeup = INVALID_SOCKET;
+        }
+    }
+
+    // start poller and workers
     this->server_running = true;
+    this->server_poller = std::thread([this] {
+        this->server_poll();
+    });
     for (int i = 0; i < server_worker_count; i++) {
         this->server_workers.emplace_back(std::thread([this] {
             this->server_worker();
@@ -135,17 +220,32 @@ Controller::~Controller() {
         closesocket(this->server);
     }
 
-    // lock handlers
-    std::lock_guard<std::mutex> handlers_guard(this->server_handlers_m);
+    // wake up poller and workers
+    this->server_wake();
+    this->server_queue_cv.notify_all();
 
     // join threads
+    if (this->server_poller.joinable()) {
+        this->server_poller.join();
+    }
     for (auto &worker : this->server_workers) {
         worker.join();
     }
-    for (auto &handler : this->server_handlers) {
-        handler.join();
+
+    // close remaining connections
+    for (auto connection : this->server_connections) {
+        this->connection_close(connection);
+    }
+    this->server_connections.clear();
+
+    // close wakeup socket
+    if (this->server_wakeup != INVALID_SOCKET) {
+        closesocket(this->server_wakeup);
     }
 
+    // free modules
+    delete this->registry.load();
+
     // cleanup WSA
     WSACleanup();
 }
@@ -154,69 +254,243 @@ void Controller::listen_serial(std::string port, DWORD baud) {
     this->serial.push_back(new SerialController(this, port, baud));
 }
 
-void Controller::server_worker() {
+void Controller::server_poll() {
+    std::vector<WSAPOLLFD> fds;
+    std::vector<ClientConnection *> fds_connections;
 
-    // connection loop
+    // poll loop
     while (this->server_running) {
 
-        // create client state
-        ClientState client_state {};
+        // clean up closed connections
+        for (auto it = this->server_connections.begin(); it != this->server_connections.end();) {
+            auto connection = *it;
+            if (!connection->busy && connection->state.close) {
+                this->connection_close(connection);
+                it = this->server_connections.erase(it);
+            } else {
+                it++;
+            }
+        }
 
-        // accept connection
-        int socket_in_size = sizeof(sockaddr_in);
-        client_state.socket = accept(this->server, (sockaddr *) &client_state.address, &socket_in_size);
-        if (client_state.socket == INVALID_SOCKET) {
+        // build poll set
+        fds.clear();
+        fds_connections.clear();
+        auto server_socket = this->server;
+        if (server_socket != INVALID_SOCKET) {
+            fds.push_back({ server_socket, POLLRDNORM, 0 });
+            fds_connections.push_back(nullptr);
+        }
+        if (this->server_wakeup != INVALID_SOCKET) {
+            fds.push_back({ this->server_wakeup, POLLRDNORM, 0 });
+            fds_connections.push_back(nullptr);
+        }
+        double push_deadline = -1;
+        for (auto connection : this->server_connections) {
+
+            // busy connections are owned by a worker until it hands them back
+            if (!connection->busy) {
+
+                // connections with unsent data wait until the socket is writable again
+                if (!connection->pending.empty()) {
+                    fds.push_back({ connection->state.socket, POLLRDNORM | POLLWRNORM, 0 });
+                    fds_connections.push_back(connection);
+                    continue;
+                }
+                fds.push_back({ connection->state.socket, POLLRDNORM, 0 });
+                fds_connections.push_back(connection);
+
+                // remember next subscription push
+                auto deadline = Controller::push_deadline(&connection->state);
+                if (deadline >= 0 && (push_deadline < 0 || deadline < push_deadline)) {
+                    push_deadline = deadline;
+                }
+            }
+        }
+        if (fds.empty()) {
+            Sleep(server_poll_timeout);
+            continue;
+        }
+
+        // wait for events or the next push
+        int timeout = server_poll_timeout;
+        if (push_deadline >= 0) {
+            auto remaining = push_deadline - get_performance_milliseconds();
+            timeout = CLAMP((int) std::ceil(remaining), 0, server_poll_timeout);
+        }
+        int result = poll_sockets(fds.data(), (ULONG) fds.size(), timeout);
+        if (result == SOCKET_ERROR) {
+            log_warning("api", "poll error: {}", WSAGetLastError());
+            Sleep(10);
             continue;
         }
 
-        // lock handlers
-        std::lock_guard<std::mutex> handlers_guard(this->server_handlers_m);
+        // due subscriptions are handled like incoming data
+        if (push_deadline >= 0) {
+            auto now = get_performance_milliseconds();
+            for (size_t i = 0; i < fds.size(); i++) {
+                auto connection = fds_connections[i];
+                if (connection != nullptr && fds[i].revents == 0 && connection->pending.empty()) {
+                    auto deadline = Controller::push_deadline(&connection->state);
+                    if (deadline >= 0 && deadline <= now) {
+                        fds[i].revents = POLLRDNORM;
+                    }
+                }
+            }
+        }
+
+        // process events
+        for (size_t i = 0; i < fds.size(); i++) {
+            auto &fd = fds[i];
+            if (fd.revents == 0) {
+                continue;
+            }
+
+            // internal sockets
+            auto connection = fds_connections[i];
+            if (connection == nullptr) {
+                if (fd.fd == this->server_wakeup) {
+                    char drain[64];
+                    while (recv(this->server_wakeup, drain, sizeof(drain), 0) > 0) {}
+                } else if (fd.fd == server_socket && (fd.revents & POLLRDNORM)) {
+                    this->server_accept();
+                }
+                continue;
+            }
+
+            // hand connection to a worker
+            connection->busy = true;
+            std::unique_lock<std::mutex> queue_lock(this->server_queue_m);
+            this->server_queue.push_back(connection);
+            queue_lock.unlock();
+            this->server_queue_cv.notify_one();
+        }
+    }
+}
+
+void Controller::server_worker() {
+
+    // worker loop
+    while (true) {
+
+        // get next connection
+        std::unique_lock<std::mutex> queue_lock(this->server_queue_m);
+        this->server_queue_cv.wait(queue_lock, [this] {
+            return !this->server_running || !this->server_queue.empty();
+        });
+        if (!this->server_running) {
+            return;
+        }
+        auto connection = this->server_queue.front();
+        this->server_queue.pop_front();
+        queue_lock.unlock();
+
+        // handle pending data and give connection back to the poller
+        this->connection_handler(connection);
+        connection->busy = false;
+        this->server_wake();
+    }
+}
+
+void Controller::server_wake() {
+    if (this->server_wakeup != INVALID_SOCKET) {
+        char data = 0;
+        send(this->server_wakeup, &data, sizeof(data), 0);
+    }
+}
+
+void Controller::server_accept() {
+
+    // accept all pending connections
+    while (true) {
 
-        // check connection limit
-        if (this->server_handlers.size() >= server_connection_limit) {
+        // accept connection
+        sockaddr_in address {};
+        int socket_in_size = sizeof(sockaddr_in);
+        auto client_socket = accept(this->server, (sockaddr *) &address, &socket_in_size);
+        if (client_socket == INVALID_SOCKET) {
+            return;
+        }
+
+        // check connection limit, the select fallback only watches FD_SETSIZE sockets including the
+        // server and wakeup sockets and silently ignores the rest
+        size_t connection_limit = WSAPoll_orig != nullptr ? server_connection_limit : FD_SETSIZE - 2;
+        if (this->server_connections.size() >= connection_limit) {
             log_warning("api", "connection limit hit");
-            closesocket(client_state.socket);
+            closesocket(client_socket);
             continue;
         }
 
-        // handle connection
-        this->server_handlers.emplace_back(std::thread([this, client_state] {
-            this->connection_handler(client_state);
-        }));
+        // connections are drained by the workers without blocking
+        u_long opt_nonblocking = 1;
+        if (ioctlsocket(client_socket, FIONBIO, &opt_nonblocking) != 0) {
+            log_warning("api", "could not set client to non-blocking: {}", get_last_error_string());
+            closesocket(client_socket);
+            continue;
+        }
+
+        // create connection
+        auto connection = new ClientConnection();
+        connection->state.address = address;
+        connection->state.socket = client_socket;
+        connection->address = get_ip_address(address);
+        connection->receive_buffer.resize(server_receive_buffer_size);
+        this->server_connections.push_back(connection);
+
+        // log connection
+        log_info("api", "client connected: {}", connection->address);
+        client_states_m.lock();
+        client_states.emplace_back(&connection->state);
+        client_states_m.unlock();
+
+        // init state
+        init_state(&connection->state);
     }
 }
 
-void Controller::connection_handler(api::ClientState client_state) {
-
-    // get address string
-    char client_address_str_data[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &client_state.address.sin_addr, client_address_str_data, INET_ADDRSTRLEN);
-    std::string client_address_str(client_address_str_data);
+void Controller::connection_close(ClientConnection *connection) {
 
-    // log connection
-    log_info("api", "client connected: {}", client_address_str);
+    // log disconnect
+    log_info("api", "client disconnected: {}", connection->address);
     client_states_m.lock();
-    client_states.emplace_back(&client_state);
+    client_states.erase(std::remove(client_states.begin(), client_states.end(), &connection->state),
+            client_states.end());
     client_states_m.unlock();
 
-    // init state
-    init_state(&client_state);
+    // close connection
+    closesocket(connection->state.socket);
+
+    // free state
+    free_state(&connection->state);
+    delete connection;
+}
+
+void Controller::connection_handler(ClientConnection *connection) {
+    auto &client_state = connection->state;
+    auto &message_buffer = connection->message_buffer;
+    auto &send_buffer = connection->send_buffer;
+    auto receive_buffer = connection->receive_buffer.data();
 
-    // listen loop
-    std::vector<char> message_buffer;
-    char receive_buffer[server_receive_buffer_size];
+    // receive until the socket is drained
     while (this->server_running && !client_state.close) {
 
         // receive data
         int received_length = recv(client_state.socket, receive_buffer, server_receive_buffer_size, 0);
-        if (received_length < 0) {
+        if (received_length == SOCKET_ERROR) {
+
+            // nothing left to read
+            auto error = WSAGetLastError();
+            if (error == WSAEWOULDBLOCK) {
+                break;
+            }
 
             // if the received length is < 0, we've got an error
-            log_warning("api", "receive error: {}", WSAGetLastError());
+            log_warning("api", "receive error: {}", error);
+            client_state.close = true;
             break;
         } else if (received_length == 0) {
 
             // if the received length is 0, the connection is closed
+            client_state.close = true;
             break;
         }
 
@@ -228,62 +502,155 @@ void Controller::connection_handler(api::ClientState client_state) {
             );
         }
 
-        // put into buffer
-        for (int i = 0; i < received_length; i++) {
+        // scan for escape bytes
+        auto cur = receive_buffer;
+        auto end = receive_buffer + received_length;
+        while (cur < end && !client_state.close) {
+            auto escape = (char *) memchr(cur, 0, end - cur);
+            auto segment_end = escape ? escape : end;
 
-            // check for escape byte
-            if (receive_buffer[i] == 0) {
+            // append to message
+            message_buffer.insert(message_buffer.end(), cur, segment_end);
+            cur = escape ? escape + 1 : end;
 
-                // get response
-                std::vector<char> send_buffer;
-                this->process_request(&client_state, &message_buffer, &send_buffer);
-
-                // clear message buffer
+            // check buffer size
+            if (message_buffer.size() > server_message_buffer_max_size) {
                 message_buffer.clear();
+                client_state.close = true;
+                break;
+            }
 
-                // check send buffer for content
-                if (!send_buffer.empty()) {
+            // wait for the rest of the message
+            if (!escape) {
+                break;
+            }
 
-                    // cipher
-                    if (client_state.cipher != nullptr) {
-                        client_state.cipher->crypt(
-                                (uint8_t *) send_buffer.data(),
-                                (size_t) send_buffer.size()
-                        );
-                    }
+            // append response, pipelined requests are answered with a single send
+            this->process_request(&client_state, &message_buffer, &send_buffer);
 
-                    // send data
-                    send(client_state.socket, send_buffer.data(), (int) send_buffer.size(), 0);
+            // clear message buffer
+            message_buffer.clear();
 
-                    // check for password change
-                    process_password_change(&client_state);
+            // the password change must only affect the following responses
+            if (client_state.password_change) {
+                if (!connection_flush(connection)) {
+                    client_state.close = true;
                 }
-            } else {
+                process_password_change(&client_state);
+            }
+        }
 
-                // append to message
-                message_buffer.push_back(receive_buffer[i]);
+        // don't let the send buffer grow unbounded while the client keeps sending
+        if (send_buffer.size() >= server_send_coalesce_size && !connection_flush(connection)) {
+            client_state.close = true;
+        }
+    }
 
-                // check buffer size
-                if (message_buffer.size() > server_message_buffer_max_size) {
-                    message_buffer.clear();
-                    client_state.close = true;
-                    break;
-                }
+    // responses are always delivered
+    if (!client_state.close && !send_buffer.empty() && !connection_flush(connection)) {
+        client_state.close = true;
+    }
+
+    // push subscribed states, clients still receiving the last push skip frames instead of blocking the worker
+    if (!client_state.close) {
+        if (!connection_send(connection, false)) {
+            client_state.close = true;
+        } else if (connection->pending.empty() && this->process_push(&client_state, &send_buffer)) {
+            connection_queue(connection);
+            if (!connection_send(connection, false)) {
+                client_state.close = true;
             }
         }
     }
+    send_buffer.clear();
+}
 
-    // log disconnect
-    log_info("api", "client disconnected: {}", client_address_str);
-    client_states_m.lock();
-    client_states.erase(std::remove(client_states.begin(), client_states.end(), &client_state));
-    client_states_m.unlock();
+bool Controller::connection_flush(ClientConnection *connection) {
+    connection_queue(connection);
+    return connection_send(connection, true);
+}
 
-    // close connection
-    closesocket(client_state.socket);
+void Controller::connection_queue(ClientConnection *connection) {
+    auto &client_state = connection->state;
+    auto &send_buffer = connection->send_buffer;
 
-    // free state
-    free_state(&client_state);
+    // check send buffer for content
+    if (send_buffer.empty()) {
+        return;
+    }
+
+    // cipher
+    if (client_state.cipher != nullptr) {
+        client_state.cipher->crypt(
+                (uint8_t *) send_buffer.data(),
+                (size_t) send_buffer.size()
+        );
+    }
+
+    // queue behind data not sent yet
+    connection->pending.insert(connection->pending.end(), send_buffer.begin(), send_buffer.end());
+    send_buffer.clear();
+}
+
+bool Controller::connection_send(ClientConnection *connection, bool blocking) {
+    auto &pending = connection->pending;
+    auto &offset = connection->pending_offset;
+
+    // send as much as the socket takes
+    while (offset < pending.size()) {
+        auto data = pending.data() + offset;
+        auto size = pending.size() - offset;
+        if (blocking) {
+            if (!send_all(connection->state.socket, data, size)) {
+                return false;
+            }
+            offset = pending.size();
+            break;
+        }
+        int sent = send(connection->state.socket, data, (int) size, 0);
+        if (sent == SOCKET_ERROR) {
+            auto error = WSAGetLastError();
+            if (error == WSAEWOULDBLOCK) {
+                return true;
+            }
+            log_warning("api", "send error: {}", error);
+            return false;
+        }
+        offset += sent;
+    }
+
+    // everything sent
+    pending.clear();
+    offset = 0;
+    return true;
+}
+
+bool Controller::send_all(SOCKET socket, const char *data, size_t size) {
+    while (size > 0) {
+
+        // send data
+        int sent = send(socket, data, (int) size, 0);
+        if (sent == SOCKET_ERROR) {
+            auto error = WSAGetLastError();
+            if (error != WSAEWOULDBLOCK) {
+                log_warning("api", "send error: {}", error);
+                return false;
+            }
+
+            // wait until the socket is writable again
+            WSAPOLLFD fd { socket, POLLWRNORM, 0 };
+            if (poll_sockets(&fd, 1, server_send_timeout) <= 0) {
+                log_warning("api", "send timeout");
+                return false;
+            }
+            continue;
+        }
+
+        // advance
+        data += sent;
+        size -= sent;
+    }
+    return true;
 }
 
 bool Controller::process_request(ClientState *state, std::vector<char> *in, std::vector<char> *out) {
@@ -291,13 +658,42 @@ bool Controller::process_request(ClientState *state, std::vector<char> *in, std:
 }
 
 bool Controller::process_request(ClientState *state, const char *in, size_t in_size, std::vector<char> *out) {
+    auto allocator = state->pool ? &state->pool->allocator : nullptr;
+    bool success = this->process_request(state, allocator, in, in_size, out);
+
+    // everything allocated for this request is dead now
+    if (allocator) {
+        allocator->Clear();
+    }
+
+    return success;
+}
+
+bool Controller::process_request(ClientState *state, rapidjson::MemoryPoolAllocator<> *allocator,
+        const char *in, size_t in_size, std::vector<char> *out) {
 
     // parse document
-    Document document;
-    document.Parse(in, in_size);
+    Document document(allocator);
+    bool parse_error;
+    if (in_size > 0 && (uint8_t) in[0] == msgpack::FRAME_MARKER) {
+
+        // binary frame
+        state->binary = true;
+        std::vector<uint8_t> scratch_local;
+        auto &scratch = state->pool ? state->pool->scratch : scratch_local;
+        scratch.assign(in + 1, in + in_size);
+        auto size = msgpack::cobs_decode(scratch.data(), scratch.size());
+        parse_error = size == SIZE_MAX || !msgpack::parse(document, scratch.data(), size);
+    } else {
+
+        // JSON frame
+        state->binary = false;
+        document.Parse(in, in_size);
+        parse_error = document.HasParseError();
+    }
 
     // check for parse error
-    if (document.HasParseError()) {
+    if (parse_error) {
 
         // return empty response and close connection
         out->push_back(0);
@@ -305,55 +701,130 @@ bool Controller::process_request(ClientState *state, const char *in, size_t in_s
         return false;
     }
 
-    // build request and response
-    Request request(document);
-    Response response(request.id);
+    // single request
+    if (!document.IsArray()) {
+        Request request(document);
+        request.client = state;
+        Response response(request.id, allocator);
+        response.binary = state->binary;
+        bool success = this->handle_request(state, request, response);
+        if (state->binary) {
+            response.write_msgpack(*out);
+        } else {
+            response.write(*out, this->pretty);
+        }
+        out->push_back(0);
+        return success;
+    }
+
+    // batch of requests, executed in order and answered with an array
     bool success = true;
+    if (state->binary) {
+        out->push_back((char) msgpack::FRAME_MARKER);
+        msgpack::CobsStream stream(*out);
+        msgpack::Writer writer(stream);
+        writer.StartArray(document.Size());
+        for (auto &value : document.GetArray()) {
+            Request request(value);
+            request.client = state;
+            Response response(request.id, allocator);
+            response.binary = state->binary;
+            success &= this->handle_request(state, request, response);
+            response.write_msgpack(writer);
+        }
+    } else {
+        out->push_back('[');
+        for (SizeType i = 0; i < document.Size(); i++) {
+            Request request(document[i]);
+            request.client = state;
+            Response response(request.id, allocator);
+            response.binary = state->binary;
+            success &= this->handle_request(state, request, response);
+            if (i > 0) {
+                out->push_back(',');
+            }
+            response.write(*out, this->pretty);
+        }
+        out->push_back(']');
+    }
+    out->push_back(0);
+    return success;
+}
+
+bool Controller::handle_request(ClientState *state, Request &request, Response &response) {
 
     // check if request has parse error
     if (request.parse_error) {
         Value module_error("Request parse error (invalid message format?).");
         response.add_error(module_error);
-        success = false;
-    } else {
+        return false;
+    }
 
-        // find module
-        bool module_found = false;
-        for (auto module : state->modules) {
-            if (module->name == request.module) {
-                module_found = true;
-
-                // check password force
-                if (module->password_force && this->password.empty() && request.function != "session_refresh") {
-                    Value err("Module requires the password to be set.");
-                    response.add_error(err);
-                    break;
-                }
+    // find function
+    bool module_found = false;
+    auto entry = this->registry.load()->find(request.module, request.function, module_found);
+    if (entry) {
 
-                // handle request
-                module->handle(request, response);
-                break;
-            }
+        // check password force
+        if (entry->module->password_force && this->password.empty() && request.function != "session_refresh") {
+            Value err("Module requires the password to be set.");
+            response.add_error(err);
+        } else {
+
+            // handle request
+            Registry::call(entry, request, response);
         }
+    } else if (module_found) {
+        Value function_error("Unknown function.");
+        response.add_error(function_error);
+    } else {
+        Value module_error("Unknown module.");
+        response.add_error(module_error);
+    }
+
+    // check for password change
+    if (response.password_changed) {
+        state->password = response.password;
+        state->password_set = !state->password.empty();
+        state->password_change = true;
+    }
 
-        // check if module wasn't found
-        if (!module_found) {
-            Value module_error("Unknown module.");
-            response.add_error(module_error);
+    return true;
+}
+
+bool Controller::process_push(ClientState *state, std::vector<char> *out) {
+    bool pushed = false;
+
+    // check due subscriptions
+    auto now = get_performance_milliseconds();
+    for (auto &subscription : state->subscriptions) {
+        if (now < subscription.next_push) {
+            continue;
+        }
+        subscription.next_push += subscription.interval;
+        if (subscription.next_push < now) {
+            subscription.next_push = now + subscription.interval;
         }
 
-        // check for password change
-        if (response.password_changed) {
-            state->password = response.password;
-            state->password_change = true;
+        // append frame
+        if (!subscription.module->subscription_push(subscription, state->binary, this->pretty, *out)) {
+            continue;
         }
+        out->push_back(0);
+        pushed = true;
     }
 
-    // write response
-    auto response_out = response.get_string(this->pretty);
-    out->insert(out->end(), response_out.begin(), response_out.end());
-    out->push_back(0);
-    return success;
+    return pushed;
+}
+
+double Controller::push_deadline(ClientState *state) {
+    double deadline = -1;
+    for (auto &subscription : state->subscriptions) {
+        if (deadline < 0 || subscription.next_push < deadline) {
+            deadline = subscription.next_push;
+        }
+    }
+    return deadline;
 }
 
 void Controller::process_password_change(api::ClientState *state) {
@@ -375,43 +846,34 @@ void Controller::process_password_change(api::ClientState *state) {
 void Controller::init_state(api::ClientState *state) {
 
     // check if already initialized
-    if (!state->modules.empty()) {
+    if (state->pool != nullptr) {
         log_fatal("api", "client state double initialization");
     }
 
+    // modules are shared by all clients
+    std::call_once(this->registry_once, [this] {
+        this->registry = new Registry();
+    });
+
     // cipher
     state->cipher = nullptr;
     state->password = this->password;
+    state->password_set = !this->password.empty();
     if (!this->password.empty()) {
         state->cipher = new util::RC4((uint8_t *) this->password.c_str(), this->password.size());
     }
 
-    // create module instances
-    state->modules.push_back(new modules::Analogs());
-    state->modules.push_back(new modules::Buttons());
-    state->modules.push_back(new modules::Card());
-    state->modules.push_back(new modules::Capture());
-    state->modules.push_back(new modules::Coin());
-    state->modules.push_back(new modules::Control());
-    state->modules.push_back(new modules::DRS());
-    state->modules.push_back(new modules::IIDX());
-    state->modules.push_back(new modules::Info());
-    state->modules.push_back(new modules::Keypads());
-    state->modules.push_back(new modules::LCD());
-    state->modules.push_back(new modules::Lights());
-    state->modules.push_back(new modules::Memory());
-    state->modules.push_back(new modules::Touch());
+    // response memory
+    state->pool = new ResponsePool();
 }
 
 void Controller::free_state(api::ClientState *state) {
 
-    // free modules
-    for (auto module : state->modules) {
-        delete module;
-    }
-
     // free cipher
     delete state->cipher;
+
+    // free response memory
+    delete state->pool;
 }
 
 void Controller::free_socket() {
@@ -427,10 +889,13 @@ void Controller::free_socket() {
     }
 }
 
-void Controller::obtain_client_states(std::vector<ClientState> *vec) {
+void Controller::obtain_client_states(std::vector<ClientInfo> *vec) {
     std::lock_guard<std::mutex> lock(this->client_states_m);
     for (auto &state : this->client_states) {
-        vec->push_back(*state);
+        vec->push_back(ClientInfo {
+            .address = state->address,
+            .password_set = state->password_set,
+        });
     }
 }
 
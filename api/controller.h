@@ -1,5 +1,8 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -10,6 +13,8 @@
 #include "util/rc4.h"
 
 #include "module.h"
+#include "registry.h"
+#include "response.h"
 #include "websocket.h"
 #include "serial.h"
 
@@ -19,10 +24,33 @@ namespace api {
         SOCKADDR_IN address;
         SOCKET socket;
         bool close = false;
-        std::vector<Module*> modules;
         std::string password;
+        std::atomic<bool> password_set = false;
         bool password_change = false;
+        bool binary = false;
         util::RC4 *cipher = nullptr;
+        ResponsePool *pool = nullptr;
+        std::vector<Subscription> subscriptions;
+    };
+
+    // what the overlay shows about a client, the rest of the state belongs to the worker handling it
+    struct ClientInfo {
+        SOCKADDR_IN address;
+        bool password_set;
+    };
+
+    struct ClientConnection {
+        ClientState state {};
+        std::string address;
+        std::vector<char> receive_buffer;
+        std::vector<char> message_buffer;
+        std::vector<char> send_buffer;
+
+        // ciphered data the socket didn't accept yet
+        std::vector<char> pending;
+        size_t pending_offset = 0;
+
+        std::atomic<bool> busy = false;
     };
 
     class Controller {
@@ -32,30 +60,49 @@ namespace api {
         const static int server_backlog = 16;
         const static int server_receive_buffer_size = 64 * 1024;
         const static int server_message_buffer_max_size = 64 * 1024;
-        const static int server_worker_count = 2;
+        const static int server_worker_count = 4;
         const static int server_connection_limit = 4096;
+        const static int server_poll_timeout = 500;
+        const static int server_send_timeout = 5000;
+        const static int server_send_coalesce_size = 256 * 1024;
 
         // settings
         unsigned short port;
         std::string password;
         bool pretty;
 
+        // shared module registry, built on the first connection
+        std::atomic<Registry *> registry = nullptr;
+        std::once_flag registry_once;
+
         // server
-        WebSocketController *websocket;
+        WebSocketController *websocket = nullptr;
         std::vector<SerialController *> serial;
+        std::thread server_poller;
         std::vector<std::thread> server_workers;
-        std::vector<std::thread> server_handlers;
-        std::mutex server_handlers_m;
+        std::vector<ClientConnection *> server_connections;
+        std::deque<ClientConnection *> server_queue;
+        std::mutex server_queue_m;
+        std::condition_variable server_queue_cv;
         std::vector<api::ClientState *> client_states;
         std::mutex client_states_m;
         SOCKET server;
+        SOCKET server_wakeup = INVALID_SOCKET;
+        void server_poll();
         void server_worker();
-        void connection_handler(ClientState client_state);
+        void server_wake();
+        void server_accept();
+        void connection_close(ClientConnection *connection);
+        void connection_handler(ClientConnection *connection);
+        bool connection_flush(ClientConnection *connection);
+        void connection_queue(ClientConnection *connection);
+        bool connection_send(ClientConnection *connection, bool blocking);
+        static bool send_all(SOCKET socket, const char *data, size_t size);
 
     public:
 
         // state
-        bool server_running;
+        std::atomic<bool> server_running = false;
 
         // constructor / destructor
         Controller(unsigned short port, std::string password, bool pretty);
@@ -65,16 +112,25 @@ namespace api {
 
         bool process_request(ClientState *state, std::vector<char> *in, std::vector<char> *out);
         bool process_request(ClientState *state, const char *in, size_t in_size, std::vector<char> *out);
+        bool process_request(ClientState *state, rapidjson::MemoryPoolAllocator<> *allocator,
+                const char *in, size_t in_size, std::vector<char> *out);
+        bool handle_request(ClientState *state, Request &request, Response &response);
         static void process_password_change(ClientState *state);
+        bool process_push(ClientState *state, std::vector<char> *out);
+        static double push_deadline(ClientState *state);
 
         void init_state(ClientState *state);
         static void free_state(ClientState *state);
 
         void free_socket();
-        void obtain_client_states(std::vector<ClientState> *output);
+        void obtain_client_states(std::vector<ClientInfo> *output);
 
         std::string get_ip_address(sockaddr_in addr);
 
+        inline const Registry *get_registry() const {
+            return this->registry.load();
+        }
+
         inline const std::string &get_password() const {
             return this->password;
         }
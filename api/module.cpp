@@ -1,8 +1,15 @@
+#include <algorithm>
+#include <cmath>
 #include <utility>
 
+#include "external/rapidjson/prettywriter.h"
+#include "external/rapidjson/writer.h"
 #include "util/logging.h"
+#include "util/time.h"
 
+#include "controller.h"
 #include "module.h"
+#include "msgpack.h"
 
 using namespace rapidjson;
 
@@ -11,24 +18,164 @@ namespace api {
     // logging setting
     bool LOGGING = false;
 
+    template<class Writer>
+    static void write_push(Writer &writer, Subscription &subscription, std::vector<size_t> &changes) {
+        auto module = subscription.module;
+        writer.StartObject();
+        writer.Key("push");
+        writer.String(module->name.c_str(), module->name.size());
+        writer.Key("data");
+        writer.StartArray();
+        for (auto i : changes) {
+            auto name = module->subscription_name(subscription.channels[i]);
+            writer.StartArray();
+            writer.String(name.c_str(), name.size());
+            writer.Double(subscription.states[i]);
+            writer.EndArray();
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+
+    static void write_push_msgpack(std::vector<char> &out, Subscription &subscription, std::vector<size_t> &changes) {
+        auto module = subscription.module;
+        out.push_back((char) msgpack::FRAME_MARKER);
+        msgpack::CobsStream stream(out);
+        msgpack::Writer writer(stream);
+        writer.StartMap(2);
+        writer.String("push", 4);
+        writer.String(module->name.c_str(), module->name.size());
+        writer.String("data", 4);
+        writer.StartArray(changes.size());
+        for (auto i : changes) {
+            auto name = module->subscription_name(subscription.channels[i]);
+            writer.StartArray(2);
+            writer.String(name.c_str(), name.size());
+            writer.Double(subscription.states[i]);
+        }
+    }
+
     Module::Module(std::string name, bool password_force) {
         this->name = std::move(name);
         this->password_force = password_force;
     }
 
-    void Module::handle(Request &req, Response &res) {
+    bool Module::subscription_push(Subscription &subscription, bool binary, bool pretty, std::vector<char> &out) {
+
+        // collect changed states
+        std::vector<size_t> changes;
+        for (size_t i = 0; i < subscription.channels.size(); i++) {
+            auto value = this->subscription_state(subscription.channels[i]);
+            if (value != subscription.states[i]) {
+                subscription.states[i] = value;
+                changes.push_back(i);
+            }
+        }
+        if (changes.empty()) {
+            return false;
+        }
+
+        // append delta frame
+        if (binary) {
+            write_push_msgpack(out, subscription, changes);
+        } else {
+            ResponseStream stream(out);
+            if (pretty) {
+                rapidjson::PrettyWriter<ResponseStream> writer(stream);
+                write_push(writer, subscription, changes);
+            } else {
+                rapidjson::Writer<ResponseStream> writer(stream);
+                write_push(writer, subscription, changes);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * subscribe(rate: float)
+     * subscribe(rate: float, name: str, ...)
+     *
+     * Pushes changed states to the client at up to `rate` times per second.
+     * Without names, all states of the module are subscribed.
+     */
+    void Module::subscribe(Request &req, Response &res) {
+
+        // check client
+        if (!req.client) {
+            return error(res, "Subscriptions are not supported on this connection.");
+        }
+
+        // check params
+        if (req.params.Size() < 1) {
+            return error_params_insufficient(res);
+        }
+        if (!req.params[0].IsNumber() || req.params[0].GetDouble() <= 0) {
+            return error_type(res, "rate", "positive number");
+        }
+
+        // build subscription
+        Subscription subscription {};
+        subscription.module = this;
+        subscription.interval = 1000.0 / std::min(req.params[0].GetDouble(), 1000.0);
+        subscription.next_push = get_performance_milliseconds();
+        auto size = this->subscription_size();
+        if (req.params.Size() == 1) {
+            for (size_t index = 0; index < size; index++) {
+                subscription.channels.push_back(index);
+            }
+        } else {
+            for (rapidjson::SizeType i = 1; i < req.params.Size(); i++) {
+                auto &param = req.params[i];
+                if (!param.IsString()) {
+                    return error_type(res, "name", "string");
+                }
+
+                // find channel
+                size_t index = 0;
+                for (; index < size; index++) {
+                    if (this->subscription_name(index) == param.GetString()) {
+                        break;
+                    }
+                }
+                if (index == size) {
+                    return error_unknown(res, "name", param.GetString());
+                }
+                subscription.channels.push_back(index);
+            }
+        }
+
+        // NaN never compares equal, so the first push contains all states
+        subscription.states.resize(subscription.channels.size(), NAN);
+
+        // replace existing subscription
+        auto &subscriptions = req.client->subscriptions;
+        for (auto &existing : subscriptions) {
+            if (existing.module == this) {
+                existing = std::move(subscription);
+                return;
+            }
+        }
+        subscriptions.emplace_back(std::move(subscription));
+    }
 
-        // log module access
-        if (LOGGING)
-            log_info("api::" + this->name, "handling request");
+    /**
+     * unsubscribe()
+     */
+    void Module::unsubscribe(Request &req, Response &res) {
 
-        // find function
-        auto pos = functions.find(req.function);
-        if (pos == functions.end())
-            return error_function_unknown(res);
+        // check client
+        if (!req.client) {
+            return;
+        }
 
-        // call function
-        pos->second(req, res);
+        // remove subscription
+        auto &subscriptions = req.client->subscriptions;
+        for (auto it = subscriptions.begin(); it != subscriptions.end(); it++) {
+            if (it->module == this) {
+                subscriptions.erase(it);
+                return;
+            }
+        }
     }
 
     void Module::error(Response &res, std::string err) {
@@ -1,10 +1,11 @@
 #pragma once
 
-#include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <sstream>
-#include <external/robin_hood.h>
+#include <utility>
+#include <vector>
 
 #include "response.h"
 #include "request.h"
@@ -14,18 +15,46 @@ namespace api {
     // logging setting
     extern bool LOGGING;
 
-    // callback
-    typedef std::function<void(Request &, Response &)> ModuleFunctionCallback;
+    class Module;
+
+    /*
+     * Push subscription of a client to the states of a module.
+     * Only states which changed since the last push are sent, at most once per interval.
+     */
+    struct Subscription {
+        Module *module = nullptr;
+        double interval = 0;
+        double next_push = 0;
+        std::vector<size_t> channels;
+        std::vector<float> states;
+
+        // module specific state
+        std::shared_ptr<void> context;
+        uint64_t sequence = 0;
+    };
 
     class Module {
+        friend class Registry;
+
+    public:
+
+        // callback
+        typedef void (Module::*Function)(Request &, Response &);
+
     protected:
 
-        // map of available functions
-        robin_hood::unordered_map<std::string, ModuleFunctionCallback> functions;
+        // available functions, collected by the registry
+        std::vector<std::pair<std::string, Function>> functions;
 
         // default constructor
         explicit Module(std::string name, bool password_force=false);
 
+        // register a function, called by the constructor of the module
+        template<class T>
+        void add_function(std::string function_name, void (T::*function)(Request &, Response &)) {
+            this->functions.emplace_back(std::move(function_name), static_cast<Function>(function));
+        }
+
     public:
 
         // virtual deconstructor
@@ -35,8 +64,25 @@ namespace api {
         std::string name;
         bool password_force;
 
-        // the magic
-        void handle(Request &req, Response &res);
+        /*
+         * Subscriptions.
+         * Modules exposing a list of named states override these and register subscribe/unsubscribe.
+         */
+
+        virtual size_t subscription_size() {
+            return 0;
+        }
+        virtual std::string subscription_name(size_t index) {
+            return "";
+        }
+        virtual float subscription_state(size_t index) {
+            return 0.f;
+        }
+
+        // appends the push frame of a due subscription without terminator, returns false if nothing changed
+        virtual bool subscription_push(Subscription &subscription, bool binary, bool pretty, std::vector<char> &out);
+        void subscribe(Request &req, Response &res);
+        void unsubscribe(Request &req, Response &res);
 
         /*
          * Error definitions.
@@ -1,5 +1,4 @@
 #include "analogs.h"
-#include <functional>
 #include "external/rapidjson/document.h"
 #include "misc/eamuse.h"
 #include "cfg/analog.h"
@@ -7,16 +6,17 @@
 #include "games/io.h"
 #include "util/utils.h"
 
-using namespace std::placeholders;
 using namespace rapidjson;
 
 
 namespace api::modules {
 
     Analogs::Analogs() : Module("analogs") {
-        functions["read"] = std::bind(&Analogs::read, this, _1, _2);
-        functions["write"] = std::bind(&Analogs::write, this, _1, _2);
-        functions["write_reset"] = std::bind(&Analogs::write_reset, this, _1, _2);
+        add_function("read", &Analogs::read);
+        add_function("write", &Analogs::write);
+        add_function("write_reset", &Analogs::write_reset);
+        add_function("subscribe", &Analogs::subscribe);
+        add_function("unsubscribe", &Analogs::unsubscribe);
         analogs = games::get_analogs(eamuse_get_game());
     }
 
@@ -174,4 +174,16 @@ namespace api::modules {
         // unknown analog
         return false;
     }
+
+    size_t Analogs::subscription_size() {
+        return this->analogs ? this->analogs->size() : 0;
+    }
+
+    std::string Analogs::subscription_name(size_t index) {
+        return (*this->analogs)[index].getName();
+    }
+
+    float Analogs::subscription_state(size_t index) {
+        return GameAPI::Analogs::getState(RI_MGR, (*this->analogs)[index]);
+    }
 }
@@ -11,6 +11,11 @@ namespace api::modules {
     public:
         Analogs();
 
+        // subscriptions
+        size_t subscription_size() override;
+        std::string subscription_name(size_t index) override;
+        float subscription_state(size_t index) override;
+
     private:
 
         // state
@@ -1,5 +1,4 @@
 #include "buttons.h"
-#include <functional>
 #include "external/rapidjson/document.h"
 #include "misc/eamuse.h"
 #include "cfg/button.h"
@@ -7,16 +6,17 @@
 #include "games/io.h"
 #include "util/utils.h"
 
-using namespace std::placeholders;
 using namespace rapidjson;
 
 
 namespace api::modules {
 
     Buttons::Buttons() : Module("buttons") {
-        functions["read"] = std::bind(&Buttons::read, this, _1, _2);
-        functions["write"] = std::bind(&Buttons::write, this, _1, _2);
-        functions["write_reset"] = std::bind(&Buttons::write_reset, this, _1, _2);
+        add_function("read", &Buttons::read);
+        add_function("write", &Buttons::write);
+        add_function("write_reset", &Buttons::write_reset);
+        add_function("subscribe", &Buttons::subscribe);
+        add_function("unsubscribe", &Buttons::unsubscribe);
         buttons = games::get_buttons(eamuse_get_game());
     }
 
@@ -179,4 +179,16 @@ namespace api::modules {
         // unknown button
         return false;
     }
+
+    size_t Buttons::subscription_size() {
+        return this->buttons ? this->buttons->size() : 0;
+    }
+
+    std::string Buttons::subscription_name(size_t index) {
+        return (*this->buttons)[index].getName();
+    }
+
+    float Buttons::subscription_state(size_t index) {
+        return GameAPI::Buttons::getVelocity(RI_MGR, (*this->buttons)[index]);
+    }
 }
@@ -1,19 +1,134 @@
 #include "capture.h"
-#include <functional>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 #include "external/rapidjson/document.h"
+#include "external/rapidjson/prettywriter.h"
+#include "external/rapidjson/writer.h"
+#include "api/msgpack.h"
 #include "hooks/graphics/graphics.h"
 #include "util/crypt.h"
+#include "util/logging.h"
+#include "util/time.h"
+#include "util/utils.h"
 
-using namespace std::placeholders;
 using namespace rapidjson;
 
 namespace api::modules {
 
     static thread_local std::vector<uint8_t> CAPTURE_BUFFER;
 
+    /*
+     * Encoder thread continuously capturing a screen.
+     * Subscribers only ever see the most recent frame, slow clients skip frames instead of queueing them.
+     */
+    struct CaptureStream {
+        const static int frame_timeout = 100;
+        const static int trigger_timeout = 1000;
+
+        int screen;
+        int quality;
+        int divide;
+        double fps;
+
+        // latest frame
+        std::mutex frame_m;
+        std::shared_ptr<const std::vector<uint8_t>> frame;
+        uint64_t sequence = 0;
+        uint64_t timestamp = 0;
+        int width = 0;
+        int height = 0;
+
+        std::atomic<bool> running = true;
+        std::thread thread;
+
+        /*
+         * The last reference is usually dropped on the poller or a worker thread. Joining there would
+         * block them for up to a frame timeout plus an encode, so the encoder is only told to stop and
+         * frees the stream itself once it's done.
+         */
+        static std::shared_ptr<CaptureStream> create(int screen, int quality, int divide, double fps) {
+            auto stream = new CaptureStream(screen, quality, divide, fps);
+            return std::shared_ptr<CaptureStream>(stream, [] (CaptureStream *stream) {
+                stream->thread.detach();
+                stream->running = false;
+            });
+        }
+
+    private:
+
+        CaptureStream(int screen, int quality, int divide, double fps)
+            : screen(screen), quality(quality), divide(divide), fps(fps) {
+            this->thread = std::thread([this] {
+                this->run();
+                delete this;
+            });
+        }
+
+        void run() {
+            log_info("api::capture", "stream started for screen {} at {} fps", screen, fps);
+            uint64_t frame_last = 0;
+            size_t frame_size = 1024 * 128;
+            double frame_time = 1000.0 / fps;
+            double next_frame = get_performance_milliseconds();
+            double trigger_time = 0;
+            bool triggered = false;
+            while (this->running) {
+
+                // pace to the target frame rate
+                auto now = get_performance_milliseconds();
+                if (now < next_frame) {
+                    Sleep((DWORD) MIN(next_frame - now, (double) frame_timeout));
+                    continue;
+                }
+
+                // request a capture on the next present, again if it got lost
+                if (!triggered || now - trigger_time > trigger_timeout) {
+                    graphics_capture_trigger(screen);
+                    trigger_time = now;
+                    triggered = true;
+                }
+                if (!graphics_capture_wait(screen, &frame_last, frame_timeout)) {
+                    continue;
+                }
+                triggered = false;
+                next_frame += frame_time;
+                if (next_frame < now) {
+                    next_frame = now + frame_time;
+                }
+
+                // encode into a new frame sized like the last one
+                uint64_t frame_timestamp = 0;
+                int frame_width = 0;
+                int frame_height = 0;
+                auto frame_new = std::make_shared<std::vector<uint8_t>>();
+                frame_new->reserve(frame_size);
+                bool success = graphics_capture_receive_jpeg(screen, *frame_new,
+                        quality, true, divide, &frame_timestamp, &frame_width, &frame_height);
+                if (!success) {
+                    continue;
+                }
+                frame_size = frame_new->size();
+
+                // publish
+                std::lock_guard<std::mutex> lock(this->frame_m);
+                this->frame = std::move(frame_new);
+                this->timestamp = frame_timestamp;
+                this->width = frame_width;
+                this->height = frame_height;
+                this->sequence++;
+            }
+            log_info("api::capture", "stream stopped for screen {}", screen);
+        }
+    };
+
     Capture::Capture() : Module("capture") {
-        functions["get_screens"] = std::bind(&Capture::get_screens, this, _1, _2);
-        functions["get_jpg"] = std::bind(&Capture::get_jpg, this, _1, _2);
+        add_function("get_screens", &Capture::get_screens);
+        add_function("get_jpg", &Capture::get_jpg);
+        add_function("stream_start", &Capture::stream_start);
+        add_function("stream_stop", &Capture::stream_stop);
     }
 
     /**
@@ -56,9 +171,8 @@ namespace api::modules {
         int width = 0;
         int height = 0;
         graphics_capture_trigger(screen);
-        bool success = graphics_capture_receive_jpeg(screen, [] (uint8_t byte) {
-            CAPTURE_BUFFER.push_back(byte);
-        }, true, quality, true, divide, &timestamp, &width, &height);
+        bool success = graphics_capture_receive_jpeg(screen, CAPTURE_BUFFER,
+                quality, true, divide, &timestamp, &width, &height);
         if (!success) {
             return;
         }
@@ -68,9 +182,6 @@ namespace api::modules {
                 CAPTURE_BUFFER.data(),
                 CAPTURE_BUFFER.size());
 
-        // clear buffer
-        CAPTURE_BUFFER.clear();
-
         // add data to response
         Value data;
         data.SetString(encoded.c_str(), encoded.length(), res.doc()->GetAllocator());
@@ -79,4 +190,181 @@ namespace api::modules {
         res.add_data(height);
         res.add_data(data);
     }
+
+    /**
+     * stream_start([screen=0, fps=30, quality=70, divide=1])
+     * screen: uint specifying the window
+     * fps: target frame rate in range (0, 120]
+     * quality: uint in range [0, 100]
+     * divide: uint for dividing image size
+     *
+     * Pushes [screen, timestamp, width, height, jpg] whenever a new frame is encoded.
+     * The JPEG is raw binary on MessagePack connections and base64 on JSON connections.
+     */
+    void Capture::stream_start(Request &req, Response &res) {
+
+        // check client
+        if (!req.client) {
+            return error(res, "Subscriptions are not supported on this connection.");
+        }
+
+        // settings
+        int screen = 0;
+        double fps = 30;
+        int quality = 70;
+        int divide = 1;
+        if (req.params.Size() > 0 && req.params[0].IsUint())
+            screen = req.params[0].GetUint();
+        if (req.params.Size() > 1 && req.params[1].IsNumber())
+            fps = req.params[1].GetDouble();
+        if (req.params.Size() > 2 && req.params[2].IsUint())
+            quality = req.params[2].GetUint();
+        if (req.params.Size() > 3 && req.params[3].IsUint())
+            divide = req.params[3].GetUint();
+        if (fps <= 0) {
+            return error_type(res, "fps", "positive number");
+        }
+        fps = MIN(fps, 120.0);
+        quality = CLAMP(quality, 0, 100);
+        divide = MAX(divide, 1);
+
+        // check screen
+        std::vector<int> screens;
+        graphics_screens_get(screens);
+        if (std::find(screens.begin(), screens.end(), screen) == screens.end()) {
+            return error_unknown(res, "screen", std::to_string(screen));
+        }
+
+        // find or start encoder
+        std::shared_ptr<CaptureStream> stream;
+        {
+            std::lock_guard<std::mutex> lock(this->streams_m);
+            for (auto it = this->streams.begin(); it != this->streams.end();) {
+                auto existing = it->lock();
+                if (!existing) {
+                    it = this->streams.erase(it);
+                    continue;
+                }
+                if (existing->screen == screen && existing->fps == fps
+                && existing->quality == quality && existing->divide == divide) {
+                    stream = std::move(existing);
+                }
+                it++;
+            }
+            if (!stream) {
+                stream = CaptureStream::create(screen, quality, divide, fps);
+                this->streams.emplace_back(stream);
+            }
+        }
+
+        // build subscription, polled twice per frame to keep the latency low
+        Subscription subscription {};
+        subscription.module = this;
+        subscription.interval = 500.0 / fps;
+        subscription.next_push = get_performance_milliseconds();
+        subscription.channels.push_back(screen);
+        subscription.context = std::move(stream);
+
+        // replace existing subscription of the screen
+        auto &subscriptions = req.client->subscriptions;
+        for (auto &existing : subscriptions) {
+            if (existing.module == this && existing.channels[0] == (size_t) screen) {
+                existing = std::move(subscription);
+                return;
+            }
+        }
+        subscriptions.emplace_back(std::move(subscription));
+    }
+
+    /**
+     * stream_stop([screen])
+     * Without a screen, all streams of the client are stopped.
+     */
+    void Capture::stream_stop(Request &req, Response &res) {
+
+        // check client
+        if (!req.client) {
+            return;
+        }
+
+        // remove subscriptions, the encoder stops with its last subscriber
+        bool all = req.params.Size() == 0 || !req.params[0].IsUint();
+        size_t screen = all ? 0 : req.params[0].GetUint();
+        auto &subscriptions = req.client->subscriptions;
+        for (auto it = subscriptions.begin(); it != subscriptions.end();) {
+            if (it->module == this && (all || it->channels[0] == screen)) {
+                it = subscriptions.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    template<class Writer>
+    static void write_frame(Writer &writer, const std::string &name, int screen, uint64_t timestamp,
+            int width, int height, const std::string &data) {
+        writer.StartObject();
+        writer.Key("push");
+        writer.String(name.c_str(), name.size());
+        writer.Key("data");
+        writer.StartArray();
+        writer.Int(screen);
+        writer.Uint64(timestamp);
+        writer.Int(width);
+        writer.Int(height);
+        writer.String(data.c_str(), data.size());
+        writer.EndArray();
+        writer.EndObject();
+    }
+
+    bool Capture::subscription_push(Subscription &subscription, bool binary, bool pretty,
+            std::vector<char> &out) {
+        auto stream = static_cast<CaptureStream *>(subscription.context.get());
+
+        // get latest frame
+        std::shared_ptr<const std::vector<uint8_t>> frame;
+        uint64_t timestamp;
+        int width, height;
+        {
+            std::lock_guard<std::mutex> lock(stream->frame_m);
+            if (!stream->frame || stream->sequence == subscription.sequence) {
+                return false;
+            }
+            subscription.sequence = stream->sequence;
+            frame = stream->frame;
+            timestamp = stream->timestamp;
+            width = stream->width;
+            height = stream->height;
+        }
+
+        // binary frame
+        if (binary) {
+            out.push_back((char) msgpack::FRAME_MARKER);
+            msgpack::CobsStream cobs(out);
+            msgpack::Writer writer(cobs);
+            writer.StartMap(2);
+            writer.String("push", 4);
+            writer.String(this->name.c_str(), this->name.size());
+            writer.String("data", 4);
+            writer.StartArray(5);
+            writer.Uint64(stream->screen);
+            writer.Uint64(timestamp);
+            writer.Uint64(width);
+            writer.Uint64(height);
+            writer.Binary(frame->data(), frame->size());
+            return true;
+        }
+
+        // JSON frame
+        auto encoded = crypt::base64_encode(frame->data(), frame->size());
+        ResponseStream json(out);
+        if (pretty) {
+            PrettyWriter<ResponseStream> writer(json);
+            write_frame(writer, this->name, stream->screen, timestamp, width, height, encoded);
+        } else {
+            Writer<ResponseStream> writer(json);
+            write_frame(writer, this->name, stream->screen, timestamp, width, height, encoded);
+        }
+        return true;
+    }
 }
@@ -1,18 +1,34 @@
 #pragma once
 
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "api/module.h"
 #include "api/request.h"
 
 namespace api::modules {
 
+    struct CaptureStream;
+
     class Capture : public Module {
     public:
         Capture();
 
+        // subscriptions
+        bool subscription_push(Subscription &subscription, bool binary, bool pretty,
+                std::vector<char> &out) override;
+
     private:
 
+        // encoders shared by all clients with the same settings
+        std::mutex streams_m;
+        std::vector<std::weak_ptr<CaptureStream>> streams;
+
         // function definitions
         void get_screens(Request &req, Response &res);
         void get_jpg(Request &req, Response &res);
+        void stream_start(Request &req, Response &res);
+        void stream_stop(Request &req, Response &res);
     };
 }
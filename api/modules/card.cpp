@@ -1,18 +1,16 @@
 #include "card.h"
-#include <functional>
 #include "external/rapidjson/document.h"
 #include "util/logging.h"
 #include "util/utils.h"
 #include "misc/eamuse.h"
 
-using namespace std::placeholders;
 using namespace rapidjson;
 
 
 namespace api::modules {
 
     Card::Card() : Module("card") {
-        functions["insert"] = std::bind(&Card::insert, this, _1, _2);
+        add_function("insert", &Card::insert);
     }
 
     /**
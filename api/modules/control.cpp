@@ -1,7 +1,6 @@
 #include "control.h"
 
 #include <csignal>
-#include <functional>
 
 #include "external/rapidjson/document.h"
 #include "launcher/shutdown.h"
@@ -9,7 +8,6 @@
 #include "util/crypt.h"
 #include "util/utils.h"
 
-using namespace std::placeholders;
 using namespace rapidjson;
 
 namespace api::modules {
@@ -56,12 +54,12 @@ namespace api::modules {
     }
 
     Control::Control() : Module("control", true) {
-        functions["raise"] = std::bind(&Control::raise, this, _1, _2);
-        functions["exit"] = std::bind(&Control::exit, this, _1, _2);
-        functions["restart"] = std::bind(&Control::restart, this, _1, _2);
-        functions["session_refresh"] = std::bind(&Control::session_refresh, this, _1, _2);
-        functions["shutdown"] = std::bind(&Control::shutdown, this, _1, _2);
-        functions["reboot"] = std::bind(&Control::reboot, this, _1, _2);
+        add_function("raise", &Control::raise);
+        add_function("exit", &Control::exit);
+        add_function("restart", &Control::restart);
+        add_function("session_refresh", &Control::session_refresh);
+        add_function("shutdown", &Control::shutdown);
+        add_function("reboot", &Control::reboot);
     }
 
     /**
@@ -1,16 +1,14 @@
 #include "drs.h"
-#include <functional>
 #include "external/rapidjson/document.h"
 #include "games/drs/drs.h"
 
-using namespace std::placeholders;
 using namespace rapidjson;
 
 namespace api::modules {
 
     DRS::DRS() : Module("drs") {
-        functions["tapeled_get"] = std::bind(&DRS::tapeled_get, this, _1, _2);
-        functions["touch_set"] = std::bind(&DRS::touch_set, this, _1, _2);
+        add_function("tapeled_get", &DRS::tapeled_get);
+        add_function("touch_set", &DRS::touch_set);
     }
 
     /**
@@ -0,0 +1,157 @@
+#include "input.h"
+
+#include "external/rapidjson/document.h"
+#include "launcher/launcher.h"
+#include "rawinput/rawinput.h"
+
+using namespace rapidjson;
+
+
+namespace api::modules {
+
+    // maximum number of events returned per request
+    static const size_t EVENTS_MAX = 1024;
+
+    Input::Input() : Module("input") {
+        add_function("devices", &Input::devices);
+        add_function("events", &Input::events);
+        add_function("latency", &Input::latency);
+        add_function("latency_reset", &Input::latency_reset);
+    }
+
+    /**
+     * devices()
+     */
+    void Input::devices(Request &req, Response &res) {
+
+        // check manager
+        if (!RI_MGR) {
+            return;
+        }
+
+        // add all devices with a journal
+        auto &alloc = res.doc()->GetAllocator();
+        for (auto &device : RI_MGR->devices_get()) {
+            if (!device.journal) {
+                continue;
+            }
+            Value state(kArrayType);
+            state.PushBack(Value(device.name.c_str(), alloc), alloc);
+            state.PushBack(Value(device.desc.c_str(), alloc), alloc);
+            state.PushBack(Value((uint64_t) device.journal->get_count()), alloc);
+            res.add_data(state);
+        }
+    }
+
+    /**
+     * events(name: str, position: uint)
+     * returns the position to continue from, followed by [time, control, analog, old, new] for each event
+     */
+    void Input::events(Request &req, Response &res) {
+
+        // get device
+        auto device = get_device(req, res);
+        if (!device) {
+            return;
+        }
+
+        // get position
+        if (req.params.Size() < 2) {
+            return error_params_insufficient(res);
+        }
+        if (!req.params[1].IsUint64()) {
+            return error_type(res, "position", "uint");
+        }
+        uint64_t position = req.params[1].GetUint64();
+
+        // copy events
+        std::vector<rawinput::JournalEvent> events(EVENTS_MAX);
+        events.resize(device->journal->read(position, events.data(), events.size()));
+
+        // add position
+        Value next((uint64_t) position);
+        res.add_data(next);
+
+        // add events
+        auto &alloc = res.doc()->GetAllocator();
+        for (auto &event : events) {
+            Value state(kArrayType);
+            state.PushBack(Value(event.time), alloc);
+            state.PushBack(Value((uint64_t) event.control), alloc);
+            state.PushBack(Value(event.analog), alloc);
+            state.PushBack(Value((double) event.value_old), alloc);
+            state.PushBack(Value((double) event.value_new), alloc);
+            res.add_data(state);
+        }
+    }
+
+    /**
+     * latency(name: str)
+     */
+    void Input::latency(Request &req, Response &res) {
+
+        // get device
+        auto device = get_device(req, res);
+        if (!device) {
+            return;
+        }
+        auto latency = device->journal->get_latency();
+
+        // build histogram
+        auto &alloc = res.doc()->GetAllocator();
+        Value buckets(kArrayType);
+        Value limits(kArrayType);
+        for (size_t bucket = 0; bucket < rawinput::JournalLatency::BUCKETS; bucket++) {
+            buckets.PushBack(Value((uint64_t) latency.buckets[bucket]), alloc);
+            if (bucket + 1 < rawinput::JournalLatency::BUCKETS) {
+                limits.PushBack(Value(rawinput::JournalLatency::bucket_limit(bucket)), alloc);
+            }
+        }
+
+        // build info object
+        Value info(kObjectType);
+        info.AddMember("count", Value((uint64_t) latency.count), alloc);
+        info.AddMember("mean", Value(latency.count > 0 ? latency.sum / latency.count : 0.0), alloc);
+        info.AddMember("max", Value(latency.max), alloc);
+        info.AddMember("buckets", buckets, alloc);
+        info.AddMember("limits", limits, alloc);
+        res.add_data(info);
+    }
+
+    /**
+     * latency_reset(name: str)
+     */
+    void Input::latency_reset(Request &req, Response &res) {
+
+        // get device
+        auto device = get_device(req, res);
+        if (!device) {
+            return;
+        }
+
+        // reset histogram
+        device->journal->reset_latency();
+    }
+
+    rawinput::Device *Input::get_device(Request &req, Response &res) {
+
+        // check params
+        if (req.params.Size() < 1) {
+            error_params_insufficient(res);
+            return nullptr;
+        }
+        if (!req.params[0].IsString()) {
+            error_type(res, "name", "str");
+            return nullptr;
+        }
+        std::string name = req.params[0].GetString();
+
+        // find device
+        auto device = RI_MGR ? RI_MGR->devices_get(name) : nullptr;
+        if (!device || !device->journal) {
+            error_unknown(res, "device", name);
+            return nullptr;
+        }
+        return device;
+    }
+}
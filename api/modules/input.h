@@ -0,0 +1,24 @@
+#pragma once
+
+#include "api/module.h"
+#include "api/request.h"
+#include "rawinput/device.h"
+
+namespace api::modules {
+
+    class Input : public Module {
+    public:
+        Input();
+
+    private:
+
+        // function definitions
+        void devices(Request &req, Response &res);
+        void events(Request &req, Response &res);
+        void latency(Request &req, Response &res);
+        void latency_reset(Request &req, Response &res);
+
+        // helper
+        rawinput::Device *get_device(Request &req, Response &res);
+    };
+}
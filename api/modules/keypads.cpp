@@ -1,6 +1,5 @@
 #include "keypads.h"
 
-#include <functional>
 
 #include <windows.h>
 
@@ -8,7 +7,6 @@
 #include "external/rapidjson/document.h"
 #include "misc/eamuse.h"
 
-using namespace std::placeholders;
 using namespace rapidjson;
 
 namespace api::modules {
@@ -34,9 +32,9 @@ namespace api::modules {
     };
 
     Keypads::Keypads() : Module("keypads") {
-        functions["write"] = std::bind(&Keypads::write, this, _1, _2);
-        functions["set"] = std::bind(&Keypads::set, this, _1, _2);
-        functions["get"] = std::bind(&Keypads::get, this, _1, _2);
+        add_function("write", &Keypads::write);
+        add_function("set", &Keypads::set);
+        add_function("get", &Keypads::get);
     }
 
     /**
@@ -2,13 +2,12 @@
 #include "external/rapidjson/document.h"
 #include "games/shared/lcdhandle.h"
 
-using namespace std::placeholders;
 using namespace rapidjson;
 
 namespace api::modules {
 
     LCD::LCD() : Module("lcd") {
-        functions["info"] = std::bind(&LCD::info, this, _1, _2);
+        add_function("info", &LCD::info);
     }
 
     /*
@@ -1,5 +1,4 @@
 #include "lights.h"
-#include <functional>
 #include "external/rapidjson/document.h"
 #include "misc/eamuse.h"
 #include "cfg/light.h"
@@ -7,16 +6,17 @@
 #include "games/io.h"
 #include "util/utils.h"
 
-using namespace std::placeholders;
 using namespace rapidjson;
 
 
 namespace api::modules {
 
     Lights::Lights() : Module("lights") {
-        functions["read"] = std::bind(&Lights::read, this, _1, _2);
-        functions["write"] = std::bind(&Lights::write, this, _1, _2);
-        functions["write_reset"] = std::bind(&Lights::write_reset, this, _1, _2);
+        add_function("read", &Lights::read);
+        add_function("write", &Lights::write);
+        add_function("write_reset", &Lights::write_reset);
+        add_function("subscribe", &Lights::subscribe);
+        add_function("unsubscribe", &Lights::unsubscribe);
         lights = games::get_lights(eamuse_get_game());
     }
 
@@ -176,4 +176,16 @@ namespace api::modules {
         // unknown light
         return false;
     }
+
+    size_t Lights::subscription_size() {
+        return this->lights ? this->lights->size() : 0;
+    }
+
+    std::string Lights::subscription_name(size_t index) {
+        return (*this->lights)[index].getName();
+    }
+
+    float Lights::subscription_state(size_t index) {
+        return GameAPI::Lights::readLight(RI_MGR, (*this->lights)[index]);
+    }
 }
@@ -1,16 +1,24 @@
 #include "memory.h"
 
-#include <functional>
-#include <mutex>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <numeric>
 
 #include "external/rapidjson/document.h"
+#include "external/rapidjson/prettywriter.h"
+#include "external/rapidjson/writer.h"
+#include "api/msgpack.h"
+#include "util/crypt.h"
 #include "util/fileutils.h"
 #include "util/libutils.h"
+#include "util/logging.h"
 #include "util/memutils.h"
 #include "util/sigscan.h"
+#include "util/time.h"
 #include "util/utils.h"
 
-using namespace std::placeholders;
 using namespace rapidjson;
 
 
@@ -19,10 +27,199 @@ namespace api::modules {
     // global lock to prevent simultaneous access to memory
     static std::mutex MEMORY_LOCK;
 
+    // unchanged bytes needed to split a diff into two runs
+    static const size_t WATCH_DIFF_GAP = 8;
+
+    struct MemoryRegion {
+        uint8_t *address;
+        size_t size;
+
+        // offset in the combined data of all regions
+        size_t position;
+    };
+
+    struct MemoryModule {
+        std::string name;
+        std::filesystem::path path;
+        MODULEINFO info;
+    };
+
+    /*
+     * Set of regions watched by a client.
+     * The sampler thread copies all regions into the snapshot at the watch rate, pushes send the byte
+     * ranges which differ from the contents the client has seen last.
+     */
+    struct MemoryWatch {
+        uint64_t id;
+        double interval;
+        std::vector<MemoryRegion> regions;
+
+        // sampler thread only
+        double next_sample = 0;
+
+        // latest snapshot
+        std::mutex snapshot_m;
+        std::vector<uint8_t> snapshot;
+        uint64_t sequence = 0;
+
+        // contents known to the client, only used by its connection
+        std::vector<uint8_t> sent;
+    };
+
+    struct MemoryChange {
+        size_t region;
+        size_t offset;
+        size_t size;
+    };
+
     Memory::Memory() : Module("memory", true) {
-        functions["write"] = std::bind(&Memory::write, this, _1, _2);
-        functions["read"] = std::bind(&Memory::read, this, _1, _2);
-        functions["signature"] = std::bind(&Memory::signature, this, _1, _2);
+        add_function("write", &Memory::write);
+        add_function("read", &Memory::read);
+        add_function("signature", &Memory::signature);
+        add_function("read_many", &Memory::read_many);
+        add_function("write_many", &Memory::write_many);
+        add_function("watch", &Memory::watch);
+        add_function("unwatch", &Memory::unwatch);
+    }
+
+    Memory::~Memory() {
+        {
+            std::lock_guard<std::mutex> lock(this->watches_m);
+            this->sampler_stop = true;
+        }
+        this->watches_cv.notify_all();
+        if (this->sampler.joinable()) {
+            this->sampler.join();
+        }
+    }
+
+    // looks up a loaded module, returns an error message on failure
+    static std::string module_find(const char *dll_name, MemoryModule &module) {
+        module.name = dll_name;
+        module.path = MODULE_PATH / dll_name;
+
+        // check if file exists in modules
+        if (!fileutils::file_exists(module.path)) {
+            return "Couldn't find " + module.path.string();
+        }
+
+        // get module
+        auto handle = libutils::try_module(dll_name);
+        if (!handle) {
+            return "Couldn't find module.";
+        }
+
+        // get module information
+        module.info = {};
+        if (!GetModuleInformation(GetCurrentProcess(), handle, &module.info, sizeof(MODULEINFO))) {
+            return "Couldn't get module information.";
+        }
+        return "";
+    }
+
+    // converts a file offset to an address in the module, returns an error message on failure
+    static std::string module_address(const MemoryModule &module, intptr_t offset, size_t size,
+            uint8_t *&address) {
+
+        // convert offset to RVA
+        offset = libutils::offset2rva(module.path, offset);
+        if (offset == ~0) {
+            return "Couldn't convert offset to RVA.";
+        }
+
+        // check bounds
+        if ((size_t) offset + size > module.info.SizeOfImage) {
+            return "Data out of bounds.";
+        }
+        address = reinterpret_cast<uint8_t *>(module.info.lpBaseOfDll) + offset;
+        return "";
+    }
+
+    uint8_t *Memory::resolve(Response &res, const char *dll_name, intptr_t offset, size_t size) {
+        MemoryModule module;
+        uint8_t *address = nullptr;
+        auto err = module_find(dll_name, module);
+        if (err.empty()) {
+            err = module_address(module, offset, size, address);
+        }
+        if (!err.empty()) {
+            error(res, err);
+            return nullptr;
+        }
+        return address;
+    }
+
+    bool Memory::resolve_regions(Response &res, const Value *begin, const Value *end,
+            size_t size_max, std::vector<MemoryRegion> &regions) {
+
+        // check count
+        if (begin == end) {
+            error_params_insufficient(res);
+            return false;
+        }
+        if ((size_t) (end - begin) > regions_max) {
+            error(res, "Too many regions.");
+            return false;
+        }
+
+        // modules are only looked up once per request
+        std::vector<MemoryModule> modules;
+        size_t size_total = 0;
+        for (auto region = begin; region != end; region++) {
+
+            // check region
+            if (!region->IsArray() || region->Size() < 3) {
+                error_type(res, "region", "[dll_name, offset, size]");
+                return false;
+            }
+            auto &dll_name = (*region)[0];
+            auto &offset = (*region)[1];
+            auto &size = (*region)[2];
+            if (!dll_name.IsString()) {
+                error_type(res, "dll_name", "str");
+                return false;
+            }
+            if (!offset.IsUint()) {
+                error_type(res, "offset", "uint");
+                return false;
+            }
+            if (!size.IsUint() || size.GetUint() == 0) {
+                error_type(res, "size", "positive uint");
+                return false;
+            }
+            size_total += size.GetUint();
+            if (size_total > size_max) {
+                error(res, "Data too large.");
+                return false;
+            }
+
+            // get module
+            auto module = std::find_if(modules.begin(), modules.end(), [&dll_name] (const MemoryModule &existing) {
+                return existing.name == dll_name.GetString();
+            });
+            if (module == modules.end()) {
+                auto err = module_find(dll_name.GetString(), modules.emplace_back());
+                if (!err.empty()) {
+                    error(res, err);
+                    return false;
+                }
+                module = modules.end() - 1;
+            }
+
+            // get address
+            uint8_t *address = nullptr;
+            auto err = module_address(*module, offset.GetUint(), size.GetUint(), address);
+            if (!err.empty()) {
+                error(res, err);
+                return false;
+            }
+            regions.push_back(MemoryRegion {
+                .address = address,
+                .size = size.GetUint(),
+                .position = size_total - size.GetUint(),
+            });
+        }
+        return true;
     }
 
     /**
@@ -47,7 +244,6 @@ namespace api::modules {
 
         // get params
         auto dll_name = req.params[0].GetString();
-        auto dll_path = MODULE_PATH / dll_name;
         auto data = req.params[1].GetString();
         intptr_t offset = req.params[2].GetUint();
 
@@ -56,35 +252,12 @@ namespace api::modules {
         auto data_bin = std::make_unique<uint8_t[]>(data_bin_size);
         hex2bin(data, data_bin.get());
 
-        // check if file exists in modules
-        if (!fileutils::file_exists(dll_path)) {
-            return error(res, "Couldn't find " + dll_path.string());
-        }
-
-        // get module
-        auto module = libutils::try_module(dll_name);
-        if (!module) {
-            return error(res, "Couldn't find module.");
-        }
-
-        // convert offset to RVA
-        offset = libutils::offset2rva(dll_path, offset);
-        if (offset == ~0) {
-            return error(res, "Couldn't convert offset to RVA.");
+        // get target
+        auto data_pos = resolve(res, dll_name, offset, data_bin_size);
+        if (!data_pos) {
+            return;
         }
 
-        // get module information
-        MODULEINFO module_info {};
-        if (!GetModuleInformation(GetCurrentProcess(), module, &module_info, sizeof(MODULEINFO))) {
-            return error(res, "Couldn't get module information.");
-        }
-
-        // check bounds
-        if (offset + data_bin_size >= (size_t) module_info.lpBaseOfDll + module_info.SizeOfImage) {
-            return error(res, "Data out of bounds.");
-        }
-        auto data_pos = reinterpret_cast<uint8_t *>(module_info.lpBaseOfDll) + offset;
-
         // replace data
         memutils::VProtectGuard guard(data_pos, data_bin_size);
         memcpy(data_pos, data_bin.get(), data_bin_size);
@@ -112,41 +285,17 @@ namespace api::modules {
 
         // get params
         auto dll_name = req.params[0].GetString();
-        auto dll_path = MODULE_PATH / dll_name;
         intptr_t offset = req.params[1].GetUint();
         auto size = req.params[2].GetUint();
 
-        // check if file exists in modules
-        if (!fileutils::file_exists(dll_path)) {
-            return error(res, "Couldn't find " + dll_path.string());
-        }
-
-        // get module
-        auto module = libutils::try_module(dll_name);
-        if (!module) {
-            return error(res, "Couldn't find module.");
-        }
-
-        // convert offset to RVA
-        offset = libutils::offset2rva(dll_path, offset);
-        if (offset == ~0) {
-            return error(res, "Couldn't convert offset to RVA.");
-        }
-
-        // get module information
-        MODULEINFO module_info {};
-        if (!GetModuleInformation(GetCurrentProcess(), module, &module_info, sizeof(MODULEINFO))) {
-            return error(res, "Couldn't get module information.");
-        }
-
-        // check bounds
-        auto max = offset + size;
-        if ((size_t) max >= (size_t) module_info.lpBaseOfDll + module_info.SizeOfImage) {
-            return error(res, "Data out of bounds.");
+        // get source
+        auto data_pos = resolve(res, dll_name, offset, size);
+        if (!data_pos) {
+            return;
         }
 
         // read memory to hex (without virtual protect)
-        std::string hex = bin2hex((uint8_t*) module_info.lpBaseOfDll + offset, size);
+        std::string hex = bin2hex(data_pos, size);
         Value hex_val(hex.c_str(), res.doc()->GetAllocator());
         res.add_data(hex_val);
     }
@@ -230,4 +379,381 @@ namespace api::modules {
         Value result_val(result);
         res.add_data(result_val);
     }
+
+    /**
+     * read_many([dll_name: str, offset: uint, size: uint], ...)
+     *
+     * Reads all regions and returns their bytes concatenated in a single value.
+     * The data is raw binary on MessagePack connections and base64 on JSON connections.
+     */
+    void Memory::read_many(Request &req, Response &res) {
+        std::lock_guard<std::mutex> lock(MEMORY_LOCK);
+
+        // get sources
+        std::vector<MemoryRegion> regions;
+        if (!resolve_regions(res, req.params.Begin(), req.params.End(), many_size_max, regions)) {
+            return;
+        }
+
+        // read memory (without virtual protect)
+        auto &last = regions.back();
+        std::vector<uint8_t> data(last.position + last.size);
+        for (auto &region : regions) {
+            memcpy(&data[region.position], region.address, region.size);
+        }
+        res.add_data_binary(data.data(), data.size());
+    }
+
+    /**
+     * write_many(data: bin, [dll_name: str, offset: uint, size: uint], ...)
+     *
+     * Writes consecutive parts of data to all regions, the sizes have to add up to the data size.
+     * The data is raw binary on MessagePack connections and base64 on JSON connections.
+     * Regions sharing memory pages are unprotected together.
+     */
+    void Memory::write_many(Request &req, Response &res) {
+        std::lock_guard<std::mutex> lock(MEMORY_LOCK);
+
+        // check params
+        if (req.params.Size() < 2) {
+            return error_params_insufficient(res);
+        }
+        if (!req.params[0].IsString()) {
+            return error_type(res, "data", req.client && req.client->binary ? "bin" : "base64 string");
+        }
+
+        // get data
+        auto &data_val = req.params[0];
+        const uint8_t *data;
+        size_t data_size;
+        std::vector<uint8_t> data_decoded;
+        if (req.client && req.client->binary) {
+            data = reinterpret_cast<const uint8_t *>(data_val.GetString());
+            data_size = data_val.GetStringLength();
+        } else {
+            if (!crypt::base64_decode(data_val.GetString(), data_val.GetStringLength(), data_decoded)) {
+                return error_type(res, "data", "base64 string");
+            }
+            data = data_decoded.data();
+            data_size = data_decoded.size();
+        }
+
+        // get targets
+        std::vector<MemoryRegion> regions;
+        if (!resolve_regions(res, req.params.Begin() + 1, req.params.End(), many_size_max, regions)) {
+            return;
+        }
+        auto &last = regions.back();
+        if (last.position + last.size != data_size) {
+            return error_size(res, "data", last.position + last.size);
+        }
+
+        // sort by address to find regions sharing pages
+        static const size_t page_size = [] {
+            SYSTEM_INFO system_info {};
+            GetSystemInfo(&system_info);
+            return (size_t) system_info.dwPageSize;
+        }();
+        std::vector<size_t> order(regions.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&regions] (size_t a, size_t b) {
+            return regions[a].address < regions[b].address;
+        });
+        auto page_start = [] (uintptr_t address) {
+            return address & ~(page_size - 1);
+        };
+        auto page_end = [] (uintptr_t address) {
+            return (address + page_size - 1) & ~(page_size - 1);
+        };
+
+        // write each range of adjacent pages
+        for (size_t i = 0; i < order.size();) {
+            auto start = page_start((uintptr_t) regions[order[i]].address);
+            auto end = page_end((uintptr_t) regions[order[i]].address + regions[order[i]].size);
+            size_t j = i + 1;
+            while (j < order.size() && page_start((uintptr_t) regions[order[j]].address) <= end) {
+                end = MAX(end, page_end((uintptr_t) regions[order[j]].address + regions[order[j]].size));
+                j++;
+            }
+
+            // one guard per part with uniform protection, so the original protection is restored correctly
+            std::deque<memutils::VProtectGuard> guards;
+            for (auto part = start; part < end;) {
+                MEMORY_BASIC_INFORMATION info {};
+                if (!VirtualQuery(reinterpret_cast<void *>(part), &info, sizeof(info))) {
+                    return error(res, "Couldn't query memory.");
+                }
+                auto part_end = MIN(end, (uintptr_t) info.BaseAddress + info.RegionSize);
+                guards.emplace_back(reinterpret_cast<void *>(part), part_end - part);
+                part = part_end;
+            }
+
+            // replace data
+            for (; i < j; i++) {
+                auto &region = regions[order[i]];
+                memcpy(region.address, &data[region.position], region.size);
+            }
+        }
+    }
+
+    /**
+     * watch(rate: float, [dll_name: str, offset: uint, size: uint], ...)
+     * rate: samples per second in range (0, 1000]
+     *
+     * Samples all regions at the given rate and pushes [id, sequence, [[region, offset, data], ...]]
+     * containing only the bytes which changed since the last push. The first push contains all regions.
+     * The data is raw binary on MessagePack connections and hex on JSON connections.
+     * The resulting integer is the watch id.
+     */
+    void Memory::watch(Request &req, Response &res) {
+
+        // check client
+        if (!req.client) {
+            return error(res, "Subscriptions are not supported on this connection.");
+        }
+
+        // check params
+        if (req.params.Size() < 2) {
+            return error_params_insufficient(res);
+        }
+        if (!req.params[0].IsNumber() || req.params[0].GetDouble() <= 0) {
+            return error_type(res, "rate", "positive number");
+        }
+        auto rate = MIN(req.params[0].GetDouble(), 1000.0);
+
+        // resolve regions
+        auto watch = std::make_shared<MemoryWatch>();
+        watch->interval = 1000.0 / rate;
+        {
+            std::lock_guard<std::mutex> lock(MEMORY_LOCK);
+            if (!resolve_regions(res, req.params.Begin() + 1, req.params.End(), watch_size_max, watch->regions)) {
+                return;
+            }
+        }
+        auto &last = watch->regions.back();
+        watch->snapshot.resize(last.position + last.size);
+
+        // register for sampling
+        {
+            std::lock_guard<std::mutex> lock(this->watches_m);
+            watch->id = this->watch_id_next++;
+            watch->next_sample = get_performance_milliseconds();
+            this->watches.emplace_back(watch);
+            if (!this->sampler.joinable()) {
+                this->sampler = std::thread([this] {
+                    this->sampler_run();
+                });
+            }
+        }
+        this->watches_cv.notify_one();
+        auto id = watch->id;
+
+        // build subscription, polled twice per sample to keep the latency low
+        Subscription subscription {};
+        subscription.module = this;
+        subscription.interval = watch->interval / 2;
+        subscription.next_push = get_performance_milliseconds();
+        subscription.channels.push_back(id);
+        subscription.context = std::move(watch);
+        req.client->subscriptions.emplace_back(std::move(subscription));
+
+        // add result
+        Value id_val((uint64_t) id);
+        res.add_data(id_val);
+    }
+
+    /**
+     * unwatch([id: uint])
+     * Without an id, all watches of the client are removed.
+     */
+    void Memory::unwatch(Request &req, Response &res) {
+
+        // check client
+        if (!req.client) {
+            return;
+        }
+
+        // remove subscriptions, the sampler drops watches without subscribers
+        bool all = req.params.Size() == 0 || !req.params[0].IsUint64();
+        size_t id = all ? 0 : (size_t) req.params[0].GetUint64();
+        auto &subscriptions = req.client->subscriptions;
+        for (auto it = subscriptions.begin(); it != subscriptions.end();) {
+            if (it->module == this && (all || it->channels[0] == id)) {
+                it = subscriptions.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    void Memory::sampler_run() {
+        log_info("api::memory", "watch sampler started");
+        std::vector<std::shared_ptr<MemoryWatch>> due;
+        std::unique_lock<std::mutex> lock(this->watches_m);
+        while (!this->sampler_stop) {
+
+            // collect due watches and drop the ones without subscribers
+            auto now = get_performance_milliseconds();
+            double next_sample = now + 1000.0;
+            for (auto it = this->watches.begin(); it != this->watches.end();) {
+                auto watch = it->lock();
+                if (!watch) {
+                    it = this->watches.erase(it);
+                    continue;
+                }
+                if (watch->next_sample <= now) {
+                    watch->next_sample = MAX(watch->next_sample + watch->interval, now);
+                    due.emplace_back(watch);
+                }
+                next_sample = MIN(next_sample, watch->next_sample);
+                it++;
+            }
+
+            // take snapshots without blocking new watches
+            if (!due.empty()) {
+                lock.unlock();
+                for (auto &watch : due) {
+                    std::lock_guard<std::mutex> snapshot_lock(watch->snapshot_m);
+                    for (auto &region : watch->regions) {
+                        memcpy(&watch->snapshot[region.position], region.address, region.size);
+                    }
+                    watch->sequence++;
+                }
+                due.clear();
+                lock.lock();
+                continue;
+            }
+
+            // sleep until the next sample is due
+            auto timeout = MAX(next_sample - get_performance_milliseconds(), 0.0);
+            this->watches_cv.wait_for(lock, std::chrono::duration<double, std::milli>(timeout));
+        }
+    }
+
+    template<class Writer>
+    static void write_diff(Writer &writer, const std::string &name, uint64_t id, uint64_t sequence,
+            const std::vector<MemoryChange> &changes, const std::vector<std::string> &data) {
+        writer.StartObject();
+        writer.Key("push");
+        writer.String(name.c_str(), name.size());
+        writer.Key("data");
+        writer.StartArray();
+        writer.Uint64(id);
+        writer.Uint64(sequence);
+        writer.StartArray();
+        for (size_t i = 0; i < changes.size(); i++) {
+            writer.StartArray();
+            writer.Uint64(changes[i].region);
+            writer.Uint64(changes[i].offset);
+            writer.String(data[i].c_str(), data[i].size());
+            writer.EndArray();
+        }
+        writer.EndArray();
+        writer.EndArray();
+        writer.EndObject();
+    }
+
+    bool Memory::subscription_push(Subscription &subscription, bool binary, bool pretty,
+            std::vector<char> &out) {
+        auto watch = static_cast<MemoryWatch *>(subscription.context.get());
+        std::lock_guard<std::mutex> lock(watch->snapshot_m);
+
+        // check for new snapshot
+        if (watch->sequence == 0 || watch->sequence == subscription.sequence) {
+            return false;
+        }
+        subscription.sequence = watch->sequence;
+
+        // find changed runs, the first push sends everything
+        std::vector<MemoryChange> changes;
+        if (watch->sent.empty()) {
+            for (size_t i = 0; i < watch->regions.size(); i++) {
+                changes.push_back(MemoryChange {
+                    .region = i,
+                    .offset = 0,
+                    .size = watch->regions[i].size,
+                });
+            }
+            watch->sent = watch->snapshot;
+        } else {
+            for (size_t i = 0; i < watch->regions.size(); i++) {
+                auto &region = watch->regions[i];
+                auto cur = &watch->snapshot[region.position];
+                auto old = &watch->sent[region.position];
+                size_t pos = 0;
+                while (pos < region.size) {
+
+                    // skip unchanged blocks
+                    auto block = MIN(region.size - pos, (size_t) 64);
+                    if (memcmp(cur + pos, old + pos, block) == 0) {
+                        pos += block;
+                        continue;
+                    }
+                    while (cur[pos] == old[pos]) {
+                        pos++;
+                    }
+
+                    // extend run until enough bytes are unchanged
+                    size_t start = pos;
+                    size_t end = pos + 1;
+                    for (pos = end; pos < region.size && pos - end < WATCH_DIFF_GAP; pos++) {
+                        if (cur[pos] != old[pos]) {
+                            end = pos + 1;
+                        }
+                    }
+                    changes.push_back(MemoryChange {
+                        .region = i,
+                        .offset = start,
+                        .size = end - start,
+                    });
+                    memcpy(old + start, cur + start, end - start);
+                }
+            }
+        }
+
+        // nothing the client doesn't know yet
+        if (changes.empty()) {
+            return false;
+        }
+
+        // binary frame
+        if (binary) {
+            out.push_back((char) msgpack::FRAME_MARKER);
+            msgpack::CobsStream cobs(out);
+            msgpack::Writer writer(cobs);
+            writer.StartMap(2);
+            writer.String("push", 4);
+            writer.String(this->name.c_str(), this->name.size());
+            writer.String("data", 4);
+            writer.StartArray(3);
+            writer.Uint64(watch->id);
+            writer.Uint64(watch->sequence);
+            writer.StartArray(changes.size());
+            for (auto &change : changes) {
+                writer.StartArray(3);
+                writer.Uint64(change.region);
+                writer.Uint64(change.offset);
+                writer.Binary(&watch->snapshot[watch->regions[change.region].position + change.offset],
+                        change.size);
+            }
+            return true;
+        }
+
+        // JSON frame
+        std::vector<std::string> data;
+        data.reserve(changes.size());
+        for (auto &change : changes) {
+            data.emplace_back(bin2hex(&watch->snapshot[watch->regions[change.region].position + change.offset],
+                    change.size));
+        }
+        ResponseStream json(out);
+        if (pretty) {
+            PrettyWriter<ResponseStream> writer(json);
+            write_diff(writer, this->name, watch->id, watch->sequence, changes, data);
+        } else {
+            Writer<ResponseStream> writer(json);
+            write_diff(writer, this->name, watch->id, watch->sequence, changes, data);
+        }
+        return true;
+    }
 }
@@ -1,19 +1,57 @@
 #pragma once
 
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "api/module.h"
 #include "api/request.h"
 
 namespace api::modules {
 
+    struct MemoryWatch;
+    struct MemoryRegion;
+
     class Memory : public Module {
     public:
         Memory();
+        ~Memory() override;
+
+        // subscriptions
+        bool subscription_push(Subscription &subscription, bool binary, bool pretty,
+                std::vector<char> &out) override;
 
     private:
+        const static size_t regions_max = 256;
+        const static size_t many_size_max = 16 * 1024 * 1024;
+        const static size_t watch_size_max = 1024 * 1024;
+
+        // watches of all clients, snapshotted by a single sampler thread
+        std::mutex watches_m;
+        std::condition_variable watches_cv;
+        std::vector<std::weak_ptr<MemoryWatch>> watches;
+        std::thread sampler;
+        bool sampler_stop = false;
+        uint64_t watch_id_next = 1;
+
+        void sampler_run();
+
+        // resolves a region of a loaded module, sets an error and returns nullptr on failure
+        uint8_t *resolve(Response &res, const char *dll_name, intptr_t offset, size_t size);
+
+        // resolves [dll_name, offset, size] regions, sets an error and returns false on failure
+        bool resolve_regions(Response &res, const rapidjson::Value *begin, const rapidjson::Value *end,
+                size_t size_max, std::vector<MemoryRegion> &regions);
 
         // function definitions
         void write(Request &req, Response &res);
         void read(Request &req, Response &res);
         void signature(Request &req, Response &res);
+        void read_many(Request &req, Response &res);
+        void write_many(Request &req, Response &res);
+        void watch(Request &req, Response &res);
+        void unwatch(Request &req, Response &res);
     };
 }
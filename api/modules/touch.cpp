@@ -1,6 +1,5 @@
 #include "touch.h"
 
-#include <functional>
 
 #include "external/rapidjson/document.h"
 #include "avs/game.h"
@@ -9,16 +8,15 @@
 #include "touch/touch.h"
 #include "util/utils.h"
 
-using namespace std::placeholders;
 using namespace rapidjson;
 
 
 namespace api::modules {
 
     Touch::Touch() : Module("touch") {
-        functions["read"] = std::bind(&Touch::read, this, _1, _2);
-        functions["write"] = std::bind(&Touch::write, this, _1, _2);
-        functions["write_reset"] = std::bind(&Touch::write_reset, this, _1, _2);
+        add_function("read", &Touch::read);
+        add_function("write", &Touch::write);
+        add_function("write_reset", &Touch::write_reset);
     }
 
     /**
@@ -0,0 +1,390 @@
+#include "msgpack.h"
+
+#include <cstring>
+
+namespace api::msgpack {
+
+    CobsStream::CobsStream(std::vector<char> &out) : out(out) {
+        code_pos = out.size();
+        out.push_back(0);
+    }
+
+    CobsStream::~CobsStream() {
+        out[code_pos] = (char) code;
+    }
+
+    void CobsStream::Put(uint8_t c) {
+
+        // zeros end the current block
+        if (c == 0) {
+            out[code_pos] = (char) code;
+            code_pos = out.size();
+            out.push_back(0);
+            code = 1;
+            return;
+        }
+
+        // append data, blocks are limited to 254 bytes
+        out.push_back((char) c);
+        if (++code == 0xFF) {
+            out[code_pos] = (char) code;
+            code_pos = out.size();
+            out.push_back(0);
+            code = 1;
+        }
+    }
+
+    void CobsStream::Put(const void *data, size_t size) {
+        auto bytes = reinterpret_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++) {
+            Put(bytes[i]);
+        }
+    }
+
+    void Writer::write_be(uint8_t type, uint64_t value, size_t size) {
+        stream.Put(type);
+        for (size_t i = size; i > 0; i--) {
+            stream.Put((uint8_t) (value >> ((i - 1) * 8)));
+        }
+    }
+
+    void Writer::Nil() {
+        stream.Put(0xC0);
+    }
+
+    void Writer::Bool(bool value) {
+        stream.Put(value ? 0xC3 : 0xC2);
+    }
+
+    void Writer::Int64(int64_t value) {
+        if (value >= 0) {
+            Uint64((uint64_t) value);
+        } else if (value >= -32) {
+            stream.Put((uint8_t) value);
+        } else if (value >= INT8_MIN) {
+            write_be(0xD0, (uint8_t) value, 1);
+        } else if (value >= INT16_MIN) {
+            write_be(0xD1, (uint16_t) value, 2);
+        } else if (value >= INT32_MIN) {
+            write_be(0xD2, (uint32_t) value, 4);
+        } else {
+            write_be(0xD3, (uint64_t) value, 8);
+        }
+    }
+
+    void Writer::Uint64(uint64_t value) {
+        if (value < 0x80) {
+            stream.Put((uint8_t) value);
+        } else if (value <= UINT8_MAX) {
+            write_be(0xCC, value, 1);
+        } else if (value <= UINT16_MAX) {
+            write_be(0xCD, value, 2);
+        } else if (value <= UINT32_MAX) {
+            write_be(0xCE, value, 4);
+        } else {
+            write_be(0xCF, value, 8);
+        }
+    }
+
+    void Writer::Double(double value) {
+
+        // most states are floats anyway, so use the short form when it's lossless
+        auto value_float = (float) value;
+        if ((double) value_float == value) {
+            uint32_t bits;
+            memcpy(&bits, &value_float, sizeof(bits));
+            write_be(0xCA, bits, 4);
+        } else {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            write_be(0xCB, bits, 8);
+        }
+    }
+
+    void Writer::String(const char *str, size_t length) {
+        if (length < 32) {
+            stream.Put((uint8_t) (0xA0 | length));
+        } else if (length <= UINT8_MAX) {
+            write_be(0xD9, length, 1);
+        } else if (length <= UINT16_MAX) {
+            write_be(0xDA, length, 2);
+        } else {
+            write_be(0xDB, length, 4);
+        }
+        stream.Put(str, length);
+    }
+
+    void Writer::Binary(const void *data, size_t size) {
+        if (size <= UINT8_MAX) {
+            write_be(0xC4, size, 1);
+        } else if (size <= UINT16_MAX) {
+            write_be(0xC5, size, 2);
+        } else {
+            write_be(0xC6, size, 4);
+        }
+        stream.Put(data, size);
+    }
+
+    void Writer::StartArray(size_t size) {
+        if (size < 16) {
+            stream.Put((uint8_t) (0x90 | size));
+        } else if (size <= UINT16_MAX) {
+            write_be(0xDC, size, 2);
+        } else {
+            write_be(0xDD, size, 4);
+        }
+    }
+
+    void Writer::StartMap(size_t size) {
+        if (size < 16) {
+            stream.Put((uint8_t) (0x80 | size));
+        } else if (size <= UINT16_MAX) {
+            write_be(0xDE, size, 2);
+        } else {
+            write_be(0xDF, size, 4);
+        }
+    }
+
+    void Writer::Value(const rapidjson::Value &value) {
+        switch (value.GetType()) {
+            case rapidjson::kNullType:
+                Nil();
+                break;
+            case rapidjson::kFalseType:
+            case rapidjson::kTrueType:
+                Bool(value.GetBool());
+                break;
+            case rapidjson::kObjectType:
+                StartMap(value.MemberCount());
+                for (auto &member : value.GetObject()) {
+                    String(member.name.GetString(), member.name.GetStringLength());
+                    Value(member.value);
+                }
+                break;
+            case rapidjson::kArrayType:
+                StartArray(value.Size());
+                for (auto &element : value.GetArray()) {
+                    Value(element);
+                }
+                break;
+            case rapidjson::kStringType:
+                String(value.GetString(), value.GetStringLength());
+                break;
+            case rapidjson::kNumberType:
+                if (value.IsUint64()) {
+                    Uint64(value.GetUint64());
+                } else if (value.IsInt64()) {
+                    Int64(value.GetInt64());
+                } else {
+                    Double(value.GetDouble());
+                }
+                break;
+        }
+    }
+
+    size_t cobs_decode(uint8_t *data, size_t size) {
+        size_t read = 0;
+        size_t write = 0;
+        while (read < size) {
+
+            // block header
+            auto code = data[read++];
+            if (code == 0) {
+                return SIZE_MAX;
+            }
+
+            // block data
+            size_t length = code - 1u;
+            if (read + length > size) {
+                return SIZE_MAX;
+            }
+            memmove(&data[write], &data[read], length);
+            write += length;
+            read += length;
+
+            // implicit zero unless the block was full or this is the end
+            if (code != 0xFF && read < size) {
+                data[write++] = 0;
+            }
+        }
+        return write;
+    }
+
+    namespace {
+
+        /*
+         * SAX style generator for rapidjson::Document::Populate
+         */
+        class Parser {
+        public:
+            Parser(const uint8_t *data, size_t size) : cur(data), end(data + size) {}
+
+            bool success = false;
+
+            bool operator()(rapidjson::Document &handler) {
+                success = value(handler, 0) && cur == end;
+                return success;
+            }
+
+        private:
+            static const int depth_max = 32;
+
+            const uint8_t *cur;
+            const uint8_t *end;
+
+            bool read_be(size_t size, uint64_t &out) {
+                if ((size_t) (end - cur) < size) {
+                    return false;
+                }
+                out = 0;
+                for (size_t i = 0; i < size; i++) {
+                    out = (out << 8) | *cur++;
+                }
+                return true;
+            }
+
+            bool string(rapidjson::Document &handler, size_t length, bool key) {
+                if ((size_t) (end - cur) < length) {
+                    return false;
+                }
+                auto str = reinterpret_cast<const char *>(cur);
+                cur += length;
+                if (key) {
+                    return handler.Key(str, (rapidjson::SizeType) length, true);
+                }
+                return handler.String(str, (rapidjson::SizeType) length, true);
+            }
+
+            bool array(rapidjson::Document &handler, size_t size, int depth) {
+                if (!handler.StartArray()) {
+                    return false;
+                }
+                for (size_t i = 0; i < size; i++) {
+                    if (!value(handler, depth + 1)) {
+                        return false;
+                    }
+                }
+                return handler.EndArray((rapidjson::SizeType) size);
+            }
+
+            bool map(rapidjson::Document &handler, size_t size, int depth) {
+                if (!handler.StartObject()) {
+                    return false;
+                }
+                for (size_t i = 0; i < size; i++) {
+
+                    // keys must be strings
+                    uint64_t length;
+                    if (cur >= end) {
+                        return false;
+                    }
+                    auto type = *cur++;
+                    if ((type & 0xE0) == 0xA0) {
+                        length = type & 0x1F;
+                    } else if (type == 0xD9) {
+                        if (!read_be(1, length)) return false;
+                    } else if (type == 0xDA) {
+                        if (!read_be(2, length)) return false;
+                    } else if (type == 0xDB) {
+                        if (!read_be(4, length)) return false;
+                    } else {
+                        return false;
+                    }
+                    if (!string(handler, length, true) || !value(handler, depth + 1)) {
+                        return false;
+                    }
+                }
+                return handler.EndObject((rapidjson::SizeType) size);
+            }
+
+            bool value(rapidjson::Document &handler, int depth) {
+                if (cur >= end || depth > depth_max) {
+                    return false;
+                }
+
+                // fixed types
+                auto type = *cur++;
+                if (type < 0x80) {
+                    return handler.Uint64(type);
+                }
+                if (type >= 0xE0) {
+                    return handler.Int64((int8_t) type);
+                }
+                if ((type & 0xF0) == 0x80) {
+                    return map(handler, type & 0x0F, depth);
+                }
+                if ((type & 0xF0) == 0x90) {
+                    return array(handler, type & 0x0F, depth);
+                }
+                if ((type & 0xE0) == 0xA0) {
+                    return string(handler, type & 0x1F, false);
+                }
+
+                // remaining types
+                uint64_t data;
+                switch (type) {
+                    case 0xC0:
+                        return handler.Null();
+                    case 0xC2:
+                        return handler.Bool(false);
+                    case 0xC3:
+                        return handler.Bool(true);
+                    case 0xC4:
+                    case 0xD9:
+                        return read_be(1, data) && string(handler, data, false);
+                    case 0xC5:
+                    case 0xDA:
+                        return read_be(2, data) && string(handler, data, false);
+                    case 0xC6:
+                    case 0xDB:
+                        return read_be(4, data) && string(handler, data, false);
+                    case 0xCA: {
+                        if (!read_be(4, data)) return false;
+                        float value_float;
+                        auto bits = (uint32_t) data;
+                        memcpy(&value_float, &bits, sizeof(value_float));
+                        return handler.Double(value_float);
+                    }
+                    case 0xCB: {
+                        if (!read_be(8, data)) return false;
+                        double value_double;
+                        memcpy(&value_double, &data, sizeof(value_double));
+                        return handler.Double(value_double);
+                    }
+                    case 0xCC:
+                        return read_be(1, data) && handler.Uint64(data);
+                    case 0xCD:
+                        return read_be(2, data) && handler.Uint64(data);
+                    case 0xCE:
+                        return read_be(4, data) && handler.Uint64(data);
+                    case 0xCF:
+                        return read_be(8, data) && handler.Uint64(data);
+                    case 0xD0:
+                        return read_be(1, data) && handler.Int64((int8_t) data);
+                    case 0xD1:
+                        return read_be(2, data) && handler.Int64((int16_t) data);
+                    case 0xD2:
+                        return read_be(4, data) && handler.Int64((int32_t) data);
+                    case 0xD3:
+                        return read_be(8, data) && handler.Int64((int64_t) data);
+                    case 0xDC:
+                        return read_be(2, data) && array(handler, data, depth);
+                    case 0xDD:
+                        return read_be(4, data) && array(handler, data, depth);
+                    case 0xDE:
+                        return read_be(2, data) && map(handler, data, depth);
+                    case 0xDF:
+                        return read_be(4, data) && map(handler, data, depth);
+                    default:
+                        return false;
+                }
+            }
+        };
+    }
+
+    bool parse(rapidjson::Document &document, const uint8_t *data, size_t size) {
+        Parser parser(data, size);
+        document.Populate(parser);
+        return parser.success;
+    }
+}
@@ -0,0 +1,107 @@
+#include "registry.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "util/logging.h"
+
+#include "modules/analogs.h"
+#include "modules/buttons.h"
+#include "modules/card.h"
+#include "modules/capture.h"
+#include "modules/coin.h"
+#include "modules/control.h"
+#include "modules/drs.h"
+#include "modules/iidx.h"
+#include "modules/info.h"
+#include "modules/input.h"
+#include "modules/keypads.h"
+#include "modules/lcd.h"
+#include "modules/lights.h"
+#include "modules/memory.h"
+#include "modules/touch.h"
+
+namespace api {
+
+    static inline bool entry_less(const Registry::Entry &entry,
+            std::string_view module_name, std::string_view function_name) {
+        if (entry.module_name != module_name) {
+            return entry.module_name < module_name;
+        }
+        return entry.function_name < function_name;
+    }
+
+    Registry::Registry() {
+
+        // create module instances
+        this->modules.push_back(new modules::Analogs());
+        this->modules.push_back(new modules::Buttons());
+        this->modules.push_back(new modules::Card());
+        this->modules.push_back(new modules::Capture());
+        this->modules.push_back(new modules::Coin());
+        this->modules.push_back(new modules::Control());
+        this->modules.push_back(new modules::DRS());
+        this->modules.push_back(new modules::IIDX());
+        this->modules.push_back(new modules::Info());
+        this->modules.push_back(new modules::Input());
+        this->modules.push_back(new modules::Keypads());
+        this->modules.push_back(new modules::LCD());
+        this->modules.push_back(new modules::Lights());
+        this->modules.push_back(new modules::Memory());
+        this->modules.push_back(new modules::Touch());
+
+        // collect functions
+        for (auto module : this->modules) {
+            for (auto &function : module->functions) {
+                this->entries.push_back(Entry {
+                    .module_name = module->name,
+                    .function_name = function.first,
+                    .module = module,
+                    .function = function.second,
+                });
+            }
+        }
+
+        // sort for binary search
+        std::sort(this->entries.begin(), this->entries.end(), [] (const Entry &a, const Entry &b) {
+            return entry_less(a, b.module_name, b.function_name);
+        });
+    }
+
+    Registry::~Registry() {
+        for (auto module : this->modules) {
+            delete module;
+        }
+    }
+
+    const Registry::Entry *Registry::find(std::string_view module_name, std::string_view function_name,
+            bool &module_found) const {
+
+        // find first entry not less than the key
+        auto it = std::partition_point(this->entries.begin(), this->entries.end(),
+                [module_name, function_name] (const Entry &entry) {
+            return entry_less(entry, module_name, function_name);
+        });
+
+        // exact match
+        if (it != this->entries.end() && it->module_name == module_name) {
+            module_found = true;
+            return it->function_name == function_name ? &*it : nullptr;
+        }
+
+        // the module may still exist if only the function is unknown
+        module_found = it != this->entries.begin() && std::prev(it)->module_name == module_name;
+        return nullptr;
+    }
+
+    void Registry::call(const Entry *entry, Request &req, Response &res) {
+
+        // log module access
+        if (LOGGING) {
+            log_info("api::" + entry->module->name, "handling request");
+        }
+
+        // call function
+        (entry->module->*entry->function)(req, res);
+    }
+}
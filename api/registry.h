@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "module.h"
+
+namespace api {
+
+    /*
+     * Shared table of all modules and their functions.
+     * It's built once and immutable afterwards, so all connections can dispatch from it without locking.
+     */
+    class Registry {
+    public:
+
+        struct Entry {
+            std::string_view module_name;
+            std::string_view function_name;
+            Module *module;
+            Module::Function function;
+        };
+
+        Registry();
+        ~Registry();
+
+        Registry(const Registry &) = delete;
+        Registry &operator=(const Registry &) = delete;
+
+        // returns the entry of the function, or nullptr with module_found telling which part is unknown
+        const Entry *find(std::string_view module_name, std::string_view function_name, bool &module_found) const;
+
+        // calls the function of the entry
+        static void call(const Entry *entry, Request &req, Response &res);
+
+        inline const std::vector<Module *> &get_modules() const {
+            return this->modules;
+        }
+
+    private:
+        std::vector<Module *> modules;
+        std::vector<Entry> entries;
+    };
+}
@@ -6,10 +6,17 @@ using namespace rapidjson;
 
 namespace api {
 
-    Request::Request(rapidjson::Document &document) {
+    Request::Request(rapidjson::Value &document) {
         Value::MemberIterator it;
         this->parse_error = false;
 
+        // check type
+        if (!document.IsObject()) {
+            log_warning("api", "Request is not an object");
+            this->parse_error = true;
+            return;
+        }
+
         // get ID
         it = document.FindMember("id");
         if (it == document.MemberEnd() || !(*it).value.IsUint64()) {
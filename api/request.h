@@ -8,14 +8,17 @@
 
 namespace api {
 
+    struct ClientState;
+
     class Request {
     public:
-        uint64_t id;
+        uint64_t id = 0;
+        ClientState *client = nullptr;
         std::string module;
         std::string function;
         rapidjson::Value params;
         bool parse_error;
 
-        Request(rapidjson::Document &document);
+        explicit Request(rapidjson::Value &document);
     };
 }
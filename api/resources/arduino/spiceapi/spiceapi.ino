@@ -16,6 +16,13 @@
 #define SPICEAPI_WRAPPER_BUFFER_SIZE 256
 #define SPICEAPI_WRAPPER_BUFFER_SIZE_STR 256
 
+/*
+ * MessagePack Support
+ * Uncomment to send binary frames instead of JSON.
+ * They are smaller and faster to parse on weak devices.
+ */
+//#define SPICEAPI_MSGPACK
+
 /*
  * WiFi Support
  * Uncomment to enable the wireless API interface.
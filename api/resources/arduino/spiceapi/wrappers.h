@@ -71,12 +71,94 @@ namespace spiceapi {
         return ++id_global;
     }
 
+#ifdef SPICEAPI_MSGPACK
+
+    /*
+     * Binary frames
+     * The MessagePack data is COBS stuffed behind a marker byte so the result is still a C string.
+     */
+
+    const uint8_t MSGPACK_FRAME_MARKER = 0xC1;
+
+    char *doc2str(DynamicJsonDocument *doc) {
+        auto buf = (uint8_t*) JSON_BUFFER_STR;
+
+        // serialize to the end of the buffer, leaving room for the stuffing overhead
+        size_t size = measureMsgPack(*doc);
+        size_t overhead = 3 + size / 254;
+        if (size + overhead > SPICEAPI_WRAPPER_BUFFER_SIZE_STR) {
+            buf[0] = 0;
+            return JSON_BUFFER_STR;
+        }
+        size_t read = SPICEAPI_WRAPPER_BUFFER_SIZE_STR - size;
+        serializeMsgPack(*doc, &buf[read], size);
+
+        // stuff forward, the write position never overtakes the read position
+        size_t write = 0;
+        buf[write++] = MSGPACK_FRAME_MARKER;
+        size_t code_pos = write++;
+        uint8_t code = 1;
+        while (read < SPICEAPI_WRAPPER_BUFFER_SIZE_STR) {
+            uint8_t c = buf[read++];
+            if (c == 0) {
+                buf[code_pos] = code;
+                code_pos = write++;
+                code = 1;
+                continue;
+            }
+            buf[write++] = c;
+            if (++code == 0xFF) {
+                buf[code_pos] = code;
+                code_pos = write++;
+                code = 1;
+            }
+        }
+        buf[code_pos] = code;
+        buf[write] = 0;
+        return JSON_BUFFER_STR;
+    }
+
+    DeserializationError str2doc(DynamicJsonDocument &doc, const char *str) {
+
+        // check marker
+        auto buf = (uint8_t*) str;
+        if (buf[0] != MSGPACK_FRAME_MARKER) {
+            return deserializeJson(doc, (char *) str);
+        }
+
+        // unstuff in place
+        size_t size = strlen(str);
+        size_t read = 1;
+        size_t write = 0;
+        while (read < size) {
+            uint8_t code = buf[read++];
+            if (read + code - 1 > size) {
+                return DeserializationError::InvalidInput;
+            }
+            for (uint8_t i = 1; i < code; i++) {
+                buf[write++] = buf[read++];
+            }
+            if (code != 0xFF && read < size) {
+                buf[write++] = 0;
+            }
+        }
+        return deserializeMsgPack(doc, (char *) buf, write);
+    }
+
+#else
+
     char *doc2str(DynamicJsonDocument *doc) {
         char *buf = JSON_BUFFER_STR;
         serializeJson(*doc, buf, SPICEAPI_WRAPPER_BUFFER_SIZE_STR);
         return buf;
     }
 
+    DeserializationError str2doc(DynamicJsonDocument &doc, const char *str) {
+        return deserializeJson(doc, (char *) str);
+    }
+
+#endif
+
     DynamicJsonDocument *request_gen(const char *module, const char *function) {
 
         // create document
@@ -98,7 +180,7 @@ namespace spiceapi {
 
         // parse document
         DynamicJsonDocument *doc = new DynamicJsonDocument(SPICEAPI_WRAPPER_BUFFER_SIZE);
-        auto err = deserializeJson(*doc, (char *) json);
+        auto err = str2doc(*doc, json);
 
         // check for parse error
         if (err) {
@@ -9,10 +9,11 @@ namespace spiceapi {
     static const int RECEIVE_TIMEOUT = 1000;
 }
 
-spiceapi::Connection::Connection(std::string host, uint16_t port, std::string password) {
+spiceapi::Connection::Connection(std::string host, uint16_t port, std::string password, bool binary) {
     this->host = host;
     this->port = port;
     this->password = password;
+    this->binary = binary;
     this->socket = INVALID_SOCKET;
     this->cipher = nullptr;
 
@@ -18,9 +18,12 @@ namespace spiceapi {
         void cipher_alloc();
 
     public:
-        Connection(std::string host, uint16_t port, std::string password = "");
+        Connection(std::string host, uint16_t port, std::string password = "", bool binary = false);
         ~Connection();
 
+        // use MessagePack frames instead of JSON
+        bool binary;
+
         bool check();
         void change_pass(std::string password);
         std::string request(std::string json);
@@ -0,0 +1,76 @@
+#ifndef SPICEAPI_MSGPACK_H
+#define SPICEAPI_MSGPACK_H
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * RapidJSON dependency
+ * You might need to adjust the paths when importing into your own project.
+ */
+#include "external/rapidjson/document.h"
+
+/*
+ * Binary frames for the API.
+ *
+ * A binary frame carries the same {id, module, function, params} and {id, errors, data} objects as
+ * the JSON protocol, encoded as MessagePack. The encoded message is COBS stuffed so it never
+ * contains a zero byte, which keeps the NUL frame delimiter, the serial session reset and the RC4
+ * layer of the existing transports untouched. The frame marker can never start a JSON document,
+ * so the server answers every frame in the format it was sent with.
+ *
+ *   frame = FRAME_MARKER, COBS(MessagePack(object)), 0x00
+ */
+namespace spiceapi { namespace msgpack {
+
+    constexpr uint8_t FRAME_MARKER = 0xC1;
+
+    /*
+     * Stream doing COBS stuffing on the fly while appending to an output buffer
+     */
+    class CobsStream {
+    public:
+        explicit CobsStream(std::vector<char> &out);
+        ~CobsStream();
+
+        void Put(uint8_t c);
+        void Put(const void *data, size_t size);
+
+    private:
+        std::vector<char> &out;
+        size_t code_pos;
+        uint8_t code = 1;
+    };
+
+    /*
+     * MessagePack encoder
+     */
+    class Writer {
+    public:
+        explicit Writer(CobsStream &stream) : stream(stream) {}
+
+        void Nil();
+        void Bool(bool value);
+        void Int64(int64_t value);
+        void Uint64(uint64_t value);
+        void Double(double value);
+        void String(const char *str, size_t length);
+        void Binary(const void *data, size_t size);
+        void StartArray(size_t size);
+        void StartMap(size_t size);
+        void Value(const rapidjson::Value &value);
+
+    private:
+        CobsStream &stream;
+
+        void write_be(uint8_t type, uint64_t value, size_t size);
+    };
+
+    // removes COBS stuffing in place and returns the decoded size, or SIZE_MAX on malformed input
+    size_t cobs_decode(uint8_t *data, size_t size);
+
+    // decodes a MessagePack object into the document, strings are copied
+    bool parse(rapidjson::Document &document, const uint8_t *data, size_t size);
+}}
+
+#endif //SPICEAPI_MSGPACK_H
@@ -8,12 +8,27 @@
  */
 #include "external/rapidjson/document.h"
 #include "external/rapidjson/writer.h"
+#include "msgpack.h"
 using namespace rapidjson;
 
 
 namespace spiceapi {
 
-    static inline std::string doc2str(Document &doc) {
+    static inline std::string doc2str(Connection &con, Document &doc) {
+
+        // binary frame
+        if (con.binary) {
+            std::vector<char> frame;
+            frame.push_back((char) msgpack::FRAME_MARKER);
+            {
+                msgpack::CobsStream stream(frame);
+                msgpack::Writer writer(stream);
+                writer.Value(doc);
+            }
+            return std::string(frame.begin(), frame.end());
+        }
+
+        // JSON
         StringBuffer sb;
         rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
         doc.Accept(writer);
@@ -44,10 +59,19 @@ namespace spiceapi {
 
         // parse document
         Document *doc = new Document();
-        doc->Parse(json.c_str());
+        if (!json.empty() && (uint8_t) json[0] == msgpack::FRAME_MARKER) {
+            std::vector<uint8_t> data(json.begin() + 1, json.end());
+            auto size = msgpack::cobs_decode(data.data(), data.size());
+            if (size == SIZE_MAX || !msgpack::parse(*doc, data.data(), size)) {
+                delete doc;
+                return nullptr;
+            }
+        } else {
+            doc->Parse(json.c_str());
+        }
 
         // check for parse error
-        if (doc->HasParseError()) {
+        if (doc->HasParseError() || !doc->IsObject()) {
             delete doc;
             return nullptr;
         }
@@ -108,7 +132,7 @@ uint64_t spiceapi::msg_gen_id() {
 
 bool spiceapi::analogs_read(spiceapi::Connection &con, std::vector<spiceapi::AnalogState> &states) {
     auto req = request_gen("analogs", "read");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     auto &data = (*res)["data"];
@@ -133,7 +157,7 @@ bool spiceapi::analogs_write(spiceapi::Connection &con, std::vector<spiceapi::An
         params.PushBack(state_val, alloc);
     }
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -150,7 +174,7 @@ bool spiceapi::analogs_write_reset(spiceapi::Connection &con, std::vector<spicea
         params.PushBack(state_val, alloc);
     }
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -159,7 +183,7 @@ bool spiceapi::analogs_write_reset(spiceapi::Connection &con, std::vector<spicea
 
 bool spiceapi::buttons_read(spiceapi::Connection &con, std::vector<spiceapi::ButtonState> &states) {
     auto req = request_gen("buttons", "read");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     auto &data = (*res)["data"];
@@ -184,7 +208,7 @@ bool spiceapi::buttons_write(spiceapi::Connection &con, std::vector<spiceapi::Bu
         params.PushBack(state_val, alloc);
     }
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -201,7 +225,7 @@ bool spiceapi::buttons_write_reset(spiceapi::Connection &con, std::vector<spicea
         params.PushBack(state_val, alloc);
     }
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -215,7 +239,7 @@ bool spiceapi::card_insert(spiceapi::Connection &con, size_t index, const char *
     params.PushBack(index, alloc);
     params.PushBack(StringRef(card_id), alloc);
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -224,7 +248,7 @@ bool spiceapi::card_insert(spiceapi::Connection &con, size_t index, const char *
 
 bool spiceapi::coin_get(Connection &con, int &coins) {
     auto req = request_gen("coin", "get");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     coins = (*res)["data"][0].GetInt();
@@ -238,7 +262,7 @@ bool spiceapi::coin_set(Connection &con, int coins) {
     Value params(kArrayType);
     params.PushBack(coins, alloc);
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -251,7 +275,7 @@ bool spiceapi::coin_insert(Connection &con, int coins) {
     Value params(kArrayType);
     params.PushBack(coins, alloc);
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -260,7 +284,7 @@ bool spiceapi::coin_insert(Connection &con, int coins) {
 
 bool spiceapi::coin_blocker_get(Connection &con, bool &closed) {
     auto req = request_gen("coin", "blocker_get");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     closed = (*res)["data"][0].GetBool();
@@ -274,7 +298,7 @@ bool spiceapi::control_raise(spiceapi::Connection &con, const char *signal) {
     Value params(kArrayType);
     params.PushBack(StringRef(signal), alloc);
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -283,7 +307,7 @@ bool spiceapi::control_raise(spiceapi::Connection &con, const char *signal) {
 
 bool spiceapi::control_exit(spiceapi::Connection &con) {
     auto req = request_gen("control", "exit");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -296,7 +320,7 @@ bool spiceapi::control_exit(spiceapi::Connection &con, int exit_code) {
     Value params(kArrayType);
     params.PushBack(exit_code, alloc);
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -305,7 +329,7 @@ bool spiceapi::control_exit(spiceapi::Connection &con, int exit_code) {
 
 bool spiceapi::control_restart(spiceapi::Connection &con) {
     auto req = request_gen("control", "restart");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -314,7 +338,7 @@ bool spiceapi::control_restart(spiceapi::Connection &con) {
 
 bool spiceapi::control_session_refresh(spiceapi::Connection &con) {
     auto req = request_gen("control", "session_refresh");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     auto key = (*res)["data"][0].GetString();
@@ -325,7 +349,7 @@ bool spiceapi::control_session_refresh(spiceapi::Connection &con) {
 
 bool spiceapi::control_shutdown(spiceapi::Connection &con) {
     auto req = request_gen("control", "shutdown");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -334,7 +358,7 @@ bool spiceapi::control_shutdown(spiceapi::Connection &con) {
 
 bool spiceapi::control_reboot(spiceapi::Connection &con) {
     auto req = request_gen("control", "reboot");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -343,7 +367,7 @@ bool spiceapi::control_reboot(spiceapi::Connection &con) {
 
 bool spiceapi::iidx_ticker_get(spiceapi::Connection &con, char *ticker) {
     auto req = request_gen("iidx", "ticker_get");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     auto data = (*res)["data"][0].GetString();
@@ -359,7 +383,7 @@ bool spiceapi::iidx_ticker_set(spiceapi::Connection &con, const char *ticker) {
     Value params(kArrayType);
     params.PushBack(StringRef(ticker), alloc);
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -368,7 +392,7 @@ bool spiceapi::iidx_ticker_set(spiceapi::Connection &con, const char *ticker) {
 
 bool spiceapi::iidx_ticker_reset(spiceapi::Connection &con) {
     auto req = request_gen("iidx", "ticker_reset");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -377,7 +401,7 @@ bool spiceapi::iidx_ticker_reset(spiceapi::Connection &con) {
 
 bool spiceapi::info_avs(spiceapi::Connection &con, spiceapi::InfoAvs &info) {
     auto req = request_gen("info", "avs");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     auto &data = (*res)["data"][0];
@@ -392,7 +416,7 @@ bool spiceapi::info_avs(spiceapi::Connection &con, spiceapi::InfoAvs &info) {
 
 bool spiceapi::info_launcher(spiceapi::Connection &con, spiceapi::InfoLauncher &info) {
     auto req = request_gen("info", "launcher");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     auto &data = (*res)["data"][0];
@@ -408,7 +432,7 @@ bool spiceapi::info_launcher(spiceapi::Connection &con, spiceapi::InfoLauncher &
 
 bool spiceapi::info_memory(spiceapi::Connection &con, spiceapi::InfoMemory &info) {
     auto req = request_gen("info", "memory");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     auto &data = (*res)["data"][0];
@@ -429,7 +453,7 @@ bool spiceapi::keypads_write(spiceapi::Connection &con, unsigned int keypad, con
     params.PushBack(keypad, alloc);
     params.PushBack(StringRef(input), alloc);
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -444,7 +468,7 @@ bool spiceapi::keypads_set(spiceapi::Connection &con, unsigned int keypad, std::
     for (auto &key : keys)
         params.PushBack(StringRef(&key, 1), alloc);
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -457,7 +481,7 @@ bool spiceapi::keypads_get(spiceapi::Connection &con, unsigned int keypad, std::
     Value params(kArrayType);
     params.PushBack(keypad, alloc);
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     auto &data = (*res)["data"];
@@ -469,7 +493,7 @@ bool spiceapi::keypads_get(spiceapi::Connection &con, unsigned int keypad, std::
 
 bool spiceapi::lights_read(spiceapi::Connection &con, std::vector<spiceapi::LightState> &states) {
     auto req = request_gen("lights", "read");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     auto &data = (*res)["data"];
@@ -494,7 +518,7 @@ bool spiceapi::lights_write(spiceapi::Connection &con, std::vector<spiceapi::Lig
         params.PushBack(state_val, alloc);
     }
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -511,7 +535,7 @@ bool spiceapi::lights_write_reset(spiceapi::Connection &con, std::vector<spiceap
         params.PushBack(state_val, alloc);
     }
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -526,7 +550,7 @@ bool spiceapi::memory_write(spiceapi::Connection &con, const char *dll_name, con
     params.PushBack(StringRef(hex), alloc);
     params.PushBack(offset, alloc);
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -542,7 +566,7 @@ bool spiceapi::memory_read(spiceapi::Connection &con, const char *dll_name, uint
     params.PushBack(offset, alloc);
     params.PushBack(size, alloc);
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     hex = (*res)["data"][0].GetString();
@@ -561,7 +585,7 @@ bool spiceapi::memory_signature(spiceapi::Connection &con, const char *dll_name,
     params.PushBack(offset, alloc);
     params.PushBack(usage, alloc);
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     file_offset = (*res)["data"][0].GetUint();
@@ -571,7 +595,7 @@ bool spiceapi::memory_signature(spiceapi::Connection &con, const char *dll_name,
 
 bool spiceapi::touch_read(spiceapi::Connection &con, std::vector<spiceapi::TouchState> &states) {
     auto req = request_gen("touch", "read");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     auto &data = (*res)["data"];
@@ -598,7 +622,7 @@ bool spiceapi::touch_write(spiceapi::Connection &con, std::vector<spiceapi::Touc
         params.PushBack(state_val, alloc);
     }
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -612,7 +636,7 @@ bool spiceapi::touch_write_reset(spiceapi::Connection &con, std::vector<spiceapi
     for (auto &state : states)
         params.PushBack(state.id, alloc);
     req["params"] = params;
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     delete res;
@@ -621,7 +645,7 @@ bool spiceapi::touch_write_reset(spiceapi::Connection &con, std::vector<spiceapi
 
 bool spiceapi::lcd_info(spiceapi::Connection &con, spiceapi::LCDInfo &info) {
     auto req = request_gen("lcd", "info");
-    auto res = response_get(con.request(doc2str(req)));
+    auto res = response_get(con.request(doc2str(con, req)));
     if (!res)
         return false;
     auto &data = (*res)["data"][0];
@@ -8,6 +8,7 @@ from .control import *
 from .exceptions import *
 from .iidx import *
 from .info import *
+from .input import *
 from .keypads import *
 from .lights import *
 from .memory import *
@@ -26,3 +26,20 @@ def analogs_write_reset(con: Connection, analog_names=None):
     for analog_name in analog_names:
         req.add_param(analog_name)
     con.request(req)
+
+
+def analogs_subscribe(con: Connection, rate: float, names=None):
+    """Subscribe to analogs state changes.
+
+    Changed states are pushed at most `rate` times per second and can be
+    received with `Connection.poll_push`.
+    """
+    req = Request("analogs", "subscribe")
+    req.add_param(rate)
+    for name in names or []:
+        req.add_param(name)
+    con.request(req)
+
+
+def analogs_unsubscribe(con: Connection):
+    con.request(Request("analogs", "unsubscribe"))
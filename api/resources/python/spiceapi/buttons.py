@@ -26,3 +26,20 @@ def buttons_write_reset(con: Connection, button_names=None):
     for button_name in button_names:
         req.add_param(button_name)
     con.request(req)
+
+
+def buttons_subscribe(con: Connection, rate: float, names=None):
+    """Subscribe to buttons state changes.
+
+    Changed states are pushed at most `rate` times per second and can be
+    received with `Connection.poll_push`.
+    """
+    req = Request("buttons", "subscribe")
+    req.add_param(rate)
+    for name in names or []:
+        req.add_param(name)
+    con.request(req)
+
+
+def buttons_unsubscribe(con: Connection):
+    con.request(Request("buttons", "unsubscribe"))
@@ -1,8 +1,11 @@
+import json
 import os
 import socket
+from collections import deque
 from .request import Request
 from .response import Response
 from .rc4 import rc4
+from . import msgpack
 from .exceptions import MalformedRequestException, APIError
 
 
@@ -10,18 +13,22 @@ class Connection:
     """ Container for managing a single connection to the API server.
     """
 
-    def __init__(self, host: str, port: int, password: str):
+    def __init__(self, host: str, port: int, password: str, binary=False):
         """Default constructor.
 
         :param host: the host string to connect to
         :param port: the port of the host
         :param password: the connection password string
+        :param binary: use MessagePack frames instead of JSON
         """
         self.host = host
         self.port = port
         self.password = password
+        self.binary = binary
         self.socket = None
         self.cipher = None
+        self.buffer = bytearray()
+        self.pushes = deque()
         self.reconnect()
 
     def reconnect(self, refresh_session=True):
@@ -41,6 +48,8 @@ class Connection:
 
         # cipher
         self.change_password(self.password)
+        self.buffer = bytearray()
+        self.pushes.clear()
 
         # refresh session
         if refresh_session:
@@ -74,12 +83,71 @@ class Connection:
         :return: response object
         """
 
+        # send request and build response
+        response = Response(self._exchange(request.data))
+        if len(response.get_errors()):
+            raise APIError(response.get_errors())
+
+        # check ID
+        req_id = request.get_id()
+        res_id = response.get_id()
+        if req_id != res_id:
+            raise RuntimeError(f"Unexpected response ID: {res_id} (expected {req_id})")
+
+        # return response object
+        return response
+
+    def request_batch(self, requests):
+        """Send multiple requests in a single frame.
+
+        The server executes them in order and answers with a single frame.
+
+        :param requests: list of request objects
+        :return: list of response objects
+        """
+
+        # send requests and build responses
+        answer = self._exchange([request.data for request in requests])
+        if not isinstance(answer, list) or len(answer) != len(requests):
+            raise RuntimeError("Unexpected batch response.")
+        responses = [Response(res) for res in answer]
+
+        # check responses
+        for request, response in zip(requests, responses):
+            if len(response.get_errors()):
+                raise APIError(response.get_errors())
+            req_id = request.get_id()
+            res_id = response.get_id()
+            if req_id != res_id:
+                raise RuntimeError(f"Unexpected response ID: {res_id} (expected {req_id})")
+
+        # return response objects
+        return responses
+
+    def _exchange(self, obj):
+        """Send a single frame and receive the answer.
+
+        :param obj: request data or list of request data
+        :return: decoded answer
+        """
+
         # check if disconnected
         if not self.socket:
             raise RuntimeError("No active connection.")
 
         # build data
-        data = request.to_json().encode("UTF-8") + b"\x00"
+        if self.binary:
+            data = msgpack.encode_frame(obj) + b"\x00"
+        else:
+            data = json.dumps(
+                obj,
+                ensure_ascii=False,
+                check_circular=False,
+                allow_nan=False,
+                indent=None,
+                separators=(",", ":"),
+                sort_keys=False
+            ).encode("UTF-8") + b"\x00"
         if self.cipher:
             data_list = list(data)
             data_cipher = []
@@ -90,50 +158,86 @@ class Connection:
         # send request
         if os.name != 'nt':
             self.socket.setsockopt(socket.IPPROTO_TCP, socket.TCP_QUICKACK, 1)
-        self.socket.send(data)
+        self.socket.sendall(data)
 
-        # get answer
-        answer_data = []
-        while not len(answer_data) or answer_data[-1] != 0:
+        # get answer, pushed frames received in between are queued
+        while True:
+            answer_data = self._receive_frame()
+            if len(answer_data) == 0:
 
-            # receive data
-            if os.name != 'nt':
-                self.socket.setsockopt(socket.IPPROTO_TCP, socket.TCP_QUICKACK, 1)
-            receive_data = self.socket.recv(4096)
+                # empty response means the request couldn't be parsed
+                raise MalformedRequestException()
 
-            # check length
-            if len(receive_data):
+            answer = self._decode_frame(answer_data)
+            if isinstance(answer, dict) and "push" in answer:
+                self.pushes.append(answer)
+                continue
+            return answer
 
-                # check cipher
-                if self.cipher:
+    def poll_push(self, timeout=None):
+        """Receive the next frame pushed by a subscription.
 
-                    # add decrypted data
-                    for b in receive_data:
-                        answer_data.append(int(b ^ next(self.cipher)))
-                else:
+        :param timeout: seconds to wait, None uses the socket timeout
+        :return: tuple of (module, data) or None if nothing arrived in time
+        """
 
-                    # add plaintext
-                    for b in receive_data:
-                        answer_data.append(int(b))
-            else:
-                raise RuntimeError("Connection was closed.")
+        # check queued pushes first
+        if not self.pushes:
+
+            # check if disconnected
+            if not self.socket:
+                raise RuntimeError("No active connection.")
+
+            # wait for the next frame
+            old_timeout = self.socket.gettimeout()
+            if timeout is not None:
+                self.socket.settimeout(timeout)
+            try:
+                frame = self._receive_frame()
+                self.pushes.append(self._decode_frame(frame))
+            except socket.timeout:
+                return None
+            finally:
+                self.socket.settimeout(old_timeout)
+
+        push = self.pushes.popleft()
+        return push["push"], push["data"]
+
+    @staticmethod
+    def _decode_frame(frame):
+        """Decode a JSON or binary frame.
+
+        :return: decoded object
+        """
+        if msgpack.is_frame(frame):
+            return msgpack.decode_frame(frame)
+        return json.loads(frame.decode("UTF-8"))
 
-        # check for empty response
-        if len(answer_data) <= 1:
+    def _receive_frame(self):
+        """Receive data until a full NUL terminated frame is buffered.
 
-            # empty response means the JSON couldn't be parsed
-            raise MalformedRequestException()
+        :return: frame contents without the terminator
+        """
+        while True:
 
-        # build response
-        response = Response(bytes(answer_data[:-1]).decode("UTF-8"))
-        if len(response.get_errors()):
-            raise APIError(response.get_errors())
+            # check for complete frame
+            end = self.buffer.find(0)
+            if end >= 0:
+                frame = bytes(self.buffer[:end])
+                del self.buffer[:end + 1]
+                return frame
 
-        # check ID
-        req_id = request.get_id()
-        res_id = response.get_id()
-        if req_id != res_id:
-            raise RuntimeError(f"Unexpected response ID: {res_id} (expected {req_id})")
+            # receive data
+            if os.name != 'nt':
+                self.socket.setsockopt(socket.IPPROTO_TCP, socket.TCP_QUICKACK, 1)
+            receive_data = self.socket.recv(4096)
 
-        # return response object
-        return response
+            # check length
+            if not len(receive_data):
+                raise RuntimeError("Connection was closed.")
+
+            # check cipher
+            if self.cipher:
+                self.buffer.extend(b ^ next(self.cipher) for b in receive_data)
+            else:
+                self.buffer.extend(receive_data)
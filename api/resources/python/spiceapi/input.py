@@ -0,0 +1,29 @@
+from .connection import Connection
+from .request import Request
+
+
+def input_devices(con: Connection):
+    res = con.request(Request("input", "devices"))
+    return res.get_data()
+
+
+def input_events(con: Connection, name: str, position: int = 0):
+    req = Request("input", "events")
+    req.add_param(name)
+    req.add_param(position)
+    res = con.request(req)
+    data = res.get_data()
+    return data[0], data[1:]
+
+
+def input_latency(con: Connection, name: str):
+    req = Request("input", "latency")
+    req.add_param(name)
+    res = con.request(req)
+    return res.get_data()[0]
+
+
+def input_latency_reset(con: Connection, name: str):
+    req = Request("input", "latency_reset")
+    req.add_param(name)
+    con.request(req)
@@ -26,3 +26,20 @@ def lights_write_reset(con: Connection, light_names=None):
     for light_name in light_names:
         req.add_param(light_name)
     con.request(req)
+
+
+def lights_subscribe(con: Connection, rate: float, names=None):
+    """Subscribe to lights state changes.
+
+    Changed states are pushed at most `rate` times per second and can be
+    received with `Connection.poll_push`.
+    """
+    req = Request("lights", "subscribe")
+    req.add_param(rate)
+    for name in names or []:
+        req.add_param(name)
+    con.request(req)
+
+
+def lights_unsubscribe(con: Connection):
+    con.request(Request("lights", "unsubscribe"))
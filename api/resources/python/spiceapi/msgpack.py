@@ -0,0 +1,199 @@
+import struct
+
+FRAME_MARKER = 0xC1
+
+
+def cobs_encode(data: bytes):
+    """Remove all zero bytes from the data using consistent overhead byte stuffing."""
+    out = bytearray(b"\x00")
+    code_pos = 0
+    code = 1
+    for b in data:
+        if b == 0:
+            out[code_pos] = code
+            code_pos = len(out)
+            out.append(0)
+            code = 1
+            continue
+        out.append(b)
+        code += 1
+        if code == 0xFF:
+            out[code_pos] = code
+            code_pos = len(out)
+            out.append(0)
+            code = 1
+    out[code_pos] = code
+    return bytes(out)
+
+
+def cobs_decode(data: bytes):
+    """Restore data stuffed by cobs_encode."""
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        code = data[pos]
+        if code == 0 or pos + code > len(data):
+            raise ValueError("Malformed COBS data")
+        out.extend(data[pos + 1:pos + code])
+        pos += code
+        if code != 0xFF and pos < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def pack(obj):
+    """Encode an object as MessagePack."""
+    out = bytearray()
+    _pack(obj, out)
+    return bytes(out)
+
+
+def _pack(obj, out):
+    if obj is None:
+        out.append(0xC0)
+    elif obj is True:
+        out.append(0xC3)
+    elif obj is False:
+        out.append(0xC2)
+    elif isinstance(obj, int):
+        if 0 <= obj < 0x80:
+            out.append(obj)
+        elif -32 <= obj < 0:
+            out.append(obj & 0xFF)
+        elif 0 <= obj < 2 ** 64:
+            out.extend(struct.pack(">BQ", 0xCF, obj))
+        else:
+            out.extend(struct.pack(">Bq", 0xD3, obj))
+    elif isinstance(obj, float):
+        out.extend(struct.pack(">Bd", 0xCB, obj))
+    elif isinstance(obj, str):
+        data = obj.encode("UTF-8")
+        if len(data) < 32:
+            out.append(0xA0 | len(data))
+        else:
+            out.extend(struct.pack(">BI", 0xDB, len(data)))
+        out.extend(data)
+    elif isinstance(obj, (bytes, bytearray)):
+        out.extend(struct.pack(">BI", 0xC6, len(obj)))
+        out.extend(obj)
+    elif isinstance(obj, (list, tuple)):
+        if len(obj) < 16:
+            out.append(0x90 | len(obj))
+        else:
+            out.extend(struct.pack(">BI", 0xDD, len(obj)))
+        for item in obj:
+            _pack(item, out)
+    elif isinstance(obj, dict):
+        if len(obj) < 16:
+            out.append(0x80 | len(obj))
+        else:
+            out.extend(struct.pack(">BI", 0xDF, len(obj)))
+        for key, value in obj.items():
+            _pack(str(key), out)
+            _pack(value, out)
+    else:
+        raise TypeError(f"Unsupported type: {type(obj)}")
+
+
+def unpack(data: bytes):
+    """Decode a single MessagePack object."""
+    obj, pos = _unpack(data, 0)
+    if pos != len(data):
+        raise ValueError("Trailing MessagePack data")
+    return obj
+
+
+_FORMATS = {
+    0xCA: ">f", 0xCB: ">d",
+    0xCC: ">B", 0xCD: ">H", 0xCE: ">I", 0xCF: ">Q",
+    0xD0: ">b", 0xD1: ">h", 0xD2: ">i", 0xD3: ">q",
+}
+
+
+def _read(data, pos, fmt):
+    size = struct.calcsize(fmt)
+    if pos + size > len(data):
+        raise ValueError("Truncated MessagePack data")
+    return struct.unpack_from(fmt, data, pos)[0], pos + size
+
+
+def _unpack(data, pos):
+    if pos >= len(data):
+        raise ValueError("Truncated MessagePack data")
+    t = data[pos]
+    pos += 1
+
+    # fixed types
+    if t < 0x80:
+        return t, pos
+    if t >= 0xE0:
+        return t - 0x100, pos
+    if t & 0xF0 == 0x80:
+        return _unpack_map(data, pos, t & 0x0F)
+    if t & 0xF0 == 0x90:
+        return _unpack_array(data, pos, t & 0x0F)
+    if t & 0xE0 == 0xA0:
+        return _unpack_str(data, pos, t & 0x1F)
+
+    # remaining types
+    if t == 0xC0:
+        return None, pos
+    if t == 0xC2:
+        return False, pos
+    if t == 0xC3:
+        return True, pos
+    if t in _FORMATS:
+        return _read(data, pos, _FORMATS[t])
+    if t in (0xC4, 0xC5, 0xC6):
+        size, pos = _read(data, pos, ">" + "BHI"[t - 0xC4])
+        if pos + size > len(data):
+            raise ValueError("Truncated MessagePack data")
+        return bytes(data[pos:pos + size]), pos + size
+    if t in (0xD9, 0xDA, 0xDB):
+        size, pos = _read(data, pos, ">" + "BHI"[t - 0xD9])
+        return _unpack_str(data, pos, size)
+    if t in (0xDC, 0xDD):
+        size, pos = _read(data, pos, ">" + "HI"[t - 0xDC])
+        return _unpack_array(data, pos, size)
+    if t in (0xDE, 0xDF):
+        size, pos = _read(data, pos, ">" + "HI"[t - 0xDE])
+        return _unpack_map(data, pos, size)
+    raise ValueError(f"Unsupported MessagePack type: {t:#x}")
+
+
+def _unpack_str(data, pos, size):
+    if pos + size > len(data):
+        raise ValueError("Truncated MessagePack data")
+    return bytes(data[pos:pos + size]).decode("UTF-8"), pos + size
+
+
+def _unpack_array(data, pos, size):
+    items = []
+    for _ in range(size):
+        item, pos = _unpack(data, pos)
+        items.append(item)
+    return items, pos
+
+
+def _unpack_map(data, pos, size):
+    items = {}
+    for _ in range(size):
+        key, pos = _unpack(data, pos)
+        value, pos = _unpack(data, pos)
+        items[key] = value
+    return items, pos
+
+
+def encode_frame(obj):
+    """Build a binary API frame without the terminator."""
+    return bytes([FRAME_MARKER]) + cobs_encode(pack(obj))
+
+
+def decode_frame(frame: bytes):
+    """Decode a binary API frame without the terminator."""
+    return unpack(cobs_decode(frame[1:]))
+
+
+def is_frame(frame: bytes):
+    """Check if a received frame is binary."""
+    return len(frame) > 0 and frame[0] == FRAME_MARKER
@@ -3,8 +3,11 @@ import json
 
 class Response:
 
-    def __init__(self, response_json: str):
-        self._res = json.loads(response_json)
+    def __init__(self, response_json):
+        if isinstance(response_json, dict):
+            self._res = response_json
+        else:
+            self._res = json.loads(response_json)
         self._id = self._res["id"]
         self._errors = self._res["errors"]
         self._data = self._res["data"]
@@ -2,50 +2,97 @@
 #include "external/rapidjson/writer.h"
 #include "external/rapidjson/prettywriter.h"
 
-#include "util/logging.h"
-
+#include "msgpack.h"
 #include "response.h"
 
-using namespace api;
+#include <algorithm>
 
-Response::Response(uint64_t id) {
+#include "util/crypt.h"
 
-    // load template
-    document.Parse(
-            "{"
-            "\"id\": -1,"
-            "\"errors\": [],"
-            "\"data\": []"
-            "}"
-    );
+using namespace api;
 
-    // check for error
-    auto error = document.GetParseError();
-    if (error)
-        log_warning("api", "response template parse error: {}", error);
+namespace {
 
-    // set ID
-    document["id"].SetUint64(id);
+    template<class Writer>
+    void write_envelope(Writer &writer, uint64_t id, rapidjson::Value &errors, rapidjson::Value &data) {
+        writer.StartObject();
+        writer.Key("id");
+        writer.Uint64(id);
+        writer.Key("errors");
+        errors.Accept(writer);
+        writer.Key("data");
+        data.Accept(writer);
+        writer.EndObject();
+    }
+}
 
-    // get fields
-    this->errors = document["errors"];
-    this->data = document["data"];
+Response::Response(uint64_t id, rapidjson::MemoryPoolAllocator<> *allocator)
+    : document(allocator), errors(rapidjson::kArrayType), data(rapidjson::kArrayType), id(id) {
 }
 
-std::string Response::get_string(bool pretty) {
+void Response::add_data_binary(const uint8_t *data, size_t size) {
+    auto &allocator = document.GetAllocator();
+
+    // binary connections keep the raw bytes in a string value
+    if (this->binary) {
+        this->data_binary.push_back(this->data.Size());
+        rapidjson::Value value(reinterpret_cast<const char *>(data), (rapidjson::SizeType) size, allocator);
+        this->data.PushBack(value, allocator);
+        return;
+    }
+
+    // text connections get base64
+    auto encoded = crypt::base64_encode(data, size);
+    rapidjson::Value value(encoded.c_str(), (rapidjson::SizeType) encoded.size(), allocator);
+    this->data.PushBack(value, allocator);
+}
 
-    // apply errors and data
-    this->document["errors"] = this->errors;
-    this->document["data"] = this->data;
+void Response::write(std::vector<char> &out, bool pretty) {
+    typedef rapidjson::UTF8<> Encoding;
+    typedef rapidjson::MemoryPoolAllocator<> Allocator;
 
-    // generate string
-    rapidjson::StringBuffer sb;
+    // generate envelope
+    ResponseStream stream(out);
     if (pretty) {
-        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(sb);
-        this->document.Accept(writer);
+        rapidjson::PrettyWriter<ResponseStream, Encoding, Encoding, Allocator> writer(
+                stream, &document.GetAllocator());
+        write_envelope(writer, this->id, this->errors, this->data);
     } else {
-        rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
-        this->document.Accept(writer);
+        rapidjson::Writer<ResponseStream, Encoding, Encoding, Allocator> writer(
+                stream, &document.GetAllocator());
+        write_envelope(writer, this->id, this->errors, this->data);
+    }
+}
+
+void Response::write_msgpack(std::vector<char> &out) {
+
+    // generate envelope
+    out.push_back((char) msgpack::FRAME_MARKER);
+    msgpack::CobsStream stream(out);
+    msgpack::Writer writer(stream);
+    write_msgpack(writer);
+}
+
+void Response::write_msgpack(msgpack::Writer &writer) {
+    writer.StartMap(3);
+    writer.String("id", 2);
+    writer.Uint64(this->id);
+    writer.String("errors", 6);
+    writer.Value(this->errors);
+    writer.String("data", 4);
+    if (this->data_binary.empty()) {
+        writer.Value(this->data);
+        return;
+    }
+
+    // binary values are stored as strings in the document
+    writer.StartArray(this->data.Size());
+    for (rapidjson::SizeType i = 0; i < this->data.Size(); i++) {
+        auto &value = this->data[i];
+        if (std::find(this->data_binary.begin(), this->data_binary.end(), i) != this->data_binary.end()) {
+            writer.Binary(value.GetString(), value.GetStringLength());
+        } else {
+            writer.Value(value);
+        }
     }
-    return std::string(sb.GetString());
 }
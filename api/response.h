@@ -1,20 +1,64 @@
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include "external/rapidjson/document.h"
 
 namespace api {
 
+    namespace msgpack {
+        class Writer;
+    }
+
+    /*
+     * Per-client memory for building requests and responses.
+     * Anything fitting into the buffer won't touch the heap, the pool is cleared after every response.
+     */
+    struct ResponsePool {
+        static const size_t buffer_size = 64 * 1024;
+
+        alignas(8) char buffer[buffer_size];
+        rapidjson::MemoryPoolAllocator<> allocator;
+        std::vector<uint8_t> scratch;
+
+        ResponsePool() : allocator(buffer, sizeof(buffer)) {}
+    };
+
+    /*
+     * Output stream appending directly to a client's send buffer
+     */
+    class ResponseStream {
+    public:
+        typedef char Ch;
+
+        explicit ResponseStream(std::vector<char> &out) : out(out) {}
+
+        inline void Put(char c) {
+            out.push_back(c);
+        }
+        inline void Flush() {}
+
+    private:
+        std::vector<char> &out;
+    };
+
     class Response {
     private:
         rapidjson::Document document;
         rapidjson::Value errors;
         rapidjson::Value data;
+        std::vector<rapidjson::SizeType> data_binary;
+        uint64_t id;
 
     public:
         std::string password;
         bool password_changed = false;
 
-        Response(uint64_t id);
+        // set for MessagePack connections
+        bool binary = false;
+
+        explicit Response(uint64_t id, rapidjson::MemoryPoolAllocator<> *allocator = nullptr);
 
         template <class T> void add_error(T& error) {
             this->errors.PushBack(error, document.GetAllocator());
@@ -23,7 +67,12 @@ namespace api {
             this->data.PushBack(data, document.GetAllocator());
         }
 
-        std::string get_string(bool pretty=false);
+        // raw bytes, sent as bin on MessagePack connections and as base64 string otherwise
+        void add_data_binary(const uint8_t *data, size_t size);
+
+        void write(std::vector<char> &out, bool pretty=false);
+        void write_msgpack(std::vector<char> &out);
+        void write_msgpack(msgpack::Writer &writer);
 
         inline rapidjson::Document* doc() {
             return &document;
@@ -2,9 +2,15 @@
 #include "external/headsocket.h"
 
 #include "websocket.h"
+
+#include <atomic>
+#include <cmath>
+#include <mutex>
+
 #include "util/utils.h"
 #include "util/rc4.h"
 #include "util/logging.h"
+#include "util/time.h"
 #include "controller.h"
 
 using namespace headsocket;
@@ -19,8 +25,15 @@ namespace api {
         // required class header
         HEADSOCKET_CLIENT(WebSocketClient, web_socket_client);
 
+    public:
+        double push_poll();
+
     private:
         ClientState *state = nullptr;
+        std::mutex state_m;
+        std::vector<char> in_buffer;
+        std::vector<char> out_buffer;
+        std::vector<char> push_buffer;
 
     protected:
         bool async_received_data(const data_block &db, uint8_t *ptr, size_t length) override;
@@ -45,6 +58,8 @@ namespace api {
      */
     struct WebSocketControllerState {
         std::shared_ptr<WebSocketServer> server;
+        std::thread push_thread;
+        std::atomic<bool> push_running {true};
     };
 
     WebSocketController::WebSocketController(Controller *controller, uint16_t port) {
@@ -61,10 +76,41 @@ namespace api {
         } else {
             log_warning("api::websocket", "server failed to listen on port: {}", port);
         }
+
+        // start subscription pusher
+        this->state->push_thread = std::thread([this] {
+            while (this->state->push_running) {
+
+                // push to all clients
+                double deadline = -1;
+                for (auto client : this->state->server->clients()) {
+                    if (client) {
+                        auto client_deadline = client->push_poll();
+                        if (client_deadline >= 0 && (deadline < 0 || client_deadline < deadline)) {
+                            deadline = client_deadline;
+                        }
+                    }
+                }
+
+                // wait for next push
+                if (deadline < 0) {
+                    Sleep(push_idle_timeout);
+                } else {
+                    auto remaining = deadline - get_performance_milliseconds();
+                    Sleep((DWORD) CLAMP((int) std::ceil(remaining), 1, push_idle_timeout));
+                }
+            }
+        });
     }
 
     WebSocketController::~WebSocketController() {
 
+        // stop pusher
+        this->state->push_running = false;
+        if (this->state->push_thread.joinable()) {
+            this->state->push_thread.join();
+        }
+
         // stop server
         this->state->server->stop();
 
@@ -86,6 +132,7 @@ namespace api {
         }
 
         // check for init
+        std::lock_guard<std::mutex> lock(state_m);
         state = new ClientState();
         srv->websocket->controller->init_state(state);
 
@@ -105,9 +152,11 @@ namespace api {
         }
 
         // clean up state
+        std::unique_lock<std::mutex> lock(state_m);
         srv->websocket->controller->free_state(state);
         delete state;
         state = nullptr;
+        lock.unlock();
 
         // call super
         web_socket_client::on_disconnect();
@@ -125,6 +174,7 @@ namespace api {
         }
 
         // check state
+        std::lock_guard<std::mutex> lock(state_m);
         if (!state) {
             log_fatal("api::websocket", "client with no state received datablock");
         }
@@ -133,9 +183,11 @@ namespace api {
         switch (db.op) {
             case opcode::binary: {
 
-                // allocate buffers
-                std::vector<char> in(ptr, ptr + length);
-                std::vector<char> out;
+                // reuse buffers
+                auto &in = this->in_buffer;
+                auto &out = this->out_buffer;
+                in.assign(ptr, ptr + length);
+                out.clear();
 
                 // crypt in-data
                 if (state->cipher) {
@@ -166,4 +218,40 @@ namespace api {
         // always consume the datablock, nomnom
         return true;
     }
+
+    /*
+     * Pushes due subscriptions and returns the time of the next one
+     */
+    double WebSocketClient::push_poll() {
+
+        // don't wait for clients which are busy handling a request
+        std::unique_lock<std::mutex> lock(state_m, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return get_performance_milliseconds() + 1;
+        }
+        if (!state || state->subscriptions.empty()) {
+            return -1;
+        }
+
+        // get pointer to server
+        auto srv = reinterpret_cast<WebSocketServer *>(server().get());
+        if (!srv || !srv->websocket) {
+            return -1;
+        }
+
+        // build pushes
+        push_buffer.clear();
+        if (srv->websocket->controller->process_push(state, &push_buffer)) {
+
+            // crypt out-data
+            if (state->cipher) {
+                state->cipher->crypt(reinterpret_cast<uint8_t *>(push_buffer.data()), push_buffer.size());
+            }
+
+            // send
+            push(push_buffer.data(), push_buffer.size());
+        }
+
+        return Controller::push_deadline(state);
+    }
 }
@@ -9,6 +9,11 @@ namespace api {
     class Controller;
 
     class WebSocketController {
+    private:
+
+        // configuration
+        const static int push_idle_timeout = 50;
+
     public:
 
         WebSocketController(Controller *controller, uint16_t port);
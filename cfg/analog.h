@@ -4,6 +4,8 @@
 #include <string>
 #include <cmath>
 
+#include "api.h"
+
 #define ANALOG_HISTORY_CNT 10
 #define M_TAU (2 * M_PI)
 #define M_1_TAU (0.5 * M_1_PI)
@@ -22,6 +24,7 @@ class Analog {
 private:
     std::string name;
     std::string device_identifier = "";
+    GameAPI::DeviceCache device_cache;
     unsigned short index = 0xFF;
     float sensitivity = 1.f;
     float deadzone = 0.f;
@@ -67,6 +70,7 @@ public:
 
     inline void clearBindings() {
         device_identifier = "";
+        device_cache = {};
         index = 0xFF;
         setSensitivity(1.f);
         setDeadzone(0.f);
@@ -84,6 +88,11 @@ public:
 
     inline void setDeviceIdentifier(std::string device_identifier) {
         this->device_identifier = std::move(device_identifier);
+        this->device_cache = {};
+    }
+
+    inline GameAPI::DeviceCache &getDeviceCache() {
+        return this->device_cache;
     }
 
     inline unsigned short getIndex() const {
@@ -1,5 +1,7 @@
 #include "api.h"
 
+#include <algorithm>
+
 #include "rawinput/rawinput.h"
 #include "rawinput/piuio.h"
 #include "util/time.h"
@@ -51,263 +53,330 @@ std::vector<Button> GameAPI::Buttons::sortButtons(
     return sorted;
 }
 
-GameAPI::Buttons::State GameAPI::Buttons::getState(rawinput::RawInputManager *manager, Button &_button, bool check_alts) {
-
-    // check override
-    if (_button.override_enabled) {
-        return _button.override_state;
+rawinput::Device *GameAPI::getDevice(rawinput::RawInputManager *manager, const std::string &identifier,
+        DeviceCache &cache)
+{
+    static const uint32_t DEVICE_NONE = UINT32_MAX;
+
+    // resolve again after the device list changed
+    auto generation = rawinput::RawInputManager::devices_get_generation();
+    auto entry = cache.entry.load(std::memory_order_acquire);
+    auto &devices = manager->devices_get();
+    if ((uint32_t) entry != generation) {
+        auto device = manager->devices_get(identifier, false);
+        uint32_t position = device ? (uint32_t) (device - devices.data()) : DEVICE_NONE;
+        entry = ((uint64_t) position << 32) | generation;
+        cache.entry.store(entry, std::memory_order_release);
     }
 
-    // for iterating button alternatives
-    auto current_button = &_button;
-    auto alternatives = check_alts ? &current_button->getAlternatives() : nullptr;
-    unsigned int button_count = 0;
-    while (true) {
-
-        // naive behavior
-        if (current_button->isNaive()) {
-
-            // read
-            auto vkey = current_button->getVKey();
-            GameAPI::Buttons::State state;
-            if (vkey == 0xFF) {
-                state = BUTTON_NOT_PRESSED;
-            } else {
-                state = (GetAsyncKeyState(current_button->getVKey()) & 0x8000) ? BUTTON_PRESSED : BUTTON_NOT_PRESSED;
-            }
+    // look up the device by position
+    auto position = (uint32_t) (entry >> 32);
+    if (position == DEVICE_NONE || position >= devices.size()) {
+        return nullptr;
+    }
+    return &devices[position];
+}
 
-            // invert
-            if (current_button->getInvert()) {
-                if (state == BUTTON_PRESSED) {
-                    state = BUTTON_NOT_PRESSED;
-                } else {
-                    state = BUTTON_PRESSED;
-                }
-            }
+// reads a naive binding straight from the keyboard state, inversion included
+static Buttons::State readButtonNaive(Button &button) {
 
-            // return state
-            if (state != BUTTON_NOT_PRESSED) {
-                return state;
-            }
+    // read
+    auto vkey = button.getVKey();
+    Buttons::State state;
+    if (vkey == 0xFF) {
+        state = Buttons::BUTTON_NOT_PRESSED;
+    } else {
+        state = (GetAsyncKeyState(vkey) & 0x8000) ? Buttons::BUTTON_PRESSED : Buttons::BUTTON_NOT_PRESSED;
+    }
 
-            // get next button
-            button_count++;
-            if (!alternatives || alternatives->empty() || button_count - 1 >= alternatives->size()) {
-                return BUTTON_NOT_PRESSED;
-            } else {
-                current_button = &alternatives->at(button_count - 1);
-                continue;
-            }
+    // invert
+    if (button.getInvert()) {
+        if (state == Buttons::BUTTON_PRESSED) {
+            state = Buttons::BUTTON_NOT_PRESSED;
+        } else {
+            state = Buttons::BUTTON_PRESSED;
         }
+    }
 
-        // get device
-        auto &devid = current_button->getDeviceIdentifier();
-        auto device = manager->devices_get(devid, false); // TODO: fix to update only
-
-        // get state if device was marked as updated
-        GameAPI::Buttons::State state = current_button->getLastState();
-        double *last_up = nullptr;
-        double *last_down = nullptr;
-        if (device) {
+    return state;
+}
 
-            // lock device
-            device->mutex->lock();
+// reads a binding from its device, the caller holds the lock or is inside the sequence lock
+static void readButton(rawinput::Device *device, Button &button, Buttons::Reading &reading) {
 
-            // get vkey
-            auto vKey = current_button->getVKey();
+    // get vkey
+    auto vKey = button.getVKey();
 
-            // update state based on device type
-            switch (device->type) {
-                case rawinput::MOUSE: {
-                    if (vKey < sizeof(device->mouseInfo->key_states)) {
-                        auto mouse = device->mouseInfo;
-                        state = mouse->key_states[vKey] ? BUTTON_PRESSED : BUTTON_NOT_PRESSED;
-                        last_up = &mouse->key_up[vKey];
-                        last_down = &mouse->key_down[vKey];
+    // update state based on device type
+    switch (device->type) {
+        case rawinput::MOUSE: {
+            auto mouse = device->mouseInfo;
+            if (mouse && vKey < sizeof(mouse->key_states)) {
+                reading.state = mouse->key_states[vKey] ? Buttons::BUTTON_PRESSED : Buttons::BUTTON_NOT_PRESSED;
+                reading.last_up = mouse->key_up[vKey];
+                reading.last_down = mouse->key_down[vKey];
+                reading.debounce = true;
+            }
+            break;
+        }
+        case rawinput::KEYBOARD: {
+            auto kb = device->keyboardInfo;
+            if (kb && vKey < sizeof(kb->key_states)) {
+                reading.state = kb->key_states[vKey] ? Buttons::BUTTON_PRESSED : Buttons::BUTTON_NOT_PRESSED;
+                reading.last_up = kb->key_up[vKey];
+                reading.last_down = kb->key_down[vKey];
+                reading.debounce = true;
+            }
+            break;
+        }
+        case rawinput::HID: {
+            auto hid = device->hidInfo;
+            if (!hid) {
+                break;
+            }
+            auto bat = button.getAnalogType();
+            switch (bat) {
+                case BAT_NONE: {
+                    auto button_states_it = hid->button_states.begin();
+                    auto button_up_it = hid->button_up.begin();
+                    auto button_down_it = hid->button_down.begin();
+                    while (button_states_it != hid->button_states.end()) {
+                        auto size = button_states_it->size();
+                        if (vKey < size) {
+                            reading.state = (*button_states_it)[vKey]
+                                    ? Buttons::BUTTON_PRESSED : Buttons::BUTTON_NOT_PRESSED;
+                            reading.last_up = (*button_up_it)[vKey];
+                            reading.last_down = (*button_down_it)[vKey];
+                            reading.debounce = true;
+                            break;
+                        } else {
+                            vKey -= size;
+                            ++button_states_it;
+                            ++button_up_it;
+                            ++button_down_it;
+                        }
                     }
                     break;
                 }
-                case rawinput::KEYBOARD: {
-                    if (vKey < sizeof(device->keyboardInfo->key_states)) {
-                        auto kb = device->keyboardInfo;
-                        state = kb->key_states[vKey] ? BUTTON_PRESSED : BUTTON_NOT_PRESSED;
-                        last_up = &kb->key_up[vKey];
-                        last_down = &kb->key_down[vKey];
+                case BAT_NEGATIVE:
+                case BAT_POSITIVE: {
+                    auto value_states = &hid->value_states;
+                    if (vKey < value_states->size()) {
+                        auto value = value_states->at(vKey);
+                        if (button.getAnalogType() == BAT_POSITIVE) {
+                            reading.state = value > 0.6f ? Buttons::BUTTON_PRESSED : Buttons::BUTTON_NOT_PRESSED;
+                        } else {
+                            reading.state = value < 0.4f ? Buttons::BUTTON_PRESSED : Buttons::BUTTON_NOT_PRESSED;
+                        }
+                    } else {
+                        reading.state = Buttons::BUTTON_NOT_PRESSED;
                     }
                     break;
                 }
-                case rawinput::HID: {
-                    auto hid = device->hidInfo;
-                    auto bat = current_button->getAnalogType();
-                    switch (bat) {
-                        case BAT_NONE: {
-                            auto button_states_it = hid->button_states.begin();
-                            auto button_up_it = hid->button_up.begin();
-                            auto button_down_it = hid->button_down.begin();
-                            while (button_states_it != hid->button_states.end()) {
-                                auto size = button_states_it->size();
-                                if (vKey < size) {
-                                    state = (*button_states_it)[vKey] ? BUTTON_PRESSED : BUTTON_NOT_PRESSED;
-                                    last_up = &(*button_up_it)[vKey];
-                                    last_down = &(*button_down_it)[vKey];
-                                    break;
-                                } else {
-                                    vKey -= size;
-                                    ++button_states_it;
-                                    ++button_up_it;
-                                    ++button_down_it;
-                                }
+                case BAT_HS_UP:
+                case BAT_HS_UPRIGHT:
+                case BAT_HS_RIGHT:
+                case BAT_HS_DOWNRIGHT:
+                case BAT_HS_DOWN:
+                case BAT_HS_DOWNLEFT:
+                case BAT_HS_LEFT:
+                case BAT_HS_UPLEFT:
+                case BAT_HS_NEUTRAL: {
+                    auto &value_states = hid->value_states;
+                    if (vKey < value_states.size()) {
+                        auto value = value_states.at(vKey);
+
+                        // get hat switch values
+                        ButtonAnalogType buffer[3];
+                        Button::getHatSwitchValues(value, buffer);
+
+                        // check if one of the values match our analog type
+                        reading.state = Buttons::BUTTON_NOT_PRESSED;
+                        for (ButtonAnalogType &buffer_bat : buffer) {
+                            if (buffer_bat == bat) {
+                                reading.state = Buttons::BUTTON_PRESSED;
+                                break;
                             }
-                            break;
                         }
-                        case BAT_NEGATIVE:
-                        case BAT_POSITIVE: {
-                            auto value_states = &hid->value_states;
-                            if (vKey < value_states->size()) {
-                                auto value = value_states->at(vKey);
-                                if (current_button->getAnalogType() == BAT_POSITIVE) {
-                                    state = value > 0.6f ? BUTTON_PRESSED : BUTTON_NOT_PRESSED;
-                                } else {
-                                    state = value < 0.4f ? BUTTON_PRESSED : BUTTON_NOT_PRESSED;
-                                }
-                            } else {
-                                state = BUTTON_NOT_PRESSED;
-                            }
-                            break;
-                        }
-                        case BAT_HS_UP:
-                        case BAT_HS_UPRIGHT:
-                        case BAT_HS_RIGHT:
-                        case BAT_HS_DOWNRIGHT:
-                        case BAT_HS_DOWN:
-                        case BAT_HS_DOWNLEFT:
-                        case BAT_HS_LEFT:
-                        case BAT_HS_UPLEFT:
-                        case BAT_HS_NEUTRAL: {
-                            auto &value_states = hid->value_states;
-                            if (vKey < value_states.size()) {
-                                auto value = value_states.at(vKey);
-
-                                // get hat switch values
-                                ButtonAnalogType buffer[3];
-                                Button::getHatSwitchValues(value, buffer);
-
-                                // check if one of the values match our analog type
-                                state = BUTTON_NOT_PRESSED;
-                                for (ButtonAnalogType &buffer_bat : buffer) {
-                                    if (buffer_bat == bat) {
-                                        state = BUTTON_PRESSED;
-                                        break;
-                                    }
-                                }
-
-                            } else
-                                state = BUTTON_NOT_PRESSED;
-                            break;
-                        }
-                        default:
-                            state = BUTTON_NOT_PRESSED;
-                            break;
-                    }
+
+                    } else
+                        reading.state = Buttons::BUTTON_NOT_PRESSED;
                     break;
                 }
-                case rawinput::MIDI: {
-                    auto bat = current_button->getAnalogType();
-                    auto midi = device->midiInfo;
-                    switch (bat) {
-                        case BAT_NONE: {
-                            if (vKey < 16 * 128) {
-
-                                // check for event
-                                auto midi_event = midi->states_events[vKey];
-                                if (midi_event) {
-
-                                    // choose state based on event
-                                    state = (midi_event % 2) ? BUTTON_PRESSED : BUTTON_NOT_PRESSED;
-
-                                    // update event
-                                    if (!midi->states[vKey] || midi_event > 1)
-                                        midi->states_events[vKey]--;
-
-                                } else
-                                    state = BUTTON_NOT_PRESSED;
-                            }
-                            break;
-                        }
-                        case BAT_MIDI_CTRL_PRECISION: {
-                            if (vKey < 16 * 32)
-                                state = midi->controls_precision[vKey] > 0 ? BUTTON_PRESSED : BUTTON_NOT_PRESSED;
-                            else
-                                state = BUTTON_NOT_PRESSED;
-                            break;
-                        }
-                        case BAT_MIDI_CTRL_SINGLE: {
-                            if (vKey < 16 * 44)
-                                state = midi->controls_single[vKey] > 0 ? BUTTON_PRESSED : BUTTON_NOT_PRESSED;
-                            else
-                                state = BUTTON_NOT_PRESSED;
-                            break;
-                        }
-                        case BAT_MIDI_CTRL_ONOFF: {
-                            if (vKey < 16 * 6)
-                                state = midi->controls_onoff[vKey] ? BUTTON_PRESSED : BUTTON_NOT_PRESSED;
-                            else
-                                state = BUTTON_NOT_PRESSED;
-                            break;
-                        }
-                        case BAT_MIDI_PITCH_DOWN:
-                            state = midi->pitch_bend < 0x2000 ? BUTTON_PRESSED : BUTTON_NOT_PRESSED;
-                            break;
-                        case BAT_MIDI_PITCH_UP:
-                            state = midi->pitch_bend > 0x2000 ? BUTTON_PRESSED : BUTTON_NOT_PRESSED;
-                            break;
-                        default: {
-                            state = BUTTON_NOT_PRESSED;
-                            break;
-                        }
+                default:
+                    reading.state = Buttons::BUTTON_NOT_PRESSED;
+                    break;
+            }
+            break;
+        }
+        case rawinput::MIDI: {
+            auto bat = button.getAnalogType();
+            auto midi = device->midiInfo;
+            switch (bat) {
+                case BAT_NONE: {
+                    if (vKey < 16 * 128) {
+
+                        // check for event
+                        auto midi_event = midi->states_events[vKey];
+                        if (midi_event) {
+
+                            // choose state based on event
+                            reading.state = (midi_event % 2) ? Buttons::BUTTON_PRESSED : Buttons::BUTTON_NOT_PRESSED;
+
+                            // update event
+                            if (!midi->states[vKey] || midi_event > 1)
+                                midi->states_events[vKey]--;
+
+                        } else
+                            reading.state = Buttons::BUTTON_NOT_PRESSED;
                     }
                     break;
                 }
-                case rawinput::PIUIO_DEVICE: {
-                    state = device->piuioDev->IsPressed(vKey) ? BUTTON_PRESSED : BUTTON_NOT_PRESSED;
+                case BAT_MIDI_CTRL_PRECISION: {
+                    if (vKey < 16 * 32)
+                        reading.state = midi->controls_precision[vKey] > 0 ? Buttons::BUTTON_PRESSED : Buttons::BUTTON_NOT_PRESSED;
+                    else
+                        reading.state = Buttons::BUTTON_NOT_PRESSED;
+                    break;
                 }
-                default:
+                case BAT_MIDI_CTRL_SINGLE: {
+                    if (vKey < 16 * 44)
+                        reading.state = midi->controls_single[vKey] > 0 ? Buttons::BUTTON_PRESSED : Buttons::BUTTON_NOT_PRESSED;
+                    else
+                        reading.state = Buttons::BUTTON_NOT_PRESSED;
                     break;
+                }
+                case BAT_MIDI_CTRL_ONOFF: {
+                    if (vKey < 16 * 6)
+                        reading.state = midi->controls_onoff[vKey] ? Buttons::BUTTON_PRESSED : Buttons::BUTTON_NOT_PRESSED;
+                    else
+                        reading.state = Buttons::BUTTON_NOT_PRESSED;
+                    break;
+                }
+                case BAT_MIDI_PITCH_DOWN:
+                    reading.state = midi->pitch_bend < 0x2000 ? Buttons::BUTTON_PRESSED : Buttons::BUTTON_NOT_PRESSED;
+                    break;
+                case BAT_MIDI_PITCH_UP:
+                    reading.state = midi->pitch_bend > 0x2000 ? Buttons::BUTTON_PRESSED : Buttons::BUTTON_NOT_PRESSED;
+                    break;
+                default: {
+                    reading.state = Buttons::BUTTON_NOT_PRESSED;
+                    break;
+                }
             }
-
-            // unlock device
-            device->mutex->unlock();
+            break;
         }
+        case rawinput::PIUIO_DEVICE: {
+            reading.state = device->piuioDev->IsPressed(vKey) ? Buttons::BUTTON_PRESSED : Buttons::BUTTON_NOT_PRESSED;
+        }
+        default:
+            break;
+    }
+}
 
-        // debounce
-        if (state == BUTTON_NOT_PRESSED) {
-            if (last_up) {
-                auto debounce_up = current_button->getDebounceUp();
-                if (debounce_up > 0.0 && get_performance_seconds() - *last_up < debounce_up) {
-                    state = BUTTON_PRESSED;
-                }
+// ends the latency measurement of the control a binding reads
+static void observeButton(rawinput::Device *device, Button &button) {
+    if (device->journal) {
+        device->journal->observe((uint16_t) button.getVKey(), button.getAnalogType() != BAT_NONE);
+    }
+}
+
+// reads a binding without blocking the input thread if the device supports it
+static void readButtonDevice(rawinput::Device *device, Button &button, Buttons::Reading &reading) {
+    if (rawinput::seqlock_supported(device->type)) {
+        auto last_state = reading.state;
+        device->seqlock->read([&] () {
+            reading = Buttons::Reading {
+                .state = last_state,
+            };
+            readButton(device, button, reading);
+        });
+        observeButton(device, button);
+    } else {
+        std::lock_guard<std::mutex> lock(*device->mutex);
+        readButton(device, button, reading);
+    }
+}
+
+// applies debounce and inversion to a binding read from its device
+static Buttons::State applyButton(Button &button, const Buttons::Reading &reading) {
+    auto state = reading.state;
+
+    // debounce
+    if (reading.debounce) {
+        if (state == Buttons::BUTTON_NOT_PRESSED) {
+            auto debounce_up = button.getDebounceUp();
+            if (debounce_up > 0.0 && get_performance_seconds() - reading.last_up < debounce_up) {
+                state = Buttons::BUTTON_PRESSED;
             }
         } else {
-            if (last_down) {
-                auto debounce_down = current_button->getDebounceDown();
-                if (debounce_down > 0.0 && get_performance_seconds() - *last_down < debounce_down) {
-                    state = BUTTON_NOT_PRESSED;
-                }
+            auto debounce_down = button.getDebounceDown();
+            if (debounce_down > 0.0 && get_performance_seconds() - reading.last_down < debounce_down) {
+                state = Buttons::BUTTON_NOT_PRESSED;
             }
         }
+    }
+
+    // set last state
+    button.setLastState(state);
+
+    // invert
+    if (button.getInvert()) {
+        if (state == Buttons::BUTTON_PRESSED) {
+            state = Buttons::BUTTON_NOT_PRESSED;
+        } else {
+            state = Buttons::BUTTON_PRESSED;
+        }
+    }
 
-        // set last state
-        current_button->setLastState(state);
+    return state;
+}
 
-        // invert
-        if (current_button->getInvert()) {
-            if (state == BUTTON_PRESSED) {
-                state = BUTTON_NOT_PRESSED;
+GameAPI::Buttons::State GameAPI::Buttons::getState(rawinput::RawInputManager *manager, Button &_button, bool check_alts) {
+
+    // check override
+    if (_button.override_enabled) {
+        return _button.override_state;
+    }
+
+    // for iterating button alternatives
+    auto current_button = &_button;
+    auto alternatives = check_alts ? &current_button->getAlternatives() : nullptr;
+    unsigned int button_count = 0;
+    while (true) {
+
+        // naive behavior
+        if (current_button->isNaive()) {
+
+            // return state
+            auto state = readButtonNaive(*current_button);
+            if (state != BUTTON_NOT_PRESSED) {
+                return state;
+            }
+
+            // get next button
+            button_count++;
+            if (!alternatives || alternatives->empty() || button_count - 1 >= alternatives->size()) {
+                return BUTTON_NOT_PRESSED;
             } else {
-                state = BUTTON_PRESSED;
+                current_button = &alternatives->at(button_count - 1);
+                continue;
             }
         }
 
+        // get device
+        auto &devid = current_button->getDeviceIdentifier();
+        auto device = GameAPI::getDevice(manager, devid, current_button->getDeviceCache());
+
+        // read and apply debounce
+        Buttons::Reading reading {
+            .state = current_button->getLastState(),
+        };
+        if (device) {
+            readButtonDevice(device, *current_button, reading);
+        }
+        auto state = applyButton(*current_button, reading);
+
         // early quit
         if (state == BUTTON_PRESSED) {
             return state;
@@ -357,7 +426,7 @@ static float getVelocityHelper(rawinput::RawInputManager *manager, Button &butto
 
     // get device
     auto &devid = button.getDeviceIdentifier();
-    auto device = manager->devices_get(devid, false);
+    auto device = GameAPI::getDevice(manager, devid, button.getDeviceCache());
 
     // return last velocity if device wasn't found
     if (!device) {
@@ -427,37 +496,50 @@ float Buttons::getVelocity(std::unique_ptr<rawinput::RawInputManager> &manager,
     }
 }
 
-float GameAPI::Analogs::getState(rawinput::Device *device, Analog &analog) {
-    float value = 0.5f;
-    if (!device) {
-        return value;
-    }
-
+// raw position or value of a mouse or HID analog, read inside the sequence lock
+static double readAnalog(rawinput::Device *device, Analog &analog) {
     auto index = analog.getIndex();
-    auto inverted = analog.getInvert();
-    device->mutex->lock();
-
-    // get value from device
     switch (device->type) {
         case rawinput::MOUSE: {
-
-            // get mouse position
             auto mouse = device->mouseInfo;
-            long pos;
+            if (!mouse) {
+                return 0.0;
+            }
             switch (index) {
                 case rawinput::MOUSEPOS_X:
-                    pos = mouse->pos_x;
-                    break;
+                    return mouse->pos_x;
                 case rawinput::MOUSEPOS_Y:
-                    pos = mouse->pos_y;
-                    break;
+                    return mouse->pos_y;
                 case rawinput::MOUSEPOS_WHEEL:
-                    pos = mouse->pos_wheel;
-                    break;
+                    return mouse->pos_wheel;
                 default:
-                    pos = 0;
-                    break;
+                    return 0.0;
             }
+        }
+        case rawinput::HID: {
+            auto hid = device->hidInfo;
+            if (!hid || (size_t) index >= hid->value_states.size()) {
+                return 0.5;
+            }
+            return hid->value_states[index];
+        }
+        default:
+            return 0.0;
+    }
+}
+
+// turns the raw value into the analog state, MIDI is read here so the caller must hold the lock
+static float applyAnalog(rawinput::Device *device, Analog &analog, double raw) {
+    float value = 0.5f;
+    auto index = analog.getIndex();
+    auto inverted = analog.getInvert();
+
+    // get value from device
+    switch (device->type) {
+        case rawinput::MOUSE: {
+
+            // get mouse position
+            auto pos = (long) raw;
 
             // apply sensitivity
             auto val = (int) roundf(pos * analog.getSensitivity());
@@ -484,10 +566,9 @@ float GameAPI::Analogs::getState(rawinput::Device *device, Analog &analog) {
         case rawinput::HID: {
 
             // get value
+            value = (float) raw;
             if (inverted) {
-                value = 1.f - device->hidInfo->value_states[index];
-            } else {
-                value = device->hidInfo->value_states[index];
+                value = 1.f - value;
             }
 
             // smoothing/sensitivity
@@ -612,11 +693,29 @@ float GameAPI::Analogs::getState(rawinput::Device *device, Analog &analog) {
             break;
     }
 
-    device->mutex->unlock();
-
     return value;
 }
 
+float GameAPI::Analogs::getState(rawinput::Device *device, Analog &analog) {
+    if (!device) {
+        return 0.5f;
+    }
+
+    // mouse and HID state is read without blocking the input thread, MIDI still needs the lock
+    if (rawinput::seqlock_supported(device->type)) {
+        double raw = 0.0;
+        device->seqlock->read([&] () {
+            raw = readAnalog(device, analog);
+        });
+        if (device->journal) {
+            device->journal->observe((uint16_t) analog.getIndex(), true);
+        }
+        return applyAnalog(device, analog, raw);
+    }
+    std::lock_guard<std::mutex> lock(*device->mutex);
+    return applyAnalog(device, analog, 0.0);
+}
+
 std::vector<Analog> GameAPI::Analogs::getAnalogs(const std::string &game_name) {
     return Config::getInstance().getAnalogs(game_name);
 }
@@ -656,7 +755,7 @@ float GameAPI::Analogs::getState(rawinput::RawInputManager *manager, Analog &ana
 
     // get device
     auto &devid = analog.getDeviceIdentifier();
-    auto device = manager->devices_get(devid, false); // TODO: fix to update only
+    auto device = GameAPI::getDevice(manager, devid, analog.getDeviceCache());
 
     // return last state if device wasn't updated
     if (!device) {
@@ -792,7 +891,7 @@ void GameAPI::Lights::writeLight(rawinput::RawInputManager *manager, Light &ligh
 
     // get device
     auto &devid = light.getDeviceIdentifier();
-    auto device = manager->devices_get(devid, false);
+    auto device = GameAPI::getDevice(manager, devid, light.getDeviceCache());
 
     // check device
     if (device) {
@@ -922,3 +1021,183 @@ void GameAPI::Options::sortOptions(std::vector<Option> &options, const std::vect
 
     options = std::move(sorted);
 }
+
+void GameAPI::InputFrame::capture(rawinput::RawInputManager *manager, std::vector<Button> &buttons,
+        std::vector<Analog> *analogs) {
+
+    // reset
+    this->button_count = buttons.size();
+    this->button_bits.assign((buttons.size() + 63) / 64, 0);
+    this->analog_values.assign(analogs ? analogs->size() : 0, 0.f);
+    this->button_bindings.clear();
+    this->analog_bindings.clear();
+    this->devices.clear();
+
+    // resolves a device and remembers it for the read pass
+    auto resolve = [this, manager] (const std::string &identifier, DeviceCache &cache) {
+        auto device = getDevice(manager, identifier, cache);
+        if (device && rawinput::seqlock_supported(device->type)
+                && std::find(this->devices.begin(), this->devices.end(), device) == this->devices.end()) {
+            this->devices.push_back(device);
+        }
+        return device;
+    };
+
+    // collect button bindings
+    for (size_t index = 0; index < buttons.size(); index++) {
+        auto &button = buttons[index];
+
+        // check override
+        if (button.override_enabled) {
+            if (button.override_state == Buttons::BUTTON_PRESSED) {
+                this->button_bits[index / 64] |= 1ull << (index % 64);
+            }
+            continue;
+        }
+
+        // button and its alternatives
+        auto add = [&] (Button &binding) {
+            rawinput::Device *device = nullptr;
+            if (!binding.isNaive()) {
+                device = resolve(binding.getDeviceIdentifier(), binding.getDeviceCache());
+            }
+            this->button_bindings.push_back(ButtonBinding {
+                .button = &binding,
+                .device = device,
+                .index = index,
+                .reading = Buttons::Reading {
+                    .state = binding.getLastState(),
+                },
+            });
+        };
+        add(button);
+        for (auto &alternative : button.getAlternatives()) {
+            add(alternative);
+        }
+    }
+
+    // collect analog bindings
+    if (analogs) {
+        for (size_t index = 0; index < analogs->size(); index++) {
+            auto &analog = (*analogs)[index];
+
+            // check override
+            if (analog.override_enabled) {
+                this->analog_values[index] = analog.override_state;
+                continue;
+            }
+
+            this->analog_bindings.push_back(AnalogBinding {
+                .analog = &analog,
+                .device = resolve(analog.getDeviceIdentifier(), analog.getDeviceCache()),
+                .index = index,
+                .raw = 0.0,
+            });
+        }
+    }
+
+    // one pass over the devices
+    this->read_devices();
+
+    // apply buttons in binding order and stop at the first pressed one, just like getState
+    size_t position = 0;
+    while (position < this->button_bindings.size()) {
+        auto index = this->button_bindings[position].index;
+        bool pressed = false;
+        for (; position < this->button_bindings.size() && this->button_bindings[position].index == index; position++) {
+            if (pressed) {
+                continue;
+            }
+            auto &binding = this->button_bindings[position];
+            auto &button = *binding.button;
+            Buttons::State state;
+            if (button.isNaive()) {
+                state = readButtonNaive(button);
+            } else {
+
+                // reading MIDI consumes events, so those are still read one by one
+                if (binding.device && !rawinput::seqlock_supported(binding.device->type)) {
+                    readButtonDevice(binding.device, button, binding.reading);
+                }
+                state = applyButton(button, binding.reading);
+            }
+            pressed = state == Buttons::BUTTON_PRESSED;
+        }
+        if (pressed) {
+            this->button_bits[index / 64] |= 1ull << (index % 64);
+        }
+    }
+
+    // apply analogs
+    for (auto &binding : this->analog_bindings) {
+        auto &analog = *binding.analog;
+        float state;
+        if (!binding.device) {
+            state = analog.getLastState();
+        } else if (rawinput::seqlock_supported(binding.device->type)) {
+            state = applyAnalog(binding.device, analog, binding.raw);
+        } else {
+            state = Analogs::getState(binding.device, analog);
+        }
+        analog.setLastState(state);
+        this->analog_values[binding.index] = state;
+    }
+}
+
+void GameAPI::InputFrame::capture(std::unique_ptr<rawinput::RawInputManager> &manager, std::vector<Button> &buttons,
+        std::vector<Analog> *analogs) {
+    if (manager) {
+        return capture(manager.get(), buttons, analogs);
+    }
+
+    // no input manager, keep the last states
+    this->button_count = buttons.size();
+    this->button_bits.assign((buttons.size() + 63) / 64, 0);
+    for (size_t index = 0; index < buttons.size(); index++) {
+        if (buttons[index].getLastState() == Buttons::BUTTON_PRESSED) {
+            this->button_bits[index / 64] |= 1ull << (index % 64);
+        }
+    }
+    this->analog_values.clear();
+    if (analogs) {
+        for (auto &analog : *analogs) {
+            this->analog_values.push_back(analog.getLastState());
+        }
+    }
+}
+
+void GameAPI::InputFrame::read_devices() {
+    for (auto device : this->devices) {
+
+        // all bindings of a device are read in the same sequence lock section
+        device->seqlock->read([this, device] () {
+            for (auto &binding : this->button_bindings) {
+                if (binding.device == device) {
+                    binding.reading = Buttons::Reading {
+                        .state = binding.button->getLastState(),
+                    };
+                    readButton(device, *binding.button, binding.reading);
+                }
+            }
+            for (auto &binding : this->analog_bindings) {
+                if (binding.device == device) {
+                    binding.raw = readAnalog(device, *binding.analog);
+                }
+            }
+        });
+
+        // only the controls the game actually reads end their latency measurement
+        for (auto &binding : this->button_bindings) {
+            if (binding.device == device) {
+                observeButton(device, *binding.button);
+            }
+        }
+        if (device->journal) {
+            for (auto &binding : this->analog_bindings) {
+                if (binding.device == device) {
+                    device->journal->observe((uint16_t) binding.analog->getIndex(), true);
+                }
+            }
+        }
+    }
+}
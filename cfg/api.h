@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -18,6 +20,30 @@ class Game;
 class Option;
 
 namespace GameAPI {
+
+    /*
+     * Device resolved from the identifier of a binding.
+     * It is kept until the device list changes or the binding gets a new identifier,
+     * so polling doesn't have to search the devices by name.
+     *
+     * Bindings are polled from the game IO thread, API workers and the overlay at once, so the device
+     * position and the generation it belongs to are stored together in one atomic word. A reader
+     * can't pair a new generation with an old device that way. Zero means unresolved.
+     */
+    struct DeviceCache {
+        std::atomic<uint64_t> entry {0};
+
+        DeviceCache() = default;
+        DeviceCache(const DeviceCache &other) : entry(other.entry.load(std::memory_order_relaxed)) {}
+        DeviceCache &operator=(const DeviceCache &other) {
+            this->entry.store(other.entry.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+    };
+
+    rawinput::Device *getDevice(rawinput::RawInputManager *manager, const std::string &identifier,
+            DeviceCache &cache);
+
     namespace Buttons {
         enum State {
             BUTTON_PRESSED = true,
@@ -80,6 +106,16 @@ namespace GameAPI {
          */
         float getVelocity(rawinput::RawInputManager *manager, Button &button);
         float getVelocity(std::unique_ptr<rawinput::RawInputManager> &manager, Button &button);
+
+        /*
+         * A single binding as read from its device, before debounce and inversion are applied.
+         */
+        struct Reading {
+            State state;
+            bool debounce = false;
+            double last_up = 0.0;
+            double last_down = 0.0;
+        };
     }
 
     namespace Analogs {
@@ -151,6 +187,59 @@ namespace GameAPI {
 
         void sortOptions(std::vector<Option> &, const std::vector<OptionDefinition> &);
     }
+
+    /*
+     * Frame-coherent snapshot of all buttons and analogs of a game.
+     *
+     * capture() resolves the device of every binding once and then reads each keyboard, mouse and HID
+     * device inside a single sequence lock section, so all bindings on a device see the same input
+     * event instead of whatever arrived between two getState calls. Debounce, inversion, alternatives
+     * and overrides behave exactly like Buttons::getState and Analogs::getState. The results end up
+     * in a flat bitset and float array, indexed like the sorted button and analog lists.
+     */
+    class InputFrame {
+    public:
+
+        void capture(rawinput::RawInputManager *manager, std::vector<Button> &buttons,
+                std::vector<Analog> *analogs = nullptr);
+        void capture(std::unique_ptr<rawinput::RawInputManager> &manager, std::vector<Button> &buttons,
+                std::vector<Analog> *analogs = nullptr);
+
+        inline bool button(size_t index) const {
+            return index < this->button_count && ((this->button_bits[index / 64] >> (index % 64)) & 1);
+        }
+
+        inline float analog(size_t index) const {
+            return index < this->analog_values.size() ? this->analog_values[index] : 0.f;
+        }
+
+    private:
+
+        // every binding including alternatives, grouped by the button they belong to
+        struct ButtonBinding {
+            Button *button;
+            rawinput::Device *device;
+            size_t index;
+            Buttons::Reading reading;
+        };
+        struct AnalogBinding {
+            Analog *analog;
+            rawinput::Device *device;
+            size_t index;
+            double raw;
+        };
+
+        size_t button_count = 0;
+        std::vector<uint64_t> button_bits;
+        std::vector<float> analog_values;
+
+        // kept between captures to avoid allocations
+        std::vector<ButtonBinding> button_bindings;
+        std::vector<AnalogBinding> analog_bindings;
+        std::vector<rawinput::Device *> devices;
+
+        void read_devices();
+    };
 }
 
 #include "button.h"
@@ -42,6 +42,7 @@ private:
     double debounce_up = 0.0;
     double debounce_down = 0.0;
     bool invert = false;
+    GameAPI::DeviceCache device_cache;
 
     GameAPI::Buttons::State last_state = GameAPI::Buttons::BUTTON_NOT_PRESSED;
     float last_velocity = 0.f;
@@ -82,6 +83,7 @@ public:
         vKey = 0xFF;
         alternatives.clear();
         device_identifier = "";
+        device_cache = {};
         analog_type = BAT_NONE;
     }
 
@@ -101,6 +103,11 @@ public:
 
     inline void setDeviceIdentifier(std::string new_device_identifier) {
         this->device_identifier = std::move(new_device_identifier);
+        this->device_cache = {};
+    }
+
+    inline GameAPI::DeviceCache &getDeviceCache() {
+        return this->device_cache;
     }
 
     inline unsigned short getVKey() const {
@@ -1,4 +1,9 @@
 #include "config.h"
+
+#include <cstdlib>
+
+#include <windows.h>
+
 #include "util/logging.h"
 
 /*
@@ -10,6 +15,9 @@
 // settings
 std::string CONFIG_PATH_OVERRIDE = "";
 
+// state
+static Config *CONFIG_INSTANCE = nullptr;
+
 
 ///////////////////
 /// Constructor ///
@@ -68,6 +76,13 @@ Config::Config() {
     } while (configLoadError != tinyxml2::XMLError::XML_SUCCESS);
 
     this->configFile.SetBOM(true);
+    this->indexGames();
+
+    // don't lose changes which are still waiting for the save thread
+    CONFIG_INSTANCE = this;
+    std::atexit([]() {
+        Config::flush();
+    });
 }
 
 ////////////////////////
@@ -83,24 +98,25 @@ bool Config::getStatus() {
     return this->status;
 }
 
-bool Config::addGame(Game &game) {
-    tinyxml2::XMLNode *rootNode = this->configFile.LastChild();
-    tinyxml2::XMLElement *gameNodes = rootNode->FirstChildElement("game");
-
-    bool gameExists = false;
+void Config::flush() {
+    if (CONFIG_INSTANCE == nullptr) {
+        return;
+    }
 
-    while (gameNodes != nullptr) {
-        const char *gameName = gameNodes->Attribute("name");
+    std::unique_lock<std::mutex> lock(CONFIG_INSTANCE->mutex);
+    if (CONFIG_INSTANCE->saveDirty) {
+        CONFIG_INSTANCE->saveWrite(lock);
+    }
+}
 
-        if (gameName == nullptr) {
-            rootNode->DeleteChild(gameNodes);
-        } else if (std::string(gameName) == game.getGameName()) {
-            gameExists = true;
-            break;
-        }
+bool Config::addGame(Game &game) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    tinyxml2::XMLNode *rootNode = this->configFile.LastChild();
 
-        gameNodes = gameNodes->NextSiblingElement("game");
-    }
+    // find game
+    auto gameIndex = this->findGame(game.getGameName());
+    bool gameExists = gameIndex != nullptr;
+    tinyxml2::XMLElement *gameNodes = gameExists ? gameIndex->node : nullptr;
 
     if (gameExists) {
 
@@ -439,422 +455,194 @@ bool Config::addGame(Game &game) {
         }
 
         rootNode->InsertEndChild(gameNode);
+        gameNodes = gameNode;
     }
 
-    // save config
-    this->configFile.SaveFile(this->configLocation.c_str(), false);
+    // update index and save config
+    this->indexGame(gameNodes);
+    this->saveSchedule();
 
     // return success
     return true;
 }
 
 bool Config::updateBinding(const Game &game, const Button &button, int alternative) {
-
-    // get root node
-    tinyxml2::XMLNode *rootNode = this->configFile.LastChild();
+    std::lock_guard<std::mutex> lock(this->mutex);
 
     // find game
-    tinyxml2::XMLElement *gameNodes = rootNode->FirstChildElement("game");
-    bool gameExists = false;
-    while (gameNodes != nullptr) {
-        const char *gameNodeName = gameNodes->Attribute("name");
-
-        if (gameNodeName == nullptr) {
-            rootNode->DeleteChild(gameNodes);
-        } else if (std::string(gameNodeName) == game.getGameName()) {
-            gameExists = true;
-            break;
-        }
-
-        gameNodes = gameNodes->NextSiblingElement("game");
-    }
-
-    // if game doesn't exist
-    if (!gameExists) {
+    auto gameIndex = this->findGame(game.getGameName());
+    if (gameIndex == nullptr || gameIndex->buttonsNode == nullptr) {
         return false;
     }
 
-    // get button nodes
-    tinyxml2::XMLElement *gameButtonsNode = gameNodes->FirstChildElement("buttons");
-    if (gameButtonsNode == nullptr) {
+    // check if there are any buttons at all
+    if (gameIndex->buttons.empty()) {
         return false;
     }
 
-    // iterate button nodes
-    tinyxml2::XMLElement *gameButtonNode = gameButtonsNode->FirstChildElement("button");
-    int button_count = 0;
-    while (gameButtonNode != nullptr) {
-        const char *buttonNodeName = gameButtonNode->Attribute("name");
-
-        if (buttonNodeName == nullptr) {
-            gameButtonsNode->DeleteChild(gameButtonNode);
-        } else if (std::string(buttonNodeName) == button.getName()) {
-            if (button_count++ == alternative + 1 || alternative < 0) {
-                gameButtonNode->SetAttribute("vkey", button.getVKey());
-                gameButtonNode->SetAttribute("analogtype", (int) button.getAnalogType());
-                gameButtonNode->SetAttribute("debounce_up", button.getDebounceUp());
-                gameButtonNode->SetAttribute("debounce_down", button.getDebounceDown());
-                gameButtonNode->SetAttribute("invert", button.getInvert());
-                gameButtonNode->SetAttribute("devid", button.getDeviceIdentifier().c_str());
-                break;
-            }
-        }
-
-        gameButtonNode = gameButtonNode->NextSiblingElement("button");
-
-        if (gameButtonNode == nullptr) {
-            gameButtonNode = this->configFile.NewElement("button");
-            gameButtonNode->SetAttribute("name", button.getName().c_str());
-            gameButtonNode->SetAttribute("vkey", 0xFF);
-            gameButtonNode->SetAttribute("analogtype", 0);
-            gameButtonNode->SetAttribute("debounce_up", 0.0);
-            gameButtonNode->SetAttribute("debounce_down", 0.0);
-            gameButtonNode->SetAttribute("invert", false);
-            gameButtonNode->SetAttribute("devid", "");
-            gameButtonsNode->InsertEndChild(gameButtonNode);
-        }
-    }
-
-    // check if button was not found
-    if (button_count == 0) {
-        return false;
-    }
+    // add nodes until the alternative exists
+    auto &buttonNodes = gameIndex->buttons[button.getName()];
+    size_t position = alternative < 0 ? 0 : static_cast<size_t>(alternative) + 1;
+    while (buttonNodes.size() <= position) {
+        tinyxml2::XMLElement *gameButtonNode = this->configFile.NewElement("button");
+        gameButtonNode->SetAttribute("name", button.getName().c_str());
+        gameButtonNode->SetAttribute("vkey", 0xFF);
+        gameButtonNode->SetAttribute("analogtype", 0);
+        gameButtonNode->SetAttribute("debounce_up", 0.0);
+        gameButtonNode->SetAttribute("debounce_down", 0.0);
+        gameButtonNode->SetAttribute("invert", false);
+        gameButtonNode->SetAttribute("devid", "");
+        gameIndex->buttonsNode->InsertEndChild(gameButtonNode);
+        buttonNodes.push_back(gameButtonNode);
+    }
+
+    // update button
+    tinyxml2::XMLElement *gameButtonNode = buttonNodes[position];
+    gameButtonNode->SetAttribute("vkey", button.getVKey());
+    gameButtonNode->SetAttribute("analogtype", (int) button.getAnalogType());
+    gameButtonNode->SetAttribute("debounce_up", button.getDebounceUp());
+    gameButtonNode->SetAttribute("debounce_down", button.getDebounceDown());
+    gameButtonNode->SetAttribute("invert", button.getInvert());
+    gameButtonNode->SetAttribute("devid", button.getDeviceIdentifier().c_str());
 
     // save config
-    this->configFile.SaveFile(this->configLocation.c_str(), false);
+    gameIndex->parsed = false;
+    this->saveSchedule();
 
     // return success
     return true;
 }
 
 bool Config::updateBinding(const Game &game, const Analog &analog) {
-    tinyxml2::XMLNode *rootNode = this->configFile.LastChild();
-    tinyxml2::XMLElement *gameNodes = rootNode->FirstChildElement("game");
+    std::lock_guard<std::mutex> lock(this->mutex);
 
-    bool gameExists = false;
-
-    while (gameNodes != nullptr) {
-        const char *gameNodeName = gameNodes->Attribute("name");
-
-        if (gameNodeName == nullptr) {
-            rootNode->DeleteChild(gameNodes);
-        } else if (std::string(gameNodeName) == game.getGameName()) {
-            gameExists = true;
-            break;
-        }
-
-        gameNodes = gameNodes->NextSiblingElement("game");
-    }
-
-    if (!gameExists) {
-        return false;
-    }
-
-    // update buttons
-    tinyxml2::XMLElement *gameAnalogsNode = gameNodes->FirstChildElement("analogs");
-    if (gameAnalogsNode == nullptr) {
+    // find game
+    auto gameIndex = this->findGame(game.getGameName());
+    if (gameIndex == nullptr || gameIndex->analogsNode == nullptr) {
         return false;
     }
 
-    bool analogExists = false;
-    tinyxml2::XMLElement *gameAnalogNode = gameAnalogsNode->FirstChildElement("analog");
-
-    while (gameAnalogNode != nullptr) {
-        const char *analogNodeName = gameAnalogNode->Attribute("name");
-
-        if (analogNodeName == nullptr) {
-            gameAnalogsNode->DeleteChild(gameAnalogNode);
-        } else if (std::string(analogNodeName) == analog.getName()) {
-            analogExists = true;
-            break;
-        }
-
-        gameAnalogNode = gameAnalogNode->NextSiblingElement("analog");
-    }
-
-    if (analogExists) {
-        gameAnalogNode->SetAttribute("index", analog.getIndex());
-        gameAnalogNode->SetAttribute("sensivity", analog.getSensitivity());
-        gameAnalogNode->SetAttribute("deadzone", analog.getDeadzone());
-        gameAnalogNode->SetAttribute("deadzone_mirror", analog.getDeadzoneMirror());
-        gameAnalogNode->SetAttribute("invert", analog.getInvert());
-        gameAnalogNode->SetAttribute("smoothing", analog.getSmoothing());
-        gameAnalogNode->SetAttribute("devid", analog.getDeviceIdentifier().c_str());
-    } else {
+    // find or create analog
+    auto &gameAnalogNode = gameIndex->analogs[analog.getName()];
+    if (gameAnalogNode == nullptr) {
         gameAnalogNode = this->configFile.NewElement("analog");
-        gameAnalogNode->SetAttribute("index", analog.getIndex());
-        gameAnalogNode->SetAttribute("sensivity", analog.getSensitivity());
-        gameAnalogNode->SetAttribute("deadzone", analog.getDeadzone());
-        gameAnalogNode->SetAttribute("deadzone_mirror", analog.getDeadzoneMirror());
-        gameAnalogNode->SetAttribute("invert", analog.getInvert());
-        gameAnalogNode->SetAttribute("smoothing", analog.getSmoothing());
-        gameAnalogNode->SetAttribute("devid", analog.getDeviceIdentifier().c_str());
-        gameAnalogsNode->InsertEndChild(gameAnalogNode);
+        gameAnalogNode->SetAttribute("name", analog.getName().c_str());
+        gameIndex->analogsNode->InsertEndChild(gameAnalogNode);
     }
 
-    this->configFile.SaveFile(this->configLocation.c_str(), false);
+    // update analog
+    gameAnalogNode->SetAttribute("index", analog.getIndex());
+    gameAnalogNode->SetAttribute("sensivity", analog.getSensitivity());
+    gameAnalogNode->SetAttribute("deadzone", analog.getDeadzone());
+    gameAnalogNode->SetAttribute("deadzone_mirror", analog.getDeadzoneMirror());
+    gameAnalogNode->SetAttribute("invert", analog.getInvert());
+    gameAnalogNode->SetAttribute("smoothing", analog.getSmoothing());
+    gameAnalogNode->SetAttribute("devid", analog.getDeviceIdentifier().c_str());
+
+    gameIndex->parsed = false;
+    this->saveSchedule();
 
     return true;
 }
 
 bool Config::updateBinding(const Game &game, ConfigKeypadBindings &keypads) {
-    tinyxml2::XMLNode *rootNode = this->configFile.LastChild();
-    tinyxml2::XMLElement *gameNodes = rootNode->FirstChildElement("game");
-
-    bool gameExists = false;
-
-    while (gameNodes != nullptr) {
-        const char *gameNodeName = gameNodes->Attribute("name");
-
-        if (gameNodeName == nullptr) {
-            rootNode->DeleteChild(gameNodes);
-        } else if (std::string(gameNodeName) == game.getGameName()) {
-            gameExists = true;
-            break;
-        }
-
-        gameNodes = gameNodes->NextSiblingElement("game");
-    }
+    std::lock_guard<std::mutex> lock(this->mutex);
 
-    if (!gameExists) {
+    // find game
+    auto gameIndex = this->findGame(game.getGameName());
+    if (gameIndex == nullptr) {
         return false;
     }
 
     // update keypads
-    tinyxml2::XMLElement *gameKeypadNode = gameNodes->FirstChildElement("keypads");
-    if (gameKeypadNode == nullptr) {
-        gameKeypadNode = this->configFile.NewElement("keypads");
-        gameNodes->InsertEndChild(gameKeypadNode);
+    if (gameIndex->keypadsNode == nullptr) {
+        gameIndex->keypadsNode = this->configFile.NewElement("keypads");
+        gameIndex->node->InsertEndChild(gameIndex->keypadsNode);
     }
 
     // update attributes
+    auto gameKeypadNode = gameIndex->keypadsNode;
     gameKeypadNode->SetAttribute("devid1", keypads.keypads[0].c_str());
     gameKeypadNode->SetAttribute("devid2", keypads.keypads[1].c_str());
     gameKeypadNode->SetAttribute("cardpath1", reinterpret_cast<const char *>(keypads.card_paths[0].u8string().c_str()));
     gameKeypadNode->SetAttribute("cardpath2", reinterpret_cast<const char *>(keypads.card_paths[1].u8string().c_str()));
 
-    this->configFile.SaveFile(this->configLocation.c_str(), false);
+    gameIndex->parsed = false;
+    this->saveSchedule();
 
     return true;
 }
 
 bool Config::updateBinding(const Game &game, const Light &light, int alternative) {
+    std::lock_guard<std::mutex> lock(this->mutex);
 
-    // get root node and find game
-    tinyxml2::XMLNode *rootNode = this->configFile.LastChild();
-    tinyxml2::XMLElement *gameNodes = rootNode->FirstChildElement("game");
-
-    bool gameExists = false;
-
-    while (gameNodes != nullptr) {
-        const char *gameNodeName = gameNodes->Attribute("name");
-        if (gameNodeName == nullptr) {
-            rootNode->DeleteChild(gameNodes);
-        } else if (std::string(gameNodeName) == game.getGameName()) {
-            gameExists = true;
-            break;
-        }
-        gameNodes = gameNodes->NextSiblingElement("game");
-    }
-
-    // if game does not exist
-    if (!gameExists) {
+    // find game
+    auto gameIndex = this->findGame(game.getGameName());
+    if (gameIndex == nullptr || gameIndex->lightsNode == nullptr) {
         return false;
     }
 
-    // get light nodes
-    tinyxml2::XMLElement *gameLightsNode = gameNodes->FirstChildElement("lights");
-    if (gameLightsNode == nullptr) {
+    // check if there are any lights at all
+    if (gameIndex->lights.empty()) {
         return false;
     }
 
-    // iterate light nodes
-    tinyxml2::XMLElement *gameLightNode = gameLightsNode->FirstChildElement("light");
-    int light_count = 0;
-    while (gameLightNode != nullptr) {
-        const char *lightNodeName = gameLightNode->Attribute("name");
-
-        if (lightNodeName == nullptr) {
-            gameLightsNode->DeleteChild(gameLightNode);
-        } else if (std::string(lightNodeName) == light.getName()) {
-            if (light_count++ == alternative + 1 || alternative < 0) {
-                gameLightNode->SetAttribute("index", light.getIndex());
-                gameLightNode->SetAttribute("devid", light.getDeviceIdentifier().c_str());
-                break;
-            }
-        }
-
-        gameLightNode = gameLightNode->NextSiblingElement("light");
-
-        if (gameLightNode == nullptr) {
-            gameLightNode = this->configFile.NewElement("light");
-            gameLightNode->SetAttribute("name", light.getName().c_str());
-            gameLightNode->SetAttribute("index", 0);
-            gameLightNode->SetAttribute("devid", "");
-            gameLightsNode->InsertEndChild(gameLightNode);
-        }
+    // add nodes until the alternative exists
+    auto &lightNodes = gameIndex->lights[light.getName()];
+    size_t position = alternative < 0 ? 0 : static_cast<size_t>(alternative) + 1;
+    while (lightNodes.size() <= position) {
+        tinyxml2::XMLElement *gameLightNode = this->configFile.NewElement("light");
+        gameLightNode->SetAttribute("name", light.getName().c_str());
+        gameLightNode->SetAttribute("index", 0);
+        gameLightNode->SetAttribute("devid", "");
+        gameIndex->lightsNode->InsertEndChild(gameLightNode);
+        lightNodes.push_back(gameLightNode);
     }
 
-    // check if light was not found
-    if (light_count == 0) {
-        return false;
-    }
+    // update light
+    tinyxml2::XMLElement *gameLightNode = lightNodes[position];
+    gameLightNode->SetAttribute("index", light.getIndex());
+    gameLightNode->SetAttribute("devid", light.getDeviceIdentifier().c_str());
 
     // save config
-    this->configFile.SaveFile(this->configLocation.c_str(), false);
+    gameIndex->parsed = false;
+    this->saveSchedule();
 
     // return success
     return true;
 }
 
 bool Config::updateBinding(const Game &game, const Option &option) {
-    tinyxml2::XMLNode *rootNode = this->configFile.LastChild();
-    tinyxml2::XMLElement *gameNodes = rootNode->FirstChildElement("game");
-
-    bool gameExists = false;
-
-    while (gameNodes != nullptr) {
-        const char *gameNodeName = gameNodes->Attribute("name");
+    std::lock_guard<std::mutex> lock(this->mutex);
 
-        if (gameNodeName == nullptr) {
-            rootNode->DeleteChild(gameNodes);
-        } else if (std::string(gameNodeName) == game.getGameName()) {
-            gameExists = true;
-            break;
-        }
-
-        gameNodes = gameNodes->NextSiblingElement("game");
-    }
-
-    if (!gameExists) {
-        return false;
-    }
-
-    // update options
-    tinyxml2::XMLElement *gameOptionsNode = gameNodes->FirstChildElement("options");
-    if (gameOptionsNode == nullptr) {
+    // find game
+    auto gameIndex = this->findGame(game.getGameName());
+    if (gameIndex == nullptr || gameIndex->optionsNode == nullptr) {
         return false;
     }
-    bool optionExists = false;
-
-    tinyxml2::XMLElement *gameOptionNode = gameOptionsNode->FirstChildElement("option");
-    while (gameOptionNode != nullptr) {
-        const char *optionNodeName = gameOptionNode->Attribute("name");
-
-        if (optionNodeName == nullptr) {
-            gameOptionsNode->DeleteChild(gameOptionNode);
-        } else if (std::string(optionNodeName) == option.get_definition().name) {
-            optionExists = true;
-            break;
-        }
-
-        gameOptionNode = gameOptionNode->NextSiblingElement("option");
-    }
 
-    if (optionExists) {
-        gameOptionNode->SetAttribute("value", option.value.c_str());
-    } else {
+    // find or create option
+    auto &gameOptionNode = gameIndex->options[option.get_definition().name];
+    if (gameOptionNode == nullptr) {
         gameOptionNode = this->configFile.NewElement("option");
         gameOptionNode->SetAttribute("name", option.get_definition().name.c_str());
-        gameOptionNode->SetAttribute("value", option.value.c_str());
-        gameOptionsNode->InsertEndChild(gameOptionNode);
+        gameIndex->optionsNode->InsertEndChild(gameOptionNode);
     }
+    gameOptionNode->SetAttribute("value", option.value.c_str());
 
-    this->configFile.SaveFile(this->configLocation.c_str(), false);
+    gameIndex->parsed = false;
+    this->saveSchedule();
 
     return true;
 }
 
 std::vector<Button> Config::getButtons(const std::string &gameName) {
-    std::vector<Button> buttons;
-
-    tinyxml2::XMLNode *rootNode = this->configFile.LastChild();
-    tinyxml2::XMLElement *gameNodes = rootNode->FirstChildElement("game");
-
-    bool gameExists = false;
-
-    while (gameNodes != nullptr) {
-        const char *gameNodeName = gameNodes->Attribute("name");
-
-        if (gameNodeName == nullptr) {
-            rootNode->DeleteChild(gameNodes);
-        } else if (std::string(gameNodeName) == gameName) {
-            gameExists = true;
-            break;
-        }
-        gameNodes = gameNodes->NextSiblingElement("game");
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto gameIndex = this->findGameParsed(gameName);
+    if (gameIndex == nullptr) {
+        return {};
     }
-    if (gameExists) {
-
-        // get buttons node
-        tinyxml2::XMLElement *gameButtonsNode = gameNodes->FirstChildElement("buttons");
-        if (gameButtonsNode == nullptr) {
-            return buttons;
-        }
-
-        // iterate all buttons
-        tinyxml2::XMLElement *gameButtonNode = gameButtonsNode->FirstChildElement("button");
-        while (gameButtonNode != nullptr) {
-            const char *buttonNodeName = nullptr;
-            buttonNodeName = gameButtonNode->Attribute("name");
-            if (buttonNodeName == nullptr) {
-                gameButtonsNode->DeleteChild(gameButtonNode);
-            } else {
-
-                // get attributes
-                int vKey = 0xFF;
-                auto analogType = (int) BAT_NONE;
-                double debounce_up = 0.0;
-                double debounce_down = 0.0;
-                bool invert = false;
-                gameButtonNode->QueryIntAttribute("vkey", &vKey);
-                gameButtonNode->QueryIntAttribute("analogtype", &analogType);
-                gameButtonNode->QueryDoubleAttribute("debounce_up", &debounce_up);
-                gameButtonNode->QueryDoubleAttribute("debounce_down", &debounce_down);
-                gameButtonNode->QueryBoolAttribute("invert", &invert);
-                const char *devid = gameButtonNode->Attribute("devid");
-
-                // find alternative
-                bool alternative_found = false;
-                for (auto &button : buttons) {
-                    if (button.getName() == std::string(buttonNodeName)) {
-                        auto &alternatives = button.getAlternatives();
-                        auto &alt = alternatives.emplace_back(buttonNodeName);
-                        alt.setVKey((unsigned short) vKey);
-                        alt.setAnalogType((ButtonAnalogType) analogType);
-                        alt.setDebounceUp(debounce_up);
-                        alt.setDebounceDown(debounce_down);
-                        alt.setInvert(invert);
-                        if (devid) {
-                            alt.setDeviceIdentifier(std::string(devid));
-                        }
-                        alternative_found = true;
-                        break;
-                    }
-                }
-
-                // if no alternative was found
-                if (!alternative_found) {
-
-                    // create button and add to list
-                    auto &button = buttons.emplace_back(buttonNodeName);
-                    button.setVKey((unsigned short) vKey);
-                    button.setAnalogType((ButtonAnalogType) analogType);
-                    button.setDebounceUp(debounce_up);
-                    button.setDebounceDown(debounce_down);
-                    button.setInvert(invert);
-                    if (devid) {
-                        button.setDeviceIdentifier(devid);
-                    }
-                }
-            }
-
-            // get next button
-            gameButtonNode = gameButtonNode->NextSiblingElement("button");
-        }
-    }
-
-    return buttons;
+    return gameIndex->buttonsParsed;
 }
 
 std::vector<Button> Config::getButtons(Game *game) {
@@ -862,81 +650,12 @@ std::vector<Button> Config::getButtons(Game *game) {
 }
 
 std::vector<Light> Config::getLights(const std::string &gameName) {
-    std::vector<Light> lights;
-
-    tinyxml2::XMLNode *rootNode = this->configFile.LastChild();
-    tinyxml2::XMLElement *gameNodes = rootNode->FirstChildElement("game");
-
-    bool gameExists = false;
-
-    while (gameNodes != nullptr) {
-        const char *gameNodeName = gameNodes->Attribute("name");
-
-        if (gameNodeName == nullptr) {
-            rootNode->DeleteChild(gameNodes);
-        } else if (std::string(gameNodeName) == gameName) {
-            gameExists = true;
-            break;
-        }
-
-        gameNodes = gameNodes->NextSiblingElement("game");
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto gameIndex = this->findGameParsed(gameName);
+    if (gameIndex == nullptr) {
+        return {};
     }
-
-    if (gameExists) {
-
-        // get lights node
-        tinyxml2::XMLElement *gameLightsNode = gameNodes->FirstChildElement("lights");
-        if (gameLightsNode == nullptr) {
-            return lights;
-        }
-
-        // iterate all lights
-        tinyxml2::XMLElement *gameLightNode = gameLightsNode->FirstChildElement("light");
-        while (gameLightNode != nullptr) {
-            const char *lightNodeName = nullptr;
-            lightNodeName = gameLightNode->Attribute("name");
-            if (lightNodeName == nullptr) {
-                gameLightsNode->DeleteChild(gameLightNode);
-            } else {
-
-                // get attributes
-                int index = 0;
-                gameLightNode->QueryIntAttribute("index", &index);
-                const char* devid = gameLightNode->Attribute("devid");
-
-                // find alternative
-                bool alternative_found = false;
-                for (auto &light : lights) {
-                    if (light.getName() == std::string(lightNodeName)) {
-                        auto &alternatives = light.getAlternatives();
-                        auto &alt = alternatives.emplace_back(lightNodeName);
-                        alt.setIndex((unsigned int) index);
-                        if (devid) {
-                            alt.setDeviceIdentifier(devid);
-                        }
-                        alternative_found = true;
-                        break;
-                    }
-                }
-
-                // if no alternative was found
-                if (!alternative_found) {
-
-                    // create light and add to lights
-                    auto &light = lights.emplace_back(lightNodeName);
-                    light.setIndex((unsigned int) index);
-                    if (devid) {
-                        light.setDeviceIdentifier(devid);
-                    }
-                }
-            }
-
-            // get next light
-            gameLightNode = gameLightNode->NextSiblingElement("light");
-        }
-    }
-
-    return lights;
+    return gameIndex->lightsParsed;
 }
 
 std::vector<Light> Config::getLights(Game *game) {
@@ -944,217 +663,353 @@ std::vector<Light> Config::getLights(Game *game) {
 }
 
 std::vector<Analog> Config::getAnalogs(const std::string &gameName) {
-    std::vector<Analog> analogs;
-
-    tinyxml2::XMLNode *rootNode = this->configFile.LastChild();
-    tinyxml2::XMLElement *gameNodes = rootNode->FirstChildElement("game");
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto gameIndex = this->findGameParsed(gameName);
+    if (gameIndex == nullptr) {
+        return {};
+    }
+    return gameIndex->analogsParsed;
+}
 
-    bool gameExists = false;
+std::vector<Analog> Config::getAnalogs(Game *game) {
+    return this->getAnalogs(game->getGameName());
+}
 
-    while (gameNodes != nullptr) {
-        const char *gameNodeName = gameNodes->Attribute("name");
+ConfigKeypadBindings Config::getKeypadBindings(const std::string &gameName) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto gameIndex = this->findGameParsed(gameName);
+    if (gameIndex == nullptr) {
+        return {};
+    }
+    return gameIndex->keypadsParsed;
+}
 
-        if (gameNodeName == nullptr) {
-            rootNode->DeleteChild(gameNodes);
-        } else if (std::string(gameNodeName) == gameName) {
-            gameExists = true;
-            break;
-        }
+ConfigKeypadBindings Config::getKeypadBindings(Game *game) {
+    return this->getKeypadBindings(game->getGameName());
+}
 
-        gameNodes = gameNodes->NextSiblingElement("game");
+std::vector<Option> Config::getOptions(const std::string &gameName) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto gameIndex = this->findGameParsed(gameName);
+    if (gameIndex == nullptr) {
+        return {};
     }
-    if (gameExists) {
-        tinyxml2::XMLElement *gameAnalogsNode = gameNodes->FirstChildElement("analogs");
-        if (gameAnalogsNode == nullptr) {
-            return analogs;
-        }
+    return gameIndex->optionsParsed;
+}
 
-        tinyxml2::XMLElement *gameAnalogNode = gameAnalogsNode->FirstChildElement("analog");
+std::vector<Option> Config::getOptions(Game *game) {
+    return this->getOptions(game->getGameName());
+}
 
-        while (gameAnalogNode != nullptr) {
-            const char *analogNodeName = gameAnalogNode->Attribute("name");
+/////////////////////////
+/// Private Functions ///
+/////////////////////////
 
-            if (analogNodeName == nullptr) {
-                gameAnalogsNode->DeleteChild(gameAnalogNode);
-            } else {
+bool Config::createConfigFile() {
+    std::ofstream ofsConfig;
+    ofsConfig.open(this->configLocation);
+    if (!ofsConfig.is_open() || ofsConfig.fail() || ofsConfig.bad()) {
+        this->status = false;
+        return false;
+    }
+    ofsConfig.close();
+    return this->firstFillConfigFile();
+}
 
-                // get attributes
-                int index = 0xFF;
-                float sensitivity = 1.f;
-                float deadzone = 0.f;
-                bool deadzone_mirror = false;
-                bool invert = false;
-                bool smoothing = false;
-                gameAnalogNode->QueryIntAttribute("index", &index);
-                gameAnalogNode->QueryFloatAttribute("sensivity", &sensitivity);
-                gameAnalogNode->QueryFloatAttribute("deadzone", &deadzone);
-                gameAnalogNode->QueryBoolAttribute("deadzone_mirror", &deadzone_mirror);
-                gameAnalogNode->QueryBoolAttribute("invert", &invert);
-                gameAnalogNode->QueryBoolAttribute("smoothing", &smoothing);
-                const char *devid = gameAnalogNode->Attribute("devid");
+bool Config::firstFillConfigFile() {
+    this->configFile.LoadFile(this->configLocation.c_str());
+    this->configFile.Clear();
 
-                // create analog and add to list
-                auto &analog = analogs.emplace_back(analogNodeName);
-                analog.setIndex((unsigned short) index);
-                analog.setSensitivity(sensitivity);
-                analog.setDeadzone(deadzone);
-                analog.setDeadzoneMirror(deadzone_mirror);
-                analog.setInvert(invert);
-                analog.setSmoothing(smoothing);
-                if (devid) {
-                    analog.setDeviceIdentifier(devid);
-                }
-            }
+    tinyxml2::XMLNode *declarationNode = this->configFile.NewDeclaration();
+    this->configFile.InsertFirstChild(declarationNode);
 
-            gameAnalogNode = gameAnalogNode->NextSiblingElement("analog");
-        }
-    }
+    tinyxml2::XMLNode *rootNode = this->configFile.NewElement("games");
+    this->configFile.InsertEndChild(rootNode);
 
-    return analogs;
+    this->configFile.SaveFile(this->configLocation.c_str(), false);
+    return true;
 }
 
-std::vector<Analog> Config::getAnalogs(Game *game) {
-    return this->getAnalogs(game->getGameName());
+/*
+ * Calls callback(name, node) for every child element with the given tag.
+ * Nodes without a name are removed on the way.
+ */
+template<typename T>
+static void config_nodes(tinyxml2::XMLElement *parentNode, const char *tag, T callback) {
+    if (parentNode == nullptr) {
+        return;
+    }
+
+    tinyxml2::XMLElement *node = parentNode->FirstChildElement(tag);
+    while (node != nullptr) {
+        tinyxml2::XMLElement *next = node->NextSiblingElement(tag);
+        const char *name = node->Attribute("name");
+        if (name == nullptr) {
+            parentNode->DeleteChild(node);
+        } else {
+            callback(name, node);
+        }
+        node = next;
+    }
 }
 
-ConfigKeypadBindings Config::getKeypadBindings(const std::string &gameName) {
-    ConfigKeypadBindings bindings {};
+void Config::indexGames() {
+    this->games.clear();
 
+    // index the first node of every game
     tinyxml2::XMLNode *rootNode = this->configFile.LastChild();
-    tinyxml2::XMLElement *gameNodes = rootNode->FirstChildElement("game");
-
-    bool gameExists = false;
-
-    while (gameNodes != nullptr) {
-        const char *gameNodeName = gameNodes->Attribute("name");
-
-        if (gameNodeName == nullptr) {
-            rootNode->DeleteChild(gameNodes);
-        } else if (std::string(gameNodeName) == gameName) {
-            gameExists = true;
-            break;
+    if (rootNode == nullptr) {
+        return;
+    }
+    config_nodes(rootNode->ToElement(), "game", [this](const char *name, tinyxml2::XMLElement *node) {
+        if (this->games.find(name) == this->games.end()) {
+            this->indexGame(node);
         }
+    });
+}
 
-        gameNodes = gameNodes->NextSiblingElement("game");
+Config::GameIndex &Config::indexGame(tinyxml2::XMLElement *gameNode) {
+    auto &gameIndex = this->games[gameNode->Attribute("name")];
+    gameIndex = GameIndex {};
+    gameIndex.node = gameNode;
+
+    // containers
+    gameIndex.buttonsNode = gameNode->FirstChildElement("buttons");
+    gameIndex.analogsNode = gameNode->FirstChildElement("analogs");
+    gameIndex.lightsNode = gameNode->FirstChildElement("lights");
+    gameIndex.optionsNode = gameNode->FirstChildElement("options");
+    gameIndex.keypadsNode = gameNode->FirstChildElement("keypads");
+
+    // controls, the first analog/option with a name wins just like in the lookups before
+    config_nodes(gameIndex.buttonsNode, "button", [&gameIndex](const char *name, tinyxml2::XMLElement *node) {
+        gameIndex.buttons[name].push_back(node);
+    });
+    config_nodes(gameIndex.analogsNode, "analog", [&gameIndex](const char *name, tinyxml2::XMLElement *node) {
+        gameIndex.analogs.emplace(name, node);
+    });
+    config_nodes(gameIndex.lightsNode, "light", [&gameIndex](const char *name, tinyxml2::XMLElement *node) {
+        gameIndex.lights[name].push_back(node);
+    });
+    config_nodes(gameIndex.optionsNode, "option", [&gameIndex](const char *name, tinyxml2::XMLElement *node) {
+        gameIndex.options.emplace(name, node);
+    });
+
+    return gameIndex;
+}
+
+Config::GameIndex *Config::findGame(const std::string &gameName) {
+    auto it = this->games.find(gameName);
+    if (it == this->games.end()) {
+        return nullptr;
     }
+    return &it->second;
+}
 
-    if (gameExists) {
-        tinyxml2::XMLElement *gameKeypadNode = gameNodes->FirstChildElement("keypads");
-        if (gameKeypadNode == nullptr) {
-            return bindings;
-        }
+Config::GameIndex *Config::findGameParsed(const std::string &gameName) {
+    auto gameIndex = this->findGame(gameName);
+    if (gameIndex != nullptr && !gameIndex->parsed) {
+        this->parseGame(*gameIndex);
+    }
+    return gameIndex;
+}
 
-        // set bindings
+void Config::parseGame(GameIndex &game) {
+    game.buttonsParsed.clear();
+    game.analogsParsed.clear();
+    game.lightsParsed.clear();
+    game.optionsParsed.clear();
+    game.keypadsParsed = {};
+
+    // buttons, repeated names are alternatives of the first one
+    std::unordered_map<std::string, size_t> buttonPositions;
+    config_nodes(game.buttonsNode, "button", [&](const char *name, tinyxml2::XMLElement *node) {
+
+        // get attributes
+        int vKey = 0xFF;
+        auto analogType = (int) BAT_NONE;
+        double debounce_up = 0.0;
+        double debounce_down = 0.0;
+        bool invert = false;
+        node->QueryIntAttribute("vkey", &vKey);
+        node->QueryIntAttribute("analogtype", &analogType);
+        node->QueryDoubleAttribute("debounce_up", &debounce_up);
+        node->QueryDoubleAttribute("debounce_down", &debounce_down);
+        node->QueryBoolAttribute("invert", &invert);
+        const char *devid = node->Attribute("devid");
+
+        // create button or alternative
+        Button *button;
+        auto position = buttonPositions.find(name);
+        if (position != buttonPositions.end()) {
+            button = &game.buttonsParsed[position->second].getAlternatives().emplace_back(name);
+        } else {
+            buttonPositions.emplace(name, game.buttonsParsed.size());
+            button = &game.buttonsParsed.emplace_back(name);
+        }
+        button->setVKey((unsigned short) vKey);
+        button->setAnalogType((ButtonAnalogType) analogType);
+        button->setDebounceUp(debounce_up);
+        button->setDebounceDown(debounce_down);
+        button->setInvert(invert);
+        if (devid) {
+            button->setDeviceIdentifier(devid);
+        }
+    });
+
+    // analogs
+    config_nodes(game.analogsNode, "analog", [&](const char *name, tinyxml2::XMLElement *node) {
+
+        // get attributes
+        int index = 0xFF;
+        float sensitivity = 1.f;
+        float deadzone = 0.f;
+        bool deadzone_mirror = false;
+        bool invert = false;
+        bool smoothing = false;
+        node->QueryIntAttribute("index", &index);
+        node->QueryFloatAttribute("sensivity", &sensitivity);
+        node->QueryFloatAttribute("deadzone", &deadzone);
+        node->QueryBoolAttribute("deadzone_mirror", &deadzone_mirror);
+        node->QueryBoolAttribute("invert", &invert);
+        node->QueryBoolAttribute("smoothing", &smoothing);
+        const char *devid = node->Attribute("devid");
+
+        // create analog and add to list
+        auto &analog = game.analogsParsed.emplace_back(name);
+        analog.setIndex((unsigned short) index);
+        analog.setSensitivity(sensitivity);
+        analog.setDeadzone(deadzone);
+        analog.setDeadzoneMirror(deadzone_mirror);
+        analog.setInvert(invert);
+        analog.setSmoothing(smoothing);
+        if (devid) {
+            analog.setDeviceIdentifier(devid);
+        }
+    });
+
+    // lights, repeated names are alternatives of the first one
+    std::unordered_map<std::string, size_t> lightPositions;
+    config_nodes(game.lightsNode, "light", [&](const char *name, tinyxml2::XMLElement *node) {
+
+        // get attributes
+        int index = 0;
+        node->QueryIntAttribute("index", &index);
+        const char *devid = node->Attribute("devid");
+
+        // create light or alternative
+        Light *light;
+        auto position = lightPositions.find(name);
+        if (position != lightPositions.end()) {
+            light = &game.lightsParsed[position->second].getAlternatives().emplace_back(name);
+        } else {
+            lightPositions.emplace(name, game.lightsParsed.size());
+            light = &game.lightsParsed.emplace_back(name);
+        }
+        light->setIndex((unsigned int) index);
+        if (devid) {
+            light->setDeviceIdentifier(devid);
+        }
+    });
+
+    // options
+    config_nodes(game.optionsNode, "option", [&](const char *name, tinyxml2::XMLElement *node) {
+        const char *value = node->Attribute("value");
+        game.optionsParsed.emplace_back(OptionDefinition {
+            .title = name,
+            .name = name,
+            .desc = "",
+            .type = OptionType::Text,
+        }, value ? value : "");
+    });
+
+    // keypads
+    if (game.keypadsNode != nullptr) {
         const char *tmp;
-        tmp = gameKeypadNode->Attribute("devid1");
+        tmp = game.keypadsNode->Attribute("devid1");
         if (tmp) {
-            bindings.keypads[0] = std::string(tmp);
+            game.keypadsParsed.keypads[0] = std::string(tmp);
         }
-        tmp = gameKeypadNode->Attribute("devid2");
+        tmp = game.keypadsNode->Attribute("devid2");
         if (tmp) {
-            bindings.keypads[1] = std::string(tmp);
+            game.keypadsParsed.keypads[1] = std::string(tmp);
         }
-        tmp = gameKeypadNode->Attribute("cardpath1");
+        tmp = game.keypadsNode->Attribute("cardpath1");
         if (tmp) {
-            bindings.card_paths[0] = std::u8string(reinterpret_cast<const char8_t *>(tmp));
+            game.keypadsParsed.card_paths[0] = std::u8string(reinterpret_cast<const char8_t *>(tmp));
         }
-        tmp = gameKeypadNode->Attribute("cardpath2");
+        tmp = game.keypadsNode->Attribute("cardpath2");
         if (tmp) {
-            bindings.card_paths[1] = std::u8string(reinterpret_cast<const char8_t *>(tmp));
+            game.keypadsParsed.card_paths[1] = std::u8string(reinterpret_cast<const char8_t *>(tmp));
         }
     }
 
-    return bindings;
-}
-
-ConfigKeypadBindings Config::getKeypadBindings(Game *game) {
-    return this->getKeypadBindings(game->getGameName());
+    game.parsed = true;
 }
 
-std::vector<Option> Config::getOptions(const std::string &gameName) {
-    std::vector<Option> options;
+void Config::saveSchedule() {
 
-    tinyxml2::XMLNode *rootNode = this->configFile.LastChild();
-    tinyxml2::XMLElement *gameNodes = rootNode->FirstChildElement("game");
+    // restart the delay on every change so bursts end up in a single write
+    this->saveDirty = true;
+    this->saveDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(SAVE_DELAY_MS);
 
-    // find game
-    bool gameExists = false;
-    while (gameNodes != nullptr) {
-        const char *gameNodeName = gameNodes->Attribute("name");
-
-        if (gameNodeName == nullptr) {
-            rootNode->DeleteChild(gameNodes);
-        } else if (std::string(gameNodeName) == gameName) {
-            gameExists = true;
-            break;
-        }
-
-        gameNodes = gameNodes->NextSiblingElement("game");
+    // start save thread on first use
+    if (!this->saveThread.joinable()) {
+        this->saveThread = std::thread([this] {
+            this->saveRun();
+        });
     }
+    this->saveCv.notify_one();
+}
 
-    // check if game exists
-    if (gameExists) {
+void Config::saveRun() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        this->saveCv.wait(lock, [this] {
+            return this->saveDirty;
+        });
 
-        // check if options node exists
-        auto gameOptionsNode = gameNodes->FirstChildElement("options");
-        if (gameOptionsNode == nullptr) {
-            return options;
+        // wait until there were no changes for a while
+        while (this->saveDirty && std::chrono::steady_clock::now() < this->saveDeadline) {
+            this->saveCv.wait_until(lock, this->saveDeadline);
         }
 
-        // iterate options
-        auto gameOptionNode = gameOptionsNode->FirstChildElement("option");
-        while (gameOptionNode != nullptr) {
-            const char *optionNodeName = gameOptionNode->Attribute("name");
-
-            if (optionNodeName == nullptr) {
-                gameOptionNode->DeleteChild(gameOptionNode);
-            } else {
-                const char *value = gameOptionNode->Attribute("value");
-
-                options.emplace_back(OptionDefinition {
-                    .title = optionNodeName,
-                    .name = optionNodeName,
-                    .desc = "",
-                    .type = OptionType::Text,
-                }, value);
-            }
-
-            gameOptionNode = gameOptionNode->NextSiblingElement("option");
+        // the changes might have been flushed in the meantime
+        if (this->saveDirty) {
+            this->saveWrite(lock);
         }
     }
-
-    return options;
 }
 
-std::vector<Option> Config::getOptions(Game *game) {
-    return this->getOptions(game->getGameName());
-}
+bool Config::saveWrite(std::unique_lock<std::mutex> &lock) {
 
-/////////////////////////
-/// Private Functions ///
-/////////////////////////
+    // serialize while the document can't change
+    tinyxml2::XMLPrinter printer(nullptr, false);
+    this->configFile.Print(&printer);
+    std::string contents(printer.CStr(), printer.CStrSize() - 1);
+    this->saveDirty = false;
 
-bool Config::createConfigFile() {
-    std::ofstream ofsConfig;
-    ofsConfig.open(this->configLocation);
-    if (!ofsConfig.is_open() || ofsConfig.fail() || ofsConfig.bad()) {
-        this->status = false;
-        return false;
-    }
-    ofsConfig.close();
-    return this->firstFillConfigFile();
-}
-
-bool Config::firstFillConfigFile() {
-    this->configFile.LoadFile(this->configLocation.c_str());
-    this->configFile.Clear();
-
-    tinyxml2::XMLNode *declarationNode = this->configFile.NewDeclaration();
-    this->configFile.InsertFirstChild(declarationNode);
+    // writes happen in the same order as the serialization
+    std::unique_lock<std::mutex> saveLock(this->saveMutex);
+    lock.unlock();
 
-    tinyxml2::XMLNode *rootNode = this->configFile.NewElement("games");
-    this->configFile.InsertEndChild(rootNode);
+    // write to a temporary file and replace the config with it
+    auto tempLocation = this->configLocation + ".tmp";
+    bool success;
+    {
+        std::ofstream out(tempLocation, std::ios::out | std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), contents.size());
+        out.close();
+        success = !out.fail();
+    }
+    if (success) {
+        success = MoveFileExA(tempLocation.c_str(), this->configLocation.c_str(),
+                MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+    }
+    if (!success) {
+        log_warning("cfg", "could not save config file: {}", this->configLocation);
+    }
 
-    this->configFile.SaveFile(this->configLocation.c_str(), false);
-    return true;
+    saveLock.unlock();
+    lock.lock();
+    return success;
 }
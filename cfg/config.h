@@ -1,8 +1,13 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 #include "external/tinyxml2/tinyxml2.h"
 
@@ -16,12 +21,20 @@ struct ConfigKeypadBindings {
     std::filesystem::path card_paths[2];
 };
 
+/*
+ * Bindings are kept in the XML document, with an index of the game and control nodes on top of it.
+ * Reads are served from the index and a parsed copy per game. Changes are written back to disk by a
+ * background thread once no further change was made for a short time.
+ */
 class Config {
 public:
     static Config &getInstance();
     bool getStatus();
     bool createConfigFile();
 
+    // writes pending changes to disk immediately, does nothing if the config was never loaded
+    static void flush();
+
     bool addGame(Game &game);
 
     bool updateBinding(const Game &game, const Button &button, int alternative);
@@ -52,9 +65,54 @@ private:
 
     const Config &operator=(const Config &);
 
+    struct GameIndex {
+        tinyxml2::XMLElement *node = nullptr;
+        tinyxml2::XMLElement *buttonsNode = nullptr;
+        tinyxml2::XMLElement *analogsNode = nullptr;
+        tinyxml2::XMLElement *lightsNode = nullptr;
+        tinyxml2::XMLElement *optionsNode = nullptr;
+        tinyxml2::XMLElement *keypadsNode = nullptr;
+
+        // control nodes by name, alternatives follow in document order
+        std::unordered_map<std::string, std::vector<tinyxml2::XMLElement *>> buttons;
+        std::unordered_map<std::string, tinyxml2::XMLElement *> analogs;
+        std::unordered_map<std::string, std::vector<tinyxml2::XMLElement *>> lights;
+        std::unordered_map<std::string, tinyxml2::XMLElement *> options;
+
+        // parsed bindings, rebuilt after the game was modified
+        bool parsed = false;
+        std::vector<Button> buttonsParsed;
+        std::vector<Analog> analogsParsed;
+        std::vector<Light> lightsParsed;
+        std::vector<Option> optionsParsed;
+        ConfigKeypadBindings keypadsParsed;
+    };
+
+    // save delay after the last change
+    static constexpr int SAVE_DELAY_MS = 500;
+
     tinyxml2::XMLDocument configFile;
     bool status;
     std::string configLocation;
 
+    std::mutex mutex;
+    std::unordered_map<std::string, GameIndex> games;
+
+    std::mutex saveMutex;
+    std::condition_variable saveCv;
+    std::thread saveThread;
+    bool saveDirty = false;
+    std::chrono::steady_clock::time_point saveDeadline;
+
     bool firstFillConfigFile();
+
+    void indexGames();
+    GameIndex &indexGame(tinyxml2::XMLElement *gameNode);
+    GameIndex *findGame(const std::string &gameName);
+    GameIndex *findGameParsed(const std::string &gameName);
+    void parseGame(GameIndex &game);
+
+    void saveSchedule();
+    void saveRun();
+    bool saveWrite(std::unique_lock<std::mutex> &lock);
 };
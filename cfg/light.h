@@ -3,6 +3,8 @@
 #include <string>
 #include <vector>
 
+#include "api.h"
+
 namespace rawinput {
     class RawInputManager;
 }
@@ -12,6 +14,7 @@ private:
     std::vector<Light> alternatives;
     std::string lightName;
     std::string deviceIdentifier = "";
+    GameAPI::DeviceCache deviceCache;
     unsigned int index = 0;
 
 public:
@@ -56,6 +59,11 @@ public:
 
     inline void setDeviceIdentifier(std::string deviceIdentifier) {
         this->deviceIdentifier = std::move(deviceIdentifier);
+        this->deviceCache = {};
+    }
+
+    inline GameAPI::DeviceCache &getDeviceCache() {
+        return this->deviceCache;
     }
 
     inline unsigned int getIndex() const {
@@ -1,5 +1,7 @@
 #include "io.h"
 
+#include "launcher/launcher.h"
+
 std::vector<Button> &games::ddr::get_buttons() {
     static std::vector<Button> analogs;
 
@@ -85,3 +87,9 @@ std::vector<Light> &games::ddr::get_lights() {
 
     return lights;
 }
+
+GameAPI::InputFrame &games::ddr::capture_input() {
+    thread_local GameAPI::InputFrame frame;
+    frame.capture(RI_MGR, get_buttons());
+    return frame;
+}
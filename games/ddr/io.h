@@ -79,4 +79,7 @@ namespace games::ddr {
     // getters
     std::vector<Button> &get_buttons();
     std::vector<Light> &get_lights();
+
+    // samples all buttons in one pass
+    GameAPI::InputFrame &capture_input();
 }
@@ -525,10 +525,10 @@ int games::ddr::DDRP3IOHandle::device_io(
         };
 
         // update states
-        auto &buttons = get_buttons();
+        auto &input = capture_input();
         size_t count = 0;
         for (auto shift : shift_table) {
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(button_table[count++]))) {
+            if (input.button(button_table[count++])) {
                 controls |= 1 << shift;
             }
         }
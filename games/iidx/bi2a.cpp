@@ -82,63 +82,63 @@ bool games::iidx::IIDXFMSerialHandle::FMSerialDevice::parse_msg(
             // generate message
             auto msg = this->create_msg(msg_in, 0x2E);
 
-            // get buttons
-            auto &buttons = get_buttons();
+            // sample all buttons at once
+            auto &input = capture_input();
 
             // player 1 buttons
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_1)))
+            if (input.button(Buttons::P1_1))
                 ARRAY_SETB(msg->cmd.raw, 151);
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_2)))
+            if (input.button(Buttons::P1_2))
                 ARRAY_SETB(msg->cmd.raw, 167);
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_3)))
+            if (input.button(Buttons::P1_3))
                 ARRAY_SETB(msg->cmd.raw, 183);
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_4)))
+            if (input.button(Buttons::P1_4))
                 ARRAY_SETB(msg->cmd.raw, 199);
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_5)))
+            if (input.button(Buttons::P1_5))
                 ARRAY_SETB(msg->cmd.raw, 215);
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_6)))
+            if (input.button(Buttons::P1_6))
                 ARRAY_SETB(msg->cmd.raw, 231);
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_7)))
+            if (input.button(Buttons::P1_7))
                 ARRAY_SETB(msg->cmd.raw, 247);
 
             // player 2 buttons
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_1)))
+            if (input.button(Buttons::P2_1))
                 ARRAY_SETB(msg->cmd.raw, 263);
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_2)))
+            if (input.button(Buttons::P2_2))
                 ARRAY_SETB(msg->cmd.raw, 279);
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_3)))
+            if (input.button(Buttons::P2_3))
                 ARRAY_SETB(msg->cmd.raw, 295);
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_4)))
+            if (input.button(Buttons::P2_4))
                 ARRAY_SETB(msg->cmd.raw, 311);
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_5)))
+            if (input.button(Buttons::P2_5))
                 ARRAY_SETB(msg->cmd.raw, 327);
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_6)))
+            if (input.button(Buttons::P2_6))
                 ARRAY_SETB(msg->cmd.raw, 343);
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_7)))
+            if (input.button(Buttons::P2_7))
                 ARRAY_SETB(msg->cmd.raw, 359);
 
             // player 1 start
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_Start)))
+            if (input.button(Buttons::P1_Start))
                 ARRAY_SETB(msg->cmd.raw, 79);
 
             // player 2 start
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_Start)))
+            if (input.button(Buttons::P2_Start))
                 ARRAY_SETB(msg->cmd.raw, 78);
 
             // VEFX
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::VEFX)))
+            if (input.button(Buttons::VEFX))
                 ARRAY_SETB(msg->cmd.raw, 77);
 
             // EFFECT
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::Effect)))
+            if (input.button(Buttons::Effect))
                 ARRAY_SETB(msg->cmd.raw, 76);
 
             // service
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::Service)))
+            if (input.button(Buttons::Service))
                 ARRAY_SETB(msg->cmd.raw, 10);
 
             // test
-            if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::Test)))
+            if (input.button(Buttons::Test))
                 ARRAY_SETB(msg->cmd.raw, 11);
 
             // turntables
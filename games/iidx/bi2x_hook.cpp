@@ -147,62 +147,62 @@ namespace games::iidx {
             AIO_IOB2_BI2X_TDJ__GetDeviceStatus_orig(This, status);
         }
 
-        // get buttons
-        auto &buttons = get_buttons();
+        // sample all buttons at once
+        auto &input = capture_input();
 
         // control buttons
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::Test]))
+        if (input.button(Buttons::Test))
             status->buffer[4] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::Service]))
+        if (input.button(Buttons::Service))
             status->buffer[5] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::CoinMech]))
+        if (input.button(Buttons::CoinMech))
             status->buffer[6] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::VEFX]))
+        if (input.button(Buttons::VEFX))
             status->buffer[10] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::Effect]))
+        if (input.button(Buttons::Effect))
             status->buffer[11] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P1_Headphone]))
+        if (input.button(Buttons::P1_Headphone))
             status->buffer[12] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P2_Headphone]))
+        if (input.button(Buttons::P2_Headphone))
             status->buffer[13] = 0xFF;
 
         // coin stock
         status->buffer[22] += eamuse_coin_get_stock();
 
         // player 1 buttons
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P1_Start]))
+        if (input.button(Buttons::P1_Start))
             status->buffer[8] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P1_1]))
+        if (input.button(Buttons::P1_1))
             status->buffer[27] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P1_2]))
+        if (input.button(Buttons::P1_2))
             status->buffer[28] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P1_3]))
+        if (input.button(Buttons::P1_3))
             status->buffer[29] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P1_4]))
+        if (input.button(Buttons::P1_4))
             status->buffer[30] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P1_5]))
+        if (input.button(Buttons::P1_5))
             status->buffer[31] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P1_6]))
+        if (input.button(Buttons::P1_6))
             status->buffer[32] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P1_7]))
+        if (input.button(Buttons::P1_7))
             status->buffer[33] = 0xFF;
 
         // player 2 buttons
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P2_Start]))
+        if (input.button(Buttons::P2_Start))
             status->buffer[9] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P2_1]))
+        if (input.button(Buttons::P2_1))
             status->buffer[34] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P2_2]))
+        if (input.button(Buttons::P2_2))
             status->buffer[35] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P2_3]))
+        if (input.button(Buttons::P2_3))
             status->buffer[36] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P2_4]))
+        if (input.button(Buttons::P2_4))
             status->buffer[37] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P2_5]))
+        if (input.button(Buttons::P2_5))
             status->buffer[38] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P2_6]))
+        if (input.button(Buttons::P2_6))
             status->buffer[39] = 0xFF;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::P2_7]))
+        if (input.button(Buttons::P2_7))
             status->buffer[40] = 0xFF;
 
         // turntables
@@ -516,6 +516,9 @@ namespace games::iidx {
         // announce
         log_info("bi2x_hook", "init");
 
+        // enable all hooks at once
+        detour::Transaction transaction("bi2x_hook");
+
         // hook IOB2 video
         const auto libaioIob2VideoDll = "libaio-iob2_video.dll";
         detour::trampoline_try(libaioIob2VideoDll, "aioIob2Bi2xTDJ_Create",
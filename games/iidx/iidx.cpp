@@ -552,63 +552,63 @@ namespace games::iidx {
     uint32_t get_pad() {
         uint32_t pad = 0;
 
-        // get buttons
-        auto &buttons = get_buttons();
+        // sample all buttons at once
+        auto &input = capture_input();
 
         // player 1 buttons
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_1)))
+        if (input.button(Buttons::P1_1))
             pad |= 1 << 0x08;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_2)))
+        if (input.button(Buttons::P1_2))
             pad |= 1 << 0x09;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_3)))
+        if (input.button(Buttons::P1_3))
             pad |= 1 << 0x0A;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_4)))
+        if (input.button(Buttons::P1_4))
             pad |= 1 << 0x0B;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_5)))
+        if (input.button(Buttons::P1_5))
             pad |= 1 << 0x0C;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_6)))
+        if (input.button(Buttons::P1_6))
             pad |= 1 << 0x0D;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_7)))
+        if (input.button(Buttons::P1_7))
             pad |= 1 << 0x0E;
 
         // player 2 buttons
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_1)))
+        if (input.button(Buttons::P2_1))
             pad |= 1 << 0x0F;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_2)))
+        if (input.button(Buttons::P2_2))
             pad |= 1 << 0x10;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_3)))
+        if (input.button(Buttons::P2_3))
             pad |= 1 << 0x11;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_4)))
+        if (input.button(Buttons::P2_4))
             pad |= 1 << 0x12;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_5)))
+        if (input.button(Buttons::P2_5))
             pad |= 1 << 0x13;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_6)))
+        if (input.button(Buttons::P2_6))
             pad |= 1 << 0x14;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_7)))
+        if (input.button(Buttons::P2_7))
             pad |= 1 << 0x15;
 
         // player 1 start
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P1_Start)))
+        if (input.button(Buttons::P1_Start))
             pad |= 1 << 0x18;
 
         // player 2 start
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::P2_Start)))
+        if (input.button(Buttons::P2_Start))
             pad |= 1 << 0x19;
 
         // VEFX
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::VEFX)))
+        if (input.button(Buttons::VEFX))
             pad |= 1 << 0x1A;
 
         // EFFECT
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::Effect)))
+        if (input.button(Buttons::Effect))
             pad |= 1 << 0x1B;
 
         // test
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::Test)))
+        if (input.button(Buttons::Test))
             pad |= 1 << 0x1C;
 
         // service
-        if (GameAPI::Buttons::getState(RI_MGR, buttons.at(Buttons::Service)))
+        if (input.button(Buttons::Service))
             pad |= 1 << 0x1D;
 
         return ~(pad & 0xFFFFFF00);
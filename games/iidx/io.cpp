@@ -1,5 +1,7 @@
 #include "io.h"
 
+#include "launcher/launcher.h"
+
 std::vector<Button> &games::iidx::get_buttons() {
     static std::vector<Button> buttons;
 
@@ -171,3 +173,9 @@ std::vector<Light> &games::iidx::get_lights() {
 
     return lights;
 }
+
+GameAPI::InputFrame &games::iidx::capture_input() {
+    thread_local GameAPI::InputFrame frame;
+    frame.capture(RI_MGR, get_buttons());
+    return frame;
+}
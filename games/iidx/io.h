@@ -158,4 +158,7 @@ namespace games::iidx {
     std::vector<Button> &get_buttons();
     std::vector<Analog> &get_analogs();
     std::vector<Light> &get_lights();
+
+    // samples all buttons in one pass, analogs still go through get_tt and the slider getters
+    GameAPI::InputFrame &capture_input();
 }
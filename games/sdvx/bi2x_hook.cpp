@@ -134,46 +134,46 @@ namespace games::sdvx {
         status->buffer[12] = count;
         count++;
 
-        // get buttons
-        auto &buttons = get_buttons();
+        // sample all buttons at once
+        auto &input = capture_input();
 
         // control buttons
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::Test]))
+        if (input.button(Buttons::Test))
             status->buffer[18] = 0x01;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::Service]))
+        if (input.button(Buttons::Service))
             status->buffer[19] = 0x01;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::CoinMech]))
+        if (input.button(Buttons::CoinMech))
             status->buffer[20] = 0x01;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::Start]))
+        if (input.button(Buttons::Start))
             status->buffer[316] |= 0x01;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::BT_A]))
+        if (input.button(Buttons::BT_A))
             status->buffer[316] |= 0x02;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::BT_B]))
+        if (input.button(Buttons::BT_B))
             status->buffer[316] |= 0x04;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::BT_C]))
+        if (input.button(Buttons::BT_C))
             status->buffer[316] |= 0x08;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::BT_D]))
+        if (input.button(Buttons::BT_D))
             status->buffer[316] |= 0x10;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::FX_L]))
+        if (input.button(Buttons::FX_L))
             status->buffer[316] |= 0x20;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::FX_R]))
+        if (input.button(Buttons::FX_R))
             status->buffer[316] |= 0x40;
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::Headphone]))
+        if (input.button(Buttons::Headphone))
             status->buffer[22] = 0x01;
 
         // volume left
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::VOL_L_Left])) {
+        if (input.button(Buttons::VOL_L_Left)) {
             VOL_L -= 64;
         }
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::VOL_L_Right])) {
+        if (input.button(Buttons::VOL_L_Right)) {
             VOL_L += 64;
         }
 
         // volume right
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::VOL_R_Left])) {
+        if (input.button(Buttons::VOL_R_Left)) {
             VOL_R -= 64;
         }
-        if (GameAPI::Buttons::getState(RI_MGR, buttons[Buttons::VOL_R_Right])) {
+        if (input.button(Buttons::VOL_R_Right)) {
             VOL_R += 64;
         }
 
@@ -182,8 +182,8 @@ namespace games::sdvx {
         auto vol_left = VOL_L;
         auto vol_right = VOL_R;
         if (analogs[0].isSet() || analogs[1].isSet()) {
-            vol_left += (uint16_t) (GameAPI::Analogs::getState(RI_MGR, analogs[Analogs::VOL_L]) * 65535);
-            vol_right += (uint16_t) (GameAPI::Analogs::getState(RI_MGR, analogs[Analogs::VOL_R]) * 65535);
+            vol_left += (uint16_t) (input.analog(Analogs::VOL_L) * 65535);
+            vol_right += (uint16_t) (input.analog(Analogs::VOL_R) * 65535);
         }
 
         *((uint16_t*) &status->buffer[312]) = vol_left;
@@ -385,6 +385,9 @@ namespace games::sdvx {
         // announce
         log_info("bi2x_hook", "init");
 
+        // enable all hooks at once
+        detour::Transaction transaction("bi2x_hook");
+
         // hook IOB2 video
         const auto libaioIob2VideoDll = "libaio-iob2_video.dll";
         detour::trampoline_try(libaioIob2VideoDll, "aioIob2Bi2xUFC_Create",
@@ -1,5 +1,7 @@
 #include "io.h"
 
+#include "launcher/launcher.h"
+
 std::vector<Button> &games::sdvx::get_buttons() {
     static std::vector<Button> buttons;
 
@@ -126,3 +128,9 @@ std::vector<Light> &games::sdvx::get_lights() {
 
     return lights;
 }
+
+GameAPI::InputFrame &games::sdvx::capture_input() {
+    thread_local GameAPI::InputFrame frame;
+    frame.capture(RI_MGR, get_buttons(), &get_analogs());
+    return frame;
+}
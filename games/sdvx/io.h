@@ -112,4 +112,7 @@ namespace games::sdvx {
     std::vector<Button> &get_buttons();
     std::vector<Analog> &get_analogs();
     std::vector<Light> &get_lights();
+
+    // samples all buttons and analogs in one pass
+    GameAPI::InputFrame &capture_input();
 }
@@ -9,6 +9,7 @@
 #include "launcher/launcher.h"
 #include "util/detour.h"
 #include "util/fileutils.h"
+#include "util/jpeg.h"
 #include "util/libutils.h"
 #include "util/logging.h"
 #include "util/utils.h"
@@ -351,8 +352,9 @@ namespace games::shared {
             }
         }
 
-        // iterate folders
+        // iterate folders, the JPEG is encoded once on first use
         log_info("printer", "writing files...");
+        std::vector<uint8_t> jpg_data;
         for (const auto &path : PRINTER_PATH) {
             for (const auto &format : PRINTER_FORMAT) {
 
@@ -370,9 +372,13 @@ namespace games::shared {
                 if (format == "tga" && stbi_write_tga(
                         image_path.c_str(), image_width, image_height, 3, image_data))
                     success = true;
-                if (format == "jpg" && stbi_write_jpg(
-                        image_path.c_str(), image_width, image_height, 3, image_data, PRINTER_JPG_QUALITY))
-                    success = true;
+                if (format == "jpg") {
+                    if (jpg_data.empty()) {
+                        jpeg::encode(jpg_data, image_data, image_width, image_height, PRINTER_JPG_QUALITY, false);
+                    }
+                    if (!jpg_data.empty() && fileutils::bin_write(image_path, jpg_data.data(), jpg_data.size()))
+                        success = true;
+                }
 
                 // logging
                 if (success) {
@@ -276,6 +276,7 @@ static int property_file_write(avs::core::property_ptr prop, const char* path) {
 void hooks::avs::init() {
     log_info("hooks::avs", "initializing");
 
+    detour::Transaction transaction("hooks::avs");
     AVS_HOOK(avs_fs_fstat);
     AVS_HOOK(avs_fs_lstat);
     AVS_HOOK(avs_fs_open);
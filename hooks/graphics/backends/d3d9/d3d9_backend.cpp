@@ -29,6 +29,7 @@
 #include "util/logging.h"
 #include "util/utils.h"
 #include "util/memutils.h"
+#include "util/pixels.h"
 #include "util/threadpool.h"
 
 #include "d3d9_device.h"
@@ -93,6 +94,11 @@ static decltype(Direct3DCreate9Ex) *Direct3DCreate9Ex_orig = nullptr;
 static Direct3DCreate9On12_t Direct3DCreate9On12_orig = nullptr;
 static Direct3DCreate9On12Ex_t Direct3DCreate9On12Ex_orig = nullptr;
 
+// capture readback
+static const size_t CAPTURE_RING_SIZE = 3;
+static const size_t CAPTURE_RING_LATENCY = 2;
+static const size_t CAPTURE_RING_SCREENS = 4;
+
 static bool ATTEMPTED_SUB_SWAP_CHAIN_ACQUIRE = false;
 static IDirect3DSwapChain9 *SUB_SWAP_CHAIN = nullptr;
 
@@ -929,83 +935,247 @@ static void save_capture(
         D3DFORMAT format,
         UINT width,
         UINT height,
-        IDirect3DSurface9 *surface) {
+        const uint8_t *data,
+        size_t pitch) {
+
+    // convert pixel data
+    auto image = graphics_capture_alloc(width, height);
+    switch (format) {
+        case D3DFMT_R8G8B8:
+            pixels::rgb_to_rgb(image, data, pitch, width, height);
+            break;
+        case D3DFMT_X8R8G8B8:
+        case D3DFMT_A8R8G8B8:
+            pixels::bgrx_to_rgb(image, data, pitch, width, height);
+            break;
+        case D3DFMT_X8B8G8R8:
+        case D3DFMT_A8B8G8R8:
+            pixels::rgbx_to_rgb(image, data, pitch, width, height);
+            break;
+        default:
+            memset(image, 0, width * height * 3);
+            break;
+    }
+
+    // enqueue
+    graphics_capture_enqueue(screen, image, width, height);
+}
+
+static IDirect3DSurface9 *get_back_buffer(IDirect3DDevice9 *device, int screen) {
+
+    // TODO: verify screen is a valid swapchain
     HRESULT hr;
+    IDirect3DSurface9 *buffer = nullptr;
+    if (SUB_SWAP_CHAIN != nullptr && screen & 1) {
+        hr = SUB_SWAP_CHAIN->GetBackBuffer(0, D3DBACKBUFFER_TYPE_MONO, &buffer);
+    } else {
+        hr = device->GetBackBuffer(screen, 0, D3DBACKBUFFER_TYPE_MONO, &buffer);
+    }
+    if (FAILED(hr) || buffer == nullptr) {
+        log_warning("graphics::d3d9",
+                "failed to get back buffer, hr={}",
+                FMT_HRESULT(hr));
+        return nullptr;
+    }
 
-    // lock surface to be able to access the data
-    D3DLOCKED_RECT finished_copy {};
-    hr = surface->LockRect(&finished_copy, nullptr, 0);
+    return buffer;
+}
+
+/*
+ * Capture readback ring
+ *
+ * Captures are copied on the GPU into a ring of default pool render targets with StretchRect,
+ * which also resolves multisampled back buffers. GetRenderTargetData waits for the copy, so a slot is
+ * only read back into the system memory surface CAPTURE_RING_LATENCY presents later, once its event
+ * query signals the copy is done. Capturing thus never stalls the present thread on the frame that
+ * was just rendered and never allocates surfaces per frame.
+ */
+
+struct CaptureSlot {
+    IDirect3DSurface9 *target = nullptr;
+    IDirect3DQuery9 *query = nullptr;
+    bool pending = false;
+    uint64_t present = 0;
+};
+
+struct CaptureRing {
+    IDirect3DDevice9 *device = nullptr;
+    D3DSURFACE_DESC desc {};
+    IDirect3DSurface9 *staging = nullptr;
+    CaptureSlot slots[CAPTURE_RING_SIZE];
+    size_t head = 0;
+};
+
+static CaptureRing CAPTURE_RINGS[CAPTURE_RING_SCREENS] {};
+static uint64_t CAPTURE_PRESENT_COUNT = 0;
+
+static void capture_ring_release(int screen) {
+    auto &ring = CAPTURE_RINGS[screen];
+
+    // release surfaces
+    for (auto &slot : ring.slots) {
+        if (slot.pending) {
+            graphics_capture_skip(screen);
+        }
+        if (slot.target != nullptr) {
+            slot.target->Release();
+        }
+        if (slot.query != nullptr) {
+            slot.query->Release();
+        }
+        slot = CaptureSlot {};
+    }
+    if (ring.staging != nullptr) {
+        ring.staging->Release();
+    }
+
+    // reset state
+    ring = CaptureRing {};
+}
+
+static bool capture_ring_init(int screen, IDirect3DDevice9 *device, const D3DSURFACE_DESC &desc) {
+    auto &ring = CAPTURE_RINGS[screen];
+    HRESULT hr;
+
+    // check if the cached surfaces still fit
+    if (ring.device == device
+    && ring.desc.Width == desc.Width
+    && ring.desc.Height == desc.Height
+    && ring.desc.Format == desc.Format) {
+        return true;
+    }
+    capture_ring_release(screen);
+    ring.device = device;
+    ring.desc = desc;
+
+    // system memory surface the slots are read back into
+    hr = device->CreateOffscreenPlainSurface(
+            desc.Width, desc.Height, desc.Format, D3DPOOL_SYSTEMMEM, &ring.staging, nullptr);
+    if (FAILED(hr) || ring.staging == nullptr) {
+        log_warning("graphics::d3d9", "failed to create capture staging surface, hr={}", FMT_HRESULT(hr));
+        capture_ring_release(screen);
+        return false;
+    }
+
+    // create GPU side copies
+    for (auto &slot : ring.slots) {
+        hr = device->CreateRenderTarget(
+                desc.Width, desc.Height, desc.Format, D3DMULTISAMPLE_NONE,
+                0, FALSE, &slot.target, nullptr);
+        if (FAILED(hr) || slot.target == nullptr) {
+            log_warning("graphics::d3d9", "failed to create capture surface, hr={}", FMT_HRESULT(hr));
+            capture_ring_release(screen);
+            return false;
+        }
+
+        // without event queries the slot is read after a fixed number of presents only
+        if (FAILED(device->CreateQuery(D3DQUERYTYPE_EVENT, &slot.query))) {
+            slot.query = nullptr;
+        }
+    }
+
+    log_misc("graphics::d3d9", "capture ring created for screen {} ({}x{}, {})",
+            screen, desc.Width, desc.Height, format2s(desc.Format));
+    return true;
+}
+
+static void capture_ring_queue(IDirect3DDevice9 *device, int screen) {
+    HRESULT hr;
+
+    // check screen
+    if (screen < 0 || screen >= (int) CAPTURE_RING_SCREENS) {
+        return;
+    }
+
+    // get back buffer
+    auto buffer = get_back_buffer(device, screen);
+    if (buffer == nullptr) {
+        graphics_capture_skip(screen);
+        return;
+    }
+    D3DSURFACE_DESC desc {};
+    hr = buffer->GetDesc(&desc);
+    if (FAILED(hr) || !capture_ring_init(screen, device, desc)) {
+        buffer->Release();
+        graphics_capture_skip(screen);
+        return;
+    }
+
+    // drop the capture if all slots are still waiting to be read back
+    auto &ring = CAPTURE_RINGS[screen];
+    auto &slot = ring.slots[ring.head];
+    if (slot.pending) {
+        buffer->Release();
+        graphics_capture_skip(screen);
+        return;
+    }
+
+    // queue copy on the GPU
+    hr = device->StretchRect(buffer, nullptr, slot.target, nullptr, D3DTEXF_NONE);
+    buffer->Release();
     if (FAILED(hr)) {
-        log_warning("graphics::d3d9", "failed to lock screenshot surface, hr={}", FMT_HRESULT(hr));
+        log_warning("graphics::d3d9", "failed to copy back buffer contents, hr={}", FMT_HRESULT(hr));
         graphics_capture_skip(screen);
         return;
     }
+    if (slot.query != nullptr) {
+        slot.query->Issue(D3DISSUE_END);
+    }
+    slot.pending = true;
+    slot.present = CAPTURE_PRESENT_COUNT;
+    ring.head = (ring.head + 1) % CAPTURE_RING_SIZE;
+}
 
-    // copy pixel data
-    size_t pitch = finished_copy.Pitch;
-    auto data = reinterpret_cast<uint8_t *>(finished_copy.pBits);
-    auto pixels = new uint8_t[width * height * 3];
-    for (size_t row = 0; row < height; row++) {
-        size_t offset_pixels = 0;
-        size_t offset_row = row * width * 3;
-        switch (format) {
-            case D3DFMT_R8G8B8: {
-                for (size_t offset = 0; offset < pitch; offset += 3) {
-                    auto cell = data + row * pitch + offset;
-                    auto pixel = &pixels[offset_row + offset_pixels];
-                    pixel[0] = cell[0];
-                    pixel[1] = cell[1];
-                    pixel[2] = cell[2];
-                    offset_pixels += 3;
-                }
-                break;
+static void capture_ring_process(IDirect3DDevice9 *device) {
+    for (int screen = 0; screen < (int) CAPTURE_RING_SCREENS; screen++) {
+        auto &ring = CAPTURE_RINGS[screen];
+        if (ring.device != device) {
+            continue;
+        }
+
+        // oldest slot first, stop at the first one still in flight
+        for (size_t i = 0; i < CAPTURE_RING_SIZE; i++) {
+            auto &slot = ring.slots[(ring.head + i) % CAPTURE_RING_SIZE];
+            if (!slot.pending) {
+                continue;
             }
-            case D3DFMT_X8R8G8B8:
-            case D3DFMT_A8R8G8B8: {
-                for (size_t offset = 0; offset < pitch; offset += 4) {
-                    auto cell = data + row * pitch + offset;
-                    auto pixel = &pixels[offset_row + offset_pixels];
-                    pixel[0] = cell[2];
-                    pixel[1] = cell[1];
-                    pixel[2] = cell[0];
-                    offset_pixels += 3;
-                }
+            if (CAPTURE_PRESENT_COUNT - slot.present < CAPTURE_RING_LATENCY) {
                 break;
             }
-            case D3DFMT_X8B8G8R8:
-            case D3DFMT_A8B8G8R8: {
-                for (size_t offset = 0; offset < pitch; offset += 4) {
-                    auto cell = data + row * pitch + offset;
-                    auto pixel = &pixels[offset_row + offset_pixels];
-                    pixel[0] = cell[0];
-                    pixel[1] = cell[1];
-                    pixel[2] = cell[2];
-                    offset_pixels += 3;
-                }
+            if (slot.query != nullptr && slot.query->GetData(nullptr, 0, 0) != S_OK) {
                 break;
             }
-            default: {
-                for (size_t offset = 0; offset < width; offset++) {
-                    auto pixel = &pixels[offset_row + offset_pixels];
-                    pixel[0] = 0;
-                    pixel[1] = 0;
-                    pixel[2] = 0;
-                    offset_pixels += 3;
-                }
+            slot.pending = false;
+
+            // read back, the copy into the slot is done so this doesn't wait for the current frame
+            HRESULT hr = device->GetRenderTargetData(slot.target, ring.staging);
+            if (FAILED(hr)) {
+                log_warning("graphics::d3d9", "failed to read back capture surface, hr={}", FMT_HRESULT(hr));
+                graphics_capture_skip(screen);
+                continue;
             }
+
+            // map
+            D3DLOCKED_RECT locked {};
+            hr = ring.staging->LockRect(&locked, nullptr, D3DLOCK_READONLY);
+            if (FAILED(hr)) {
+                log_warning("graphics::d3d9", "failed to lock capture surface, hr={}", FMT_HRESULT(hr));
+                graphics_capture_skip(screen);
+                continue;
+            }
+
+            // convert straight from the mapped surface, costs about as much as a plain copy
+            save_capture(screen, ring.desc.Format, ring.desc.Width, ring.desc.Height,
+                    reinterpret_cast<const uint8_t *>(locked.pBits), locked.Pitch);
+            ring.staging->UnlockRect();
         }
     }
+}
 
-    // unlock surface
-    hr = surface->UnlockRect();
-    if (FAILED(hr)) {
-        log_warning("graphics::d3d9", "failed to unlock screenshot surface, hr={}", FMT_HRESULT(hr));
-        graphics_capture_skip(screen);
-        return;
+void graphics_d3d9_capture_release() {
+    for (int screen = 0; screen < (int) CAPTURE_RING_SCREENS; screen++) {
+        capture_ring_release(screen);
     }
-
-    // enqueue
-    graphics_capture_enqueue(screen, pixels, width, height);
 }
 
 static void save_screenshot(const std::string &file_path, UINT height, IDirect3DSurface9 *surface) {
@@ -1131,27 +1301,21 @@ void graphics_d3d9_on_present(
         trigger_last = false;
     }
 
-    // process pending screenshot
-    bool screenshot = false;
-    bool capture = false;
+    // finish and start captures
+    CAPTURE_PRESENT_COUNT++;
+    capture_ring_process(device);
     int capture_screen = 0;
-    if ((screenshot = graphics_screenshot_consume())
-    || ((capture = graphics_capture_consume(&capture_screen)))) {
-        HRESULT hr = S_OK;
+    if (graphics_capture_consume(&capture_screen)) {
+        capture_ring_queue(device, capture_screen);
+    }
 
-        // TODO: verify capture_screen is a valid swapchain
+    // process pending screenshot
+    if (graphics_screenshot_consume()) {
+        HRESULT hr = S_OK;
 
         // get back buffer
-        IDirect3DSurface9 *buffer = nullptr;
-        if (SUB_SWAP_CHAIN != nullptr && capture_screen & 1) {
-            hr = SUB_SWAP_CHAIN->GetBackBuffer(0, D3DBACKBUFFER_TYPE_MONO, &buffer);
-        } else {
-            hr = device->GetBackBuffer(capture_screen, 0, D3DBACKBUFFER_TYPE_MONO, &buffer);
-        }
-        if (FAILED(hr) || buffer == nullptr) {
-            log_warning("graphics::d3d9",
-                    "failed to get back buffer, hr={}",
-                    FMT_HRESULT(hr));
+        auto buffer = get_back_buffer(device, 0);
+        if (buffer == nullptr) {
             return;
         }
 
@@ -1165,7 +1329,6 @@ void graphics_d3d9_on_present(
             return;
         }
 
-        // TODO: cache render targets
         IDirect3DSurface9 *temp_surface = nullptr;
         hr = device->CreateRenderTarget(
                 desc.Width, desc.Height, desc.Format, desc.MultiSampleType,
@@ -1194,21 +1357,12 @@ void graphics_d3d9_on_present(
         // function for storing the surface
         auto surface_process = [=]() {
 
-            // capture
-            if (capture) {
-                save_capture(capture_screen, desc.Format, desc.Width, desc.Height, temp_surface);
-            }
-
-            // screenshot
-            if (screenshot) {
+            // check where we can save it
+            auto file_path = graphics_screenshot_genpath();
+            if (!file_path.empty()) {
 
-                // check where we can save it
-                auto file_path = graphics_screenshot_genpath();
-                if (!file_path.empty()) {
-
-                    // write to file
-                    save_screenshot(file_path, desc.Height, temp_surface);
-                }
+                // write to file
+                save_screenshot(file_path, desc.Height, temp_surface);
             }
 
             // release surface
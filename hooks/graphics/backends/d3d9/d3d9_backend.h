@@ -14,6 +14,7 @@ void graphics_d3d9_on_present(
     IDirect3DDevice9 *wrapped_device);
 
 IDirect3DSurface9 *graphics_d3d9_ldj_get_sub_screen();
+void graphics_d3d9_capture_release();
 
 struct WrappedIDirect3D9 : IDirect3D9Ex {
     explicit WrappedIDirect3D9(IDirect3D9 *orig) : pReal(orig), is_d3d9ex(false) {}
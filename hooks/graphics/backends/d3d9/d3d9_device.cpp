@@ -342,6 +342,9 @@ HRESULT STDMETHODCALLTYPE WrappedIDirect3DDevice9::Reset(
         overlay::OVERLAY->reset_invalidate();
     }
 
+    // release cached capture surfaces
+    graphics_d3d9_capture_release();
+
     HRESULT res = pReal->Reset(pPresentationParameters);
 
     // recreate overlay
@@ -1647,6 +1650,9 @@ HRESULT STDMETHODCALLTYPE WrappedIDirect3DDevice9::ResetEx(
         overlay::OVERLAY->reset_invalidate();
     }
 
+    // release cached capture surfaces
+    graphics_d3d9_capture_release();
+
     HRESULT res = static_cast<IDirect3DDevice9Ex *>(pReal)->ResetEx(
             pPresentationParameters, pFullscreenDisplayMode);
 
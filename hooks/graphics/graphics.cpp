@@ -17,6 +17,8 @@
 #include "util/detour.h"
 #include "util/logging.h"
 #include "util/fileutils.h"
+#include "util/jpeg.h"
+#include "util/pixels.h"
 #include "util/utils.h"
 #include "util/time.h"
 
@@ -24,6 +26,7 @@ struct CaptureData {
     std::shared_ptr<uint8_t[]> data;
     unsigned short width, height;
     uint64_t timestamp;
+    uint64_t frame;
 };
 
 // icon
@@ -743,23 +746,81 @@ bool graphics_capture_consume(int *screen) {
     return flag;
 }
 
+// released capture buffers by size, never destroyed since readers may hold frames until exit
+static std::mutex GRAPHICS_CAPTURE_POOL_M;
+static auto GRAPHICS_CAPTURE_POOL = new std::vector<std::pair<size_t, uint8_t *>>();
+static const size_t GRAPHICS_CAPTURE_POOL_MAX = 4;
+
+uint8_t *graphics_capture_alloc(size_t width, size_t height) {
+    auto size = width * height * 3;
+
+    // reuse a buffer of the same frame size
+    {
+        std::lock_guard<std::mutex> lock(GRAPHICS_CAPTURE_POOL_M);
+        for (auto it = GRAPHICS_CAPTURE_POOL->begin(); it != GRAPHICS_CAPTURE_POOL->end(); it++) {
+            if (it->first == size) {
+                auto data = it->second;
+                GRAPHICS_CAPTURE_POOL->erase(it);
+                return data;
+            }
+        }
+    }
+
+    // new buffer
+    return new uint8_t[size];
+}
+
+static void graphics_capture_free(uint8_t *data, size_t size) {
+    {
+        std::lock_guard<std::mutex> lock(GRAPHICS_CAPTURE_POOL_M);
+        if (GRAPHICS_CAPTURE_POOL->size() < GRAPHICS_CAPTURE_POOL_MAX) {
+            GRAPHICS_CAPTURE_POOL->emplace_back(size, data);
+            return;
+        }
+    }
+    delete[] data;
+}
+
 void graphics_capture_enqueue(int screen, uint8_t *data, size_t width, size_t height) {
     GRAPHICS_CAPTURE_BUFFER_M[screen].lock();
     auto &capture = GRAPHICS_CAPTURE_BUFFER[screen];
-    capture.data.reset(data);
+    capture.data = std::shared_ptr<uint8_t[]>(data, [size = width * height * 3] (uint8_t *data) {
+        graphics_capture_free(data, size);
+    });
     capture.width = width;
     capture.height = height;
     capture.timestamp = get_performance_milliseconds();
+    capture.frame++;
     GRAPHICS_CAPTURE_BUFFER_M[screen].unlock();
-    GRAPHICS_CAPTURE_CV[screen].notify_one();
+    GRAPHICS_CAPTURE_CV[screen].notify_all();
 }
 
 void graphics_capture_skip(int screen) {
-    GRAPHICS_CAPTURE_CV[screen].notify_one();
+    GRAPHICS_CAPTURE_CV[screen].notify_all();
 }
 
-bool graphics_capture_receive_jpeg(int screen, TooJpeg::WRITE_ONE_BYTE receiver,
-        bool rgb, int quality, bool downsample, int divide, uint64_t *timestamp,
+bool graphics_capture_wait(int screen, uint64_t *frame, int timeout) {
+
+    // check screen
+    if (screen < 0 || (size_t) screen >= GRAPHICS_CAPTURE_SCREEN_NO) {
+        return false;
+    }
+
+    // wait for a frame newer than the last one seen
+    std::unique_lock<std::mutex> lock(GRAPHICS_CAPTURE_BUFFER_M[screen]);
+    auto &capture = GRAPHICS_CAPTURE_BUFFER[screen];
+    auto last_frame = *frame;
+    if (!GRAPHICS_CAPTURE_CV[screen].wait_for(lock, std::chrono::milliseconds(timeout), [&capture, last_frame] {
+        return capture.data != nullptr && capture.frame != last_frame;
+    })) {
+        return false;
+    }
+    *frame = capture.frame;
+    return true;
+}
+
+bool graphics_capture_receive_jpeg(int screen, std::vector<uint8_t> &out,
+        int quality, bool downsample, int divide, uint64_t *timestamp,
         int *width, int *height) {
 
     // wait for capture event
@@ -779,43 +840,22 @@ bool graphics_capture_receive_jpeg(int screen, TooJpeg::WRITE_ONE_BYTE receiver,
         return false;
     }
 
-    // divide image size
+    // box filter into a buffer kept by the calling thread
+    const uint8_t *image = capture_data.get();
     if (divide > 1) {
-
-        // get new resolution (round up)
-        int width_new = (capture_width + divide - 1) / divide;
-        int height_new = (capture_height + divide - 1) / divide;
-
-        // allocate new data
-        auto data_old = capture_data.get();
-        auto data_new = new uint8_t[width_new * height_new * 3];
-
-        // copy pixel data
-        int data_y = 0;
-        for (int y = 0; y < capture_height; y += divide) {
-            int data_y_offset_old = y * capture_width;
-            int data_y_offset = data_y * width_new;
-            int data_x = 0;
-            for (int x = 0; x < capture_width; x += divide) {
-                auto pixel_new = &data_new[(data_x + data_y_offset) * 3];
-                auto pixel_old = &data_old[(data_y_offset_old + x) * 3];
-                memcpy(pixel_new, pixel_old, 3);
-                data_x++;
-            }
-            data_y++;
-        }
-
-        // update capture data
-        capture_data.reset(data_new);
+        thread_local std::vector<uint8_t> divide_buffer;
+        auto width_new = pixels::box_size(capture_width, divide);
+        auto height_new = pixels::box_size(capture_height, divide);
+        divide_buffer.resize(width_new * height_new * 3);
+        pixels::box_downscale_rgb(divide_buffer.data(), image, capture_width, capture_height, divide);
+        image = divide_buffer.data();
         capture_width = width_new;
         capture_height = height_new;
     }
 
     // compress
-    auto success = TooJpeg::writeJpeg(
-            receiver, capture_data.get(),
-            capture_width, capture_height,
-            rgb, quality, downsample);
+    out.clear();
+    auto success = jpeg::encode(out, image, capture_width, capture_height, quality, downsample);
 
     // status
     if (timestamp) {
@@ -7,8 +7,6 @@
 #include <windows.h>
 #include <d3d9.h>
 
-#include "external/toojpeg/toojpeg.h"
-
 // flag settings
 extern bool GRAPHICS_CAPTURE_CURSOR;
 extern bool GRAPHICS_LOG_HRESULT;
@@ -40,10 +38,12 @@ void graphics_screenshot_trigger();
 bool graphics_screenshot_consume();
 void graphics_capture_trigger(int screen);
 bool graphics_capture_consume(int *screen);
+uint8_t *graphics_capture_alloc(size_t width, size_t height);
 void graphics_capture_enqueue(int screen, uint8_t *data, size_t width, size_t height);
 void graphics_capture_skip(int screen);
-bool graphics_capture_receive_jpeg(int screen, TooJpeg::WRITE_ONE_BYTE receiver,
-        bool rgb = true, int quality = 80, bool downsample = true, int divide = 0,
+bool graphics_capture_wait(int screen, uint64_t *frame, int timeout);
+bool graphics_capture_receive_jpeg(int screen, std::vector<uint8_t> &out,
+        int quality = 80, bool downsample = true, int divide = 0,
         uint64_t *timestamp = nullptr,
         int *width = nullptr, int *height = nullptr);
 std::string graphics_screenshot_genpath();
@@ -109,6 +109,7 @@ void hooks::lang::early_init() {
     log_info("hooks::lang", "early initialization");
 
     // hooking these two functions fixes the jubeat mojibake
+    detour::Transaction transaction("hooks::lang");
     detour::trampoline_try("kernel32.dll", "GetACP", GetACP_hook, &GetACP_orig);
     detour::trampoline_try("kernel32.dll", "GetOEMCP", GetOEMCP_hook, &GetOEMCP_orig);
 }
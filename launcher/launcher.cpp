@@ -84,11 +84,16 @@
 #include "stubs/stubs.h"
 #include "touch/touch.h"
 #include "util/crypt.h"
+#include "util/detour.h"
 #include "util/fileutils.h"
 #include "util/libutils.h"
 #include "util/logging.h"
+#include "util/jpeg.h"
 #include "util/peb.h"
+#include "util/pixels.h"
+#include "util/sigscan.h"
 #include "util/time.h"
+#include "util/utils.h"
 #include "avs/ssl.h"
 
 // std::max
@@ -206,6 +211,7 @@ int main_implementation(int argc, char *argv[]) {
     bool realtime = false;
     bool cardio_enabled = false;
     bool peb_print = false;
+    std::vector<std::string> benchmarks;
     bool cfg_run = false;
     bool rich_presence = false;
     bool automap = false;
@@ -473,6 +479,9 @@ int main_implementation(int argc, char *argv[]) {
     if (options[launcher::Options::OutputPEB].value_bool()) {
         peb_print = true;
     }
+    if (options[launcher::Options::RunBenchmarks].is_active()) {
+        strsplit(options[launcher::Options::RunBenchmarks].value_text(), benchmarks, ',');
+    }
     if (options[launcher::Options::EnableBemaniTools5API].value_bool()) {
         BT5API_ENABLED = true;
     }
@@ -647,6 +656,18 @@ int main_implementation(int argc, char *argv[]) {
     if (options[launcher::Options::NoLegacy].value_bool()) {
         rawinput::NOLEGACY = true;
     }
+    if (options[launcher::Options::DisableRawInputBuffer].value_bool()) {
+        rawinput::BUFFERED = false;
+    }
+    if (options[launcher::Options::OutputRate].is_active()) {
+        rawinput::OUTPUT_RATE = options[launcher::Options::OutputRate].value_int();
+    }
+    if (options[launcher::Options::OutputRefresh].value_bool()) {
+        rawinput::OUTPUT_REFRESH_ALL = true;
+    }
+    if (options[launcher::Options::HIDCapture].is_active()) {
+        rawinput::HID_CAPTURE_PATH = options[launcher::Options::HIDCapture].value_text();
+    }
     if (options[launcher::Options::RichPresence].value_bool()) {
         rich_presence = true;
     }
@@ -1484,6 +1505,23 @@ int main_implementation(int argc, char *argv[]) {
         peb::peb_print();
     }
 
+    // run benchmarks
+    for (auto &benchmark : benchmarks) {
+        if (benchmark == "pixels") {
+            pixels::benchmark();
+        } else if (benchmark == "jpeg") {
+            jpeg::benchmark();
+        } else if (benchmark == "sigscan") {
+            sigscan_benchmark();
+        } else if (benchmark == "rawinput") {
+            rawinput::RawInputManager::benchmark();
+        } else if (benchmark == "inputstate") {
+            rawinput::RawInputManager::benchmark_contention();
+        } else {
+            log_warning("launcher", "unknown benchmark: {}", benchmark);
+        }
+    }
+
     // enable automap
     if (automap) {
         avs::automap::enable();
@@ -1508,6 +1546,12 @@ int main_implementation(int argc, char *argv[]) {
         game->post_attach();
     }
 
+    // hook installation timings
+    detour::report();
+
+    // save signature scan results of the hooks
+    sigscan_cache_flush();
+
     // game start
     log_info("launcher", "calling game entry");
     avs::game::entry_main();
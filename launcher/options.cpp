@@ -1026,6 +1026,44 @@ static const std::vector<OptionDefinition> OPTION_DEFINITIONS = {
         .type = OptionType::Bool,
         .category = "Development",
     },
+    {
+        .title = "Run Benchmarks",
+        .name = "benchmark",
+        .desc = "Runs micro-benchmarks on startup and logs the results. Comma separated list of: pixels, jpeg, sigscan, rawinput, inputstate",
+        .type = OptionType::Text,
+        .category = "Development",
+    },
+    {
+        .title = "Disable Raw Input Buffering",
+        .name = "rawinputnobuffer",
+        .desc = "Handles every raw input message on its own instead of reading all queued input at once",
+        .type = OptionType::Bool,
+        .category = "Development",
+    },
+    {
+        .title = "Light Output Rate",
+        .name = "outputrate",
+        .desc = "Maximum light updates per second written to each device, 0 writes every change (default: 120)",
+        .type = OptionType::Integer,
+        .setting_name = "(0-1000)",
+        .category = "Common",
+    },
+    {
+        .title = "Light Output Refresh",
+        .name = "outputrefresh",
+        .desc = "Rewrites the light output of every device twice a second even without changes, "
+                "for boards which fall back to their own lighting (DJ DAO boards are always refreshed)",
+        .type = OptionType::Bool,
+        .category = "Common",
+    },
+    {
+        .title = "HID Report Capture",
+        .name = "hidcapture",
+        .desc = "Records the input reports of every HID device together with the hid.dll results "
+                "as decoder test fixtures into the given folder",
+        .type = OptionType::Text,
+        .category = "Development",
+    },
 };
 
 const std::vector<OptionDefinition> &launcher::get_option_definitions() {
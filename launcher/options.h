@@ -147,6 +147,11 @@ namespace launcher {
             DisableDebugHooks,
             DisableAvsVfsDriveMountRedirection,
             OutputPEB,
+            RunBenchmarks,
+            DisableRawInputBuffer,
+            OutputRate,
+            OutputRefresh,
+            HIDCapture,
         };
     }
 
@@ -4,11 +4,13 @@
 #include "shutdown.h"
 
 #include "api/controller.h"
+#include "cfg/config.h"
 #include "easrv/easrv.h"
 #include "rawinput/rawinput.h"
 #include "misc/vrutil.h"
 #include "hooks/audio/audio.h"
 #include "util/logging.h"
+#include "util/sigscan.h"
 
 #include "launcher.h"
 #include "logger.h"
@@ -18,6 +20,12 @@ namespace launcher {
     void stop_subsystems() {
         log_info("launcher", "stopping subsystems");
 
+        // write pending config changes
+        Config::flush();
+
+        // write pending scan cache changes
+        sigscan_cache_flush();
+
         // flush/stop logger
         logger::stop();
 
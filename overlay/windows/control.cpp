@@ -36,6 +36,7 @@
 #include "eadev.h"
 #include "wnd_manager.h"
 #include "midi.h"
+#include "input_journal.h"
 
 namespace overlay::windows {
 
@@ -550,7 +551,7 @@ namespace overlay::windows {
 
     void Control::api_view() {
         if (API_CONTROLLER != nullptr && ImGui::CollapsingHeader("API")) {
-            std::vector<api::ClientState> client_states;
+            std::vector<api::ClientInfo> client_states;
             API_CONTROLLER->obtain_client_states(&client_states);
 
             // show ip addresses
@@ -566,6 +567,18 @@ namespace overlay::windows {
                 }
             }
 
+            // modules, shared by all clients
+            auto registry = API_CONTROLLER->get_registry();
+            if (registry && ImGui::TreeNode("Modules")) {
+                for (auto module : registry->get_modules()) {
+                    if (ImGui::TreeNode(module->name.c_str())) {
+                        ImGui::Text("Password force: %i", module->password_force);
+                        ImGui::TreePop();
+                    }
+                }
+                ImGui::TreePop();
+            }
+
             // client count
             ImGui::Text("Connected clients: %u", (unsigned int) client_states.size());
 
@@ -573,20 +586,11 @@ namespace overlay::windows {
             for (auto &client : client_states) {
                 auto address = API_CONTROLLER->get_ip_address(client.address);
                 if (ImGui::TreeNode(("Client @ " + address).c_str())) {
-                    if (client.password.empty()) {
+                    if (!client.password_set) {
                         ImGui::Text("No password set.");
                     } else {
                         ImGui::Text("Password set.");
                     }
-                    if (ImGui::TreeNode("Modules")) {
-                        for (auto &module : client.modules) {
-                            if (ImGui::TreeNode(module->name.c_str())) {
-                                ImGui::Text("Password force: %i", module->password_force);
-                                ImGui::TreePop();
-                            }
-                        }
-                        ImGui::TreePop();
-                    }
                     ImGui::TreePop();
                 }
             }
@@ -601,6 +605,12 @@ namespace overlay::windows {
                 this->children.push_back(new MIDIWindow(this->overlay));
             }
 
+            // input journal
+            ImGui::SameLine();
+            if (ImGui::Button("Input Journal")) {
+                this->children.push_back(new InputJournalWindow(this->overlay));
+            }
+
             // device count
             auto devices = RI_MGR->devices_get();
             ImGui::Text("Devices detected: %u", (unsigned int) devices.size());
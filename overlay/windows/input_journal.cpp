@@ -0,0 +1,171 @@
+#include "input_journal.h"
+
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+
+#include "launcher/launcher.h"
+#include "util/logging.h"
+#include "util/time.h"
+
+namespace overlay::windows {
+
+    // power of two buckets in microseconds, same as the latency histogram
+    static size_t interval_bucket(double seconds) {
+        auto us = seconds > 0.0 ? (uint64_t) (seconds * 1000000.0) : 0;
+        auto bucket = (size_t) std::bit_width(us);
+        return bucket < rawinput::JournalLatency::BUCKETS ? bucket : rawinput::JournalLatency::BUCKETS - 1;
+    }
+
+    static std::string bucket_str(size_t bucket) {
+        if (bucket + 1 >= rawinput::JournalLatency::BUCKETS) {
+            return fmt::format(">= {:.0f}us",
+                    rawinput::JournalLatency::bucket_limit(bucket - 1) * 1000000.0);
+        }
+        return fmt::format("< {:.0f}us",
+                rawinput::JournalLatency::bucket_limit(bucket) * 1000000.0);
+    }
+
+    InputJournalWindow::InputJournalWindow(SpiceOverlay *overlay) : Window(overlay) {
+        this->title = "Input Journal";
+        this->init_size = ImVec2(
+                ImGui::GetIO().DisplaySize.x * 0.6f,
+                ImGui::GetIO().DisplaySize.y * 0.8f);
+        this->size_min = ImVec2(250, 200);
+        this->init_pos = ImVec2(
+                ImGui::GetIO().DisplaySize.x / 2 - this->init_size.x / 2,
+                ImGui::GetIO().DisplaySize.y / 2 - this->init_size.y / 2);
+        this->active = true;
+    }
+
+    void InputJournalWindow::select(rawinput::Device *device) {
+        this->device_name = device ? device->name : "";
+        this->position = device ? device->journal->get_count() : 0;
+        this->rate = 0.0;
+        this->rate_time = get_performance_seconds();
+        this->rate_count = this->position;
+        std::fill(std::begin(this->intervals), std::end(this->intervals), 0.f);
+        this->interval_last = 0.0;
+        this->events.clear();
+    }
+
+    void InputJournalWindow::update(rawinput::Device *device) {
+
+        // copy new events
+        rawinput::JournalEvent buffer[64];
+        size_t count;
+        while ((count = device->journal->read(this->position, buffer, std::size(buffer))) > 0) {
+            for (size_t index = 0; index < count; index++) {
+                auto &event = buffer[index];
+
+                // interval histogram
+                if (this->interval_last > 0.0) {
+                    this->intervals[interval_bucket(event.time - this->interval_last)] += 1.f;
+                }
+                this->interval_last = event.time;
+
+                // recent events
+                this->events.push_back(event);
+                if (this->events.size() > EVENTS_MAX) {
+                    this->events.pop_front();
+                }
+            }
+        }
+
+        // event rate over the last second
+        auto now = get_performance_seconds();
+        if (now - this->rate_time >= 1.0) {
+            auto total = device->journal->get_count();
+            this->rate = (double) (total - this->rate_count) / (now - this->rate_time);
+            this->rate_count = total;
+            this->rate_time = now;
+        }
+    }
+
+    void InputJournalWindow::build_content() {
+
+        // device selection
+        rawinput::Device *device = nullptr;
+        if (!this->device_name.empty()) {
+            device = RI_MGR->devices_get(this->device_name);
+            if (!device || !device->journal) {
+                device = nullptr;
+                this->select(nullptr);
+            }
+        }
+        if (ImGui::BeginCombo("Device", device ? device->desc.c_str() : "None")) {
+            for (auto &entry : RI_MGR->devices_get()) {
+                if (!entry.journal) {
+                    continue;
+                }
+                ImGui::PushID(&entry);
+                if (ImGui::Selectable(entry.desc.c_str(), &entry == device)) {
+                    device = &entry;
+                    this->select(device);
+                }
+                ImGui::PopID();
+            }
+            ImGui::EndCombo();
+        }
+        if (!device) {
+            ImGui::TextUnformatted("Select a device to start recording.");
+            return;
+        }
+        this->update(device);
+
+        // event rate
+        ImGui::Text("Events: %llu total, %.0f/s", (unsigned long long) device->journal->get_count(), this->rate);
+
+        // interval histogram
+        size_t interval_max = 0;
+        for (size_t bucket = 0; bucket < rawinput::JournalLatency::BUCKETS; bucket++) {
+            if (this->intervals[bucket] > 0.f) {
+                interval_max = bucket;
+            }
+        }
+        ImGui::PlotHistogram("Interval", this->intervals, (int) std::size(this->intervals),
+                0, bucket_str(interval_max).c_str(), 0.f, FLT_MAX, ImVec2(0, 80));
+        if (ImGui::Button("Reset Intervals")) {
+            std::fill(std::begin(this->intervals), std::end(this->intervals), 0.f);
+        }
+
+        // latency from arrival to the first game poll
+        auto latency = device->journal->get_latency();
+        float latency_buckets[rawinput::JournalLatency::BUCKETS];
+        for (size_t bucket = 0; bucket < rawinput::JournalLatency::BUCKETS; bucket++) {
+            latency_buckets[bucket] = (float) latency.buckets[bucket];
+        }
+        auto latency_text = fmt::format("mean {:.1f}us, max {:.1f}us",
+                latency.count > 0 ? latency.sum / latency.count * 1000000.0 : 0.0,
+                latency.max * 1000000.0);
+        ImGui::PlotHistogram("Poll Latency", latency_buckets, (int) std::size(latency_buckets),
+                0, latency_text.c_str(), 0.f, FLT_MAX, ImVec2(0, 80));
+        if (ImGui::Button("Reset Latency")) {
+            device->journal->reset_latency();
+        }
+        ImGui::SameLine();
+        ImGui::Text("%llu polls", (unsigned long long) latency.count);
+
+        // recent events
+        ImGui::Separator();
+        ImGui::BeginChild("InputJournalEvents", ImVec2(), false);
+        ImGui::Columns(4, "InputJournalColumns", true);
+        ImGui::TextColored(ImVec4(1.f, 0.7f, 0, 1), "Time"); ImGui::NextColumn();
+        ImGui::TextColored(ImVec4(1.f, 0.7f, 0, 1), "Control"); ImGui::NextColumn();
+        ImGui::TextColored(ImVec4(1.f, 0.7f, 0, 1), "Old"); ImGui::NextColumn();
+        ImGui::TextColored(ImVec4(1.f, 0.7f, 0, 1), "New"); ImGui::NextColumn();
+        ImGui::Separator();
+        for (auto it = this->events.rbegin(); it != this->events.rend(); ++it) {
+            ImGui::Text("%.6f", it->time);
+            ImGui::NextColumn();
+            ImGui::Text("%s %u", it->analog ? "Analog" : "Button", (unsigned) it->control);
+            ImGui::NextColumn();
+            ImGui::Text("%.3f", it->value_old);
+            ImGui::NextColumn();
+            ImGui::Text("%.3f", it->value_new);
+            ImGui::NextColumn();
+        }
+        ImGui::Columns();
+        ImGui::EndChild();
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <deque>
+
+#include "rawinput/rawinput.h"
+#include "overlay/window.h"
+
+namespace overlay::windows {
+
+    class InputJournalWindow : public Window {
+    public:
+
+        InputJournalWindow(SpiceOverlay *overlay);
+
+        void build_content() override;
+
+    private:
+
+        static constexpr size_t EVENTS_MAX = 256;
+
+        // selected device
+        std::string device_name;
+        uint64_t position = 0;
+
+        // event rate
+        double rate = 0.0;
+        double rate_time = 0.0;
+        uint64_t rate_count = 0;
+
+        // time between consecutive events
+        float intervals[rawinput::JournalLatency::BUCKETS] {};
+        double interval_last = 0.0;
+
+        std::deque<rawinput::JournalEvent> events;
+
+        void select(rawinput::Device *device);
+        void update(rawinput::Device *device);
+    };
+}
@@ -543,7 +543,7 @@ namespace overlay::windows {
                 ImGui::HelpMarker("Please specify \"-api [PORT]\" / \"-apipass [PASS] \" command line arguments.");
                 ImGui::Separator();
             } else {
-                std::vector<api::ClientState> client_states;
+                std::vector<api::ClientInfo> client_states;
                 API_CONTROLLER->obtain_client_states(&client_states);
 
                 // show ip addresses
@@ -558,6 +558,18 @@ namespace overlay::windows {
                     }
                 }
 
+                // modules, shared by all clients
+                auto registry = API_CONTROLLER->get_registry();
+                if (registry && ImGui::TreeNode("Modules")) {
+                    for (auto module : registry->get_modules()) {
+                        if (ImGui::TreeNode(module->name.c_str())) {
+                            ImGui::Text("Password force: %i", module->password_force);
+                            ImGui::TreePop();
+                        }
+                    }
+                    ImGui::TreePop();
+                }
+
                 // client count
                 ImGui::Text("Connected clients: %u", (unsigned int) client_states.size());
 
@@ -565,20 +577,11 @@ namespace overlay::windows {
                 for (auto &client : client_states) {
                     auto address = API_CONTROLLER->get_ip_address(client.address);
                     if (ImGui::TreeNode(("Client @ " + address).c_str())) {
-                        if (client.password.empty()) {
+                        if (!client.password_set) {
                             ImGui::Text("No password set.");
                         } else {
                             ImGui::Text("Password set.");
                         }
-                        if (ImGui::TreeNode("Modules")) {
-                            for (auto &module : client.modules) {
-                                if (ImGui::TreeNode(module->name.c_str())) {
-                                    ImGui::Text("Password force: %i", module->password_force);
-                                    ImGui::TreePop();
-                                }
-                            }
-                            ImGui::TreePop();
-                        }
                         ImGui::TreePop();
                     }
                 }
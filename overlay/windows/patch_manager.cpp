@@ -1,5 +1,7 @@
 #include "patch_manager.h"
 
+#include <map>
+
 #include <psapi.h>
 #include "external/rapidjson/document.h"
 #include "external/rapidjson/writer.h"
@@ -451,6 +453,8 @@ namespace overlay::windows {
         }
 
         // iterate patches
+        auto patches_first = patches.size();
+        std::vector<std::pair<size_t, SignaturePatch>> signatures;
         for (auto &patch : doc.GetArray()) {
 
             // verfiy patch data
@@ -759,7 +763,7 @@ namespace overlay::windows {
                         }
                     }
 
-                    // build signature patch
+                    // build signature patch, converted to a memory patch before anything is applied
                     SignaturePatch signature_data = {
                             .dll_name = dll_name,
                             .signature = data_signature_it->value.GetString(),
@@ -767,10 +771,7 @@ namespace overlay::windows {
                             .offset = offset,
                             .usage = usage,
                     };
-
-                    // convert to memory patch
-                    patch_data.patches_memory.emplace_back(signature_data.to_memory(&patch_data));
-                    patch_data.type = PatchType::Memory;
+                    signatures.emplace_back(patches.size(), std::move(signature_data));
                     break;
                 }
                 case PatchType::Unknown:
@@ -779,15 +780,115 @@ namespace overlay::windows {
                     break;
             }
 
-            // auto apply
-            if (apply_patches && setting_auto_apply && patch_data.enabled) {
-                log_misc("patchmanager", "auto apply: {}", patch_data.name);
-                apply_patch(patch_data, true);
-            }
-
             // remember patch
             patches.emplace_back(patch_data);
         }
+
+        // find all signatures
+        resolve_signatures(signatures);
+
+        // auto apply in file order
+        if (apply_patches && setting_auto_apply) {
+            for (size_t i = patches_first; i < patches.size(); i++) {
+                auto &patch_data = patches[i];
+                if (patch_data.enabled) {
+                    log_misc("patchmanager", "auto apply: {}", patch_data.name);
+                    apply_patch(patch_data, true);
+                }
+            }
+        }
+    }
+
+    void PatchManager::resolve_signatures(std::vector<std::pair<size_t, SignaturePatch>> &signatures) {
+
+        // group by module so every image is only scanned once
+        std::map<std::string, std::vector<size_t>> modules;
+        std::vector<MemoryPatch> results(signatures.size(), MemoryPatch {.fatal_error = true});
+        for (size_t i = 0; i < signatures.size(); i++) {
+            if (signatures[i].second.parse()) {
+                modules[signatures[i].second.dll_name].push_back(i);
+            }
+        }
+        for (auto &[dll_name, indices] : modules) {
+
+            // check if file exists
+            auto dll_path = MODULE_PATH / dll_name;
+            if (!fileutils::file_exists(dll_path)) {
+
+                // file does not exist so that's pretty fatal
+                continue;
+            }
+
+            // collect patterns
+            std::vector<SigScanPattern> patterns;
+            for (auto index : indices) {
+                patterns.push_back(signatures[index].second.pattern);
+            }
+
+            if (cfg::CONFIGURATOR_STANDALONE) {
+
+                // load file into dll map if missing
+                auto it = DLL_MAP.find(dll_name);
+                if (it == DLL_MAP.end()) {
+                    DLL_MAP[dll_name] =
+                            std::unique_ptr<std::vector<uint8_t>>(
+                                    fileutils::bin_read(dll_path));
+                    it = DLL_MAP.find(dll_name);
+                }
+
+                // find patterns
+                auto &data = *it->second;
+                find_patterns(data.data(), data.size(), 0, patterns);
+                for (size_t i = 0; i < indices.size(); i++) {
+                    auto &[patch_index, signature] = signatures[indices[i]];
+                    auto data_offset = static_cast<uint64_t>(patterns[i].result);
+                    results[indices[i]] = signature.to_memory(&patches[patch_index],
+                            reinterpret_cast<uint8_t *>(data_offset), (uintptr_t) data.data(), data_offset);
+                }
+
+            } else {
+
+                // get module
+                auto module = libutils::try_module(dll_path);
+                bool module_free = false;
+                if (!module) {
+                    module = libutils::try_library(dll_path);
+                    if (module) {
+                        module_free = true;
+                    } else {
+                        continue;
+                    }
+                }
+
+                // find patterns
+                find_patterns(module, patterns);
+                for (size_t i = 0; i < indices.size(); i++) {
+                    auto &[patch_index, signature] = signatures[indices[i]];
+                    auto data_offset_ptr = reinterpret_cast<uint8_t *>(patterns[i].result);
+                    if (!data_offset_ptr) {
+                        continue;
+                    }
+
+                    // convert back to offset
+                    auto data_offset = libutils::rva2offset(dll_path,
+                            (intptr_t) (data_offset_ptr - (uint8_t*) module));
+                    results[indices[i]] = signature.to_memory(&patches[patch_index],
+                            data_offset_ptr, 0, data_offset);
+                }
+
+                // clean
+                if (module_free) {
+                    FreeLibrary(module);
+                }
+            }
+        }
+
+        // convert to memory patches
+        for (size_t i = 0; i < signatures.size(); i++) {
+            auto &patch_data = patches[signatures[i].first];
+            patch_data.patches_memory.emplace_back(std::move(results[i]));
+            patch_data.type = PatchType::Memory;
+        }
     }
 
     PatchStatus is_patch_active(PatchData &patch) {
@@ -1073,114 +1174,32 @@ namespace overlay::windows {
         }
     }
 
-    MemoryPatch SignaturePatch::to_memory(PatchData *patch) {
-
-        // check if file exists
-        auto dll_path = MODULE_PATH / dll_name;
-        if (!fileutils::file_exists(dll_path)) {
-
-            // file does not exist so that's pretty fatal
-            return {.fatal_error = true};
-        }
+    bool SignaturePatch::parse() {
 
         // remove spaces
         signature.erase(std::remove(signature.begin(), signature.end(), ' '), signature.end());
         replacement.erase(std::remove(replacement.begin(), replacement.end(), ' '), replacement.end());
 
-        // build pattern
-        std::string pattern_str(signature);
-        strreplace(pattern_str, "??", "00");
-        strreplace(pattern_str, "XX", "00");
-        auto pattern_bin = std::make_unique<uint8_t[]>(signature.length() / 2);
-        if (!hex2bin(pattern_str.c_str(), pattern_bin.get())) {
-            return {.fatal_error = true};
-        }
-
-        // build signature mask
-        std::ostringstream signature_mask;
-        for (size_t i = 0; i < signature.length(); i += 2) {
-            if (signature[i] == '?' || signature[i] == 'X') {
-                if (signature[i + 1] == '?' || signature[i + 1] == 'X') {
-                    signature_mask << '?';
-                } else {
-                    return {.fatal_error = true};
+        // "XX" is accepted as a wildcard as well
+        auto normalize = [] (std::string hex) {
+            for (size_t i = 0; i + 1 < hex.length(); i += 2) {
+                if ((hex[i] == '?' || hex[i] == 'X') && (hex[i + 1] == '?' || hex[i + 1] == 'X')) {
+                    hex[i] = '?';
+                    hex[i + 1] = '?';
                 }
-            } else {
-                signature_mask << 'X';
             }
-        }
-        std::string signature_mask_str = signature_mask.str();
-
-        // build replace data
-        std::string replace_data_str(replacement);
-        strreplace(replace_data_str, "??", "00");
-        strreplace(replace_data_str, "XX", "00");
-        auto replace_data_bin = std::make_unique<uint8_t[]>(replacement.length() / 2);
-        if (!hex2bin(replace_data_str.c_str(), replace_data_bin.get())) {
-            return {.fatal_error = true};
-        }
-
-        // build replace mask
-        std::ostringstream replace_mask;
-        for (size_t i = 0; i < replacement.length(); i += 2) {
-            if (replacement[i] == '?' || replacement[i] == 'X') {
-                if (replacement[i + 1] == '?' || replacement[i + 1] == 'X') {
-                    replace_mask << '?';
-                } else {
-                    return {.fatal_error = true};
-                }
-            } else {
-                replace_mask << 'X';
-            }
-        }
-        std::string replace_mask_str = replace_mask.str();
-
-        // find offset
-        uint64_t data_offset = 0;
-        uint8_t *data_offset_ptr = nullptr;
-        uintptr_t data_offset_ptr_base = 0;
-        if (cfg::CONFIGURATOR_STANDALONE) {
-
-            // load file into dll map if missing
-            auto it = DLL_MAP.find(dll_name);
-            if (it == DLL_MAP.end()) {
-                DLL_MAP[dll_name] =
-                        std::unique_ptr<std::vector<uint8_t>>(
-                                fileutils::bin_read(dll_path));
-                it = DLL_MAP.find(dll_name);
-            }
-
-            // find pattern
-            data_offset = find_pattern(*it->second, 0, pattern_bin.get(), signature_mask_str.c_str(), offset, usage);
-            data_offset_ptr = reinterpret_cast<uint8_t *>(data_offset);
-            data_offset_ptr_base = (uintptr_t) it->second->data();
-
-        } else {
-
-            // get module
-            auto module = libutils::try_module(dll_path);
-            bool module_free = false;
-            if (!module) {
-                module = libutils::try_library(dll_path);
-                if (module) {
-                    module_free = true;
-                } else {
-                    return {.fatal_error = true};
-                }
-            }
-
-            // find pattern
-            data_offset_ptr = reinterpret_cast<uint8_t *>(
-                    find_pattern(module, pattern_bin.get(), signature_mask_str.c_str(), offset, usage));
+            return hex;
+        };
 
-            // convert back to offset
-            data_offset = libutils::rva2offset(dll_path, (intptr_t) (data_offset_ptr - (uint8_t*) module));
+        // build pattern and replacement
+        pattern.offset = offset;
+        pattern.usage = usage;
+        return parse_pattern(normalize(signature), pattern.data, pattern.mask)
+            && parse_pattern(normalize(replacement), replace_data, replace_mask);
+    }
 
-            // clean
-            if (module_free) {
-                FreeLibrary(module);
-            }
-        }
+    MemoryPatch SignaturePatch::to_memory(PatchData *patch, uint8_t *data_offset_ptr, uintptr_t data_offset_ptr_base,
+            uint64_t data_offset) {
 
         // check pointers
         if (data_offset_ptr == nullptr) {
@@ -1188,22 +1207,22 @@ namespace overlay::windows {
         }
 
         // get disabled/enabled data
-        size_t data_len = std::max(signature_mask_str.length(), replace_mask_str.length());
+        size_t data_len = std::max(pattern.mask.length(), replace_mask.length());
         std::shared_ptr<uint8_t[]> data_disabled(new uint8_t[data_len]);
         std::shared_ptr<uint8_t[]> data_enabled(new uint8_t[data_len]);
         memutils::VProtectGuard data_guard(data_offset_ptr + data_offset_ptr_base, data_len);
         for (size_t i = 0; i < data_len; ++i) {
-            if (i >= signature_mask_str.length() || signature_mask_str[i] != 'X') {
+            if (i >= pattern.mask.length() || pattern.mask[i] != 'X') {
                 data_disabled.get()[i] = (data_offset_ptr + data_offset_ptr_base)[i];
             } else {
-                data_disabled.get()[i] = pattern_bin.get()[i];
+                data_disabled.get()[i] = pattern.data[i];
             }
         }
         for (size_t i = 0; i < data_len; ++i) {
-            if (i >= replace_mask_str.length() || replace_mask_str[i] != 'X') {
+            if (i >= replace_mask.length() || replace_mask[i] != 'X') {
                 data_enabled.get()[i] = (data_offset_ptr + data_offset_ptr_base)[i];
             } else {
-                data_enabled.get()[i] = replace_data_bin.get()[i];
+                data_enabled.get()[i] = replace_data[i];
             }
         }
 
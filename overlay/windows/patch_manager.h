@@ -1,6 +1,7 @@
 #pragma once
 
 #include "overlay/window.h"
+#include "util/sigscan.h"
 
 namespace overlay::windows {
 
@@ -33,7 +34,14 @@ namespace overlay::windows {
         std::string signature = "", replacement = "";
         int64_t offset = 0, usage = 0;
 
-        MemoryPatch to_memory(PatchData *patch);
+        // parsed signature and replacement
+        SigScanPattern pattern;
+        std::vector<uint8_t> replace_data;
+        std::string replace_mask;
+
+        bool parse();
+        MemoryPatch to_memory(PatchData *patch, uint8_t *data_offset_ptr, uintptr_t data_offset_ptr_base,
+                uint64_t data_offset);
     };
 
     struct PatchData {
@@ -76,6 +84,7 @@ namespace overlay::windows {
         void config_save();
 
         void append_patches(std::string &patches_json, bool apply_patches = false);
+        void resolve_signatures(std::vector<std::pair<size_t, SignaturePatch>> &signatures);
     };
 
     PatchStatus is_patch_active(PatchData &patch);
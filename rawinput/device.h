@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <thread>
 #include <mutex>
@@ -14,6 +16,8 @@ extern "C" {
 
 #include "util/unique_plain_ptr.h"
 
+#include "hid_decoder.h"
+#include "journal.h"
 #include "sextet.h"
 
 namespace rawinput {
@@ -97,6 +101,24 @@ namespace rawinput {
         std::vector<HIDTouchPoint> touch_points;
     };
 
+    // output report as built from the current states and as last written to the device
+    struct HIDOutputReport {
+        std::vector<CHAR> data;
+        std::vector<CHAR> sent;
+        bool control = false;
+    };
+
+    /*
+     * Input reports of a device together with what hid.dll decoded from them, written in the fixture
+     * format of rawinput/test once enough distinct reports were seen.
+     */
+    struct HIDCapture {
+        std::string path;
+        std::string header;
+        std::vector<uint8_t> last_report;
+        std::vector<std::string> reports;
+    };
+
     struct DeviceHIDInfo {
         HANDLE handle;
         _HIDP_CAPS caps;
@@ -123,6 +145,16 @@ namespace rawinput {
         std::vector<LONG> value_states_raw;
         std::vector<float> value_output_states;
 
+        // preallocated output reports and usage lists
+        std::vector<HIDOutputReport> output_reports;
+        std::vector<USAGE> output_usages_on, output_usages_off;
+
+        // input report layout, null if the device has to be decoded by hid.dll
+        std::unique_ptr<HIDReportDecoder> decoder;
+
+        // reports recorded as a rawinput/test fixture, null unless capturing
+        std::unique_ptr<HIDCapture> capture;
+
         // for config binding function
         std::vector<float> bind_value_states;
     };
@@ -147,6 +179,59 @@ namespace rawinput {
         uint16_t pitch_bend; // 14 bit resolution
     };
 
+    /*
+     * Sequence lock publishing the input state of mice, keyboards and HID devices.
+     *
+     * The input thread makes the sequence odd before it changes the state and even again afterwards,
+     * while still holding the device mutex to keep out other writers. Readers don't take the mutex,
+     * they copy what they need and retry if the sequence changed in the meantime. This way polling
+     * the state never blocks on the input thread, and the input thread never waits for a reader.
+     */
+    class DeviceSeqLock {
+    public:
+
+        void write_begin() {
+            this->sequence.store(this->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        void write_end() {
+            this->sequence.store(this->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        uint32_t read_begin() const {
+            auto sequence = this->sequence.load(std::memory_order_acquire);
+            while (sequence & 1) {
+                YieldProcessor();
+                sequence = this->sequence.load(std::memory_order_acquire);
+            }
+            return sequence;
+        }
+
+        bool read_retry(uint32_t sequence) const {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return this->sequence.load(std::memory_order_relaxed) != sequence;
+        }
+
+        // runs the function until it saw a consistent state, so it must not have side effects
+        template<typename T>
+        void read(T &&function) const {
+            uint32_t sequence;
+            do {
+                sequence = this->read_begin();
+                function();
+            } while (this->read_retry(sequence));
+        }
+
+    private:
+        std::atomic<uint32_t> sequence {0};
+    };
+
+    // whether the input state of a device type is published through its sequence lock
+    inline bool seqlock_supported(DeviceType type) {
+        return type == MOUSE || type == KEYBOARD || type == HID;
+    }
+
     class PIUIO;
 
     struct Device {
@@ -158,9 +243,14 @@ namespace rawinput {
         DeviceInfo info;
         std::mutex *mutex;
         std::mutex *mutex_out;
+        DeviceSeqLock *seqlock;
+        DeviceJournal *journal = nullptr;
         bool updated = true;
         bool output_pending = true;
         bool output_enabled = false;
+        bool output_refresh = false;
+        double output_time = 0.0;
+        double output_refresh_time = 0.0;
         DeviceMouseInfo *mouseInfo = nullptr;
         DeviceKeyboardInfo *keyboardInfo = nullptr;
         DeviceHIDInfo *hidInfo = nullptr;
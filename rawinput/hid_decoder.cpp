@@ -0,0 +1,91 @@
+#include "hid_decoder.h"
+
+std::unique_ptr<rawinput::HIDReportDecoder> rawinput::HIDReportDecoder::compile(size_t report_size,
+        const std::vector<ButtonProbe> &button_probes,
+        const std::vector<ValueProbe> &value_probes) {
+    if (report_size == 0) {
+        return nullptr;
+    }
+    auto decoder = std::make_unique<HIDReportDecoder>(report_size);
+
+    // buttons, arrays store usage indices instead of bits and are left to hid.dll
+    std::vector<uint32_t> offsets;
+    for (auto &probe : button_probes) {
+        if (probe.array) {
+            return nullptr;
+        }
+        offsets.clear();
+        for (auto &bits : probe.usage_bits) {
+            if (bits.size() != 1 || bits[0] >= report_size * 8) {
+                return nullptr;
+            }
+            offsets.push_back(bits[0]);
+        }
+        decoder->add_buttons(probe.report_id, offsets.data(), offsets.size());
+    }
+
+    // values have to be a single run of bits
+    for (auto &probe : value_probes) {
+        auto &bits = probe.bits;
+        if (probe.bit_size == 0 || probe.bit_size > 32 || bits.size() != probe.bit_size
+                || bits.back() - bits.front() + 1 != probe.bit_size
+                || bits.back() >= report_size * 8) {
+            return nullptr;
+        }
+        decoder->add_value(probe.report_id, bits.front(), (uint8_t) probe.bit_size);
+    }
+
+    return decoder;
+}
+
+void rawinput::HIDReportDecoder::add_buttons(uint8_t report_id, const uint32_t *offsets, size_t count) {
+    this->button_caps.emplace_back(ButtonCap {
+        .report_id = report_id,
+        .first = (uint32_t) this->button_offsets.size(),
+        .count = (uint32_t) count,
+    });
+    this->button_offsets.insert(this->button_offsets.end(), offsets, offsets + count);
+}
+
+void rawinput::HIDReportDecoder::add_value(uint8_t report_id, uint32_t offset, uint8_t size) {
+    this->value_caps.emplace_back(ValueCap {
+        .report_id = report_id,
+        .offset = offset,
+        .size = size,
+    });
+}
+
+bool rawinput::HIDReportDecoder::buttons(size_t cap, const uint8_t *report, size_t size, bool *states) const {
+    auto &button_cap = this->button_caps[cap];
+    if (!this->matches(button_cap.report_id, report, size)) {
+        return false;
+    }
+
+    // one bit per usage
+    auto offsets = &this->button_offsets[button_cap.first];
+    for (uint32_t button = 0; button < button_cap.count; button++) {
+        auto offset = offsets[button];
+        states[button] = (report[offset >> 3] >> (offset & 7)) & 1;
+    }
+
+    return true;
+}
+
+bool rawinput::HIDReportDecoder::value(size_t cap, const uint8_t *report, size_t size, uint32_t &value) const {
+    auto &value_cap = this->value_caps[cap];
+    if (!this->matches(value_cap.report_id, report, size)) {
+        return false;
+    }
+
+    // values are packed little endian and span at most five bytes
+    auto byte = value_cap.offset >> 3;
+    auto byte_end = (value_cap.offset + value_cap.size + 7) >> 3;
+    uint64_t bits = 0;
+    for (auto index = byte; index < byte_end; index++) {
+        bits |= (uint64_t) report[index] << ((index - byte) * 8);
+    }
+    bits >>= value_cap.offset & 7;
+    value = (uint32_t) (bits & (((uint64_t) 1 << value_cap.size) - 1));
+
+    return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rawinput {
+
+    /*
+     * Precompiled input report layout of a HID device.
+     *
+     * Instead of letting hid.dll walk the preparsed data for every report, the position of every button
+     * and value cap is looked up once and stored as plain bit offsets. Decoding a report then only
+     * extracts bits. Caps are numbered in the same order as the caps lists of the device.
+     *
+     * Offsets count from the start of the report including the report ID byte, which is zero for
+     * devices not using report IDs. Values are returned as the raw unsigned bits like HidP_GetUsageValue
+     * does, sign extension and scaling are left to the caller.
+     *
+     * This doesn't depend on any Windows API so it can be fed captured layouts and reports anywhere,
+     * see rawinput/test for the host build.
+     */
+    class HIDReportDecoder {
+    public:
+
+        /*
+         * Bits hid.dll changed while probing a cap in a blank report of its report ID.
+         * Buttons list the bits written for each single usage, values the bits which differ between
+         * writing zero and all ones. Failed probes are left empty.
+         */
+        struct ButtonProbe {
+            uint8_t report_id = 0;
+            bool array = false;
+            std::vector<std::vector<uint32_t>> usage_bits;
+        };
+        struct ValueProbe {
+            uint8_t report_id = 0;
+            uint16_t bit_size = 0;
+            std::vector<uint32_t> bits;
+        };
+
+        // builds the layout from probes, null if any cap can't be mapped to plain bits
+        static std::unique_ptr<HIDReportDecoder> compile(size_t report_size,
+                const std::vector<ButtonProbe> &button_probes,
+                const std::vector<ValueProbe> &value_probes);
+
+        explicit HIDReportDecoder(size_t report_size) : report_size(report_size) {}
+
+        // layout, one bit offset per usage of the cap
+        void add_buttons(uint8_t report_id, const uint32_t *offsets, size_t count);
+        void add_value(uint8_t report_id, uint32_t offset, uint8_t size);
+
+        // decoding, false if the report doesn't contain the cap
+        bool buttons(size_t cap, const uint8_t *report, size_t size, bool *states) const;
+        bool value(size_t cap, const uint8_t *report, size_t size, uint32_t &value) const;
+
+        inline size_t get_report_size() const {
+            return this->report_size;
+        }
+        inline size_t get_button_caps() const {
+            return this->button_caps.size();
+        }
+        inline size_t get_value_caps() const {
+            return this->value_caps.size();
+        }
+
+    private:
+
+        struct ButtonCap {
+            uint8_t report_id;
+            uint32_t first;
+            uint32_t count;
+        };
+        struct ValueCap {
+            uint8_t report_id;
+            uint32_t offset;
+            uint8_t size;
+        };
+
+        size_t report_size;
+        std::vector<ButtonCap> button_caps;
+        std::vector<uint32_t> button_offsets;
+        std::vector<ValueCap> value_caps;
+
+        inline bool matches(uint8_t report_id, const uint8_t *report, size_t size) const {
+            return size >= this->report_size && report[0] == report_id;
+        }
+    };
+}
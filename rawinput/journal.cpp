@@ -0,0 +1,100 @@
+#include "journal.h"
+
+#include <bit>
+
+#include "util/time.h"
+
+void rawinput::DeviceJournal::push(double time, uint16_t control, bool analog, float value_old, float value_new) {
+    auto position = this->written.load(std::memory_order_relaxed);
+    auto &slot = this->slots[position % SIZE];
+
+    // odd sequence while the slot is being written
+    slot.sequence.store(position * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event = JournalEvent {
+        .time = time,
+        .control = control,
+        .analog = analog,
+        .value_old = value_old,
+        .value_new = value_new,
+    };
+    slot.sequence.store(position * 2 + 2, std::memory_order_release);
+    this->written.store(position + 1, std::memory_order_release);
+
+    // start the latency measurement unless an older transition is still waiting for a poll
+    double expected = 0.0;
+    this->pending[pending_slot(control, analog)].compare_exchange_strong(expected, time,
+            std::memory_order_relaxed);
+}
+
+size_t rawinput::DeviceJournal::read(uint64_t &position, JournalEvent *out, size_t count) const {
+    auto end = this->written.load(std::memory_order_acquire);
+
+    // events older than the ring are lost
+    if (end > SIZE && position < end - SIZE) {
+        position = end - SIZE;
+    }
+
+    size_t copied = 0;
+    for (; position < end && copied < count; position++) {
+        auto &slot = this->slots[position % SIZE];
+
+        // skip slots the writer already moved past
+        auto sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != position * 2 + 2) {
+            continue;
+        }
+        out[copied] = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+            continue;
+        }
+        copied++;
+    }
+
+    return copied;
+}
+
+void rawinput::DeviceJournal::observe_pending(std::atomic<double> &pending) {
+    auto time = pending.exchange(0.0, std::memory_order_relaxed);
+    if (time <= 0.0) {
+        return;
+    }
+
+    // power of two buckets in microseconds
+    auto latency = get_performance_seconds() - time;
+    auto latency_ns = latency > 0.0 ? (uint64_t) (latency * 1000000000.0) : 0;
+    auto bucket = (size_t) std::bit_width(latency_ns / 1000);
+    if (bucket >= JournalLatency::BUCKETS) {
+        bucket = JournalLatency::BUCKETS - 1;
+    }
+    this->latency_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    this->latency_count.fetch_add(1, std::memory_order_relaxed);
+    this->latency_sum_ns.fetch_add(latency_ns, std::memory_order_relaxed);
+
+    // keep maximum
+    auto latency_max = this->latency_max_ns.load(std::memory_order_relaxed);
+    while (latency_ns > latency_max
+            && !this->latency_max_ns.compare_exchange_weak(latency_max, latency_ns, std::memory_order_relaxed)) {
+    }
+}
+
+rawinput::JournalLatency rawinput::DeviceJournal::get_latency() const {
+    JournalLatency latency {};
+    for (size_t bucket = 0; bucket < JournalLatency::BUCKETS; bucket++) {
+        latency.buckets[bucket] = this->latency_buckets[bucket].load(std::memory_order_relaxed);
+    }
+    latency.count = this->latency_count.load(std::memory_order_relaxed);
+    latency.sum = (double) this->latency_sum_ns.load(std::memory_order_relaxed) / 1000000000.0;
+    latency.max = (double) this->latency_max_ns.load(std::memory_order_relaxed) / 1000000000.0;
+    return latency;
+}
+
+void rawinput::DeviceJournal::reset_latency() {
+    for (auto &bucket : this->latency_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    this->latency_count.store(0, std::memory_order_relaxed);
+    this->latency_sum_ns.store(0, std::memory_order_relaxed);
+    this->latency_max_ns.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace rawinput {
+
+    // a single transition of a button or analog
+    struct JournalEvent {
+        double time;
+        uint16_t control;
+        bool analog;
+        float value_old;
+        float value_new;
+    };
+
+    // distribution of the delay between input arrival and the first game poll reading it
+    struct JournalLatency {
+        static constexpr size_t BUCKETS = 16;
+        uint64_t buckets[BUCKETS];
+        uint64_t count;
+        double sum;
+        double max;
+
+        // upper bound of a bucket in seconds, the last one is open ended
+        static double bucket_limit(size_t bucket) {
+            return (double) (1ull << bucket) / 1000000.0;
+        }
+    };
+
+    /*
+     * Per-device journal of input transitions.
+     *
+     * The input thread is the only writer and stores events into a fixed ring, every slot carries
+     * its own sequence number. Readers copy events out and skip slots which were overwritten while
+     * copying, so neither side ever waits. Times are performance counter seconds of WM_INPUT arrival.
+     *
+     * Game polls call observe() for every control they read. The arrival time of the oldest transition
+     * of a control nobody has read yet is kept until then and the delay goes into the latency histogram,
+     * so reads of other controls (e.g. overlay hotkeys) don't count as having seen it. Controls share a
+     * fixed table of pending times, in the rare case two of them collide the older transition wins.
+     */
+    class DeviceJournal {
+    public:
+        static constexpr size_t SIZE = 1024;
+
+        // input thread
+        void push(double time, uint16_t control, bool analog, float value_old, float value_new);
+
+        // game polls
+        inline void observe(uint16_t control, bool analog) {
+            auto &pending = this->pending[pending_slot(control, analog)];
+            if (pending.load(std::memory_order_relaxed) > 0.0) {
+                this->observe_pending(pending);
+            }
+        }
+
+        // copies up to count events starting at position, which is advanced past the copied events
+        size_t read(uint64_t &position, JournalEvent *out, size_t count) const;
+
+        // number of events ever written
+        inline uint64_t get_count() const {
+            return this->written.load(std::memory_order_acquire);
+        }
+
+        JournalLatency get_latency() const;
+        void reset_latency();
+
+    private:
+        struct Slot {
+            std::atomic<uint64_t> sequence {0};
+            JournalEvent event {};
+        };
+        Slot slots[SIZE];
+        std::atomic<uint64_t> written {0};
+
+        // latency
+        static constexpr size_t PENDING_SIZE = 1024;
+        std::atomic<double> pending[PENDING_SIZE] {};
+        std::atomic<uint64_t> latency_buckets[JournalLatency::BUCKETS] {};
+        std::atomic<uint64_t> latency_count {0};
+        std::atomic<uint64_t> latency_sum_ns {0};
+        std::atomic<uint64_t> latency_max_ns {0};
+
+        static inline size_t pending_slot(uint16_t control, bool analog) {
+            return ((size_t) control * 2 + (analog ? 1 : 0)) % PENDING_SIZE;
+        }
+        void observe_pending(std::atomic<double> &pending);
+    };
+}
@@ -1,11 +1,14 @@
 #include "rawinput.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdarg>
 #include <utility>
 
 #include <objbase.h>
 #include <setupapi.h>
 
+#include "util/fileutils.h"
 #include "util/logging.h"
 #include "util/time.h"
 #include "util/utils.h"
@@ -21,17 +24,23 @@ namespace rawinput {
 
     // settings
     bool NOLEGACY = false;
+    bool BUFFERED = true;
+    int OUTPUT_RATE = 120;
+    bool OUTPUT_REFRESH_ALL = false;
+    std::string HID_CAPTURE_PATH;
 }
 
+std::atomic<uint32_t> rawinput::RawInputManager::devices_generation {1};
+
 rawinput::RawInputManager::RawInputManager() {
 
     // create input window and load in devices
     this->input_hwnd_create();
+    this->devices_changed();
     this->devices_reload();
 
-    // start flushing thread
+    // start output thread
     this->output_start();
-    this->flush_start();
 
     // now create the hotplug manager on that window
     this->hotplug = new HotplugManager(this, this->input_hwnd);
@@ -55,7 +64,6 @@ void rawinput::RawInputManager::stop() {
     this->devices_unregister();
 
     // stop threads
-    this->flush_stop();
     this->output_stop();
 
     // destruct all devices and input window
@@ -75,6 +83,20 @@ void rawinput::RawInputManager::input_hwnd_create() {
         return;
     }
 
+    // buffered input storage, allocated once
+    this->input_arena.resize(INPUT_ARENA_SIZE / sizeof(uint64_t));
+    this->input_batch.reserve(INPUT_ARENA_SIZE / sizeof(RAWINPUTHEADER));
+    this->input_batch_devices.reserve(64);
+
+    // 32-bit processes on 64-bit windows get the 64-bit header layout from GetRawInputBuffer
+#ifndef SPICE64
+    BOOL wow64 = FALSE;
+    if (IsWow64Process(GetCurrentProcess(), &wow64) && wow64) {
+        this->input_buffer_header_size = 24;
+        this->input_buffer_align = 8;
+    }
+#endif
+
     // create input thread
     this->input_thread = new std::thread([this]() {
 
@@ -210,6 +232,8 @@ void rawinput::RawInputManager::devices_scan_rawinput(RAWINPUTDEVICELIST *device
     new_device.info = device_info;
     new_device.mutex = new std::mutex();
     new_device.mutex_out = new std::mutex();
+    new_device.seqlock = new DeviceSeqLock();
+    new_device.journal = new DeviceJournal();
     new_device.input_time = get_performance_seconds();
     switch (device->dwType) {
         case RIM_TYPEMOUSE:
@@ -685,6 +709,9 @@ void rawinput::RawInputManager::devices_scan_rawinput(RAWINPUTDEVICELIST *device
             new_device.hidInfo->handle = hid_handle;
             new_device.hidInfo->caps = caps;
             new_device.hidInfo->attributes = hid_attributes;
+
+            // DJ DAO boards fall back to button based lighting without periodic output reports
+            new_device.output_refresh = hid_attributes.VendorID == 0x1CCF;
             new_device.hidInfo->driver = hid_driver;
             new_device.hidInfo->usage_name = std::move(usage_name);
             new_device.hidInfo->preparsed_data = std::move(preparsed_data);
@@ -706,6 +733,12 @@ void rawinput::RawInputManager::devices_scan_rawinput(RAWINPUTDEVICELIST *device
             new_device.hidInfo->value_output_states = std::move(value_output_states);
             new_device.hidInfo->bind_value_states = std::move(bind_value_states);
 
+            // precompile the input report layout
+            new_device.hidInfo->decoder = hid_decoder_compile(new_device.hidInfo);
+            if (!new_device.hidInfo->decoder) {
+                log_misc("rawinput", "input reports of {} are decoded by hid.dll", new_device.desc);
+            }
+
             // check for touch screen
             if (rawinput::touch::is_touchscreen(&new_device)) {
                 rawinput::touch::enable(&new_device);
@@ -728,6 +761,7 @@ void rawinput::RawInputManager::devices_scan_rawinput(RAWINPUTDEVICELIST *device
             // destruct and replace
             this->devices_destruct(&prev_device);
             prev_device = new_device;
+            this->devices_changed();
 
             // notify change
             for (auto &cb : this->callback_change) {
@@ -740,6 +774,7 @@ void rawinput::RawInputManager::devices_scan_rawinput(RAWINPUTDEVICELIST *device
 
     // add device to list
     auto &added_device = this->devices.emplace_back(new_device);
+    this->devices_changed();
     if (log) {
         log_info("rawinput", "added device: {} / {}", added_device.desc, added_device.name);
     }
@@ -819,6 +854,7 @@ void rawinput::RawInputManager::devices_scan_midi() {
         midi_device.info = midi_device_info;
         midi_device.mutex = new std::mutex();
         midi_device.mutex_out = new std::mutex();
+        midi_device.seqlock = new DeviceSeqLock();
         midi_device.midiInfo = midi_device_midi_info;
 
         // check for duplicate handle
@@ -843,6 +879,7 @@ void rawinput::RawInputManager::devices_scan_midi() {
 
         // add device to list
         auto &device = this->devices.emplace_back(midi_device);
+        this->devices_changed();
 
         // notify add
         for (auto &cb : this->callback_add) {
@@ -861,9 +898,11 @@ void rawinput::RawInputManager::devices_scan_piuio() {
     new_piuio_device->piuioDev = nullptr;
     new_piuio_device->mutex = new std::mutex();
     new_piuio_device->mutex_out = new std::mutex();
+    new_piuio_device->seqlock = new DeviceSeqLock();
 
     // try to initialize
     auto &device = this->devices.emplace_back(*new_piuio_device);
+    this->devices_changed();
     auto piuioDev = new PIUIO(&device);
     if (piuioDev->Init()) {
 
@@ -878,42 +917,7 @@ void rawinput::RawInputManager::devices_scan_piuio() {
 
         // remove device since connection failed
         this->devices.pop_back();
-    }
-}
-
-void rawinput::RawInputManager::flush_start() {
-
-    // start flush thread
-    if (this->flush_thread == nullptr) {
-        this->flush_thread_running = true;
-        this->flush_thread = new std::thread([this] {
-            while (this->flush_thread_running) {
-
-                /*
-                 * Write output report all ~500ms so DAO IIDX boards (and probably more) don't go back
-                 * to button based lighting.
-                 */
-                this->devices_flush_output(false);
-                Sleep(495);
-            }
-        });
-    }
-}
-
-void rawinput::RawInputManager::flush_stop() {
-
-    // set stop flag
-    this->flush_thread_running = false;
-
-    // check if thread is set
-    if (this->flush_thread) {
-
-        // join and kill
-        this->flush_thread->join();
-        delete this->flush_thread;
-
-        // unset thread
-        this->flush_thread = nullptr;
+        this->devices_changed();
     }
 }
 
@@ -925,26 +929,40 @@ void rawinput::RawInputManager::output_start() {
         output_thread = new std::thread([this] {
             std::unique_lock<std::mutex> lock(output_thread_m);
             while (output_thread_running) {
+                output_thread_ready = false;
 
-                // wait for CV
-                output_thread_cv.wait(lock, [this] {
-                    return output_thread_ready;
-                });
-
-                // check for exit
-                if (!output_thread_running) {
-                    break;
-                }
+                // minimum time between two writes to the same device
+                double interval = OUTPUT_RATE > 0 ? 1.0 / OUTPUT_RATE : 0.0;
 
-                // iterate all devices
-                do {
-                    output_thread_ready = false;
-                    for (auto &device : this->devices) {
+                // write all devices which are due and find the next deadline
+                auto now = get_performance_seconds();
+                auto deadline = now + OUTPUT_REFRESH;
+                for (auto &device : this->devices) {
+                    if (!device.output_enabled) {
+                        continue;
+                    }
 
-                        // write output
-                        device_write_output(&device, true);
+                    // rewrite all reports periodically if needed, other changes unless written to too recently
+                    bool refresh = device.output_refresh || OUTPUT_REFRESH_ALL;
+                    if (refresh && now - device.output_refresh_time >= OUTPUT_REFRESH) {
+                        device_write_output(&device, false, true);
+                    } else if (device.output_pending) {
+                        if (now - device.output_time >= interval) {
+                            device_write_output(&device, true);
+                        } else {
+                            deadline = MIN(deadline, device.output_time + interval);
+                        }
                     }
-                } while (output_thread_ready);
+                    if (refresh) {
+                        deadline = MIN(deadline, device.output_refresh_time + OUTPUT_REFRESH);
+                    }
+                }
+
+                // wait for new output or the next deadline
+                auto timeout = MAX(deadline - get_performance_seconds(), 0.0);
+                output_thread_cv.wait_for(lock, std::chrono::duration<double>(timeout), [this] {
+                    return output_thread_ready;
+                });
             }
         });
     }
@@ -1092,12 +1110,14 @@ void rawinput::RawInputManager::sextet_register(const std::string &port_name, co
     device.sextetInfo = new rawinput::SextetDevice(R"(\\.\)" + port_name);
     device.mutex = new std::mutex();
     device.mutex_out = new std::mutex();
+    device.seqlock = new DeviceSeqLock();
 
     // try to connect
     if (device.sextetInfo->connect()) {
 
         // successful connection
         this->devices.emplace_back(device);
+        this->devices_changed();
 
         // notify add
         for (auto &cb : this->callback_add) {
@@ -1266,10 +1286,56 @@ void rawinput::RawInputManager::devices_destruct() {
     for (auto &device : this->devices) {
         this->devices_destruct(&device, false);
         delete device.mutex;
+        delete device.seqlock;
+        delete device.journal;
+    }
+
+    // nothing reads the retired input state anymore
+    for (auto &retired : this->devices_retired) {
+        delete retired.mouseInfo;
+        delete retired.keyboardInfo;
+        delete retired.hidInfo;
     }
+    this->devices_retired.clear();
 
     // empty array
     this->devices.clear();
+    this->devices_changed();
+}
+
+void rawinput::RawInputManager::devices_changed() {
+
+    // publish a new index before anyone can see the new generation
+    {
+        std::lock_guard<std::mutex> lock(this->devices_index_m);
+        std::shared_ptr<const DeviceIndex> index = devices_index_build(this->devices);
+        std::atomic_store_explicit(&this->devices_index, std::move(index), std::memory_order_release);
+    }
+
+    devices_generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+std::unique_ptr<rawinput::RawInputManager::DeviceIndex> rawinput::RawInputManager::devices_index_build(
+        const std::vector<Device> &devices)
+{
+    auto index = std::make_unique<DeviceIndex>();
+    index->handles.reserve(devices.size());
+    index->names.reserve(devices.size());
+    for (size_t i = 0; i < devices.size(); i++) {
+        auto &device = devices[i];
+
+        // first device with a name wins, like the linear search did
+        index->names.emplace(device.name, i);
+
+        // handles of destroyed devices might get reused
+        auto handle = index->handles.find(device.handle);
+        if (handle == index->handles.end()) {
+            index->handles.emplace(device.handle, i);
+        } else if (devices[handle->second].type == DESTROYED && device.type != DESTROYED) {
+            handle->second = i;
+        }
+    }
+    return index;
 }
 
 void rawinput::RawInputManager::devices_destruct(Device *device, bool log) {
@@ -1287,6 +1353,7 @@ void rawinput::RawInputManager::devices_destruct(Device *device, bool log) {
     // mark as destroyed
     auto device_type = device->type;
     device->type = DESTROYED;
+    this->devices_changed();
 
     // notify change
     for (auto &cb : this->callback_change) {
@@ -1320,13 +1387,22 @@ void rawinput::RawInputManager::devices_destruct(Device *device, bool log) {
             break;
     }
 
-    // clean up generic stuff
-    delete device->mouseInfo;
+    /*
+     * input state is read lock free and a reader might still be looking at it,
+     * so it is only freed together with the device list
+     */
+    device->seqlock->write_begin();
+    this->devices_retired.push_back(DeviceRetired {
+        .mouseInfo = device->mouseInfo,
+        .keyboardInfo = device->keyboardInfo,
+        .hidInfo = device->hidInfo,
+    });
     device->mouseInfo = nullptr;
-    delete device->keyboardInfo;
     device->keyboardInfo = nullptr;
-    delete device->hidInfo;
     device->hidInfo = nullptr;
+    device->seqlock->write_end();
+
+    // clean up generic stuff
     delete device->midiInfo;
     device->midiInfo = nullptr;
     delete device->sextetInfo;
@@ -1334,6 +1410,749 @@ void rawinput::RawInputManager::devices_destruct(Device *device, bool log) {
     // TODO: check if mutex can be deleted
 }
 
+/*
+ * Looks up the position of every input cap by letting hid.dll write it into a blank report.
+ * Returns null if any cap can't be mapped to plain bits, the device then keeps using hid.dll.
+ */
+std::unique_ptr<rawinput::HIDReportDecoder> rawinput::RawInputManager::hid_decoder_compile(DeviceHIDInfo *info) {
+    auto preparsed_data = reinterpret_cast<PHIDP_PREPARSED_DATA>(info->preparsed_data.get());
+    ULONG report_size = info->caps.InputReportByteLength;
+    if (report_size == 0) {
+        return nullptr;
+    }
+
+    // blank report for a report ID
+    std::vector<CHAR> report_blank(report_size);
+    auto report_init = [&] (UCHAR report_id) {
+        std::fill(report_blank.begin(), report_blank.end(), 0);
+        return HidP_InitializeReportForID(HidP_Input, report_id, preparsed_data,
+                report_blank.data(), report_size) == HIDP_STATUS_SUCCESS;
+    };
+
+    // bits which differ between two reports
+    auto report_diff = [&] (const std::vector<CHAR> &a, const std::vector<CHAR> &b) {
+        std::vector<uint32_t> bits;
+        for (uint32_t byte = 0; byte < report_size; byte++) {
+            auto diff = (uint8_t) (a[byte] ^ b[byte]);
+            for (uint32_t bit = 0; diff != 0; bit++, diff >>= 1) {
+                if (diff & 1) {
+                    bits.push_back(byte * 8 + bit);
+                }
+            }
+        }
+        return bits;
+    };
+
+    // buttons, every usage is written on its own, arrays store usage indices and are not probed
+    std::vector<HIDReportDecoder::ButtonProbe> button_probes;
+    std::vector<CHAR> report_low(report_size), report_high(report_size);
+    for (auto &button_caps : info->button_caps_list) {
+        auto &probe = button_probes.emplace_back();
+        probe.report_id = button_caps.ReportID;
+        probe.array = (button_caps.BitField & 0x02) == 0;
+        if (probe.array) {
+            continue;
+        }
+        bool report_valid = report_init(button_caps.ReportID);
+        for (int usage = button_caps.Range.UsageMin; usage <= button_caps.Range.UsageMax; usage++) {
+            report_high = report_blank;
+            auto usage_value = (USAGE) usage;
+            ULONG usage_length = 1;
+            if (report_valid && HidP_SetUsages(
+                    HidP_Input,
+                    button_caps.UsagePage,
+                    button_caps.LinkCollection,
+                    &usage_value,
+                    &usage_length,
+                    preparsed_data,
+                    report_high.data(),
+                    report_size) == HIDP_STATUS_SUCCESS) {
+                probe.usage_bits.emplace_back(report_diff(report_blank, report_high));
+            } else {
+                probe.usage_bits.emplace_back();
+            }
+        }
+    }
+
+    // values, written once with all bits cleared and once with all bits set
+    std::vector<HIDReportDecoder::ValueProbe> value_probes;
+    for (auto &value_caps : info->value_caps_list) {
+        auto &probe = value_probes.emplace_back();
+        probe.report_id = value_caps.ReportID;
+        probe.bit_size = value_caps.BitSize;
+        if (value_caps.BitSize == 0 || value_caps.BitSize > 32 || !report_init(value_caps.ReportID)) {
+            continue;
+        }
+        auto value_write = [&] (std::vector<CHAR> &report, ULONG value) {
+            report = report_blank;
+            return HidP_SetUsageValue(
+                    HidP_Input,
+                    value_caps.UsagePage,
+                    value_caps.LinkCollection,
+                    value_caps.Range.UsageMin,
+                    value,
+                    preparsed_data,
+                    report.data(),
+                    report_size) == HIDP_STATUS_SUCCESS;
+        };
+        auto value_mask = (ULONG) (((uint64_t) 1 << value_caps.BitSize) - 1);
+        if (value_write(report_low, 0) && value_write(report_high, value_mask)) {
+            probe.bits = report_diff(report_low, report_high);
+        }
+    }
+
+    auto decoder = HIDReportDecoder::compile(report_size, button_probes, value_probes);
+    if (!HID_CAPTURE_PATH.empty()) {
+        hid_capture_start(info, report_size, button_probes, value_probes, decoder == nullptr);
+    }
+    return decoder;
+}
+
+/*
+ * Starts recording input reports in the fixture format of rawinput/test, see hid_decoder_test.cpp.
+ * The probes are stored as found, the reports are decoded by hid.dll regardless of the layout.
+ */
+void rawinput::RawInputManager::hid_capture_start(DeviceHIDInfo *info, size_t report_size,
+        const std::vector<HIDReportDecoder::ButtonProbe> &button_probes,
+        const std::vector<HIDReportDecoder::ValueProbe> &value_probes,
+        bool fallback) {
+
+    // list of numbers
+    auto join = [] (const std::vector<uint32_t> &bits) {
+        std::string list;
+        for (auto bit : bits) {
+            list += list.empty() ? fmt::format("{}", bit) : fmt::format(", {}", bit);
+        }
+        return list;
+    };
+
+    // device name without characters which would need escaping
+    auto device = fmt::format("{:04X}:{:04X} {}",
+            info->attributes.VendorID, info->attributes.ProductID, info->usage_name);
+    device.erase(std::remove_if(device.begin(), device.end(), [] (char c) {
+        return c == '"' || c == '\\' || (unsigned char) c < 0x20;
+    }), device.end());
+
+    // header with the probes
+    std::string header = fmt::format("{{\n"
+            "    \"device\": \"{}\",\n"
+            "    \"report_size\": {},\n"
+            "    \"fallback\": {},\n"
+            "    \"button_caps\": [",
+            device, report_size, fallback ? "true" : "false");
+    for (size_t cap = 0; cap < button_probes.size(); cap++) {
+        auto &probe = button_probes[cap];
+        std::string usage_bits;
+        for (auto &bits : probe.usage_bits) {
+            usage_bits += fmt::format("{}[{}]", usage_bits.empty() ? "" : ", ", join(bits));
+        }
+        header += fmt::format("{}\n        {{\"report_id\": {}, \"array\": {}, \"usage_bits\": [{}]}}",
+                cap > 0 ? "," : "", probe.report_id, probe.array ? "true" : "false", usage_bits);
+    }
+    header += "\n    ],\n    \"value_caps\": [";
+    for (size_t cap = 0; cap < value_probes.size(); cap++) {
+        auto &probe = value_probes[cap];
+        header += fmt::format("{}\n        {{\"report_id\": {}, \"bit_size\": {}, \"bits\": [{}]}}",
+                cap > 0 ? "," : "", probe.report_id, probe.bit_size, join(probe.bits));
+    }
+    header += "\n    ],\n    \"reports\": [";
+
+    // start capture
+    info->capture = std::make_unique<HIDCapture>();
+    info->capture->path = fmt::format("{:04x}_{:04x}_{:04x}_{:04x}.json",
+            info->attributes.VendorID, info->attributes.ProductID, info->caps.UsagePage, info->caps.Usage);
+    info->capture->header = std::move(header);
+    log_info("rawinput", "capturing input reports of {} to {}", device, info->capture->path);
+}
+
+/*
+ * Records what HidP_GetUsages and HidP_GetUsageValue return for every cap of a new distinct report.
+ * The capture is written and stopped once HID_CAPTURE_REPORTS reports were recorded.
+ */
+void rawinput::RawInputManager::hid_capture_report(DeviceHIDInfo *info, const RAWHID &data) {
+    auto &capture = info->capture;
+    auto preparsed_data = reinterpret_cast<PHIDP_PREPARSED_DATA>(info->preparsed_data.get());
+    auto report_data = reinterpret_cast<PCHAR>(const_cast<BYTE *>(data.bRawData));
+
+    // skip repeated reports
+    std::vector<uint8_t> report(data.bRawData, data.bRawData + data.dwSizeHid);
+    if (report.empty() || report == capture->last_report) {
+        return;
+    }
+    capture->last_report = report;
+
+    // raw report
+    std::string report_hex;
+    for (auto byte : report) {
+        report_hex += fmt::format("{:02x}", byte);
+    }
+
+    // usage indices of pressed buttons, null if the report doesn't contain the cap
+    std::string buttons;
+    for (auto &button_caps : info->button_caps_list) {
+        int button_count = button_caps.Range.UsageMax - button_caps.Range.UsageMin + 1;
+        auto usages_length = static_cast<ULONG>(MAX(button_count, 0));
+        std::vector<USAGE> usages(usages_length);
+        if (!buttons.empty()) {
+            buttons += ", ";
+        }
+        if (button_count <= 0 || HidP_GetUsages(
+                HidP_Input,
+                button_caps.UsagePage,
+                button_caps.LinkCollection,
+                usages.data(),
+                &usages_length,
+                preparsed_data,
+                report_data,
+                data.dwSizeHid) != HIDP_STATUS_SUCCESS) {
+            buttons += "null";
+            continue;
+        }
+        std::vector<uint32_t> indices;
+        for (ULONG usage_num = 0; usage_num < usages_length; usage_num++) {
+            USAGE usage = usages[usage_num] - button_caps.Range.UsageMin;
+            if (usage < button_count) {
+                indices.push_back(usage);
+            }
+        }
+        std::sort(indices.begin(), indices.end());
+        std::string list;
+        for (auto index : indices) {
+            list += list.empty() ? fmt::format("{}", index) : fmt::format(", {}", index);
+        }
+        buttons += fmt::format("[{}]", list);
+    }
+
+    // raw values, null if the report doesn't contain the cap
+    std::string values;
+    for (auto &value_caps : info->value_caps_list) {
+        ULONG value = 0;
+        if (!values.empty()) {
+            values += ", ";
+        }
+        if (HidP_GetUsageValue(
+                HidP_Input,
+                value_caps.UsagePage,
+                value_caps.LinkCollection,
+                value_caps.Range.UsageMin,
+                &value,
+                preparsed_data,
+                report_data,
+                data.dwSizeHid) != HIDP_STATUS_SUCCESS) {
+            values += "null";
+        } else {
+            values += fmt::format("{}", value);
+        }
+    }
+
+    capture->reports.emplace_back(fmt::format(
+            "        {{\"data\": \"{}\", \"buttons\": [{}], \"values\": [{}]}}",
+            report_hex, buttons, values));
+
+    // write capture
+    if (capture->reports.size() >= HID_CAPTURE_REPORTS) {
+        std::string text = capture->header;
+        for (size_t report_num = 0; report_num < capture->reports.size(); report_num++) {
+            text += report_num > 0 ? ",\n" : "\n";
+            text += capture->reports[report_num];
+        }
+        text += "\n    ]\n}\n";
+        std::filesystem::path path = HID_CAPTURE_PATH;
+        if ((fileutils::dir_exists(path) || fileutils::dir_create_recursive(path))
+                && fileutils::text_write(path / capture->path, text)) {
+            log_info("rawinput", "wrote input report capture {}", (path / capture->path).string());
+        } else {
+            log_warning("rawinput", "failed to write input report capture {}", (path / capture->path).string());
+        }
+        capture.reset();
+    }
+}
+
+void rawinput::RawInputManager::input_process(Device &device, RawInputData &data, double input_time) {
+
+    // update hz
+    double diff_time = input_time - device.input_time;
+    if (diff_time > 0.0001) {
+        device.input_hz = 1.f / diff_time;
+        device.input_hz_max = MAX(device.input_hz_max, device.input_hz);
+        device.input_time = input_time;
+    }
+
+    // publish to lock free readers
+    device.seqlock->write_begin();
+
+    // check type
+    switch (device.type) {
+        case DESTROYED:
+            log_warning("rawinput", "received input msg for destroyed device");
+            break;
+        case MOUSE: {
+
+            // get mouse data
+            auto data_mouse = data.mouse;
+
+            // remember the previous state for the journal
+            DeviceMouseInfo mouse_old = *device.mouseInfo;
+
+            // save position
+            if (data_mouse.usFlags & MOUSE_MOVE_ABSOLUTE) {
+                if (device.mouseInfo->pos_x != data_mouse.lLastX) {
+                    device.updated = true;
+                }
+                device.mouseInfo->pos_x = data_mouse.lLastX;
+                if (device.mouseInfo->pos_y != data_mouse.lLastY) {
+                    device.updated = true;
+                }
+                device.mouseInfo->pos_y = data_mouse.lLastY;
+            } else {
+                if (data_mouse.lLastX != 0 || data_mouse.lLastY != 0) {
+                    device.updated = true;
+                }
+                device.mouseInfo->pos_x += data_mouse.lLastX;
+                device.mouseInfo->pos_y += data_mouse.lLastY;
+            }
+
+            // check buttons
+            if (data_mouse.usButtonFlags) {
+                auto &key_states = device.mouseInfo->key_states;
+                auto &key_up = device.mouseInfo->key_up;
+                auto &key_down = device.mouseInfo->key_down;
+                if (data_mouse.usButtonFlags & RI_MOUSE_LEFT_BUTTON_DOWN) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_LEFT] = true;
+                    key_down[MOUSEBTN_LEFT] = input_time;
+                }
+                if (data_mouse.usButtonFlags & RI_MOUSE_LEFT_BUTTON_UP) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_LEFT] = false;
+                    key_up[MOUSEBTN_LEFT] = input_time;
+                }
+                if (data_mouse.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_DOWN) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_RIGHT] = true;
+                    key_down[MOUSEBTN_RIGHT] = input_time;
+                }
+                if (data_mouse.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_UP) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_RIGHT] = false;
+                    key_up[MOUSEBTN_RIGHT] = input_time;
+                }
+                if (data_mouse.usButtonFlags & RI_MOUSE_MIDDLE_BUTTON_DOWN) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_MIDDLE] = true;
+                    key_down[MOUSEBTN_MIDDLE] = input_time;
+                }
+                if (data_mouse.usButtonFlags & RI_MOUSE_MIDDLE_BUTTON_UP) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_MIDDLE] = false;
+                    key_up[MOUSEBTN_MIDDLE] = input_time;
+                }
+                if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_1_DOWN) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_1] = true;
+                    key_down[MOUSEBTN_1] = input_time;
+                }
+                if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_1_UP) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_1] = false;
+                    key_up[MOUSEBTN_1] = input_time;
+                }
+                if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_2_DOWN) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_2] = true;
+                    key_down[MOUSEBTN_2] = input_time;
+                }
+                if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_2_UP) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_2] = false;
+                    key_up[MOUSEBTN_2] = input_time;
+                }
+                if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_3_DOWN) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_3] = true;
+                    key_down[MOUSEBTN_3] = input_time;
+                }
+                if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_3_UP) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_3] = false;
+                    key_up[MOUSEBTN_3] = input_time;
+                }
+                if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_4_DOWN) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_4] = true;
+                    key_down[MOUSEBTN_4] = input_time;
+                }
+                if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_4_UP) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_4] = false;
+                    key_up[MOUSEBTN_4] = input_time;
+                }
+                if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_5_DOWN) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_5] = true;
+                    key_down[MOUSEBTN_5] = input_time;
+                }
+                if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_5_UP) {
+                    device.updated = true;
+                    key_states[MOUSEBTN_5] = false;
+                    key_up[MOUSEBTN_5] = input_time;
+                }
+            }
+
+            // check wheel
+            if (data_mouse.usButtonFlags & RI_MOUSE_WHEEL) {
+                if ((short) data_mouse.usButtonData != 0) {
+                    device.updated = true;
+                }
+                device.mouseInfo->pos_wheel += ((short) data_mouse.usButtonData) / WHEEL_DELTA;
+            }
+
+            // journal
+            if (device.journal) {
+                auto mouse = device.mouseInfo;
+                for (uint16_t key = 0; key < std::size(mouse->key_states); key++) {
+                    if (mouse->key_states[key] != mouse_old.key_states[key]) {
+                        device.journal->push(input_time, key, false,
+                                mouse_old.key_states[key] ? 1.f : 0.f,
+                                mouse->key_states[key] ? 1.f : 0.f);
+                    }
+                }
+                if (mouse->pos_x != mouse_old.pos_x) {
+                    device.journal->push(input_time, MOUSEPOS_X, true, mouse_old.pos_x, mouse->pos_x);
+                }
+                if (mouse->pos_y != mouse_old.pos_y) {
+                    device.journal->push(input_time, MOUSEPOS_Y, true, mouse_old.pos_y, mouse->pos_y);
+                }
+                if (mouse->pos_wheel != mouse_old.pos_wheel) {
+                    device.journal->push(input_time, MOUSEPOS_WHEEL, true, mouse_old.pos_wheel, mouse->pos_wheel);
+                }
+            }
+
+            break;
+        }
+        case KEYBOARD: {
+
+            // get keyboard data
+            auto &data_keyboard = data.keyboard;
+
+            // set index based on flags
+            int index = 0;
+            if (data_keyboard.Flags & RI_KEY_E0) {
+                index += 256;
+            }
+            if (data_keyboard.Flags & RI_KEY_E1) {
+                index += 512;
+            }
+
+            // check the funny exceptions
+            USHORT vkey = data_keyboard.VKey;
+            switch (index + vkey) {
+                case 17:
+                    vkey = VK_LCONTROL;
+                    break;
+                case 273:
+                    vkey = VK_RCONTROL;
+                    break;
+            }
+            switch (data_keyboard.MakeCode) {
+                case 42:
+                    vkey = VK_LSHIFT;
+                    break;
+                case 54:
+                    vkey = VK_RSHIFT;
+                    break;
+            }
+
+            // update key state
+            if (vkey < 255) {
+                bool state = (data_keyboard.Flags & RI_KEY_BREAK) == 0;
+                auto &cur_state = device.keyboardInfo->key_states[index + vkey];
+                if (cur_state != state && device.journal) {
+                    device.journal->push(input_time, index + vkey, false, cur_state ? 1.f : 0.f, state ? 1.f : 0.f);
+                }
+                if (!cur_state && state) {
+                    cur_state = state;
+                    device.updated = true;
+                    device.keyboardInfo->key_down[index + vkey] = input_time;
+                } else if (cur_state && !state) {
+                    cur_state = state;
+                    device.updated = true;
+                    device.keyboardInfo->key_up[index + vkey] = input_time;
+                }
+            }
+
+            break;
+        }
+        case HID: {
+
+            // get HID data
+            auto &data_hid = data.hid;
+            auto &decoder = device.hidInfo->decoder;
+
+            // record for the decoder test
+            if (device.hidInfo->capture) {
+                hid_capture_report(device.hidInfo, data_hid);
+            }
+
+            // buttons
+            size_t button_base = 0;
+            for (size_t cap_num = 0; cap_num < device.hidInfo->button_caps_list.size(); cap_num++) {
+                auto &button_caps = device.hidInfo->button_caps_list[cap_num];
+                auto &button_states = device.hidInfo->button_states[cap_num];
+                auto &button_down = device.hidInfo->button_down[cap_num];
+                auto &button_up = device.hidInfo->button_up[cap_num];
+
+                // buttons are numbered across all caps, just like the bindings
+                auto button_index = button_base;
+                button_base += button_states.size();
+
+                // get button count
+                int button_count = button_caps.Range.UsageMax - button_caps.Range.UsageMin + 1;
+                if (button_count <= 0) {
+                    continue;
+                }
+
+                // get states
+                bool new_states[button_count] {};
+                if (decoder) {
+                    if (!decoder->buttons(cap_num, data_hid.bRawData, data_hid.dwSizeHid, new_states)) {
+                        continue;
+                    }
+                } else {
+
+                    // get usages
+                    auto usages_length = static_cast<ULONG>(button_count);
+                    std::vector<USAGE> usages(static_cast<size_t>(usages_length));
+                    if (HidP_GetUsages(
+                            HidP_Input,
+                            button_caps.UsagePage,
+                            button_caps.LinkCollection,
+                            usages.data(),
+                            &usages_length,
+                            reinterpret_cast<PHIDP_PREPARSED_DATA>(device.hidInfo->preparsed_data.get()),
+                            reinterpret_cast<PCHAR>(data_hid.bRawData),
+                            data_hid.dwSizeHid) != HIDP_STATUS_SUCCESS) {
+                        continue;
+                    }
+                    for (ULONG usage_num = 0; usage_num < usages_length; usage_num++) {
+                        USAGE usage = usages[usage_num] - button_caps.Range.UsageMin;
+
+                        // guard against some buggy device sending an event for a usage below `UsageMin`
+                        if (usage < button_count) {
+                            new_states[usage] = true;
+                        }
+                    }
+                }
+
+                // update buttons
+                for (int button_num = 0; button_num < button_count; button_num++) {
+                    if (new_states[button_num] != button_states[button_num] && device.journal) {
+                        device.journal->push(input_time, (uint16_t) (button_index + button_num), false,
+                                button_states[button_num] ? 1.f : 0.f,
+                                new_states[button_num] ? 1.f : 0.f);
+                    }
+                    if (!new_states[button_num] && button_states[button_num]) {
+                        device.updated = true;
+                        button_states[button_num] = new_states[button_num];
+                        button_down[button_num] = input_time;
+                    } else if (new_states[button_num] && !button_states[button_num]) {
+                        device.updated = true;
+                        button_states[button_num] = new_states[button_num];
+                        button_up[button_num] = input_time;
+                    }
+                }
+            }
+
+            // analogs
+            for (auto cap_num = 0; cap_num < device.hidInfo->caps.NumberInputValueCaps; cap_num++) {
+                auto &value_caps = device.hidInfo->value_caps_list[cap_num];
+
+                // get value
+                LONG value_raw = 0;
+                if (decoder) {
+                    uint32_t value_bits;
+                    if (!decoder->value(cap_num, data_hid.bRawData, data_hid.dwSizeHid, value_bits)) {
+                        continue;
+                    }
+                    value_raw = (LONG) value_bits;
+                } else if (HidP_GetUsageValue(
+                        HidP_Input,
+                        value_caps.UsagePage,
+                        value_caps.LinkCollection,
+                        value_caps.Range.UsageMin,
+                        reinterpret_cast<ULONG *>(&value_raw),
+                        reinterpret_cast<PHIDP_PREPARSED_DATA>(device.hidInfo->preparsed_data.get()),
+                        reinterpret_cast<CHAR *>(data_hid.bRawData),
+                        data_hid.dwSizeHid) != HIDP_STATUS_SUCCESS)
+                {
+                    continue;
+                }
+
+                // get min and max
+                LONG value_min = value_caps.LogicalMin;
+                LONG value_max = value_caps.LogicalMax;
+
+                // fix sign bits for signed values
+                if (value_caps.LogicalMin < 0 &&
+                        value_caps.BitSize > 0 &&
+                        value_caps.BitSize <= sizeof(value_caps.LogicalMin) * 8) {
+                    auto shift_size = sizeof(value_caps.LogicalMin) * 8 - value_caps.BitSize + 1;
+                    value_raw <<= shift_size;
+                    value_raw >>= shift_size;
+                }
+
+                float value;
+                // 0x1 == generic desktop, 0x39 == hat switch
+                if (value_caps.UsagePage == 0x1 && value_caps.Range.UsageMin == 0x39) {
+                    if (value_min <= value_raw && value_raw <= value_max) {
+                        // scale to float; minimum valid value is UP, and increases in clockwise order
+                        value = (float) (value_raw - value_min) / (float) (value_max - value_min);
+                    } else {
+                        // hat switches report an out-of-bounds value to indicate a neutral position, so it
+                        // needs special handling; here, we will use a negative value to indicate neutral
+                        value = -1.f;
+                    }
+                } else {
+                    // automatic calibration
+                    if (value_raw < value_min) {
+                        value_caps.LogicalMin = value_raw;
+                        value_min = value_raw;
+                    }
+                    if (value_raw > value_max) {
+                        value_caps.LogicalMax = value_raw;
+                        value_max = value_raw;
+                    }
+
+                    // scale to float
+                    value = (float) (value_raw - value_min) / (float) (value_max - value_min);
+                }
+
+                // store value
+                auto &cur_state = device.hidInfo->value_states[cap_num];
+                if (cur_state != value) {
+                    if (device.journal) {
+                        device.journal->push(input_time, (uint16_t) cap_num, true, cur_state, value);
+                    }
+                    device.updated = true;
+                    cur_state = value;
+                }
+
+                // store raw value
+                auto &cur_raw_state = device.hidInfo->value_states_raw[cap_num];
+                if (cur_raw_state != value_raw) {
+                    device.updated = true;
+                    cur_raw_state = value_raw;
+                }
+            }
+
+            // touch screen
+            rawinput::touch::update_input(&device);
+
+            break;
+        }
+        default:
+            break;
+    }
+
+    device.seqlock->write_end();
+}
+
+void rawinput::RawInputManager::input_buffer_process(HRAWINPUT message_input) {
+
+    // everything read below counts as arrived with this message
+    this->input_batch_time = get_performance_seconds();
+
+    auto arena = reinterpret_cast<uint8_t *>(this->input_arena.data());
+    auto arena_size = this->input_arena.size() * sizeof(uint64_t);
+    size_t arena_used = 0;
+
+    // input of the message which woke us up, this one has the native layout
+    auto data_size = static_cast<UINT>(arena_size);
+    if (GetRawInputData(message_input, RID_INPUT, arena, &data_size, sizeof(RAWINPUTHEADER)) != (UINT) -1
+            && data_size > 0) {
+        auto data = reinterpret_cast<RAWINPUT *>(arena);
+        this->input_batch_add(data->header.hDevice, &data->data);
+        arena_used = (data_size + 7u) & ~7u;
+    }
+
+    // drain everything else which is queued up
+    while (true) {
+        auto buffer = reinterpret_cast<RAWINPUT *>(arena + arena_used);
+        auto buffer_size = static_cast<UINT>(arena_size - arena_used);
+        auto count = GetRawInputBuffer(buffer, &buffer_size, sizeof(RAWINPUTHEADER));
+        if (count == (UINT) -1) {
+
+            // the next input doesn't fit behind the message input
+            if (arena_used > 0) {
+                this->input_batch_flush();
+                arena_used = 0;
+                continue;
+            }
+            break;
+        }
+        if (count == 0) {
+            break;
+        }
+
+        // collect events
+        for (UINT i = 0; i < count; i++) {
+            auto data = reinterpret_cast<RawInputData *>(
+                    reinterpret_cast<uint8_t *>(buffer) + this->input_buffer_header_size);
+            this->input_batch_add(buffer->header.hDevice, data);
+
+            // same as NEXTRAWINPUTBLOCK, but with the alignment matching the header layout
+            auto next = reinterpret_cast<uintptr_t>(buffer) + buffer->header.dwSize;
+            next = (next + this->input_buffer_align - 1) & ~(this->input_buffer_align - 1);
+            buffer = reinterpret_cast<RAWINPUT *>(next);
+        }
+
+        // apply and reuse the arena
+        this->input_batch_flush();
+        arena_used = 0;
+    }
+
+    // apply whatever is left
+    this->input_batch_flush();
+}
+
+void rawinput::RawInputManager::input_batch_add(HANDLE handle, RawInputData *data) {
+    auto device = this->devices_get_handle(handle);
+    if (device == nullptr) {
+        return;
+    }
+
+    // remember each device only once
+    if (std::find(this->input_batch_devices.begin(), this->input_batch_devices.end(), device)
+            == this->input_batch_devices.end()) {
+        this->input_batch_devices.push_back(device);
+    }
+
+    this->input_batch.push_back(InputEvent {
+        .device = device,
+        .data = data,
+    });
+}
+
+void rawinput::RawInputManager::input_batch_flush() {
+    if (this->input_batch.empty()) {
+        return;
+    }
+
+    // events of each device are applied in order while holding its lock once
+    double input_time = this->input_batch_time;
+    for (auto device : this->input_batch_devices) {
+        std::lock_guard<std::mutex> lock(*device->mutex);
+        for (auto &event : this->input_batch) {
+            if (event.device == device) {
+                input_process(*device, *event.data, input_time);
+            }
+        }
+    }
+
+    this->input_batch.clear();
+    this->input_batch_devices.clear();
+}
+
 LRESULT CALLBACK rawinput::RawInputManager::input_wnd_proc(
         HWND hWnd, UINT msg, WPARAM wparam, LPARAM lParam) {
 
@@ -1352,6 +2171,13 @@ LRESULT CALLBACK rawinput::RawInputManager::input_wnd_proc(
             // get reference
             auto ref = reinterpret_cast<RawInputManager *>(GetWindowLongPtrW(hWnd, GWLP_USERDATA));
 
+            // buffered mode processes everything queued up at once
+            if (rawinput::BUFFERED) {
+                ref->input_buffer_process((HRAWINPUT) lParam);
+                DefWindowProc(hWnd, msg, wparam, lParam);
+                return 0;
+            }
+
             // get raw input data
             UINT data_size = 0;
             if (GetRawInputData(
@@ -1377,342 +2203,15 @@ LRESULT CALLBACK rawinput::RawInputManager::input_wnd_proc(
 
             // find device
             HANDLE device_handle = data->header.hDevice;
-            for (auto &device : ref->devices_get()) {
-
-                // skip if this is the wrong device
-                if (device.handle != device_handle) {
-                    continue;
-                }
+            if (auto device = ref->devices_get_handle(device_handle)) {
 
                 // get input time
                 double input_time = get_performance_seconds();
 
-                // lock device
-                device.mutex->lock();
-
-                // update hz
-                double diff_time = input_time - device.input_time;
-                if (diff_time > 0.0001) {
-                    device.input_hz = 1.f / diff_time;
-                    device.input_hz_max = MAX(device.input_hz_max, device.input_hz);
-                    device.input_time = input_time;
-                }
-
-                // check type
-                switch (device.type) {
-                    case DESTROYED:
-                        log_warning("rawinput", "received input msg for destroyed device");
-                        break;
-                    case MOUSE: {
-
-                        // get mouse data
-                        auto data_mouse = data->data.mouse;
-
-                        // save position
-                        if (data_mouse.usFlags & MOUSE_MOVE_ABSOLUTE) {
-                            if (device.mouseInfo->pos_x != data_mouse.lLastX) {
-                                device.updated = true;
-                            }
-                            device.mouseInfo->pos_x = data_mouse.lLastX;
-                            if (device.mouseInfo->pos_y != data_mouse.lLastY) {
-                                device.updated = true;
-                            }
-                            device.mouseInfo->pos_y = data_mouse.lLastY;
-                        } else {
-                            if (data_mouse.lLastX != 0 || data_mouse.lLastY != 0) {
-                                device.updated = true;
-                            }
-                            device.mouseInfo->pos_x += data_mouse.lLastX;
-                            device.mouseInfo->pos_y += data_mouse.lLastY;
-                        }
-
-                        // check buttons
-                        if (data_mouse.usButtonFlags) {
-                            auto &key_states = device.mouseInfo->key_states;
-                            auto &key_up = device.mouseInfo->key_up;
-                            auto &key_down = device.mouseInfo->key_down;
-                            if (data_mouse.usButtonFlags & RI_MOUSE_LEFT_BUTTON_DOWN) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_LEFT] = true;
-                                key_down[MOUSEBTN_LEFT] = input_time;
-                            }
-                            if (data_mouse.usButtonFlags & RI_MOUSE_LEFT_BUTTON_UP) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_LEFT] = false;
-                                key_up[MOUSEBTN_LEFT] = input_time;
-                            }
-                            if (data_mouse.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_DOWN) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_RIGHT] = true;
-                                key_down[MOUSEBTN_RIGHT] = input_time;
-                            }
-                            if (data_mouse.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_UP) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_RIGHT] = false;
-                                key_up[MOUSEBTN_RIGHT] = input_time;
-                            }
-                            if (data_mouse.usButtonFlags & RI_MOUSE_MIDDLE_BUTTON_DOWN) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_MIDDLE] = true;
-                                key_down[MOUSEBTN_MIDDLE] = input_time;
-                            }
-                            if (data_mouse.usButtonFlags & RI_MOUSE_MIDDLE_BUTTON_UP) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_MIDDLE] = false;
-                                key_up[MOUSEBTN_MIDDLE] = input_time;
-                            }
-                            if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_1_DOWN) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_1] = true;
-                                key_down[MOUSEBTN_1] = input_time;
-                            }
-                            if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_1_UP) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_1] = false;
-                                key_up[MOUSEBTN_1] = input_time;
-                            }
-                            if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_2_DOWN) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_2] = true;
-                                key_down[MOUSEBTN_2] = input_time;
-                            }
-                            if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_2_UP) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_2] = false;
-                                key_up[MOUSEBTN_2] = input_time;
-                            }
-                            if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_3_DOWN) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_3] = true;
-                                key_down[MOUSEBTN_3] = input_time;
-                            }
-                            if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_3_UP) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_3] = false;
-                                key_up[MOUSEBTN_3] = input_time;
-                            }
-                            if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_4_DOWN) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_4] = true;
-                                key_down[MOUSEBTN_4] = input_time;
-                            }
-                            if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_4_UP) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_4] = false;
-                                key_up[MOUSEBTN_4] = input_time;
-                            }
-                            if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_5_DOWN) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_5] = true;
-                                key_down[MOUSEBTN_5] = input_time;
-                            }
-                            if (data_mouse.usButtonFlags & RI_MOUSE_BUTTON_5_UP) {
-                                device.updated = true;
-                                key_states[MOUSEBTN_5] = false;
-                                key_up[MOUSEBTN_5] = input_time;
-                            }
-                        }
-
-                        // check wheel
-                        if (data_mouse.usButtonFlags & RI_MOUSE_WHEEL) {
-                            if ((short) data_mouse.usButtonData != 0) {
-                                device.updated = true;
-                            }
-                            device.mouseInfo->pos_wheel += ((short) data_mouse.usButtonData) / WHEEL_DELTA;
-                        }
-
-                        break;
-                    }
-                    case KEYBOARD: {
-
-                        // get keyboard data
-                        auto &data_keyboard = data->data.keyboard;
-
-                        // set index based on flags
-                        int index = 0;
-                        if (data_keyboard.Flags & RI_KEY_E0) {
-                            index += 256;
-                        }
-                        if (data_keyboard.Flags & RI_KEY_E1) {
-                            index += 512;
-                        }
-
-                        // check the funny exceptions
-                        USHORT vkey = data_keyboard.VKey;
-                        switch (index + vkey) {
-                            case 17:
-                                vkey = VK_LCONTROL;
-                                break;
-                            case 273:
-                                vkey = VK_RCONTROL;
-                                break;
-                        }
-                        switch (data_keyboard.MakeCode) {
-                            case 42:
-                                vkey = VK_LSHIFT;
-                                break;
-                            case 54:
-                                vkey = VK_RSHIFT;
-                                break;
-                        }
-
-                        // update key state
-                        if (vkey < 255) {
-                            bool state = (data_keyboard.Flags & RI_KEY_BREAK) == 0;
-                            auto &cur_state = device.keyboardInfo->key_states[index + vkey];
-                            if (!cur_state && state) {
-                                cur_state = state;
-                                device.updated = true;
-                                device.keyboardInfo->key_down[index + vkey] = input_time;
-                            } else if (cur_state && !state) {
-                                cur_state = state;
-                                device.updated = true;
-                                device.keyboardInfo->key_up[index + vkey] = input_time;
-                            }
-                        }
-
-                        break;
-                    }
-                    case HID: {
-
-                        // get HID data
-                        auto &data_hid = data->data.hid;
-
-                        // buttons
-                        for (size_t cap_num = 0; cap_num < device.hidInfo->button_caps_list.size(); cap_num++) {
-                            auto &button_caps = device.hidInfo->button_caps_list[cap_num];
-                            auto &button_states = device.hidInfo->button_states[cap_num];
-                            auto &button_down = device.hidInfo->button_down[cap_num];
-                            auto &button_up = device.hidInfo->button_up[cap_num];
-
-                            // get button count
-                            int button_count = button_caps.Range.UsageMax - button_caps.Range.UsageMin + 1;
-                            if (button_count <= 0) {
-                                continue;
-                            }
-
-                            // get usages
-                            auto usages_length = static_cast<ULONG>(button_count);
-                            std::vector<USAGE> usages(static_cast<size_t>(usages_length));
-                            if (HidP_GetUsages(
-                                    HidP_Input,
-                                    button_caps.UsagePage,
-                                    button_caps.LinkCollection,
-                                    usages.data(),
-                                    &usages_length,
-                                    reinterpret_cast<PHIDP_PREPARSED_DATA>(device.hidInfo->preparsed_data.get()),
-                                    reinterpret_cast<PCHAR>(data_hid.bRawData),
-                                    data_hid.dwSizeHid) != HIDP_STATUS_SUCCESS) {
-                                continue;
-                            }
-
-                            // update buttons
-                            bool new_states[button_count] {};
-                            for (ULONG usage_num = 0; usage_num < usages_length; usage_num++) {
-                                USAGE usage = usages[usage_num] - button_caps.Range.UsageMin;
-
-                                // guard against some buggy device sending an event for a usage below `UsageMin`
-                                if (usage < button_count) {
-                                    new_states[usage] = true;
-                                }
-                            }
-                            for (int button_num = 0; button_num < button_count; button_num++) {
-                                if (!new_states[button_num] && button_states[button_num]) {
-                                    device.updated = true;
-                                    button_states[button_num] = new_states[button_num];
-                                    button_down[button_num] = input_time;
-                                } else if (new_states[button_num] && !button_states[button_num]) {
-                                    device.updated = true;
-                                    button_states[button_num] = new_states[button_num];
-                                    button_up[button_num] = input_time;
-                                }
-                            }
-                        }
-
-                        // analogs
-                        for (auto cap_num = 0; cap_num < device.hidInfo->caps.NumberInputValueCaps; cap_num++) {
-                            auto &value_caps = device.hidInfo->value_caps_list[cap_num];
-
-                            // get value
-                            LONG value_raw = 0;
-                            if (HidP_GetUsageValue(
-                                    HidP_Input,
-                                    value_caps.UsagePage,
-                                    value_caps.LinkCollection,
-                                    value_caps.Range.UsageMin,
-                                    reinterpret_cast<ULONG *>(&value_raw),
-                                    reinterpret_cast<PHIDP_PREPARSED_DATA>(device.hidInfo->preparsed_data.get()),
-                                    reinterpret_cast<CHAR *>(data_hid.bRawData),
-                                    data_hid.dwSizeHid) != HIDP_STATUS_SUCCESS)
-                            {
-                                continue;
-                            }
-
-                            // get min and max
-                            LONG value_min = value_caps.LogicalMin;
-                            LONG value_max = value_caps.LogicalMax;
-
-                            // fix sign bits for signed values
-                            if (value_caps.LogicalMin < 0 &&
-                                    value_caps.BitSize > 0 &&
-                                    value_caps.BitSize <= sizeof(value_caps.LogicalMin) * 8) {
-                                auto shift_size = sizeof(value_caps.LogicalMin) * 8 - value_caps.BitSize + 1;
-                                value_raw <<= shift_size;
-                                value_raw >>= shift_size;
-                            }
-
-                            float value;
-                            // 0x1 == generic desktop, 0x39 == hat switch
-                            if (value_caps.UsagePage == 0x1 && value_caps.Range.UsageMin == 0x39) {
-                                if (value_min <= value_raw && value_raw <= value_max) {
-                                    // scale to float; minimum valid value is UP, and increases in clockwise order
-                                    value = (float) (value_raw - value_min) / (float) (value_max - value_min);
-                                } else {
-                                    // hat switches report an out-of-bounds value to indicate a neutral position, so it
-                                    // needs special handling; here, we will use a negative value to indicate neutral
-                                    value = -1.f;
-                                }
-                            } else {
-                                // automatic calibration
-                                if (value_raw < value_min) {
-                                    value_caps.LogicalMin = value_raw;
-                                    value_min = value_raw;
-                                }
-                                if (value_raw > value_max) {
-                                    value_caps.LogicalMax = value_raw;
-                                    value_max = value_raw;
-                                }
-
-                                // scale to float
-                                value = (float) (value_raw - value_min) / (float) (value_max - value_min);
-                            }
-
-                            // store value
-                            auto &cur_state = device.hidInfo->value_states[cap_num];
-                            if (cur_state != value) {
-                                device.updated = true;
-                                cur_state = value;
-                            }
-
-                            // store raw value
-                            auto &cur_raw_state = device.hidInfo->value_states_raw[cap_num];
-                            if (cur_raw_state != value_raw) {
-                                device.updated = true;
-                                cur_raw_state = value_raw;
-                            }
-                        }
-
-                        // touch screen
-                        rawinput::touch::update_input(&device);
-
-                        break;
-                    }
-                    default:
-                        break;
-                }
-
-                // free device
-                device.mutex->unlock();
+                // process input
+                device->mutex->lock();
+                input_process(*device, data->data, input_time);
+                device->mutex->unlock();
             }
 
             // call the default window handler for cleanup
@@ -2109,7 +2608,52 @@ void CALLBACK rawinput::RawInputManager::input_midi_proc(HMIDIIN hMidiIn, UINT w
     }
 }
 
-void rawinput::RawInputManager::device_write_output(Device *device, bool only_updated) {
+/*
+ * Returns the output report at the index with all bytes cleared.
+ * Buffers are kept with the device, so building reports only allocates the first time.
+ */
+static rawinput::HIDOutputReport &hid_output_report(rawinput::DeviceHIDInfo *hid, size_t index, size_t size) {
+    if (index >= hid->output_reports.size()) {
+        hid->output_reports.resize(index + 1);
+    }
+    auto &report = hid->output_reports[index];
+    report.data.assign(size, 0);
+    report.control = false;
+    return report;
+}
+
+/*
+ * Writes the report unless it equals the one written last.
+ * Returns true if the device was written to.
+ */
+static bool hid_output_send(rawinput::DeviceHIDInfo *hid, rawinput::HIDOutputReport &report, bool refresh) {
+    if (!refresh && report.data == report.sent) {
+        return false;
+    }
+
+    // write report
+    bool success;
+    if (report.control) {
+        success = HidD_SetOutputReport(hid->handle, report.data.data(), (ULONG) report.data.size());
+    } else {
+        DWORD written_bytes = 0;
+        success = WriteFile(
+                hid->handle,
+                reinterpret_cast<void *>(report.data.data()),
+                (DWORD) report.data.size(),
+                &written_bytes,
+                nullptr
+        );
+    }
+
+    // failed reports are sent again on the next write
+    if (success) {
+        report.sent = report.data;
+    }
+    return true;
+}
+
+void rawinput::RawInputManager::device_write_output(Device *device, bool only_updated, bool refresh) {
 
     // check if output is enabled
     if (!device->output_enabled) {
@@ -2126,6 +2670,7 @@ void rawinput::RawInputManager::device_write_output(Device *device, bool only_up
 
     // mark device as updated
     device->output_pending = false;
+    bool written = false;
 
     // check device type
     switch (device->type) {
@@ -2142,20 +2687,27 @@ void rawinput::RawInputManager::device_write_output(Device *device, bool only_up
             // check driver
             switch (hid->driver) {
                 case HIDDriver::Default: {
-
-                    // allocate report
-                    CHAR *report_data = new CHAR[hid->caps.OutputReportByteLength] {};
+                    auto preparsed_data = reinterpret_cast<PHIDP_PREPARSED_DATA>(hid->preparsed_data.get());
+                    auto report_size = hid->caps.OutputReportByteLength;
+
+                    // caps belonging to another report ID continue in the next report
+                    size_t report_count = 1;
+                    auto report = &hid_output_report(hid, 0, report_size);
+                    auto report_next = [&] (bool control) {
+                        report->control = control;
+                        report = &hid_output_report(hid, report_count++, report_size);
+                    };
 
                     // set buttons
+                    auto &usage_list = hid->output_usages_on;
+                    auto &usage_off_list = hid->output_usages_off;
                     for (size_t cap_no = 0; cap_no < hid->button_output_caps_list.size(); cap_no++) {
                         auto &button_cap = hid->button_output_caps_list[cap_no];
                         auto &button_state_list = hid->button_output_states[cap_no];
 
                         // determine which buttons to turn on
-                        std::vector<USAGE> usage_list;
-                        std::vector<USAGE> usage_off_list;
-                        usage_list.reserve(button_state_list.size());
-                        usage_off_list.reserve(button_state_list.size());
+                        usage_list.clear();
+                        usage_off_list.clear();
                         for (size_t state_no = 0; state_no < button_state_list.size(); state_no++) {
                             if (button_state_list[state_no]) {
                                 usage_list.push_back(button_cap.Range.UsageMin + (USAGE) state_no);
@@ -2170,15 +2722,12 @@ void rawinput::RawInputManager::device_write_output(Device *device, bool only_up
                                        HidP_Output,
                                        button_cap.UsagePage,
                                        button_cap.LinkCollection,
-                                       &usage_list[0],
+                                       usage_list.data(),
                                        &usage_list_length,
-                                       reinterpret_cast<PHIDP_PREPARSED_DATA>(hid->preparsed_data.get()),
-                                       report_data,
-                                       hid->caps.OutputReportByteLength) == HIDP_STATUS_INCOMPATIBLE_REPORT_ID) {
-
-                            // flush report
-                            HidD_SetOutputReport(hid->handle, report_data, hid->caps.OutputReportByteLength);
-                            memset(report_data, 0, hid->caps.OutputReportByteLength);
+                                       preparsed_data,
+                                       report->data.data(),
+                                       report_size) == HIDP_STATUS_INCOMPATIBLE_REPORT_ID) {
+                            report_next(true);
                         }
 
                         // clear the buttons
@@ -2187,22 +2736,12 @@ void rawinput::RawInputManager::device_write_output(Device *device, bool only_up
                                        HidP_Output,
                                        button_cap.UsagePage,
                                        button_cap.LinkCollection,
-                                       &usage_off_list[0],
+                                       usage_off_list.data(),
                                        &usage_off_list_length,
-                                       reinterpret_cast<PHIDP_PREPARSED_DATA>(hid->preparsed_data.get()),
-                                       report_data,
-                                       hid->caps.OutputReportByteLength) == HIDP_STATUS_INCOMPATIBLE_REPORT_ID) {
-
-                            // flush report
-                            DWORD written_bytes = 0;
-                            WriteFile(
-                                    hid->handle,
-                                    reinterpret_cast<void *>(report_data),
-                                    hid->caps.OutputReportByteLength,
-                                    &written_bytes,
-                                    nullptr
-                            );
-                            memset(report_data, 0, hid->caps.OutputReportByteLength);
+                                       preparsed_data,
+                                       report->data.data(),
+                                       report_size) == HIDP_STATUS_INCOMPATIBLE_REPORT_ID) {
+                            report_next(false);
                         }
                     }
 
@@ -2227,26 +2766,16 @@ void rawinput::RawInputManager::device_write_output(Device *device, bool only_up
                                 value_cap.LinkCollection,
                                 value_cap.NotRange.Usage,
                                 static_cast<ULONG>(usage_value),
-                                reinterpret_cast<PHIDP_PREPARSED_DATA>(hid->preparsed_data.get()),
-                                report_data,
-                                hid->caps.OutputReportByteLength) == HIDP_STATUS_INCOMPATIBLE_REPORT_ID) {
-
-                            // flush report
-                            DWORD written_bytes = 0;
-                            WriteFile(
-                                    hid->handle,
-                                    reinterpret_cast<void *>(report_data),
-                                    hid->caps.OutputReportByteLength,
-                                    &written_bytes,
-                                    nullptr
-                            );
-                            memset(report_data, 0, hid->caps.OutputReportByteLength);
+                                preparsed_data,
+                                report->data.data(),
+                                report_size) == HIDP_STATUS_INCOMPATIBLE_REPORT_ID) {
+                            report_next(false);
                         }
                     }
 
                     // MiniMaid Madness
                     if (hid->attributes.VendorID == 0xBEEF && hid->attributes.ProductID == 0x5730) {
-                        if (hid->caps.OutputReportByteLength >= 8) {
+                        if (report_size >= 8) {
                             /*
                              * MiniMaid HID Index Positions:
                              * 0: HID Report ID
@@ -2259,6 +2788,7 @@ void rawinput::RawInputManager::device_write_output(Device *device, bool only_up
                              * 7: Keyboard Enable
                              * 8: Unused 'hax' variable
                              */
+                            auto report_data = report->data.data();
 
                             // put pads in proper mode
                             // bit 4 high is pad enable.
@@ -2270,25 +2800,18 @@ void rawinput::RawInputManager::device_write_output(Device *device, bool only_up
                         }
                     }
 
-                    // write final report
-                    DWORD written_bytes = 0;
-                    WriteFile(
-                            hid->handle,
-                            reinterpret_cast<void *>(report_data),
-                            hid->caps.OutputReportByteLength,
-                            &written_bytes,
-                            nullptr
-                    );
-
-                    // delete report
-                    delete[] report_data;
+                    // write changed reports in order
+                    for (size_t report_no = 0; report_no < report_count; report_no++) {
+                        written |= hid_output_send(hid, hid->output_reports[report_no], refresh);
+                    }
 
                     break;
                 }
                 case HIDDriver::PacDrive: {
 
-                    // allocate report
-                    uint8_t report_data[5] {};
+                    // get report
+                    auto &report = hid_output_report(hid, 0, 5);
+                    auto report_data = reinterpret_cast<uint8_t *>(report.data.data());
 
                     // set leds
                     static const size_t mapping[] = {
@@ -2307,14 +2830,7 @@ void rawinput::RawInputManager::device_write_output(Device *device, bool only_up
                     }
 
                     // write report
-                    DWORD written_bytes = 0;
-                    WriteFile(
-                            hid->handle,
-                            static_cast<void *>(&report_data),
-                            sizeof(report_data),
-                            &written_bytes,
-                            nullptr
-                    );
+                    written = hid_output_send(hid, report, refresh);
 
                     break;
                 }
@@ -2325,12 +2841,21 @@ void rawinput::RawInputManager::device_write_output(Device *device, bool only_up
         }
         case SEXTET_OUTPUT: {
             device->sextetInfo->push_light_state();
+            written = true;
             break;
         }
         default:
             break;
     }
 
+    // remember time for the rate limit and refresh
+    if (written || refresh) {
+        device->output_time = get_performance_seconds();
+    }
+    if (refresh) {
+        device->output_refresh_time = device->output_time;
+    }
+
     // unlock device
     device->mutex_out->unlock();
 }
@@ -2523,53 +3048,58 @@ rawinput::Device *rawinput::RawInputManager::devices_get(const std::string &name
         return nullptr;
     }
 
-    // check if caller wants only updated devices
-    if (updated) {
-
-        // iterate the devices
-        for (auto &device : this->devices) {
-
-            // check if the device names match
-            if (device.name == name) {
-
-                // lock the device since we are messing with updated
-                device.mutex->lock();
-
-                // was the device updated?
-                if (device.updated) {
+    // look up position
+    auto index = std::atomic_load_explicit(&this->devices_index, std::memory_order_acquire);
+    if (index == nullptr) {
+        return nullptr;
+    }
+    auto position = index->names.find(name);
+    if (position == index->names.end() || position->second >= this->devices.size()) {
+        return nullptr;
+    }
 
-                    // next call shouldn't trigger
-                    device.updated = false;
+    // the index might be one change behind
+    auto &device = this->devices[position->second];
+    if (device.name != name) {
+        return nullptr;
+    }
 
-                    // unlock the device
-                    device.mutex->unlock();
+    // check if caller wants only updated devices
+    if (updated) {
 
-                    // return the device
-                    return &device;
+        // lock the device since we are messing with updated
+        std::lock_guard<std::mutex> lock(*device.mutex);
 
-                } else {
+        // was the device updated?
+        if (!device.updated) {
+            return nullptr;
+        }
 
-                    // unlock the device again
-                    device.mutex->unlock();
+        // next call shouldn't trigger
+        device.updated = false;
+    }
 
-                    // return null since the device wasn't updated
-                    return nullptr;
-                }
-            }
-        }
+    return &device;
+}
 
-    } else {
+rawinput::Device *rawinput::RawInputManager::devices_get_handle(HANDLE handle) {
 
-        // just the usual "lookup by name"
-        for (auto &device : this->devices) {
-            if (device.name == name) {
-                return &device;
-            }
-        }
+    // look up position
+    auto index = std::atomic_load_explicit(&this->devices_index, std::memory_order_acquire);
+    if (index == nullptr) {
+        return nullptr;
+    }
+    auto position = index->handles.find(handle);
+    if (position == index->handles.end() || position->second >= this->devices.size()) {
+        return nullptr;
     }
 
-    // device not found
-    return nullptr;
+    // the index might be one change behind
+    auto &device = this->devices[position->second];
+    if (device.handle != handle) {
+        return nullptr;
+    }
+    return &device;
 }
 
 void rawinput::RawInputManager::add_callback_add(void *data, std::function<void (void *, Device *)> callback) {
@@ -2618,3 +3148,152 @@ void rawinput::RawInputManager::remove_callback_midi(void * data, const std::fun
                 return cb.data == data && cb.f.target<void>() == callback.target<void>();
             }), this->callback_midi.end());
 }
+
+void rawinput::RawInputManager::benchmark() {
+    const size_t device_count = 32;
+    const size_t events = 1000000;
+    const size_t name_lookups = 100000;
+
+    // fake HID devices, the names share a long prefix just like the real ones
+    std::vector<Device> devices(device_count);
+    for (size_t i = 0; i < device_count; i++) {
+        auto &device = devices[i];
+        device.id = i;
+        device.type = HID;
+        device.handle = reinterpret_cast<HANDLE>(0x10000 + i * 0x40);
+        device.name = fmt::format("\\\\?\\HID#VID_1CCF&PID_{:04X}&MI_00#7&1a2b3c4d&0&0000"
+                "#{{4d1e55b2-f16f-11cf-88cb-001111000030}}", i);
+    }
+    auto index = devices_index_build(devices);
+
+    // input storm spread randomly over all devices
+    std::vector<HANDLE> storm(events);
+    uint32_t seed = 0x1234567;
+    for (auto &handle : storm) {
+        seed = seed * 1664525u + 1013904223u;
+        handle = devices[(seed >> 8) % device_count].handle;
+    }
+
+    // handle lookups like input_wnd_proc did before
+    size_t found_linear = 0;
+    auto time_start = get_performance_milliseconds();
+    for (auto handle : storm) {
+        for (auto &device : devices) {
+            if (device.handle == handle) {
+                found_linear += device.id;
+            }
+        }
+    }
+    auto time_linear = get_performance_milliseconds() - time_start;
+
+    // handle lookups using the index
+    size_t found_index = 0;
+    time_start = get_performance_milliseconds();
+    for (auto handle : storm) {
+        auto position = index->handles.find(handle);
+        if (position != index->handles.end()) {
+            found_index += devices[position->second].id;
+        }
+    }
+    auto time_index = get_performance_milliseconds() - time_start;
+
+    log_info("rawinput", "WM_INPUT storm, {} devices, {} events: linear {:.3f} ms, indexed {:.3f} ms",
+            device_count, events, time_linear, time_index);
+    if (found_linear != found_index) {
+        log_warning("rawinput", "indexed handle lookups do not match linear search");
+    }
+
+    // name lookups like devices_get did before
+    found_linear = 0;
+    time_start = get_performance_milliseconds();
+    for (size_t i = 0; i < name_lookups; i++) {
+        auto &name = devices[(i * 7) % device_count].name;
+        for (auto &device : devices) {
+            if (device.name == name) {
+                found_linear += device.id;
+                break;
+            }
+        }
+    }
+    time_linear = get_performance_milliseconds() - time_start;
+
+    // name lookups using the index
+    found_index = 0;
+    time_start = get_performance_milliseconds();
+    for (size_t i = 0; i < name_lookups; i++) {
+        auto position = index->names.find(devices[(i * 7) % device_count].name);
+        if (position != index->names.end()) {
+            found_index += devices[position->second].id;
+        }
+    }
+    time_index = get_performance_milliseconds() - time_start;
+
+    log_info("rawinput", "name lookups, {} devices, {} lookups: linear {:.3f} ms, indexed {:.3f} ms",
+            device_count, name_lookups, time_linear, time_index);
+    if (found_linear != found_index) {
+        log_warning("rawinput", "indexed name lookups do not match linear search");
+    }
+}
+
+void rawinput::RawInputManager::benchmark_contention() {
+    const size_t polls = 200000;
+    const size_t keys = 16;
+
+    // fake keyboard, fed by a thread pressing and releasing keys as fast as it can
+    std::mutex mutex;
+    DeviceSeqLock seqlock;
+    DeviceKeyboardInfo keyboard {};
+    Device device {};
+    device.type = KEYBOARD;
+    device.mutex = &mutex;
+    device.seqlock = &seqlock;
+    device.keyboardInfo = &keyboard;
+
+    for (bool lock_free : { false, true }) {
+
+        // input thread
+        std::atomic<bool> running {true};
+        size_t writes = 0;
+        std::thread writer([&] () {
+            RawInputData data {};
+            while (running.load(std::memory_order_relaxed)) {
+                data.keyboard.VKey = (USHORT) ('A' + writes % keys);
+                data.keyboard.Flags = (writes / keys) % 2 ? RI_KEY_BREAK : RI_KEY_MAKE;
+                std::lock_guard<std::mutex> lock(mutex);
+                input_process(device, data, get_performance_seconds());
+                writes++;
+            }
+        });
+
+        // game thread polling all keys
+        std::vector<double> latencies(polls);
+        size_t pressed = 0;
+        for (auto &latency : latencies) {
+            auto time_start = get_performance_seconds();
+            auto read_keys = [&] () {
+                pressed = 0;
+                for (size_t key = 0; key < keys; key++) {
+                    pressed += keyboard.key_states['A' + key] ? 1 : 0;
+                }
+            };
+            if (lock_free) {
+                seqlock.read(read_keys);
+            } else {
+                std::lock_guard<std::mutex> lock(mutex);
+                read_keys();
+            }
+            latency = (get_performance_seconds() - time_start) * 1000000.0;
+        }
+        running.store(false, std::memory_order_relaxed);
+        writer.join();
+
+        // latency distribution in microseconds
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&latencies] (double p) {
+            return latencies[std::min(latencies.size() - 1, (size_t) (latencies.size() * p))];
+        };
+        log_info("rawinput", "{} polls, {} writes: p50 {:.2f} us, p99 {:.2f} us, p99.9 {:.2f} us, max {:.2f} us",
+                lock_free ? "seqlock" : "mutex", polls, writes,
+                percentile(0.5), percentile(0.99), percentile(0.999), latencies.back());
+    }
+}
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <string>
 #include <thread>
 #include <condition_variable>
+#include <unordered_map>
 #include <vector>
 
 #include <windows.h>
@@ -15,6 +19,10 @@ namespace rawinput {
 
     // settings
     extern bool NOLEGACY;
+    extern bool BUFFERED;
+    extern int OUTPUT_RATE;
+    extern bool OUTPUT_REFRESH_ALL;
+    extern std::string HID_CAPTURE_PATH;
 
     struct DeviceCallback {
         void *data;
@@ -33,17 +41,75 @@ namespace rawinput {
         HWND input_hwnd = nullptr;
         WNDCLASSEX input_hwnd_class {};
         std::thread *input_thread = nullptr;
-        std::thread *flush_thread = nullptr;
-        bool flush_thread_running = false;
         std::thread *output_thread = nullptr;
         std::mutex output_thread_m;
         bool output_thread_ready = false;
         bool output_thread_running = false;
         std::condition_variable output_thread_cv;
+
+        /*
+         * Output of devices flagged with output_refresh is rewritten every ~500ms even without changes
+         * so DAO IIDX boards don't go back to button based lighting. Other devices are only written on
+         * changes unless OUTPUT_REFRESH_ALL is set.
+         */
+        static constexpr double OUTPUT_REFRESH = 0.495;
+
+        // distinct input reports recorded per device before a capture is written
+        static constexpr size_t HID_CAPTURE_REPORTS = 200;
+
         std::vector<DeviceCallback> callback_add;
         std::vector<DeviceCallback> callback_change;
         std::vector<MidiCallback> callback_midi;
 
+        // bumped whenever device pointers or names may have changed, shared by all managers
+        static std::atomic<uint32_t> devices_generation;
+
+        /*
+         * Positions in the device list by handle and name.
+         * A new index is published on every change, lookups running concurrently hold a reference
+         * to the one they started with, so old indices are freed as soon as nobody uses them anymore.
+         * Only access through std::atomic_load/std::atomic_store.
+         */
+        struct DeviceIndex {
+            std::unordered_map<HANDLE, size_t> handles;
+            std::unordered_map<std::string, size_t> names;
+        };
+        std::shared_ptr<const DeviceIndex> devices_index;
+        std::mutex devices_index_m;
+
+        static std::unique_ptr<DeviceIndex> devices_index_build(const std::vector<Device> &devices);
+
+        // input state of destroyed devices, lock free readers might still hold a pointer to it
+        struct DeviceRetired {
+            DeviceMouseInfo *mouseInfo;
+            DeviceKeyboardInfo *keyboardInfo;
+            DeviceHIDInfo *hidInfo;
+        };
+        std::vector<DeviceRetired> devices_retired;
+
+        /*
+         * Buffered input
+         * All queued raw input is read into the arena with a single call and then applied device by device,
+         * so every device is locked once per batch instead of once per event.
+         */
+        using RawInputData = decltype(RAWINPUT::data);
+        struct InputEvent {
+            Device *device;
+            RawInputData *data;
+        };
+        static constexpr size_t INPUT_ARENA_SIZE = 64 * 1024;
+        std::vector<uint64_t> input_arena;
+        std::vector<InputEvent> input_batch;
+        std::vector<Device *> input_batch_devices;
+        double input_batch_time = 0.0;
+        size_t input_buffer_header_size = sizeof(RAWINPUTHEADER);
+        size_t input_buffer_align = sizeof(ULONG_PTR);
+
+        void input_buffer_process(HRAWINPUT message_input);
+        void input_batch_add(HANDLE handle, RawInputData *data);
+        void input_batch_flush();
+        static void input_process(Device &device, RawInputData &data, double input_time);
+
         void input_hwnd_create();
         void input_hwnd_destroy();
         void devices_reload();
@@ -51,8 +117,7 @@ namespace rawinput {
         void devices_scan_piuio();
         void devices_destruct();
         void devices_destruct(Device *device, bool log = true);
-        void flush_start();
-        void flush_stop();
+        void devices_changed();
         void output_start();
         void output_stop();
 
@@ -62,6 +127,12 @@ namespace rawinput {
         static LRESULT CALLBACK input_wnd_proc(HWND, UINT, WPARAM, LPARAM);
         static void CALLBACK input_midi_proc(HMIDIIN, UINT, DWORD_PTR, DWORD_PTR, DWORD_PTR);
         static DeviceInfo get_device_info(const std::string &device_name);
+        static std::unique_ptr<HIDReportDecoder> hid_decoder_compile(DeviceHIDInfo *info);
+        static void hid_capture_start(DeviceHIDInfo *info, size_t report_size,
+                const std::vector<HIDReportDecoder::ButtonProbe> &button_probes,
+                const std::vector<HIDReportDecoder::ValueProbe> &value_probes,
+                bool fallback);
+        static void hid_capture_report(DeviceHIDInfo *info, const RAWHID &data);
 
     public:
 
@@ -82,11 +153,17 @@ namespace rawinput {
         void devices_register();
         void devices_unregister();
 
-        static void device_write_output(Device *device, bool only_updated = true);
+        static void device_write_output(Device *device, bool only_updated = true, bool refresh = false);
         void devices_flush_output(bool optimized = true);
 
         void __stdcall devices_print();
         Device *devices_get(const std::string &name, bool updated = false);
+        Device *devices_get_handle(HANDLE handle);
+
+        // lookups by name stay valid as long as this didn't change
+        static inline uint32_t devices_get_generation() {
+            return devices_generation.load(std::memory_order_acquire);
+        }
 
         inline std::vector<Device> &devices_get() {
             return devices;
@@ -128,5 +205,11 @@ namespace rawinput {
                 uint8_t, uint8_t, uint8_t, uint8_t)> callback);
         void remove_callback_midi(void *data, const std::function<void(void *, Device *,
                 uint8_t, uint8_t, uint8_t, uint8_t)>& callback);
+
+        // times device lookups for a simulated WM_INPUT storm and logs the results
+        static void benchmark();
+
+        // polls a keyboard while another thread feeds it input, with and without the device lock
+        static void benchmark_contention();
     };
 }
@@ -0,0 +1,201 @@
+/*
+ * Checks HIDReportDecoder against captured devices.
+ *
+ * Every file in the data directory describes one device: the report size, the bits hid.dll changed
+ * while probing its caps and a list of raw reports with what HidP_GetUsages/HidP_GetUsageValue
+ * returned for every cap. A null result means the report belongs to another report ID. Devices marked
+ * as fallback have to be rejected by the decoder so they keep using hid.dll.
+ *
+ * Real devices are recorded in this format by running spice with -hidcapture <folder>, every device
+ * gets its own file once enough distinct reports were seen.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "external/rapidjson/document.h"
+#include "rawinput/hid_decoder.h"
+
+using namespace rawinput;
+
+namespace {
+
+    size_t failures = 0;
+
+    template<typename... Args>
+    void fail(const std::string &device, const char *format, Args... args) {
+        std::printf("FAIL %s: ", device.c_str());
+        std::printf(format, args...);
+        std::printf("\n");
+        failures++;
+    }
+
+    std::vector<uint8_t> hex_decode(const std::string &hex) {
+        std::vector<uint8_t> data;
+        for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+            data.push_back((uint8_t) std::stoul(hex.substr(i, 2), nullptr, 16));
+        }
+        return data;
+    }
+
+    void test_device(const std::filesystem::path &path) {
+        auto device = path.filename().string();
+        auto failures_before = failures;
+
+        // read file
+        std::ifstream file(path);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        rapidjson::Document doc;
+        doc.Parse(contents.str().c_str());
+        if (doc.HasParseError() || !doc.IsObject()) {
+            fail(device, "invalid document");
+            return;
+        }
+
+        // probes
+        std::vector<HIDReportDecoder::ButtonProbe> button_probes;
+        for (auto &cap : doc["button_caps"].GetArray()) {
+            auto &probe = button_probes.emplace_back();
+            probe.report_id = (uint8_t) cap["report_id"].GetUint();
+            probe.array = cap["array"].GetBool();
+            for (auto &bits : cap["usage_bits"].GetArray()) {
+                auto &usage_bits = probe.usage_bits.emplace_back();
+                for (auto &bit : bits.GetArray()) {
+                    usage_bits.push_back(bit.GetUint());
+                }
+            }
+        }
+        std::vector<HIDReportDecoder::ValueProbe> value_probes;
+        for (auto &cap : doc["value_caps"].GetArray()) {
+            auto &probe = value_probes.emplace_back();
+            probe.report_id = (uint8_t) cap["report_id"].GetUint();
+            probe.bit_size = (uint16_t) cap["bit_size"].GetUint();
+            for (auto &bit : cap["bits"].GetArray()) {
+                probe.bits.push_back(bit.GetUint());
+            }
+        }
+
+        // compile layout
+        auto report_size = doc["report_size"].GetUint();
+        auto decoder = HIDReportDecoder::compile(report_size, button_probes, value_probes);
+        if (doc["fallback"].GetBool()) {
+            if (decoder) {
+                fail(device, "compiled a layout for a device which needs hid.dll");
+            } else {
+                std::printf("ok %s: falls back to hid.dll\n", device.c_str());
+            }
+            return;
+        }
+        if (!decoder) {
+            fail(device, "no layout");
+            return;
+        }
+
+        // compare every report
+        size_t report_no = 0;
+        for (auto &report : doc["reports"].GetArray()) {
+            auto data = hex_decode(report["data"].GetString());
+
+            // buttons
+            auto &buttons = report["buttons"];
+            for (size_t cap = 0; cap < button_probes.size(); cap++) {
+                auto count = button_probes[cap].usage_bits.size();
+                std::unique_ptr<bool[]> states(new bool[count] {});
+                bool found = decoder->buttons(cap, data.data(), data.size(), states.get());
+                auto &expected = buttons[(rapidjson::SizeType) cap];
+                if (expected.IsNull()) {
+                    if (found) {
+                        fail(device, "report %zu: button cap %zu decoded from another report ID", report_no, cap);
+                    }
+                    continue;
+                }
+                if (!found) {
+                    fail(device, "report %zu: button cap %zu not decoded", report_no, cap);
+                    continue;
+                }
+                std::vector<bool> expected_states(count);
+                for (auto &usage : expected.GetArray()) {
+                    expected_states[usage.GetUint()] = true;
+                }
+                for (size_t usage = 0; usage < count; usage++) {
+                    if (states[usage] != expected_states[usage]) {
+                        fail(device, "report %zu: button cap %zu usage %zu is %d, expected %d",
+                                report_no, cap, usage, (int) states[usage], (int) expected_states[usage]);
+                    }
+                }
+            }
+
+            // values
+            auto &values = report["values"];
+            for (size_t cap = 0; cap < value_probes.size(); cap++) {
+                uint32_t value = 0;
+                bool found = decoder->value(cap, data.data(), data.size(), value);
+                auto &expected = values[(rapidjson::SizeType) cap];
+                if (expected.IsNull()) {
+                    if (found) {
+                        fail(device, "report %zu: value cap %zu decoded from another report ID", report_no, cap);
+                    }
+                    continue;
+                }
+                if (!found) {
+                    fail(device, "report %zu: value cap %zu not decoded", report_no, cap);
+                } else if (value != expected.GetUint()) {
+                    fail(device, "report %zu: value cap %zu is %u, expected %u",
+                            report_no, cap, value, expected.GetUint());
+                }
+            }
+
+            report_no++;
+        }
+
+        // reports shorter than the layout are never decoded
+        if (report_size > 0) {
+            std::vector<uint8_t> short_report(report_size - 1);
+            uint32_t value = 0;
+            for (size_t cap = 0; cap < button_probes.size(); cap++) {
+                std::unique_ptr<bool[]> states(new bool[button_probes[cap].usage_bits.size()] {});
+                if (decoder->buttons(cap, short_report.data(), short_report.size(), states.get())) {
+                    fail(device, "button cap %zu decoded from a short report", cap);
+                }
+            }
+            for (size_t cap = 0; cap < value_probes.size(); cap++) {
+                if (decoder->value(cap, short_report.data(), short_report.size(), value)) {
+                    fail(device, "value cap %zu decoded from a short report", cap);
+                }
+            }
+        }
+
+        if (failures == failures_before) {
+            std::printf("ok %s: %zu reports\n", device.c_str(), report_no);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::filesystem::path data_path = argc > 1 ? argv[1] : HID_DECODER_TEST_DATA;
+
+    // run all devices in a stable order
+    std::vector<std::filesystem::path> paths;
+    for (auto &entry : std::filesystem::directory_iterator(data_path)) {
+        if (entry.path().extension() == ".json") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    if (paths.empty()) {
+        std::printf("no devices found in %s\n", data_path.string().c_str());
+        return 1;
+    }
+    for (auto &path : paths) {
+        test_device(path);
+    }
+
+    return failures > 0 ? 1 : 0;
+}
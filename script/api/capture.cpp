@@ -24,9 +24,8 @@ namespace script::api::capture {
         int width = 0;
         int height = 0;
         graphics_capture_trigger(screen);
-        bool success = graphics_capture_receive_jpeg(screen, [] (uint8_t byte) {
-            CAPTURE_BUFFER.push_back(byte);
-        }, true, quality, true, divide, &timestamp, &width, &height);
+        bool success = graphics_capture_receive_jpeg(screen, CAPTURE_BUFFER,
+                quality, true, divide, &timestamp, &width, &height);
         if (!success) {
             return std::string();
         }
@@ -36,9 +35,6 @@ namespace script::api::capture {
                 CAPTURE_BUFFER.data(),
                 CAPTURE_BUFFER.size());
 
-        // clear buffer
-        CAPTURE_BUFFER.clear();
-
         // return base64
         return encoded;
     }
@@ -1,5 +1,6 @@
 #include "cpuutils.h"
 
+#include <cstring>
 #include <thread>
 
 #define WIN32_NO_STATUS
@@ -9,6 +10,12 @@
 #include <winternl.h>
 #include <ntstatus.h>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
 #include "util/libutils.h"
 #include "util/logging.h"
 #include "util/utils.h"
@@ -131,4 +138,69 @@ namespace cpuutils {
         // return data
         return cpu_load_values;
     }
+
+    struct CPUFeatures {
+        bool ssse3 = false;
+        bool avx2 = false;
+    };
+
+    static CPUFeatures detect_features() {
+        CPUFeatures features {};
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+
+        // query leaves
+        unsigned int leaf1[4] {};
+        unsigned int leaf7[4] {};
+#ifdef _MSC_VER
+        int regs[4];
+        __cpuid(regs, 0);
+        auto leaf_max = (unsigned int) regs[0];
+        __cpuid(regs, 1);
+        memcpy(leaf1, regs, sizeof(leaf1));
+        if (leaf_max >= 7) {
+            __cpuidex(regs, 7, 0);
+            memcpy(leaf7, regs, sizeof(leaf7));
+        }
+#else
+        auto leaf_max = __get_cpuid_max(0, nullptr);
+        __get_cpuid(1, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+        if (leaf_max >= 7) {
+            __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+        }
+#endif
+        features.ssse3 = (leaf1[2] & (1u << 9)) != 0;
+
+        // AVX state has to be enabled by the OS (OSXSAVE + XCR0 bits for XMM/YMM)
+        bool avx = (leaf1[2] & (1u << 28)) != 0;
+        bool osxsave = (leaf1[2] & (1u << 27)) != 0;
+        if (avx && osxsave) {
+#ifdef _MSC_VER
+            auto xcr0 = _xgetbv(0);
+#else
+            unsigned int xcr0_lo, xcr0_hi;
+            __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+            auto xcr0 = ((uint64_t) xcr0_hi << 32) | xcr0_lo;
+#endif
+            features.avx2 = (xcr0 & 0x6) == 0x6 && (leaf7[1] & (1u << 5)) != 0;
+        }
+#endif
+        return features;
+    }
+
+    static const CPUFeatures &get_features() {
+        static const CPUFeatures features = [] {
+            auto result = detect_features();
+            log_misc("cpuutils", "detected cpu features: ssse3={}, avx2={}", result.ssse3, result.avx2);
+            return result;
+        }();
+        return features;
+    }
+
+    bool has_ssse3() {
+        return get_features().ssse3;
+    }
+
+    bool has_avx2() {
+        return get_features().avx2;
+    }
 }
@@ -5,4 +5,8 @@
 namespace cpuutils {
 
     std::vector<float> get_load();
+
+    // x86 extensions usable by this process, checks both cpu and os support
+    bool has_ssse3();
+    bool has_avx2();
 }
@@ -67,4 +67,44 @@ namespace crypt {
         return result;
     }
 
+    bool base64_decode(const char *str, size_t length, std::vector<uint8_t> &out) {
+        out.clear();
+        if (length % 4) {
+            return false;
+        }
+        out.reserve(length / 4 * 3);
+        uint32_t triplet = 0;
+        size_t bits = 0;
+        size_t padding = 0;
+        for (size_t i = 0; i < length; i++) {
+            auto c = str[i];
+            uint32_t value;
+            if (c >= 'A' && c <= 'Z') {
+                value = c - 'A';
+            } else if (c >= 'a' && c <= 'z') {
+                value = c - 'a' + 26;
+            } else if (c >= '0' && c <= '9') {
+                value = c - '0' + 52;
+            } else if (c == '+') {
+                value = 62;
+            } else if (c == '/') {
+                value = 63;
+            } else if (c == '=' && i + 2 >= length) {
+                padding++;
+                continue;
+            } else {
+                return false;
+            }
+            if (padding) {
+                return false;
+            }
+            triplet = (triplet << 6) | value;
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                out.push_back((uint8_t) (triplet >> bits));
+            }
+        }
+        return true;
+    }
 }
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace crypt {
     extern bool INITIALIZED;
@@ -10,4 +12,5 @@ namespace crypt {
     void dispose();
     void random_bytes(void *data, size_t length);
     std::string base64_encode(const uint8_t *ptr, size_t length);
+    bool base64_decode(const char *str, size_t length, std::vector<uint8_t> &out);
 }
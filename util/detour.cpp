@@ -1,14 +1,35 @@
 #include "detour.h"
 
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include "external/minhook/include/MinHook.h"
 
 #include "logging.h"
 #include "memutils.h"
 #include "peb.h"
+#include "time.h"
 #include "utils.h"
 
+struct HookTiming {
+    std::string subsystem;
+    size_t hooks = 0;
+    size_t failed = 0;
+    size_t freezes = 0;
+    double time = 0.0;
+};
+
+// transaction state, the lock is held for as long as a transaction is open
+static std::recursive_mutex TRANSACTION_M;
+static size_t TRANSACTION_DEPTH = 0;
+static size_t TRANSACTION_QUEUED = 0;
+static const char *TRANSACTION_SUBSYSTEM = nullptr;
+
+// queued hooks which are fatal if they can't be enabled, like outside of a transaction
+static std::vector<std::string> TRANSACTION_FATAL;
+static std::vector<HookTiming> HOOK_TIMINGS;
+
 static void minhook_init() {
     static std::once_flag init;
 
@@ -17,6 +38,44 @@ static void minhook_init() {
     });
 }
 
+static HookTiming &hook_timing(const char *subsystem) {
+    for (auto &timing : HOOK_TIMINGS) {
+        if (timing.subsystem == subsystem) {
+            return timing;
+        }
+    }
+    return HOOK_TIMINGS.emplace_back(HookTiming {
+        .subsystem = subsystem,
+    });
+}
+
+static bool trampoline_enable(void *target, double start) {
+    bool success = target != nullptr;
+    if (TRANSACTION_DEPTH > 0) {
+
+        // enabled on commit
+        if (success) {
+            success = MH_QueueEnableHook(target) == MH_OK;
+            TRANSACTION_QUEUED += success ? 1 : 0;
+        }
+    } else if (success) {
+
+        // every single enable suspends and resumes all other threads
+        success = MH_EnableHook(target) == MH_OK;
+    }
+
+    // timing
+    auto &timing = hook_timing(TRANSACTION_DEPTH > 0 ? TRANSACTION_SUBSYSTEM : "unbatched");
+    timing.time += get_performance_milliseconds() - start;
+    if (success) {
+        timing.hooks++;
+        timing.freezes += TRANSACTION_DEPTH > 0 ? 0 : 1;
+    } else {
+        timing.failed++;
+    }
+    return success;
+}
+
 bool detour::inline_hook(void *new_adr, void *address) {
 #ifdef SPICE64
     if (address) {
@@ -409,38 +468,114 @@ void *detour::iat_ordinal(const char *iid_name, DWORD ordinal, void *new_func, H
 }
 
 bool detour::trampoline(const char *dll, const char *func, void *hook, void **orig) {
+    std::lock_guard<std::recursive_mutex> lock(TRANSACTION_M);
     if (!trampoline_try(dll, func, hook, orig)) {
         log_fatal("detour", "could not insert trampoline for {}:{}", dll, func);
         return false;
     }
+    if (TRANSACTION_DEPTH > 0) {
+        TRANSACTION_FATAL.emplace_back(fmt::format("{}:{}", dll, func));
+    }
     return true;
 }
 
 bool detour::trampoline(void *func, void *hook, void **orig) {
+    std::lock_guard<std::recursive_mutex> lock(TRANSACTION_M);
     if (!trampoline_try(func, hook, orig)) {
         log_fatal("detour", "could not insert trampoline for {}", func);
         return false;
     }
+    if (TRANSACTION_DEPTH > 0) {
+        TRANSACTION_FATAL.emplace_back(fmt::format("{}", func));
+    }
     return true;
 }
 
 bool detour::trampoline_try(const char *dll, const char *func, void *hook, void **orig) {
     minhook_init();
+    std::lock_guard<std::recursive_mutex> lock(TRANSACTION_M);
+    auto start = get_performance_milliseconds();
     auto dll_w = s2ws(dll);
-    auto target = *orig;
-    auto create = MH_CreateHookApi(dll_w.c_str(), func, hook, orig);
+    void *target = nullptr;
+    auto create = MH_CreateHookApiEx(dll_w.c_str(), func, hook, orig, &target);
     if (create != MH_OK) {
         // log_warning("detour", "MH_CreateHookApi({}, {}): {}", dll, func, MH_StatusToString(create));
-        return false;
+        target = nullptr;
     }
-    return !(MH_EnableHook(target) != MH_OK);
+    return trampoline_enable(target, start);
 }
 
 bool detour::trampoline_try(void *func, void *hook, void **orig) {
     minhook_init();
-    auto target = *orig;
+    std::lock_guard<std::recursive_mutex> lock(TRANSACTION_M);
+    auto start = get_performance_milliseconds();
     if (MH_CreateHook(func, hook, orig) != MH_OK) {
-        return false;
+        func = nullptr;
+    }
+    return trampoline_enable(func, start);
+}
+
+detour::Transaction::Transaction(const char *subsystem) : subsystem(subsystem) {
+    minhook_init();
+    TRANSACTION_M.lock();
+    this->parent = TRANSACTION_SUBSYSTEM;
+    TRANSACTION_SUBSYSTEM = subsystem;
+    TRANSACTION_DEPTH++;
+}
+
+detour::Transaction::~Transaction() {
+    commit();
+}
+
+bool detour::Transaction::commit() {
+    if (this->committed) {
+        return true;
+    }
+    this->committed = true;
+    TRANSACTION_SUBSYSTEM = this->parent;
+
+    // only the outermost transaction applies the queue
+    bool success = true;
+    if (--TRANSACTION_DEPTH == 0 && TRANSACTION_QUEUED > 0) {
+        auto start = get_performance_milliseconds();
+        auto status = MH_ApplyQueued();
+        auto &timing = hook_timing(this->subsystem);
+        timing.time += get_performance_milliseconds() - start;
+        timing.freezes++;
+        if (status != MH_OK) {
+            if (!TRANSACTION_FATAL.empty()) {
+                std::string hooks;
+                for (auto &hook : TRANSACTION_FATAL) {
+                    hooks += hooks.empty() ? hook : ", " + hook;
+                }
+                log_fatal("detour", "{}: could not enable trampolines for {}: {}",
+                        this->subsystem, hooks, MH_StatusToString(status));
+            }
+            log_warning("detour", "{}: failed to enable {} queued hooks: {}",
+                    this->subsystem, TRANSACTION_QUEUED, MH_StatusToString(status));
+            success = false;
+        }
+        TRANSACTION_QUEUED = 0;
     }
-    return !(MH_EnableHook(target) != MH_OK);
+    if (TRANSACTION_DEPTH == 0) {
+        TRANSACTION_FATAL.clear();
+    }
+
+    TRANSACTION_M.unlock();
+    return success;
+}
+
+void detour::report() {
+    std::lock_guard<std::recursive_mutex> lock(TRANSACTION_M);
+    HookTiming total {};
+    for (auto &timing : HOOK_TIMINGS) {
+        log_info("detour", "{}: {} hooks, {} failed, {} thread freezes, {:.3f}ms",
+                timing.subsystem, timing.hooks, timing.failed, timing.freezes, timing.time);
+        total.hooks += timing.hooks;
+        total.failed += timing.failed;
+        total.freezes += timing.freezes;
+        total.time += timing.time;
+    }
+    log_info("detour", "total: {} hooks, {} failed, {} thread freezes, {:.3f}ms",
+            total.hooks, total.failed, total.freezes, total.time);
 }
@@ -22,6 +22,32 @@ namespace detour {
     bool trampoline_try(const char *dll, const char *func, void *hook, void **orig);
     bool trampoline_try(void *func, void *hook, void **orig);
 
+    /*
+     * Hook transactions
+     *
+     * Trampolines created while a transaction is open are only queued and get enabled together
+     * when the outermost transaction commits, so the process threads are suspended once instead
+     * of once per hook. Queued hooks are not active before that, so don't call into functions
+     * hooked by the same transaction. Transactions nest and block other threads from hooking.
+     */
+
+    class Transaction {
+    public:
+        explicit Transaction(const char *subsystem);
+        ~Transaction();
+
+        // enables the queued hooks, done automatically on destruction
+        bool commit();
+
+    private:
+        const char *subsystem;
+        const char *parent;
+        bool committed = false;
+    };
+
+    // logs hook count and installation time per subsystem
+    void report();
+
     /*
      * Inline hook aliases
      */
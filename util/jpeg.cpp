@@ -0,0 +1,603 @@
+#include "jpeg.h"
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+
+#include "util/logging.h"
+#include "util/threadpool.h"
+#include "util/time.h"
+#include "util/utils.h"
+
+namespace jpeg {
+
+    /*
+     * Tables from the JPEG standard, Annex K
+     * The DCT, quantization scaling and Huffman table generation follow TooJpeg (external/toojpeg).
+     */
+
+    static const uint8_t QUANT_LUMINANCE[64] {
+        16, 11, 10, 16, 24, 40, 51, 61,
+        12, 12, 14, 19, 26, 58, 60, 55,
+        14, 13, 16, 24, 40, 57, 69, 56,
+        14, 17, 22, 29, 51, 87, 80, 62,
+        18, 22, 37, 56, 68, 109, 103, 77,
+        24, 35, 55, 64, 81, 104, 113, 92,
+        49, 64, 78, 87, 103, 121, 120, 101,
+        72, 92, 95, 98, 112, 100, 103, 99,
+    };
+    static const uint8_t QUANT_CHROMINANCE[64] {
+        17, 18, 24, 47, 99, 99, 99, 99,
+        18, 21, 26, 66, 99, 99, 99, 99,
+        24, 26, 56, 99, 99, 99, 99, 99,
+        47, 66, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+    };
+
+    // natural position of the n-th coefficient in zig-zag order
+    static const uint8_t ZIGZAG_INV[64] {
+        0, 1, 8, 16, 9, 2, 3, 10,
+        17, 24, 32, 25, 18, 11, 4, 5,
+        12, 19, 26, 33, 40, 48, 41, 34,
+        27, 20, 13, 6, 7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36,
+        29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46,
+        53, 60, 61, 54, 47, 55, 62, 63,
+    };
+
+    // Huffman tables, number of codes per bit length followed by the symbols
+    static const uint8_t DC_LUMINANCE_BITS[16] { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+    static const uint8_t DC_LUMINANCE_VALUES[12] { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+    static const uint8_t AC_LUMINANCE_BITS[16] { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 125 };
+    static const uint8_t AC_LUMINANCE_VALUES[162] {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+        0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0,
+        0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+        0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+        0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
+        0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5,
+        0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+        0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+        0xF9, 0xFA,
+    };
+    static const uint8_t DC_CHROMINANCE_BITS[16] { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+    static const uint8_t DC_CHROMINANCE_VALUES[12] { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+    static const uint8_t AC_CHROMINANCE_BITS[16] { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 119 };
+    static const uint8_t AC_CHROMINANCE_VALUES[162] {
+        0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+        0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0,
+        0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26,
+        0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+        0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+        0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+        0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5,
+        0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+        0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+        0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+        0xF9, 0xFA,
+    };
+
+    // threads besides the caller, strips per thread so uneven strips still balance out
+    static const size_t WORKER_COUNT_MAX = 8;
+    static const size_t STRIPS_PER_THREAD = 4;
+
+    // quantized coefficients stay within +/-2^11
+    static const int CODEWORD_LIMIT = 2048;
+
+    struct BitCode {
+        uint16_t code;
+        uint8_t bits;
+    };
+
+    struct HuffmanTable {
+        BitCode dc[256];
+        BitCode ac[256];
+    };
+
+    struct CodeTables {
+        HuffmanTable luminance;
+        HuffmanTable chrominance;
+
+        // magnitude categories, value v is found at codewords[v + CODEWORD_LIMIT]
+        BitCode codewords[CODEWORD_LIMIT * 2];
+    };
+
+    struct Quantization {
+
+        // zig-zag order as stored in the file
+        uint8_t luminance[64];
+        uint8_t chrominance[64];
+
+        // reciprocals in natural order including the AAN scale factors
+        float scale_luminance[64];
+        float scale_chrominance[64];
+    };
+
+    struct Image {
+        const uint8_t *pixels;
+        size_t width, height;
+        bool downsample;
+        size_t mcu_size;
+        size_t mcu_cols;
+        size_t mcu_rows;
+        const Quantization *quant;
+        const CodeTables *tables;
+    };
+
+    /*
+     * Bit writer with byte stuffing
+     */
+    class BitWriter {
+    public:
+        explicit BitWriter(std::vector<uint8_t> &out) : out(out) {}
+
+        inline void put(BitCode code) {
+            buffer = (buffer << code.bits) | code.code;
+            count += code.bits;
+            while (count >= 8) {
+                count -= 8;
+                auto byte = (uint8_t) (buffer >> count);
+                out.push_back(byte);
+
+                // 0xFF would start a marker
+                if (byte == 0xFF) {
+                    out.push_back(0);
+                }
+            }
+        }
+
+        // pad the last byte with ones
+        void flush() {
+            put({ 0x7F, 7 });
+            count = 0;
+        }
+
+    private:
+        std::vector<uint8_t> &out;
+        uint32_t buffer = 0;
+        int count = 0;
+    };
+
+    static void generate_huffman(const uint8_t bits[16], const uint8_t *values, BitCode table[256]) {
+        uint16_t code = 0;
+        for (uint8_t length = 1; length <= 16; length++) {
+            for (int i = 0; i < bits[length - 1]; i++) {
+                table[*values++] = { code++, length };
+            }
+            code <<= 1;
+        }
+    }
+
+    static const CodeTables &get_code_tables() {
+        static const auto tables = [] {
+            auto result = std::make_unique<CodeTables>();
+            generate_huffman(DC_LUMINANCE_BITS, DC_LUMINANCE_VALUES, result->luminance.dc);
+            generate_huffman(AC_LUMINANCE_BITS, AC_LUMINANCE_VALUES, result->luminance.ac);
+            generate_huffman(DC_CHROMINANCE_BITS, DC_CHROMINANCE_VALUES, result->chrominance.dc);
+            generate_huffman(AC_CHROMINANCE_BITS, AC_CHROMINANCE_VALUES, result->chrominance.ac);
+
+            // negative values are stored as the one's complement
+            uint8_t bits = 1;
+            int mask = 1;
+            for (int value = 1; value < CODEWORD_LIMIT; value++) {
+                if (value > mask) {
+                    bits++;
+                    mask = (mask << 1) | 1;
+                }
+                result->codewords[CODEWORD_LIMIT - value] = { (uint16_t) (mask - value), bits };
+                result->codewords[CODEWORD_LIMIT + value] = { (uint16_t) value, bits };
+            }
+            return result;
+        }();
+        return *tables;
+    }
+
+    static void get_quantization(Quantization &quant, int quality) {
+
+        // scale factor, formula from libjpeg
+        quality = CLAMP(quality, 1, 100);
+        quality = quality < 50 ? 5000 / quality : 200 - quality * 2;
+
+        // AAN scale factors, [0] = 1, [k] = cos(k * PI / 16) * sqrt(2)
+        static const float AAN_SCALE[8] {
+            1.f, 1.387039845f, 1.306562965f, 1.175875602f, 1.f, 0.785694958f, 0.541196100f, 0.275899379f
+        };
+        for (int i = 0; i < 64; i++) {
+            auto pos = ZIGZAG_INV[i];
+            quant.luminance[i] = (uint8_t) CLAMP((QUANT_LUMINANCE[pos] * quality + 50) / 100, 1, 255);
+            quant.chrominance[i] = (uint8_t) CLAMP((QUANT_CHROMINANCE[pos] * quality + 50) / 100, 1, 255);
+            auto factor = 1.f / (AAN_SCALE[pos / 8] * AAN_SCALE[pos % 8] * 8.f);
+            quant.scale_luminance[pos] = factor / quant.luminance[i];
+            quant.scale_chrominance[pos] = factor / quant.chrominance[i];
+        }
+    }
+
+    /*
+     * Forward DCT in one dimension, AAN algorithm
+     * Stride is 1 for rows and 8 for columns.
+     */
+    static inline void dct(float *block, size_t stride) {
+        const float SQRT_HALF_SQRT = 1.306562965f;
+        const float INV_SQRT = 0.707106781f;
+        const float HALF_SQRT_SQRT = 0.382683432f;
+        const float INV_SQRT_SQRT = 0.541196100f;
+
+        auto &b0 = block[0];
+        auto &b1 = block[1 * stride];
+        auto &b2 = block[2 * stride];
+        auto &b3 = block[3 * stride];
+        auto &b4 = block[4 * stride];
+        auto &b5 = block[5 * stride];
+        auto &b6 = block[6 * stride];
+        auto &b7 = block[7 * stride];
+
+        // even part
+        auto add07 = b0 + b7;
+        auto sub07 = b0 - b7;
+        auto add16 = b1 + b6;
+        auto sub16 = b1 - b6;
+        auto add25 = b2 + b5;
+        auto sub25 = b2 - b5;
+        auto add34 = b3 + b4;
+        auto sub34 = b3 - b4;
+        auto add0347 = add07 + add34;
+        auto sub07_34 = add07 - add34;
+        auto add1256 = add16 + add25;
+        auto sub16_25 = add16 - add25;
+        b0 = add0347 + add1256;
+        b4 = add0347 - add1256;
+        auto z1 = (sub16_25 + sub07_34) * INV_SQRT;
+        b2 = sub07_34 + z1;
+        b6 = sub07_34 - z1;
+
+        // odd part
+        auto sub23_45 = sub25 + sub34;
+        auto sub12_56 = sub16 + sub25;
+        auto sub01_67 = sub16 + sub07;
+        auto z5 = (sub23_45 - sub01_67) * HALF_SQRT_SQRT;
+        auto z2 = sub23_45 * INV_SQRT_SQRT + z5;
+        auto z3 = sub12_56 * INV_SQRT;
+        auto z4 = sub01_67 * SQRT_HALF_SQRT + z5;
+        auto z6 = sub07 + z3;
+        auto z7 = sub07 - z3;
+        b1 = z6 + z4;
+        b7 = z6 - z4;
+        b5 = z7 + z2;
+        b3 = z7 - z2;
+    }
+
+    static inline int round_int(float value) {
+        return (int) (value + (value >= 0 ? 0.5f : -0.5f));
+    }
+
+    static int encode_block(BitWriter &writer, float block[64], const float scale[64], int last_dc,
+            const HuffmanTable &huffman, const BitCode *codewords) {
+
+        // transform
+        for (size_t offset = 0; offset < 64; offset += 8) {
+            dct(block + offset, 1);
+        }
+        for (size_t offset = 0; offset < 8; offset++) {
+            dct(block + offset, 8);
+        }
+
+        // quantize in zig-zag order
+        int quantized[64];
+        int last_nonzero = 0;
+        for (int i = 0; i < 64; i++) {
+            auto pos = ZIGZAG_INV[i];
+            quantized[i] = round_int(block[pos] * scale[pos]);
+            if (i > 0 && quantized[i] != 0) {
+                last_nonzero = i;
+            }
+        }
+
+        // DC is coded as difference to the previous block
+        auto dc = quantized[0];
+        auto diff = dc - last_dc;
+        if (diff == 0) {
+            writer.put(huffman.dc[0x00]);
+        } else {
+            auto codeword = codewords[diff];
+            writer.put(huffman.dc[codeword.bits]);
+            writer.put(codeword);
+        }
+
+        // AC as run length of zeros and magnitude
+        int run = 0;
+        for (int i = 1; i <= last_nonzero; i++) {
+            if (quantized[i] == 0) {
+                if (++run == 16) {
+                    writer.put(huffman.ac[0xF0]);
+                    run = 0;
+                }
+                continue;
+            }
+            auto codeword = codewords[quantized[i]];
+            writer.put(huffman.ac[(run << 4) + codeword.bits]);
+            writer.put(codeword);
+            run = 0;
+        }
+
+        // end of block unless the last coefficient was set
+        if (last_nonzero < 63) {
+            writer.put(huffman.ac[0x00]);
+        }
+        return dc;
+    }
+
+    static void encode_strip(std::vector<uint8_t> &out, const Image &image, size_t row_start, size_t row_end) {
+        BitWriter writer(out);
+        auto codewords = &image.tables->codewords[CODEWORD_LIMIT];
+        auto mcu_size = image.mcu_size;
+        int last_y = 0, last_cb = 0, last_cr = 0;
+
+        // MCU converted to YCbCr
+        float y[16 * 16];
+        float cb[16 * 16];
+        float cr[16 * 16];
+        float block[64];
+        float block_cr[64];
+
+        for (size_t row = row_start; row < row_end; row++) {
+            for (size_t col = 0; col < image.mcu_cols; col++) {
+
+                // color conversion, the last row/column gets repeated at the borders
+                for (size_t dy = 0; dy < mcu_size; dy++) {
+                    auto sy = MIN(row * mcu_size + dy, image.height - 1);
+                    auto src = image.pixels + sy * image.width * 3;
+                    for (size_t dx = 0; dx < mcu_size; dx++) {
+                        auto sx = MIN(col * mcu_size + dx, image.width - 1);
+                        auto pixel = src + sx * 3;
+                        float r = pixel[0];
+                        float g = pixel[1];
+                        float b = pixel[2];
+                        auto pos = dy * mcu_size + dx;
+                        y[pos] = 0.299f * r + 0.587f * g + 0.114f * b - 128.f;
+                        cb[pos] = -0.16874f * r - 0.33126f * g + 0.5f * b;
+                        cr[pos] = 0.5f * r - 0.41869f * g - 0.08131f * b;
+                    }
+                }
+
+                // luminance blocks
+                for (size_t by = 0; by < mcu_size; by += 8) {
+                    for (size_t bx = 0; bx < mcu_size; bx += 8) {
+                        for (size_t i = 0; i < 64; i++) {
+                            block[i] = y[(by + i / 8) * mcu_size + bx + i % 8];
+                        }
+                        last_y = encode_block(writer, block, image.quant->scale_luminance, last_y,
+                                image.tables->luminance, codewords);
+                    }
+                }
+
+                // chrominance blocks, averaged over 2x2 pixels for 4:2:0
+                if (image.downsample) {
+                    for (size_t i = 0; i < 64; i++) {
+                        auto pos = (i / 8) * 32 + (i % 8) * 2;
+                        block[i] = (cb[pos] + cb[pos + 1] + cb[pos + 16] + cb[pos + 17]) * 0.25f;
+                        block_cr[i] = (cr[pos] + cr[pos + 1] + cr[pos + 16] + cr[pos + 17]) * 0.25f;
+                    }
+                    last_cb = encode_block(writer, block, image.quant->scale_chrominance, last_cb,
+                            image.tables->chrominance, codewords);
+                    last_cr = encode_block(writer, block_cr, image.quant->scale_chrominance, last_cr,
+                            image.tables->chrominance, codewords);
+                } else {
+                    last_cb = encode_block(writer, cb, image.quant->scale_chrominance, last_cb,
+                            image.tables->chrominance, codewords);
+                    last_cr = encode_block(writer, cr, image.quant->scale_chrominance, last_cr,
+                            image.tables->chrominance, codewords);
+                }
+            }
+        }
+
+        // strips end on a byte boundary
+        writer.flush();
+    }
+
+    static inline void put_marker(std::vector<uint8_t> &out, uint8_t id, uint16_t length) {
+        out.push_back(0xFF);
+        out.push_back(id);
+        out.push_back((uint8_t) (length >> 8));
+        out.push_back((uint8_t) (length & 0xFF));
+    }
+
+    static inline void put_bytes(std::vector<uint8_t> &out, const uint8_t *data, size_t size) {
+        out.insert(out.end(), data, data + size);
+    }
+
+    static void put_headers(std::vector<uint8_t> &out, const Image &image, size_t restart_interval) {
+
+        // start of image, JFIF 1.1 without density or thumbnail
+        static const uint8_t JFIF[] {
+            0xFF, 0xD8,
+            0xFF, 0xE0, 0, 16, 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0,
+        };
+        put_bytes(out, JFIF, sizeof(JFIF));
+
+        // quantization tables
+        put_marker(out, 0xDB, 2 + 2 * 65);
+        out.push_back(0x00);
+        put_bytes(out, image.quant->luminance, 64);
+        out.push_back(0x01);
+        put_bytes(out, image.quant->chrominance, 64);
+
+        // start of frame, baseline with Y/Cb/Cr
+        put_marker(out, 0xC0, 2 + 6 + 3 * 3);
+        out.push_back(8);
+        out.push_back((uint8_t) (image.height >> 8));
+        out.push_back((uint8_t) (image.height & 0xFF));
+        out.push_back((uint8_t) (image.width >> 8));
+        out.push_back((uint8_t) (image.width & 0xFF));
+        out.push_back(3);
+        for (uint8_t id = 1; id <= 3; id++) {
+            out.push_back(id);
+            out.push_back(id == 1 && image.downsample ? 0x22 : 0x11);
+            out.push_back(id == 1 ? 0 : 1);
+        }
+
+        // Huffman tables
+        put_marker(out, 0xC4, 2 + 208 + 208);
+        out.push_back(0x00);
+        put_bytes(out, DC_LUMINANCE_BITS, sizeof(DC_LUMINANCE_BITS));
+        put_bytes(out, DC_LUMINANCE_VALUES, sizeof(DC_LUMINANCE_VALUES));
+        out.push_back(0x10);
+        put_bytes(out, AC_LUMINANCE_BITS, sizeof(AC_LUMINANCE_BITS));
+        put_bytes(out, AC_LUMINANCE_VALUES, sizeof(AC_LUMINANCE_VALUES));
+        out.push_back(0x01);
+        put_bytes(out, DC_CHROMINANCE_BITS, sizeof(DC_CHROMINANCE_BITS));
+        put_bytes(out, DC_CHROMINANCE_VALUES, sizeof(DC_CHROMINANCE_VALUES));
+        out.push_back(0x11);
+        put_bytes(out, AC_CHROMINANCE_BITS, sizeof(AC_CHROMINANCE_BITS));
+        put_bytes(out, AC_CHROMINANCE_VALUES, sizeof(AC_CHROMINANCE_VALUES));
+
+        // restart interval in MCUs
+        if (restart_interval > 0) {
+            put_marker(out, 0xDD, 4);
+            out.push_back((uint8_t) (restart_interval >> 8));
+            out.push_back((uint8_t) (restart_interval & 0xFF));
+        }
+
+        // start of scan
+        static const uint8_t SCAN[] {
+            3,
+            1, 0x00,
+            2, 0x11,
+            3, 0x11,
+            0, 63, 0,
+        };
+        put_marker(out, 0xDA, 2 + sizeof(SCAN));
+        put_bytes(out, SCAN, sizeof(SCAN));
+    }
+
+    static size_t get_worker_count() {
+        static const size_t count = MIN((size_t) MAX(std::thread::hardware_concurrency(), 2u) - 1,
+                WORKER_COUNT_MAX);
+        return count;
+    }
+
+    static ThreadPool &get_pool() {
+        static ThreadPool pool(get_worker_count());
+        return pool;
+    }
+
+    static bool encode(std::vector<uint8_t> &out, const uint8_t *pixels, size_t width, size_t height,
+            int quality, bool downsample, size_t workers) {
+
+        // check image
+        if (pixels == nullptr || width == 0 || height == 0 || width > 0xFFFF || height > 0xFFFF) {
+            return false;
+        }
+
+        // image info
+        Quantization quant {};
+        get_quantization(quant, quality);
+        size_t mcu_size = downsample ? 16 : 8;
+        Image image {
+            .pixels = pixels,
+            .width = width,
+            .height = height,
+            .downsample = downsample,
+            .mcu_size = mcu_size,
+            .mcu_cols = (width + mcu_size - 1) / mcu_size,
+            .mcu_rows = (height + mcu_size - 1) / mcu_size,
+            .quant = &quant,
+            .tables = &get_code_tables(),
+        };
+
+        // split into strips, the restart interval is limited to 16 bits
+        auto strips_wanted = (workers + 1) * STRIPS_PER_THREAD;
+        auto strip_rows = (image.mcu_rows + strips_wanted - 1) / strips_wanted;
+        strip_rows = MAX(MIN(strip_rows, 0xFFFF / image.mcu_cols), (size_t) 1);
+        auto strip_count = (image.mcu_rows + strip_rows - 1) / strip_rows;
+        put_headers(out, image, strip_count > 1 ? strip_rows * image.mcu_cols : 0);
+
+        // strip buffers are kept by the calling thread
+        thread_local std::vector<std::vector<uint8_t>> strips;
+        if (strips.size() < strip_count) {
+            strips.resize(strip_count);
+        }
+
+        // encode, the calling thread takes part so progress never depends on the pool
+        std::atomic<size_t> strip_next = 0;
+        auto work = [&image, &strip_next, strip_count, strip_rows, buffers = strips.data()] () {
+            size_t strip;
+            while ((strip = strip_next++) < strip_count) {
+                buffers[strip].clear();
+                encode_strip(buffers[strip], image,
+                        strip * strip_rows, MIN((strip + 1) * strip_rows, image.mcu_rows));
+            }
+        };
+        std::future<void> helpers[WORKER_COUNT_MAX];
+        auto helper_count = MIN(workers, strip_count - 1);
+        for (size_t i = 0; i < helper_count; i++) {
+            helpers[i] = get_pool().add(work);
+        }
+        work();
+        for (size_t i = 0; i < helper_count; i++) {
+            helpers[i].get();
+        }
+
+        // join strips with restart markers in between
+        size_t size = 2;
+        for (size_t i = 0; i < strip_count; i++) {
+            size += strips[i].size() + 2;
+        }
+        out.reserve(out.size() + size);
+        for (size_t i = 0; i < strip_count; i++) {
+            put_bytes(out, strips[i].data(), strips[i].size());
+            if (i + 1 < strip_count) {
+                out.push_back(0xFF);
+                out.push_back((uint8_t) (0xD0 + (i & 7)));
+            }
+        }
+
+        // end of image
+        out.push_back(0xFF);
+        out.push_back(0xD9);
+        return true;
+    }
+
+    bool encode(std::vector<uint8_t> &out, const uint8_t *pixels, size_t width, size_t height,
+            int quality, bool downsample) {
+        return encode(out, pixels, width, height, quality, downsample, get_worker_count());
+    }
+
+    void benchmark() {
+        const size_t width = 1920;
+        const size_t height = 1080;
+        const int iterations = 20;
+
+        // gradients with some noise, roughly as hard to compress as a game frame
+        std::vector<uint8_t> frame(width * height * 3);
+        uint32_t seed = 1;
+        for (size_t y = 0; y < height; y++) {
+            for (size_t x = 0; x < width; x++) {
+                seed = seed * 1103515245 + 12345;
+                auto pixel = &frame[(y * width + x) * 3];
+                pixel[0] = (uint8_t) (x * 255 / width);
+                pixel[1] = (uint8_t) (y * 255 / height);
+                pixel[2] = (uint8_t) ((seed >> 16) & 0x3F);
+            }
+        }
+
+        log_info("jpeg", "benchmarking {}x{}, {} iterations, {} workers",
+                width, height, iterations, get_worker_count());
+        std::vector<uint8_t> out;
+        for (auto workers : { (size_t) 0, get_worker_count() }) {
+            auto time_start = get_performance_milliseconds();
+            for (int i = 0; i < iterations; i++) {
+                out.clear();
+                encode(out, frame.data(), width, height, 70, true, workers);
+            }
+            auto time = (get_performance_milliseconds() - time_start) / iterations;
+            log_info("jpeg", "{} workers: {:.3f} ms, {} bytes", workers, time, out.size());
+        }
+    }
+}
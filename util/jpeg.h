@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Baseline JPEG encoder for packed RGB images.
+ *
+ * The image is split into strips of MCU rows separated by restart markers. Every strip starts with
+ * fresh DC predictors, so strips are encoded in parallel on a shared worker pool and then joined.
+ * The output is a regular JFIF file any decoder can read.
+ */
+namespace jpeg {
+
+    // appends the encoded image to out, downsample selects YCbCr 4:2:0 instead of 4:4:4
+    bool encode(std::vector<uint8_t> &out, const uint8_t *pixels, size_t width, size_t height,
+            int quality = 90, bool downsample = true);
+
+    // times the encoder on a 1080p frame and logs the results
+    void benchmark();
+}
@@ -1,5 +1,11 @@
 #include "libutils.h"
 
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 #include <windows.h>
 #include <psapi.h>
 #include <shlwapi.h>
@@ -7,6 +13,202 @@
 #include "logging.h"
 #include "utils.h"
 #include "peb.h"
+#include "time.h"
+
+namespace libutils {
+
+    /*
+     * Section table of a PE file on disk.
+     * Both directions hold disjoint ranges sorted by start, so translating is a binary search.
+     */
+    struct PESection {
+        uint64_t start;
+        uint64_t end;
+        uint64_t target;
+    };
+    struct PEInfo {
+        FILETIME creation_time;
+        FILETIME write_time;
+        uint64_t file_size;
+        std::vector<PESection> offset_to_rva;
+        std::vector<PESection> rva_to_offset;
+    };
+    struct PECacheEntry {
+        std::shared_ptr<const PEInfo> info;
+        double validated;
+    };
+
+    // files are checked for changes at most once per interval
+    static const double PE_CACHE_VALIDATE_INTERVAL = 1000.0;
+
+    static std::mutex PE_CACHE_M;
+    static std::unordered_map<std::wstring, PECacheEntry> PE_CACHE;
+
+    static void pe_sections_add(std::vector<PESection> &sections, uint64_t start, uint64_t end, uint64_t target) {
+
+        // earlier sections take precedence like in the linear search, so only add the uncovered parts
+        std::vector<std::pair<uint64_t, uint64_t>> pieces {{start, end}};
+        for (auto &section : sections) {
+            std::vector<std::pair<uint64_t, uint64_t>> remaining;
+            for (auto &piece : pieces) {
+                if (piece.second <= section.start || piece.first >= section.end) {
+                    remaining.push_back(piece);
+                    continue;
+                }
+                if (piece.first < section.start) {
+                    remaining.emplace_back(piece.first, section.start);
+                }
+                if (piece.second > section.end) {
+                    remaining.emplace_back(section.end, piece.second);
+                }
+            }
+            pieces = std::move(remaining);
+        }
+        for (auto &piece : pieces) {
+            sections.push_back(PESection {
+                .start = piece.first,
+                .end = piece.second,
+                .target = target + (piece.first - start),
+            });
+        }
+    }
+
+    static intptr_t pe_sections_translate(const std::vector<PESection> &sections, intptr_t value) {
+
+        // find last section starting at or before the value
+        auto key = static_cast<DWORD>(value);
+        auto it = std::upper_bound(sections.begin(), sections.end(), key,
+                [] (uint64_t key, const PESection &section) {
+            return key < section.start;
+        });
+        if (it == sections.begin()) {
+            return -1;
+        }
+        it--;
+
+        // check if value is within section
+        if (key >= it->end) {
+            return -1;
+        }
+        return static_cast<intptr_t>(key - it->start + it->target);
+    }
+
+    static std::shared_ptr<const PEInfo> pe_info_parse(const std::filesystem::path &path) {
+
+        // open file
+        HANDLE dll_file = CreateFileW(
+                path.c_str(),
+                GENERIC_READ,
+                FILE_SHARE_READ,
+                nullptr,
+                OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL,
+                0);
+        if (dll_file == INVALID_HANDLE_VALUE) {
+            return nullptr;
+        }
+
+        // reads a part of the file, only the headers are needed
+        auto read = [dll_file] (uint64_t offset, void *buffer, DWORD size) {
+            OVERLAPPED overlapped {};
+            overlapped.Offset = static_cast<DWORD>(offset);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD read = 0;
+            return ReadFile(dll_file, buffer, size, &read, &overlapped) && read == size;
+        };
+
+        // get file identity
+        auto info = std::make_shared<PEInfo>();
+        BY_HANDLE_FILE_INFORMATION file_info {};
+        if (!GetFileInformationByHandle(dll_file, &file_info)) {
+            log_warning("libutils", "could not get file information for {}: {}",
+                    path.string(), get_last_error_string());
+            CloseHandle(dll_file);
+            return nullptr;
+        }
+        info->creation_time = file_info.ftCreationTime;
+        info->write_time = file_info.ftLastWriteTime;
+        info->file_size = (static_cast<uint64_t>(file_info.nFileSizeHigh) << 32) | file_info.nFileSizeLow;
+
+        // read headers
+        IMAGE_DOS_HEADER dll_dos {};
+        DWORD nt_signature = 0;
+        IMAGE_FILE_HEADER file_header {};
+        std::vector<IMAGE_SECTION_HEADER> section_headers;
+        bool valid = read(0, &dll_dos, sizeof(dll_dos))
+                && dll_dos.e_magic == IMAGE_DOS_SIGNATURE
+                && read(dll_dos.e_lfanew, &nt_signature, sizeof(nt_signature))
+                && nt_signature == IMAGE_NT_SIGNATURE
+                && read(dll_dos.e_lfanew + sizeof(nt_signature), &file_header, sizeof(file_header));
+        if (valid) {
+            section_headers.resize(file_header.NumberOfSections);
+            valid = section_headers.empty() || read(
+                    dll_dos.e_lfanew + sizeof(nt_signature) + sizeof(file_header) + file_header.SizeOfOptionalHeader,
+                    section_headers.data(),
+                    static_cast<DWORD>(section_headers.size() * sizeof(IMAGE_SECTION_HEADER)));
+        }
+        CloseHandle(dll_file);
+        if (!valid) {
+            log_warning("libutils", "could not read PE headers of {}", path.string());
+            return nullptr;
+        }
+
+        // build lookup tables
+        for (auto &section : section_headers) {
+            pe_sections_add(info->offset_to_rva,
+                    section.PointerToRawData,
+                    static_cast<uint64_t>(section.PointerToRawData) + section.SizeOfRawData,
+                    section.VirtualAddress);
+            pe_sections_add(info->rva_to_offset,
+                    section.VirtualAddress,
+                    static_cast<uint64_t>(section.VirtualAddress) + section.Misc.VirtualSize,
+                    section.PointerToRawData);
+        }
+        auto compare = [] (const PESection &a, const PESection &b) {
+            return a.start < b.start;
+        };
+        std::sort(info->offset_to_rva.begin(), info->offset_to_rva.end(), compare);
+        std::sort(info->rva_to_offset.begin(), info->rva_to_offset.end(), compare);
+        return info;
+    }
+
+    static std::shared_ptr<const PEInfo> pe_info_get(const std::filesystem::path &path) {
+        auto key = path.lexically_normal().wstring();
+        auto now = get_performance_milliseconds();
+        std::lock_guard<std::mutex> lock(PE_CACHE_M);
+
+        // check cached entry
+        auto it = PE_CACHE.find(key);
+        if (it != PE_CACHE.end()) {
+            auto &entry = it->second;
+            if (now - entry.validated < PE_CACHE_VALIDATE_INTERVAL) {
+                return entry.info;
+            }
+
+            // file replaced or modified since it was parsed
+            WIN32_FILE_ATTRIBUTE_DATA attributes {};
+            if (GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &attributes)
+            && CompareFileTime(&attributes.ftCreationTime, &entry.info->creation_time) == 0
+            && CompareFileTime(&attributes.ftLastWriteTime, &entry.info->write_time) == 0
+            && ((static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow)
+               == entry.info->file_size) {
+                entry.validated = now;
+                return entry.info;
+            }
+            PE_CACHE.erase(it);
+        }
+
+        // parse file, failures aren't cached since the file might appear later
+        auto info = pe_info_parse(path);
+        if (info) {
+            PE_CACHE[key] = PECacheEntry {
+                .info = info,
+                .validated = now,
+            };
+        }
+        return info;
+    }
+}
 
 std::filesystem::path libutils::module_file_name(HMODULE module) {
     std::wstring buf;
@@ -205,50 +407,22 @@ intptr_t libutils::rva2offset(IMAGE_NT_HEADERS *nt_headers, intptr_t rva) {
 
 
 intptr_t libutils::rva2offset(const std::filesystem::path &path, intptr_t rva) {
-
-    // open file
-    HANDLE dll_file = CreateFileW(
-            path.c_str(),
-            GENERIC_READ,
-            FILE_SHARE_READ,
-            NULL,
-            OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL,
-            0);
-    if (!dll_file) {
-        return ~0;
-    }
-
-    // create file mapping
-    HANDLE dll_mapping = CreateFileMappingW(dll_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
-    if (!dll_mapping) {
-        CloseHandle(dll_file);
-        log_warning("libutils", "could not create file mapping for {}", path.string());
+    auto info = pe_info_get(path);
+    if (!info) {
         return -1;
     }
+    return pe_sections_translate(info->rva_to_offset, rva);
+}
 
-    // map view of file
-    LPVOID dll_file_base = MapViewOfFile(dll_mapping, FILE_MAP_READ, 0, 0, 0);
-    if (!dll_file_base) {
-        CloseHandle(dll_file);
-        CloseHandle(dll_mapping);
-        log_warning("libutils", "could not map view of file for {}", path.string());
-        return -1;
+bool libutils::rva2offset(const std::filesystem::path &path, std::vector<intptr_t> &values) {
+    auto info = pe_info_get(path);
+    if (!info) {
+        return false;
     }
-
-    // get offset
-    intptr_t offset = -1;
-    auto dll_dos = reinterpret_cast<PIMAGE_DOS_HEADER>(dll_file_base);
-    if (dll_dos->e_magic == IMAGE_DOS_SIGNATURE) {
-        auto dll_nt = reinterpret_cast<PIMAGE_NT_HEADERS>(reinterpret_cast<uint8_t *>(dll_dos) + dll_dos->e_lfanew);
-        offset = libutils::rva2offset(dll_nt, rva);
+    for (auto &value : values) {
+        value = pe_sections_translate(info->rva_to_offset, value);
     }
-
-    // clean up and return
-    UnmapViewOfFile(dll_file_base);
-    CloseHandle(dll_file);
-    CloseHandle(dll_mapping);
-    return offset;
+    return true;
 }
 
 intptr_t libutils::offset2rva(IMAGE_NT_HEADERS *nt_headers, intptr_t offset) {
@@ -276,49 +450,20 @@ intptr_t libutils::offset2rva(IMAGE_NT_HEADERS *nt_headers, intptr_t offset) {
 }
 
 intptr_t libutils::offset2rva(const std::filesystem::path &path, intptr_t offset) {
-
-    // open file
-    HANDLE dll_file = CreateFileW(
-            path.c_str(),
-            GENERIC_READ,
-            FILE_SHARE_READ,
-            nullptr,
-            OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL,
-            0);
-    if (!dll_file) {
-        return -1;
-    }
-
-    // create file mapping
-    HANDLE dll_mapping = CreateFileMappingW(dll_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
-    if (!dll_mapping) {
-        log_warning("libutils", "could not create file mapping for {}: {}", path.string(), get_last_error_string());
-        CloseHandle(dll_file);
+    auto info = pe_info_get(path);
+    if (!info) {
         return -1;
     }
+    return pe_sections_translate(info->offset_to_rva, offset);
+}
 
-    // map view of file
-    LPVOID dll_file_base = MapViewOfFile(dll_mapping, FILE_MAP_READ, 0, 0, 0);
-    if (!dll_file_base) {
-        log_warning("libutils", "could not map view of file for {}: {}", path.string(), get_last_error_string());
-        CloseHandle(dll_file);
-        CloseHandle(dll_mapping);
-        return -1;
+bool libutils::offset2rva(const std::filesystem::path &path, std::vector<intptr_t> &values) {
+    auto info = pe_info_get(path);
+    if (!info) {
+        return false;
     }
-
-    // get RVA
-    intptr_t rva = -1;
-    auto dll_dos = reinterpret_cast<PIMAGE_DOS_HEADER>(dll_file_base);
-    if (dll_dos->e_magic == IMAGE_DOS_SIGNATURE) {
-        auto dll_nt = reinterpret_cast<PIMAGE_NT_HEADERS>(reinterpret_cast<uint8_t *>(dll_dos) + dll_dos->e_lfanew);
-        rva = libutils::offset2rva(dll_nt, offset);
+    for (auto &value : values) {
+        value = pe_sections_translate(info->offset_to_rva, value);
     }
-
-    // clean up
-    UnmapViewOfFile(dll_file_base);
-    CloseHandle(dll_file);
-    CloseHandle(dll_mapping);
-
-    return rva;
+    return true;
 }
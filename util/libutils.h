@@ -3,6 +3,7 @@
 #include <filesystem>
 #include <initializer_list>
 #include <string>
+#include <vector>
 
 #include <windows.h>
 
@@ -69,9 +70,14 @@ namespace libutils {
         return reinterpret_cast<T>(try_proc_list(module, list));
     }
 
-    // offset helpers
+    // offset helpers, the section tables of files are parsed once and cached for the process
     intptr_t rva2offset(IMAGE_NT_HEADERS *nt_headers, intptr_t rva);
     intptr_t rva2offset(const std::filesystem::path &path, intptr_t rva);
     intptr_t offset2rva(IMAGE_NT_HEADERS *nt_headers, intptr_t offset);
     intptr_t offset2rva(const std::filesystem::path &path, intptr_t offset);
+
+    // batch offset helpers, converts all values in place (-1 if out of bounds)
+    // returns false if the file couldn't be read
+    bool rva2offset(const std::filesystem::path &path, std::vector<intptr_t> &values);
+    bool offset2rva(const std::filesystem::path &path, std::vector<intptr_t> &values);
 }
@@ -0,0 +1,416 @@
+#include "pixels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "util/cpuutils.h"
+#include "util/logging.h"
+#include "util/time.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define PIXELS_X86
+#include <immintrin.h>
+#endif
+
+// GCC/Clang need the extension enabled per function, MSVC accepts intrinsics everywhere
+#if defined(__GNUC__) || defined(__clang__)
+#define PIXELS_TARGET(x) __attribute__((target(x)))
+#else
+#define PIXELS_TARGET(x)
+#endif
+
+namespace pixels {
+
+    /*
+     * Swizzle
+     * Swap selects BGRX input, otherwise the input is RGBX and only the padding is dropped.
+     */
+
+    template<bool Swap>
+    static void swizzle_row_scalar(uint8_t *dst, const uint8_t *src, size_t width) {
+        for (size_t x = 0; x < width; x++) {
+            dst[0] = src[Swap ? 2 : 0];
+            dst[1] = src[1];
+            dst[2] = src[Swap ? 0 : 2];
+            dst += 3;
+            src += 4;
+        }
+    }
+
+#ifdef PIXELS_X86
+
+    template<bool Swap>
+    static PIXELS_TARGET("ssse3") void swizzle_row_ssse3(uint8_t *dst, const uint8_t *src, size_t width) {
+
+        // packs the 4 pixels of a register into its lower 12 bytes
+        const __m128i mask = Swap
+                ? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+                : _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+        // 16 pixels in, 3 full registers out
+        size_t x = 0;
+        for (; x + 16 <= width; x += 16) {
+            auto a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (src + 0)), mask);
+            auto b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (src + 16)), mask);
+            auto c = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (src + 32)), mask);
+            auto d = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (src + 48)), mask);
+            _mm_storeu_si128((__m128i *) (dst + 0), _mm_or_si128(a, _mm_slli_si128(b, 12)));
+            _mm_storeu_si128((__m128i *) (dst + 16), _mm_or_si128(_mm_srli_si128(b, 4), _mm_slli_si128(c, 8)));
+            _mm_storeu_si128((__m128i *) (dst + 32), _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(d, 4)));
+            dst += 48;
+            src += 64;
+        }
+
+        // remainder
+        swizzle_row_scalar<Swap>(dst, src, width - x);
+    }
+
+    template<bool Swap>
+    static PIXELS_TARGET("avx2") void swizzle_row_avx2(uint8_t *dst, const uint8_t *src, size_t width) {
+
+        // pshufb works per 128-bit lane, pack each lane to 12 bytes and then join the lanes
+        const __m256i mask = Swap
+                ? _mm256_setr_epi8(
+                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+                : _mm256_setr_epi8(
+                        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+        // 32 pixels per iteration, each store overlaps the unused tail of the previous one
+        size_t x = 0;
+        for (; x + 32 <= width; x += 32) {
+            auto a = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(
+                    _mm256_loadu_si256((const __m256i *) (src + 0)), mask), join);
+            auto b = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(
+                    _mm256_loadu_si256((const __m256i *) (src + 32)), mask), join);
+            auto c = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(
+                    _mm256_loadu_si256((const __m256i *) (src + 64)), mask), join);
+            auto d = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(
+                    _mm256_loadu_si256((const __m256i *) (src + 96)), mask), join);
+            _mm256_storeu_si256((__m256i *) (dst + 0), a);
+            _mm256_storeu_si256((__m256i *) (dst + 24), b);
+            _mm256_storeu_si256((__m256i *) (dst + 48), c);
+
+            // the last one must not write past the row
+            _mm_storeu_si128((__m128i *) (dst + 72), _mm256_castsi256_si128(d));
+            _mm_storel_epi64((__m128i *) (dst + 88), _mm256_extracti128_si256(d, 1));
+            dst += 96;
+            src += 128;
+        }
+
+        // remainder
+        swizzle_row_ssse3<Swap>(dst, src, width - x);
+    }
+
+#endif
+
+    template<bool Swap>
+    static void swizzle(Kernel kernel, uint8_t *dst, const uint8_t *src, size_t src_pitch,
+            size_t width, size_t height) {
+        for (size_t y = 0; y < height; y++) {
+            auto row = src + y * src_pitch;
+            auto out = dst + y * width * 3;
+            switch (kernel) {
+#ifdef PIXELS_X86
+                case Kernel::AVX2:
+                    swizzle_row_avx2<Swap>(out, row, width);
+                    break;
+                case Kernel::SSE:
+                    swizzle_row_ssse3<Swap>(out, row, width);
+                    break;
+#endif
+                default:
+                    swizzle_row_scalar<Swap>(out, row, width);
+                    break;
+            }
+        }
+    }
+
+    /*
+     * Box filter
+     * Rows of a block are summed into 16-bit column sums first, then the column sums of each
+     * block are added up and scaled. The 16-bit sums hold up to 257 rows.
+     */
+
+    static const size_t BOX_DIVIDE_SIMD_MAX = 257;
+
+    template<typename T>
+    static void accumulate_row_scalar(T *sums, const uint8_t *row, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            sums[i] += row[i];
+        }
+    }
+
+#ifdef PIXELS_X86
+
+    static PIXELS_TARGET("sse2") void accumulate_row_sse2(uint16_t *sums, const uint8_t *row, size_t count) {
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            auto v = _mm_loadu_si128((const __m128i *) (row + i));
+            auto lo = _mm_loadu_si128((const __m128i *) (sums + i));
+            auto hi = _mm_loadu_si128((const __m128i *) (sums + i + 8));
+            _mm_storeu_si128((__m128i *) (sums + i), _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero)));
+            _mm_storeu_si128((__m128i *) (sums + i + 8), _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero)));
+        }
+        accumulate_row_scalar(sums + i, row + i, count - i);
+    }
+
+    static PIXELS_TARGET("avx2") void accumulate_row_avx2(uint16_t *sums, const uint8_t *row, size_t count) {
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32) {
+            auto lo = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (row + i)));
+            auto hi = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (row + i + 16)));
+            auto sums_lo = _mm256_loadu_si256((const __m256i *) (sums + i));
+            auto sums_hi = _mm256_loadu_si256((const __m256i *) (sums + i + 16));
+            _mm256_storeu_si256((__m256i *) (sums + i), _mm256_add_epi16(sums_lo, lo));
+            _mm256_storeu_si256((__m256i *) (sums + i + 16), _mm256_add_epi16(sums_hi, hi));
+        }
+        accumulate_row_sse2(sums + i, row + i, count - i);
+    }
+
+#endif
+
+    // 32.32 fixed point reciprocal, rounded up so exact halves still round up after scaling
+    static inline uint64_t box_scale(size_t count) {
+        return ((1ull << 32) + count - 1) / count;
+    }
+
+    template<typename T, typename Sum, size_t Cols>
+    static void reduce_row(uint8_t *out, const T *sums, size_t width, size_t rows, size_t divide) {
+        auto cols = Cols ? Cols : divide;
+        auto width_full = width - width % cols;
+
+        // full blocks, power of two sizes can shift instead of scaling
+        auto count = rows * cols;
+        size_t shift = 0;
+        while (((size_t) 1 << shift) < count) {
+            shift++;
+        }
+        auto column = sums;
+        if (((size_t) 1 << shift) == count) {
+            auto half = (Sum) (count >> 1);
+            for (size_t x_start = 0; x_start < width_full; x_start += cols) {
+                Sum r = half, g = half, b = half;
+                for (size_t x = 0; x < cols; x++) {
+                    r += column[0];
+                    g += column[1];
+                    b += column[2];
+                    column += 3;
+                }
+                out[0] = (uint8_t) (r >> shift);
+                out[1] = (uint8_t) (g >> shift);
+                out[2] = (uint8_t) (b >> shift);
+                out += 3;
+            }
+        } else {
+            auto scale = box_scale(count);
+            for (size_t x_start = 0; x_start < width_full; x_start += cols) {
+                Sum r = 0, g = 0, b = 0;
+                for (size_t x = 0; x < cols; x++) {
+                    r += column[0];
+                    g += column[1];
+                    b += column[2];
+                    column += 3;
+                }
+                out[0] = (uint8_t) ((r * scale + (1ull << 31)) >> 32);
+                out[1] = (uint8_t) ((g * scale + (1ull << 31)) >> 32);
+                out[2] = (uint8_t) ((b * scale + (1ull << 31)) >> 32);
+                out += 3;
+            }
+        }
+
+        // partial block at the right edge
+        if (width_full < width) {
+            auto scale = box_scale(rows * (width - width_full));
+            Sum r = 0, g = 0, b = 0;
+            for (size_t x = width_full; x < width; x++) {
+                r += column[0];
+                g += column[1];
+                b += column[2];
+                column += 3;
+            }
+            out[0] = (uint8_t) ((r * scale + (1ull << 31)) >> 32);
+            out[1] = (uint8_t) ((g * scale + (1ull << 31)) >> 32);
+            out[2] = (uint8_t) ((b * scale + (1ull << 31)) >> 32);
+        }
+    }
+
+    template<typename T>
+    static void box_downscale(Kernel kernel, uint8_t *dst, const uint8_t *src,
+            size_t width, size_t height, size_t divide) {
+
+        // block sums must hold divide * divide * 255
+        typedef std::conditional_t<sizeof(T) == sizeof(uint16_t), uint32_t, uint64_t> Sum;
+
+        // column sums are kept per thread so repeated calls don't allocate
+        thread_local std::vector<T> sums;
+        auto stride = width * 3;
+        sums.resize(stride);
+        auto width_new = box_size(width, divide);
+        auto height_new = box_size(height, divide);
+
+        // pick the row accumulator
+        void (*accumulate)(T *, const uint8_t *, size_t) = accumulate_row_scalar<T>;
+#ifdef PIXELS_X86
+        if constexpr (sizeof(T) == sizeof(uint16_t)) {
+            if (kernel == Kernel::AVX2) {
+                accumulate = accumulate_row_avx2;
+            } else if (kernel == Kernel::SSE) {
+                accumulate = accumulate_row_sse2;
+            }
+        }
+#endif
+
+        for (size_t y_new = 0; y_new < height_new; y_new++) {
+
+            // vertical pass
+            auto y_start = y_new * divide;
+            auto rows = std::min(divide, height - y_start);
+            memset(sums.data(), 0, stride * sizeof(T));
+            for (size_t y = y_start; y < y_start + rows; y++) {
+                accumulate(sums.data(), src + y * stride, stride);
+            }
+
+            // horizontal pass, the common factors get unrolled loops
+            auto out = dst + y_new * width_new * 3;
+            switch (divide) {
+                case 2:
+                    reduce_row<T, Sum, 2>(out, sums.data(), width, rows, divide);
+                    break;
+                case 3:
+                    reduce_row<T, Sum, 3>(out, sums.data(), width, rows, divide);
+                    break;
+                case 4:
+                    reduce_row<T, Sum, 4>(out, sums.data(), width, rows, divide);
+                    break;
+                default:
+                    reduce_row<T, Sum, 0>(out, sums.data(), width, rows, divide);
+                    break;
+            }
+        }
+    }
+
+    /*
+     * Public interface
+     */
+
+    Kernel get_kernel() {
+        static const Kernel kernel = [] {
+#ifdef PIXELS_X86
+            if (cpuutils::has_avx2()) {
+                return Kernel::AVX2;
+            }
+            if (cpuutils::has_ssse3()) {
+                return Kernel::SSE;
+            }
+#endif
+            return Kernel::Scalar;
+        }();
+        return kernel;
+    }
+
+    const char *get_kernel_name(Kernel kernel) {
+        switch (kernel) {
+            case Kernel::AVX2:
+                return "avx2";
+            case Kernel::SSE:
+                return "sse";
+            case Kernel::Scalar:
+            default:
+                return "scalar";
+        }
+    }
+
+    void bgrx_to_rgb(Kernel kernel, uint8_t *dst, const uint8_t *src, size_t src_pitch,
+            size_t width, size_t height) {
+        swizzle<true>(kernel, dst, src, src_pitch, width, height);
+    }
+
+    void bgrx_to_rgb(uint8_t *dst, const uint8_t *src, size_t src_pitch, size_t width, size_t height) {
+        swizzle<true>(get_kernel(), dst, src, src_pitch, width, height);
+    }
+
+    void rgbx_to_rgb(uint8_t *dst, const uint8_t *src, size_t src_pitch, size_t width, size_t height) {
+        swizzle<false>(get_kernel(), dst, src, src_pitch, width, height);
+    }
+
+    void rgb_to_rgb(uint8_t *dst, const uint8_t *src, size_t src_pitch, size_t width, size_t height) {
+        auto stride = width * 3;
+        if (src_pitch == stride) {
+            memcpy(dst, src, stride * height);
+            return;
+        }
+        for (size_t y = 0; y < height; y++) {
+            memcpy(dst + y * stride, src + y * src_pitch, stride);
+        }
+    }
+
+    void box_downscale_rgb(Kernel kernel, uint8_t *dst, const uint8_t *src,
+            size_t width, size_t height, size_t divide) {
+        if (divide <= 1) {
+            memcpy(dst, src, width * height * 3);
+        } else if (divide <= BOX_DIVIDE_SIMD_MAX) {
+            box_downscale<uint16_t>(kernel, dst, src, width, height, divide);
+        } else {
+            box_downscale<uint32_t>(kernel, dst, src, width, height, divide);
+        }
+    }
+
+    void box_downscale_rgb(uint8_t *dst, const uint8_t *src, size_t width, size_t height, size_t divide) {
+        box_downscale_rgb(get_kernel(), dst, src, width, height, divide);
+    }
+
+    void benchmark() {
+        const size_t width = 1920;
+        const size_t height = 1080;
+        const int iterations = 100;
+
+        // test frame with a bit of structure so the box filter has something to average
+        std::vector<uint8_t> frame(width * height * 4);
+        for (size_t i = 0; i < frame.size(); i++) {
+            frame[i] = (uint8_t) ((i * 7) ^ (i >> 11));
+        }
+        std::vector<uint8_t> rgb(width * height * 3);
+        std::vector<uint8_t> rgb_reference(width * height * 3);
+        std::vector<uint8_t> small(box_size(width, 2) * box_size(height, 2) * 3);
+        std::vector<uint8_t> small_reference(small.size());
+        bgrx_to_rgb(Kernel::Scalar, rgb_reference.data(), frame.data(), width * 4, width, height);
+        box_downscale_rgb(Kernel::Scalar, small_reference.data(), rgb_reference.data(), width, height, 2);
+
+        log_info("pixels", "benchmarking {}x{}, {} iterations, best kernel: {}",
+                width, height, iterations, get_kernel_name(get_kernel()));
+        for (auto kernel : { Kernel::Scalar, Kernel::SSE, Kernel::AVX2 }) {
+            if (kernel > get_kernel()) {
+                break;
+            }
+
+            // swizzle
+            auto time_start = get_performance_milliseconds();
+            for (int i = 0; i < iterations; i++) {
+                bgrx_to_rgb(kernel, rgb.data(), frame.data(), width * 4, width, height);
+            }
+            auto time_swizzle = (get_performance_milliseconds() - time_start) / iterations;
+            if (rgb != rgb_reference) {
+                log_warning("pixels", "{} swizzle output does not match scalar", get_kernel_name(kernel));
+            }
+
+            // box filter
+            time_start = get_performance_milliseconds();
+            for (int i = 0; i < iterations; i++) {
+                box_downscale_rgb(kernel, small.data(), rgb.data(), width, height, 2);
+            }
+            auto time_box = (get_performance_milliseconds() - time_start) / iterations;
+            if (small != small_reference) {
+                log_warning("pixels", "{} box filter output does not match scalar", get_kernel_name(kernel));
+            }
+
+            log_info("pixels", "{}: bgrx_to_rgb {:.3f} ms, box_downscale_rgb/2 {:.3f} ms",
+                    get_kernel_name(kernel), time_swizzle, time_box);
+        }
+    }
+}
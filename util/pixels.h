@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Pixel conversion kernels used by the frame capture.
+ *
+ * Every function uses the widest implementation supported by the CPU (AVX2, SSE or scalar),
+ * which is picked on first use. Destination images are packed 24-bit RGB without row padding.
+ */
+namespace pixels {
+
+    enum class Kernel {
+        Scalar,
+        SSE,
+        AVX2,
+    };
+
+    // fastest kernel supported on this machine
+    Kernel get_kernel();
+    const char *get_kernel_name(Kernel kernel);
+
+    // 32-bit BGRX/BGRA rows (D3DFMT_X8R8G8B8, D3DFMT_A8R8G8B8) to RGB
+    void bgrx_to_rgb(uint8_t *dst, const uint8_t *src, size_t src_pitch, size_t width, size_t height);
+
+    // 32-bit RGBX/RGBA rows (D3DFMT_X8B8G8R8, D3DFMT_A8B8G8R8) to RGB
+    void rgbx_to_rgb(uint8_t *dst, const uint8_t *src, size_t src_pitch, size_t width, size_t height);
+
+    // 24-bit rows to RGB
+    void rgb_to_rgb(uint8_t *dst, const uint8_t *src, size_t src_pitch, size_t width, size_t height);
+
+    // output size of the box filter, partial blocks at the right/bottom edge are kept
+    inline size_t box_size(size_t size, size_t divide) {
+        return divide > 1 ? (size + divide - 1) / divide : size;
+    }
+
+    // averages each divide x divide block of an RGB image into one pixel
+    void box_downscale_rgb(uint8_t *dst, const uint8_t *src, size_t width, size_t height, size_t divide);
+
+    // same as above with an explicit kernel, used for benchmarking
+    void bgrx_to_rgb(Kernel kernel, uint8_t *dst, const uint8_t *src, size_t src_pitch,
+            size_t width, size_t height);
+    void box_downscale_rgb(Kernel kernel, uint8_t *dst, const uint8_t *src,
+            size_t width, size_t height, size_t divide);
+
+    // times all supported kernels on a 1080p frame and logs the results
+    void benchmark();
+}
@@ -1,82 +1,821 @@
 #include "sigscan.h"
 
+#include <cstring>
+#include <filesystem>
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 #include <vector>
 
+#include "external/rapidjson/document.h"
+#include "external/rapidjson/stringbuffer.h"
+#include "external/rapidjson/writer.h"
+
+#include "util/cpuutils.h"
+#include "util/fileutils.h"
 #include "util/logging.h"
 #include "util/memutils.h"
+#include "util/time.h"
 #include "util/utils.h"
 
-intptr_t find_pattern(std::vector<uint8_t> &data, intptr_t base, const uint8_t *pattern,
-        const char *mask, intptr_t offset, intptr_t usage)
-{
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define SIGSCAN_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
 
-    // build pattern
-    std::vector<std::pair<uint8_t, bool>> pattern_vector;
-    size_t mask_size = strlen(mask);
-    for (size_t i = 0; i < mask_size; i++) {
-        pattern_vector.emplace_back(pattern[i], mask[i] == 'X');
+// GCC/Clang need the extension enabled per function, MSVC accepts intrinsics everywhere
+#if defined(__GNUC__) || defined(__clang__)
+#define SIGSCAN_TARGET(x) __attribute__((target(x)))
+#else
+#define SIGSCAN_TARGET(x)
+#endif
+
+namespace {
+
+    // one out of this many bytes is sampled for estimating byte frequencies
+    const size_t SAMPLE_STRIDE = 61;
+
+    // distinct anchor bytes compared directly, more are looked up in a bit set
+    const size_t FILTER_BYTES_MAX = 4;
+
+    enum class Kernel {
+        Scalar,
+        SSE,
+        AVX2,
+    };
+
+    Kernel get_kernel() {
+        static const Kernel kernel = [] {
+            if (cpuutils::has_avx2()) {
+                return Kernel::AVX2;
+            }
+            if (cpuutils::has_ssse3()) {
+                return Kernel::SSE;
+            }
+            return Kernel::Scalar;
+        }();
+        return kernel;
+    }
+
+    const char *get_kernel_name(Kernel kernel) {
+        switch (kernel) {
+            case Kernel::AVX2:
+                return "AVX2";
+            case Kernel::SSE:
+                return "SSE";
+            default:
+                return "scalar";
+        }
     }
 
-    // the scan loop
-    auto data_begin = data.begin();
-    auto cur_usage = 0;
-    while (true) {
+    inline unsigned int bit_scan(uint32_t mask) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return (unsigned int) index;
+#else
+        return (unsigned int) __builtin_ctz(mask);
+#endif
+    }
 
-        // search for the pattern
-        auto search_result = std::search(data_begin, data.end(), pattern_vector.begin(), pattern_vector.end(),
-                               [&](uint8_t c, std::pair<uint8_t, bool> pat) {
-                                   return (!pat.second) || c == pat.first;
-                               });
+    /*
+     * Single pass scanner for a set of patterns.
+     * Every pattern is anchored at its rarest fixed byte. The scan only stops at bytes which anchor
+     * at least one pattern and then compares those patterns around the anchor, so the cost barely
+     * depends on the number of patterns. Matches are counted in address order to support usage.
+     *
+     * The SIMD kernels test 16/32 positions at once for anchor bytes. A single pattern is filtered
+     * on its two rarest bytes, a few anchor bytes are compared directly and larger sets are looked
+     * up in a 256 bit set with pshufb.
+     */
+    class Scanner {
+    public:
 
-        // check for a match
-        if (search_result != data.end()) {
+        explicit Scanner(std::vector<SigScanPattern> &patterns, Kernel kernel = get_kernel())
+            : patterns(patterns), states(patterns.size()), remaining(patterns.size()), kernel(kernel) {
+            for (auto &pattern : patterns) {
+                pattern.result = 0;
+            }
+        }
 
-            // return the result if we hit the usage count
-            if (cur_usage == usage) {
-                return (std::distance(data.begin(), search_result) + base) + offset;
+        void sample(const uint8_t *data, size_t size) {
+            for (size_t i = 0; i < size; i += SAMPLE_STRIDE) {
+                histogram[data[i]]++;
             }
+        }
 
-            // increment the found count
-            ++cur_usage;
-            data_begin = ++search_result;
+        void prepare() {
+
+            // pick the rarest fixed byte of each pattern
+            std::vector<std::pair<uint8_t, Anchor>> anchor_list;
+            for (size_t i = 0; i < patterns.size(); i++) {
+                auto &pattern = patterns[i];
+                auto &state = states[i];
+                state.size = MIN(pattern.mask.size(), pattern.data.size());
+                for (size_t j = 0; j < state.size; j++) {
+                    if (pattern.mask[j] != 'X') {
+                        continue;
+                    }
+                    state.checks.push_back((uint32_t) j);
+                    if (!state.anchored || histogram[pattern.data[j]] < histogram[pattern.data[state.anchor]]) {
+                        state.anchor = (uint32_t) j;
+                        state.anchored = true;
+                    }
+                }
+                if (state.anchored) {
+                    anchor_list.emplace_back(pattern.data[state.anchor], Anchor {
+                        .pattern = (uint32_t) i,
+                        .position = state.anchor,
+                    });
+                }
+            }
+
+            // group anchors by byte
+            std::stable_sort(anchor_list.begin(), anchor_list.end(), [] (auto &a, auto &b) {
+                return a.first < b.first;
+            });
+            anchors.reserve(anchor_list.size());
+            for (auto &entry : anchor_list) {
+                if (anchors_end[entry.first + 1] == 0) {
+                    anchor_bytes.push_back(entry.first);
+                }
+                anchors.push_back(entry.second);
+                anchors_end[entry.first + 1] = anchors.size();
+            }
+            for (size_t i = 1; i < 257; i++) {
+                anchors_end[i] = MAX(anchors_end[i], anchors_end[i - 1]);
+            }
+
+            // a single pattern is also filtered on its second rarest byte
+            if (anchors.size() == 1) {
+                auto &pattern = patterns[anchors[0].pattern];
+                auto &state = states[anchors[0].pattern];
+                bool found = false;
+                size_t second = 0;
+                for (auto check : state.checks) {
+                    if (check != state.anchor
+                    && (!found || histogram[pattern.data[check]] < histogram[pattern.data[second]])) {
+                        second = check;
+                        found = true;
+                    }
+                }
+                if (found) {
+                    filter_second = true;
+                    filter_second_byte = pattern.data[second];
+                    filter_second_delta = (ptrdiff_t) second - (ptrdiff_t) state.anchor;
+                }
+            }
+
+            // bit set indexed by the low nibble, each row holds one bit per high nibble
+            for (auto byte : anchor_bytes) {
+                auto &row = byte < 0x80 ? filter_set_low[byte & 0xF] : filter_set_high[byte & 0xF];
+                row |= (uint8_t) (1u << ((byte >> 4) & 7));
+            }
+        }
+
+        // scans a contiguous block, match counts carry over between calls
+        void scan(const uint8_t *data, size_t size, intptr_t base) {
+
+            // patterns without fixed bytes match everywhere
+            for (size_t i = 0; i < patterns.size(); i++) {
+                auto &state = states[i];
+                if (state.anchored || state.done) {
+                    continue;
+                }
+                size_t positions = size >= state.size ? size - state.size + 1 : 0;
+                if (patterns[i].usage >= 0 && (size_t) (patterns[i].usage - state.matches) < positions) {
+                    found(i, base + (patterns[i].usage - state.matches));
+                } else {
+                    state.matches += positions;
+                }
+            }
+            if (anchors.empty() || remaining == 0) {
+                return;
+            }
+
+            // run kernel
+            switch (kernel) {
+#ifdef SIGSCAN_X86
+                case Kernel::AVX2:
+                    if (filter_second) {
+                        return scan_avx2<Filter::Second>(data, size, base);
+                    } else if (anchor_bytes.size() <= FILTER_BYTES_MAX) {
+                        return scan_avx2<Filter::Bytes>(data, size, base);
+                    } else {
+                        return scan_avx2<Filter::Set>(data, size, base);
+                    }
+                case Kernel::SSE:
+                    if (filter_second) {
+                        return scan_sse<Filter::Second>(data, size, base);
+                    } else if (anchor_bytes.size() <= FILTER_BYTES_MAX) {
+                        return scan_sse<Filter::Bytes>(data, size, base);
+                    } else {
+                        return scan_sse<Filter::Set>(data, size, base);
+                    }
+#endif
+                default:
+                    return scan_scalar(data, size, base);
+            }
+        }
+
+        size_t found_count() {
+            return patterns.size() - remaining;
+        }
+
+        bool finished() {
+            return remaining == 0;
+        }
+
+    private:
+
+        enum class Filter {
+            Second,
+            Bytes,
+            Set,
+        };
+
+        struct Anchor {
+            uint32_t pattern;
+            uint32_t position;
+        };
+
+        struct State {
+            size_t size = 0;
+            std::vector<uint32_t> checks;
+            uint32_t anchor = 0;
+            bool anchored = false;
+            intptr_t matches = 0;
+            bool done = false;
+        };
+
+        std::vector<SigScanPattern> &patterns;
+        std::vector<State> states;
+        size_t remaining;
+        Kernel kernel;
+
+        size_t histogram[256] {};
+        std::vector<Anchor> anchors;
+        size_t anchors_end[257] {};
+        std::vector<uint8_t> anchor_bytes;
+
+        // candidate filters
+        bool filter_second = false;
+        uint8_t filter_second_byte = 0;
+        ptrdiff_t filter_second_delta = 0;
+        uint8_t filter_set_low[16] {};
+        uint8_t filter_set_high[16] {};
+
+        bool compare(size_t pattern, const uint8_t *data) {
+            auto &pattern_data = patterns[pattern].data;
+            for (auto check : states[pattern].checks) {
+                if (data[check] != pattern_data[check]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void found(size_t pattern, intptr_t address) {
+            patterns[pattern].result = address + patterns[pattern].offset;
+            states[pattern].done = true;
+            remaining--;
+        }
+
+        // checks all patterns anchored at a position
+        void check(const uint8_t *data, size_t size, intptr_t base, size_t position) {
+            auto byte = data[position];
+            for (size_t i = anchors_end[byte]; i < anchors_end[byte + 1]; i++) {
+                auto &anchor = anchors[i];
+                auto &state = states[anchor.pattern];
+                if (state.done || position < anchor.position) {
+                    continue;
+                }
+                size_t start = position - anchor.position;
+                if (start + state.size > size || !compare(anchor.pattern, data + start)) {
+                    continue;
+                }
+                if (state.matches++ == patterns[anchor.pattern].usage) {
+                    found(anchor.pattern, base + start);
+                }
+            }
+        }
+
+        // range of positions the vector loads of a filter stay within the data
+        void filter_range(size_t size, size_t &begin, size_t &end) {
+            begin = 0;
+            end = size;
+            if (filter_second) {
+                if (filter_second_delta < 0) {
+                    begin = MIN(size, (size_t) -filter_second_delta);
+                } else {
+                    end = size - MIN(size, (size_t) filter_second_delta);
+                }
+            }
+        }
+
+        void scan_scalar(const uint8_t *data, size_t size, intptr_t base) {
+            auto cur = data;
+            auto end = data + size;
+            bool single = anchor_bytes.size() == 1;
+            while (cur < end && remaining > 0) {
+
+                // skip to next anchor byte
+                if (single) {
+                    cur = reinterpret_cast<const uint8_t *>(memchr(cur, anchor_bytes[0], end - cur));
+                    if (!cur) {
+                        break;
+                    }
+                } else if (anchors_end[*cur] == anchors_end[*cur + 1]) {
+                    cur++;
+                    continue;
+                }
+
+                check(data, size, base, cur - data);
+                cur++;
+            }
+        }
+
+#ifdef SIGSCAN_X86
+
+        template<Filter F>
+        SIGSCAN_TARGET("ssse3") void scan_sse(const uint8_t *data, size_t size, intptr_t base) {
+
+            // filter constants
+            __m128i bytes[FILTER_BYTES_MAX];
+            for (size_t i = 0; i < FILTER_BYTES_MAX; i++) {
+                bytes[i] = _mm_set1_epi8((char) anchor_bytes[MIN(i, anchor_bytes.size() - 1)]);
+            }
+            const __m128i second = _mm_set1_epi8((char) filter_second_byte);
+            const __m128i set_low = _mm_loadu_si128((const __m128i *) filter_set_low);
+            const __m128i set_high = _mm_loadu_si128((const __m128i *) filter_set_high);
+            const __m128i set_bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+            const __m128i nibble = _mm_set1_epi8(0x0F);
+
+            // positions before the filter range
+            size_t begin, end;
+            filter_range(size, begin, end);
+            size_t position = 0;
+            for (; position < begin && remaining > 0; position++) {
+                check(data, size, base, position);
+            }
+
+            // 16 positions at once
+            for (; position + 16 <= end && remaining > 0; position += 16) {
+                auto block = _mm_loadu_si128((const __m128i *) (data + position));
+                __m128i hits;
+                if constexpr (F == Filter::Second) {
+                    auto block_second = _mm_loadu_si128((const __m128i *) (data + position + filter_second_delta));
+                    hits = _mm_and_si128(_mm_cmpeq_epi8(block, bytes[0]), _mm_cmpeq_epi8(block_second, second));
+                } else if constexpr (F == Filter::Bytes) {
+                    hits = _mm_or_si128(
+                            _mm_or_si128(_mm_cmpeq_epi8(block, bytes[0]), _mm_cmpeq_epi8(block, bytes[1])),
+                            _mm_or_si128(_mm_cmpeq_epi8(block, bytes[2]), _mm_cmpeq_epi8(block, bytes[3])));
+                } else {
+                    auto low = _mm_and_si128(block, nibble);
+                    auto high = _mm_and_si128(_mm_srli_epi16(block, 4), nibble);
+                    auto upper = _mm_cmplt_epi8(block, _mm_setzero_si128());
+                    auto row = _mm_or_si128(
+                            _mm_andnot_si128(upper, _mm_shuffle_epi8(set_low, low)),
+                            _mm_and_si128(upper, _mm_shuffle_epi8(set_high, low)));
+                    auto bit = _mm_shuffle_epi8(set_bits, high);
+                    hits = _mm_cmpeq_epi8(_mm_and_si128(row, bit), bit);
+                }
+                auto mask = (uint32_t) _mm_movemask_epi8(hits);
+                while (mask) {
+                    check(data, size, base, position + bit_scan(mask));
+                    mask &= mask - 1;
+                }
+            }
+
+            // remainder
+            for (; position < size && remaining > 0; position++) {
+                check(data, size, base, position);
+            }
+        }
+
+        template<Filter F>
+        SIGSCAN_TARGET("avx2") void scan_avx2(const uint8_t *data, size_t size, intptr_t base) {
+
+            // filter constants
+            __m256i bytes[FILTER_BYTES_MAX];
+            for (size_t i = 0; i < FILTER_BYTES_MAX; i++) {
+                bytes[i] = _mm256_set1_epi8((char) anchor_bytes[MIN(i, anchor_bytes.size() - 1)]);
+            }
+            const __m256i second = _mm256_set1_epi8((char) filter_second_byte);
+            const __m256i set_low = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) filter_set_low));
+            const __m256i set_high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) filter_set_high));
+            const __m256i set_bits = _mm256_setr_epi8(
+                    1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                    1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+            const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+            // positions before the filter range
+            size_t begin, end;
+            filter_range(size, begin, end);
+            size_t position = 0;
+            for (; position < begin && remaining > 0; position++) {
+                check(data, size, base, position);
+            }
+
+            // 32 positions at once
+            for (; position + 32 <= end && remaining > 0; position += 32) {
+                auto block = _mm256_loadu_si256((const __m256i *) (data + position));
+                __m256i hits;
+                if constexpr (F == Filter::Second) {
+                    auto block_second = _mm256_loadu_si256((const __m256i *) (data + position + filter_second_delta));
+                    hits = _mm256_and_si256(
+                            _mm256_cmpeq_epi8(block, bytes[0]),
+                            _mm256_cmpeq_epi8(block_second, second));
+                } else if constexpr (F == Filter::Bytes) {
+                    hits = _mm256_or_si256(
+                            _mm256_or_si256(_mm256_cmpeq_epi8(block, bytes[0]), _mm256_cmpeq_epi8(block, bytes[1])),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(block, bytes[2]), _mm256_cmpeq_epi8(block, bytes[3])));
+                } else {
+                    auto low = _mm256_and_si256(block, nibble);
+                    auto high = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble);
+                    auto upper = _mm256_cmpgt_epi8(_mm256_setzero_si256(), block);
+                    auto row = _mm256_blendv_epi8(
+                            _mm256_shuffle_epi8(set_low, low),
+                            _mm256_shuffle_epi8(set_high, low),
+                            upper);
+                    auto bit = _mm256_shuffle_epi8(set_bits, high);
+                    hits = _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit);
+                }
+                auto mask = (uint32_t) _mm256_movemask_epi8(hits);
+                while (mask) {
+                    check(data, size, base, position + bit_scan(mask));
+                    mask &= mask - 1;
+                }
+            }
+
+            // remainder
+            for (; position < size && remaining > 0; position++) {
+                check(data, size, base, position);
+            }
+        }
+
+#endif
+    };
+}
+
+bool parse_pattern(const std::string &signature, std::vector<uint8_t> &data, std::string &mask) {
+    if (signature.length() % 2) {
+        return false;
+    }
+
+    // build pattern
+    std::string pattern_str(signature);
+    strreplace(pattern_str, "??", "00");
+    data.resize(signature.length() / 2);
+    if (!hex2bin(pattern_str.c_str(), data.data())) {
+        return false;
+    }
+
+    // build mask
+    mask.clear();
+    for (size_t i = 0; i < signature.length(); i += 2) {
+        if (signature[i] == '?') {
+            if (signature[i + 1] == '?') {
+                mask += '?';
+            } else {
+                return false;
+            }
         } else {
-            break;
+            mask += 'X';
+        }
+    }
+    return true;
+}
+
+namespace {
+
+    /*
+     * Scan results for loaded modules, stored next to the patch manager config.
+     * Entries are keyed by module build and pattern and hold the RVA of the match.
+     * Hits are verified to still be the requested occurrence before they are used, so a stale entry
+     * only costs a scan. Misses aren't stored since patches applied at runtime can hide a signature
+     * which is there on a clean image. Changes are only marked dirty and written out by
+     * sigscan_cache_flush.
+     */
+    std::mutex SCAN_CACHE_M;
+    bool SCAN_CACHE_LOADED = false;
+    bool SCAN_CACHE_DIRTY = false;
+    std::unordered_map<std::string, std::unordered_map<std::string, uint32_t>> SCAN_CACHE;
+
+    std::filesystem::path scan_cache_path() {
+        auto appdata = getenv("APPDATA");
+        if (!appdata) {
+            return {};
         }
+        return std::filesystem::path(appdata) / "spicetools_sigscan_cache.json";
     }
 
-    return 0;
+    void scan_cache_load() {
+        SCAN_CACHE_LOADED = true;
+
+        // read file
+        auto path = scan_cache_path();
+        if (path.empty() || !fileutils::file_exists(path)) {
+            return;
+        }
+        auto text = fileutils::text_read(path);
+
+        // parse document
+        rapidjson::Document doc;
+        doc.Parse(text.c_str());
+        if (doc.HasParseError() || !doc.IsObject()) {
+            log_warning("sigscan", "ignoring invalid scan cache {}", path.string());
+            return;
+        }
+
+        // read entries
+        for (auto module = doc.MemberBegin(); module != doc.MemberEnd(); module++) {
+            if (!module->value.IsObject()) {
+                continue;
+            }
+            auto &entries = SCAN_CACHE[module->name.GetString()];
+            for (auto entry = module->value.MemberBegin(); entry != module->value.MemberEnd(); entry++) {
+                if (entry->value.IsUint()) {
+                    entries[entry->name.GetString()] = entry->value.GetUint();
+                }
+            }
+        }
+    }
+
+    void scan_cache_save() {
+        auto path = scan_cache_path();
+        if (path.empty()) {
+            return;
+        }
+
+        // build document
+        rapidjson::Document doc;
+        doc.SetObject();
+        auto &allocator = doc.GetAllocator();
+        for (auto &[module_hash, entries] : SCAN_CACHE) {
+            rapidjson::Value module(rapidjson::kObjectType);
+            for (auto &[key, rva] : entries) {
+                module.AddMember(rapidjson::Value(key.c_str(), allocator), rapidjson::Value(rva), allocator);
+            }
+            doc.AddMember(rapidjson::Value(module_hash.c_str(), allocator), module, allocator);
+        }
+
+        // write to a temporary file and replace the cache with it
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        doc.Accept(writer);
+        auto temp_path = path;
+        temp_path += ".tmp";
+        bool success = fileutils::text_write(temp_path, buffer.GetString());
+        if (success) {
+            success = MoveFileExA(temp_path.string().c_str(), path.string().c_str(),
+                    MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+        }
+        if (!success) {
+            log_warning("sigscan", "unable to save scan cache to {}", path.string());
+        }
+    }
+
+    // identifies a module build by its name and the timestamp, checksum and size from its PE header
+    std::string module_hash(HMODULE module) {
+        auto dos = reinterpret_cast<const IMAGE_DOS_HEADER *>(module);
+        auto nt = reinterpret_cast<const IMAGE_NT_HEADERS *>(reinterpret_cast<const uint8_t *>(module) + dos->e_lfanew);
+        char name[MAX_PATH] {};
+        GetModuleBaseNameA(GetCurrentProcess(), module, name, sizeof(name));
+        return fmt::format("{}:{:08x}:{:08x}:{:08x}",
+                name,
+                nt->FileHeader.TimeDateStamp,
+                nt->OptionalHeader.CheckSum,
+                nt->OptionalHeader.SizeOfImage);
+    }
+
+    // pattern as hex with wildcards, the offset isn't part of it since it's applied after the scan
+    std::string pattern_key(const SigScanPattern &pattern) {
+        std::string key;
+        auto size = MIN(pattern.data.size(), pattern.mask.size());
+        key.reserve(size * 2 + 8);
+        for (size_t i = 0; i < size; i++) {
+            key += pattern.mask[i] == 'X' ? bin2hex(pattern.data[i]) : "??";
+        }
+        key += '/';
+        key += std::to_string(pattern.usage);
+        return key;
+    }
+
+    size_t find_patterns(Kernel kernel, const uint8_t *data, size_t size, intptr_t base,
+            std::vector<SigScanPattern> &patterns) {
+        Scanner scanner(patterns, kernel);
+        scanner.sample(data, size);
+        scanner.prepare();
+        scanner.scan(data, size, base);
+        return scanner.found_count();
+    }
 }
 
-intptr_t find_pattern(HMODULE module, const uint8_t *pattern, const char *mask,
-        intptr_t offset, intptr_t result_usage)
-{
+size_t find_patterns(const uint8_t *data, size_t size, intptr_t base, std::vector<SigScanPattern> &patterns) {
+    return find_patterns(get_kernel(), data, size, base, patterns);
+}
+
+size_t find_patterns(HMODULE module, std::vector<SigScanPattern> &patterns) {
+    for (auto &pattern : patterns) {
+        pattern.result = 0;
+    }
+
     // get module information
     MODULEINFO module_info {};
     if (!GetModuleInformation(GetCurrentProcess(), module, &module_info, sizeof(module_info))) {
         return 0;
     }
 
-    auto size = static_cast<size_t>(module_info.SizeOfImage);
+    // collect readable memory, adjacent regions are merged so patterns can cross them
+    std::vector<std::pair<const uint8_t *, size_t>> spans;
+    auto cur = reinterpret_cast<const uint8_t *>(module_info.lpBaseOfDll);
+    auto end = cur + module_info.SizeOfImage;
+    while (cur < end) {
+        MEMORY_BASIC_INFORMATION info {};
+        if (!VirtualQuery(cur, &info, sizeof(info))) {
+            break;
+        }
+        auto region_end = MIN(end, reinterpret_cast<const uint8_t *>(info.BaseAddress) + info.RegionSize);
+        const DWORD readable = PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY
+                | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+        if (info.State == MEM_COMMIT && (info.Protect & readable) && !(info.Protect & PAGE_GUARD)) {
+            if (!spans.empty() && spans.back().first + spans.back().second == cur) {
+                spans.back().second += region_end - cur;
+            } else {
+                spans.emplace_back(cur, region_end - cur);
+            }
+        }
+        cur = region_end;
+    }
+    if (spans.empty()) {
+        return 0;
+    }
 
-    try {
+    // look up cached results
+    auto base = reinterpret_cast<const uint8_t *>(module_info.lpBaseOfDll);
+    auto hash = module_hash(module);
+    std::vector<std::string> keys;
+    std::vector<size_t> cached;
+    std::vector<uint32_t> cached_rvas;
+    std::vector<size_t> missing;
+    std::vector<SigScanPattern> verify_patterns;
+    const uint8_t *verify_end = base;
+    {
+        std::lock_guard<std::mutex> lock(SCAN_CACHE_M);
+        if (!SCAN_CACHE_LOADED) {
+            scan_cache_load();
+        }
+        auto &entries = SCAN_CACHE[hash];
+        for (size_t i = 0; i < patterns.size(); i++) {
+            auto &pattern = patterns[i];
+            keys.emplace_back(pattern_key(pattern));
+            auto entry = entries.find(keys.back());
+            auto size = MIN(pattern.data.size(), pattern.mask.size());
+            if (entry == entries.end() || entry->second + size > module_info.SizeOfImage) {
+                missing.push_back(i);
+            } else {
+                cached.push_back(i);
+                cached_rvas.push_back(entry->second);
+                verify_patterns.push_back(pattern);
+                verify_patterns.back().offset = 0;
+                verify_end = MAX(verify_end, base + entry->second + size);
+            }
+        }
+    }
 
-        // copy data
-        std::vector<uint8_t> data(size);
-        memcpy(data.data(), module_info.lpBaseOfDll, size);
+    // rescan up to the cached hits to make sure they still are the requested occurrence
+    std::vector<std::pair<size_t, intptr_t>> updates;
+    if (!verify_patterns.empty()) {
+        std::vector<std::pair<const uint8_t *, size_t>> verify_spans;
+        for (auto &span : spans) {
+            if (span.first < verify_end) {
+                verify_spans.emplace_back(span.first, MIN(span.second, (size_t) (verify_end - span.first)));
+            }
+        }
+        Scanner scanner(verify_patterns);
+        for (auto &span : verify_spans) {
+            scanner.sample(span.first, span.second);
+        }
+        scanner.prepare();
+        for (auto &span : verify_spans) {
+            if (scanner.finished()) {
+                break;
+            }
+            scanner.scan(span.first, span.second, reinterpret_cast<intptr_t>(span.first));
+        }
+        for (size_t i = 0; i < cached.size(); i++) {
+            auto &pattern = patterns[cached[i]];
+            auto result = verify_patterns[i].result;
+            if (!result) {
 
-        // find pattern
-        return find_pattern(
-                data,
-                reinterpret_cast<intptr_t>(module_info.lpBaseOfDll),
-                pattern,
-                mask,
-                offset,
-                result_usage);
-    } catch (const std::bad_alloc &e) {
-        log_warning("sigscan", "failed to allocate buffer of size {} for image data", size);
-        return false;
+                // the cached match is gone, so the occurrence has to be searched for again
+                // the entry is kept though, the image might just be patched right now
+                missing.push_back(cached[i]);
+                continue;
+            }
+            if (result != reinterpret_cast<intptr_t>(base + cached_rvas[i])) {
+
+                // an earlier occurrence showed up, which shifts the requested one
+                updates.emplace_back(cached[i], result);
+            }
+            pattern.result = result + pattern.offset;
+        }
+    }
+
+    // scan in place for the rest
+    std::vector<SigScanPattern> scan_patterns;
+    for (auto index : missing) {
+        scan_patterns.push_back(patterns[index]);
+    }
+    if (!scan_patterns.empty()) {
+        Scanner scanner(scan_patterns);
+        for (auto &span : spans) {
+            scanner.sample(span.first, span.second);
+        }
+        scanner.prepare();
+        for (auto &span : spans) {
+            if (scanner.finished()) {
+                break;
+            }
+            scanner.scan(span.first, span.second, reinterpret_cast<intptr_t>(span.first));
+        }
+        for (size_t i = 0; i < missing.size(); i++) {
+            auto &pattern = scan_patterns[i];
+            patterns[missing[i]].result = pattern.result;
+            if (pattern.result) {
+                updates.emplace_back(missing[i], pattern.result - pattern.offset);
+            }
+        }
     }
+
+    // remember hits
+    if (!updates.empty()) {
+        std::lock_guard<std::mutex> lock(SCAN_CACHE_M);
+        auto &entries = SCAN_CACHE[hash];
+        for (auto &[index, address] : updates) {
+            auto value = (uint32_t) (address - reinterpret_cast<intptr_t>(base));
+            auto entry = entries.find(keys[index]);
+            if (entry == entries.end() || entry->second != value) {
+                entries[keys[index]] = value;
+                SCAN_CACHE_DIRTY = true;
+            }
+        }
+    }
+
+    // count results
+    size_t found = 0;
+    for (auto &pattern : patterns) {
+        if (pattern.result) {
+            found++;
+        }
+    }
+    return found;
+}
+
+void sigscan_cache_flush() {
+    std::lock_guard<std::mutex> lock(SCAN_CACHE_M);
+    if (SCAN_CACHE_DIRTY) {
+        SCAN_CACHE_DIRTY = false;
+        scan_cache_save();
+    }
+}
+
+intptr_t find_pattern(std::vector<uint8_t> &data, intptr_t base, const uint8_t *pattern,
+        const char *mask, intptr_t offset, intptr_t usage)
+{
+
+    // build pattern
+    size_t mask_size = strlen(mask);
+    std::vector<SigScanPattern> patterns(1);
+    patterns[0].data.assign(pattern, pattern + mask_size);
+    patterns[0].mask = mask;
+    patterns[0].offset = offset;
+    patterns[0].usage = usage;
+
+    // find pattern
+    find_patterns(data.data(), data.size(), base, patterns);
+    return patterns[0].result;
+}
+
+intptr_t find_pattern(HMODULE module, const uint8_t *pattern, const char *mask,
+        intptr_t offset, intptr_t result_usage)
+{
+
+    // build pattern
+    size_t mask_size = strlen(mask);
+    std::vector<SigScanPattern> patterns(1);
+    patterns[0].data.assign(pattern, pattern + mask_size);
+    patterns[0].mask = mask;
+    patterns[0].offset = offset;
+    patterns[0].usage = result_usage;
+
+    // find pattern
+    find_patterns(module, patterns);
+    return patterns[0].result;
 }
 
 intptr_t replace_pattern(HMODULE module, const uint8_t *pattern, const char *mask, intptr_t offset,
@@ -110,57 +849,133 @@ intptr_t replace_pattern(HMODULE module, const std::string &signature,
         const std::string &replacement, intptr_t offset, intptr_t usage)
 {
     // build pattern
-    std::string pattern_str(signature);
-    strreplace(pattern_str, "??", "00");
-    auto pattern_bin = std::make_unique<uint8_t[]>(signature.length() / 2);
-    if (!hex2bin(pattern_str.c_str(), pattern_bin.get())) {
+    std::vector<uint8_t> pattern_bin;
+    std::string signature_mask;
+    if (!parse_pattern(signature, pattern_bin, signature_mask)) {
         return false;
     }
 
-    // build signature mask
-    std::ostringstream signature_mask;
-    for (size_t i = 0; i < signature.length(); i += 2) {
-        if (signature[i] == '?') {
-            if (signature[i + 1] == '?') {
-                signature_mask << '?';
-            } else {
-                return false;
-            }
-        } else {
-            signature_mask << 'X';
-        }
-    }
-
-    // build replace data
-    std::string replace_data_str(replacement);
-    strreplace(replace_data_str, "??", "00");
-    auto replace_data_bin = std::make_unique<uint8_t[]>(replacement.length() / 2);
-    if (!hex2bin(replace_data_str.c_str(), replace_data_bin.get())) {
+    // build replacement
+    std::vector<uint8_t> replace_data_bin;
+    std::string replace_mask;
+    if (!parse_pattern(replacement, replace_data_bin, replace_mask)) {
         return false;
     }
 
-    // build replace mask
-    std::ostringstream replace_mask;
-    for (size_t i = 0; i < replacement.length(); i += 2) {
-        if (replacement[i] == '?') {
-            if (replacement[i + 1] == '?') {
-                replace_mask << '?';
-            } else {
-                return false;
-            }
-        } else {
-            replace_mask << 'X';
-        }
-    }
-
     // do the replacement
     return replace_pattern(
             module,
-            pattern_bin.get(),
-            signature_mask.str().c_str(),
+            pattern_bin.data(),
+            signature_mask.c_str(),
             offset,
             usage,
-            replace_data_bin.get(),
-            replace_mask.str().c_str()
+            replace_data_bin.data(),
+            replace_mask.c_str()
     );
 }
+
+namespace {
+
+    // the previous implementation, searching the whole image once per pattern
+    intptr_t find_pattern_search(std::vector<uint8_t> &data, intptr_t base, const SigScanPattern &pattern) {
+        std::vector<std::pair<uint8_t, bool>> pattern_vector;
+        for (size_t i = 0; i < pattern.mask.size(); i++) {
+            pattern_vector.emplace_back(pattern.data[i], pattern.mask[i] == 'X');
+        }
+        auto data_begin = data.begin();
+        intptr_t cur_usage = 0;
+        while (true) {
+            auto search_result = std::search(data_begin, data.end(), pattern_vector.begin(), pattern_vector.end(),
+                    [] (uint8_t c, std::pair<uint8_t, bool> pat) {
+                        return (!pat.second) || c == pat.first;
+                    });
+            if (search_result == data.end()) {
+                return 0;
+            }
+            if (cur_usage == pattern.usage) {
+                return (std::distance(data.begin(), search_result) + base) + pattern.offset;
+            }
+            ++cur_usage;
+            data_begin = ++search_result;
+        }
+    }
+}
+
+void sigscan_benchmark() {
+    const size_t size = 16 * 1024 * 1024;
+    const size_t pattern_count = 32;
+    const size_t pattern_size = 16;
+    const intptr_t base = 0x10000000;
+
+    // fake code section, common x86 bytes are a lot more frequent like in real images
+    static const uint8_t common[] = { 0x00, 0xFF, 0x8B, 0x48, 0x89, 0x45, 0xE8, 0x0F, 0x83, 0x24, 0xCC, 0x44 };
+    std::vector<uint8_t> data(size);
+    uint32_t seed = 0x12345678;
+    auto random = [&seed] {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    };
+    for (auto &c : data) {
+        auto value = random();
+        c = (value & 3) ? common[(value >> 8) % sizeof(common)] : (uint8_t) (value >> 16);
+    }
+
+    // signatures taken from the image with wildcards for a relative call target, the last ones won't match
+    std::vector<SigScanPattern> patterns(pattern_count);
+    for (size_t i = 0; i < pattern_count; i++) {
+        auto &pattern = patterns[i];
+        auto position = random() % (size - pattern_size);
+        pattern.data.assign(&data[position], &data[position + pattern_size]);
+        pattern.mask = std::string(pattern_size, 'X');
+        for (size_t j = 4; j < 8; j++) {
+            pattern.mask[j] = '?';
+        }
+        if (i >= pattern_count - 4) {
+            pattern.data[pattern_size - 1] ^= 0x5A;
+            pattern.data[0] ^= 0xA5;
+        }
+    }
+
+    // previous implementation
+    std::vector<intptr_t> results_reference;
+    auto time_start = get_performance_milliseconds();
+    for (auto &pattern : patterns) {
+        results_reference.push_back(find_pattern_search(data, base, pattern));
+    }
+    auto time_search = get_performance_milliseconds() - time_start;
+    log_info("sigscan", "benchmarking {} patterns on {} MiB, best kernel: {}",
+            pattern_count, size / (1024 * 1024), get_kernel_name(get_kernel()));
+    log_info("sigscan", "search per pattern: {:.3f} ms", time_search);
+
+    for (auto kernel : { Kernel::Scalar, Kernel::SSE, Kernel::AVX2 }) {
+        if (kernel > get_kernel()) {
+            break;
+        }
+
+        // single pattern, like most callers
+        time_start = get_performance_milliseconds();
+        for (size_t i = 0; i < pattern_count; i++) {
+            std::vector<SigScanPattern> single { patterns[i] };
+            find_patterns(kernel, data.data(), data.size(), base, single);
+            if (single[0].result != results_reference[i]) {
+                log_warning("sigscan", "{} result mismatch for pattern {}", get_kernel_name(kernel), i);
+            }
+        }
+        auto time_single = get_performance_milliseconds() - time_start;
+
+        // single pass
+        time_start = get_performance_milliseconds();
+        auto found = find_patterns(kernel, data.data(), data.size(), base, patterns);
+        auto time_scan = get_performance_milliseconds() - time_start;
+        for (size_t i = 0; i < pattern_count; i++) {
+            if (patterns[i].result != results_reference[i]) {
+                log_warning("sigscan", "{} result mismatch for pattern {}", get_kernel_name(kernel), i);
+            }
+        }
+
+        log_info("sigscan", "{}: scanner per pattern: {:.3f} ms, single pass: {:.3f} ms, {} found",
+                get_kernel_name(kernel), time_single, time_scan, found);
+    }
+}
@@ -6,6 +6,38 @@
 #include "windows.h"
 #include "psapi.h"
 
+/*
+ * Masked pattern for scanning many signatures in a single pass.
+ * The mask contains 'X' for bytes which have to match and '?' for wildcards.
+ */
+struct SigScanPattern {
+    std::vector<unsigned char> data;
+    std::string mask;
+    intptr_t offset = 0;
+    intptr_t usage = 0;
+
+    // address of the match plus offset, 0 if not found
+    intptr_t result = 0;
+};
+
+// converts a hex signature with "??" wildcards, returns false if it's invalid
+bool parse_pattern(const std::string &signature, std::vector<unsigned char> &data, std::string &mask);
+
+// finds all patterns in a single pass, returns the number of patterns found
+size_t find_patterns(
+        const unsigned char *data,
+        size_t size,
+        intptr_t base,
+        std::vector<SigScanPattern> &patterns);
+
+// same as above for the readable memory of a loaded module, which is scanned in place
+size_t find_patterns(
+        HMODULE module,
+        std::vector<SigScanPattern> &patterns);
+
+// writes pending scan cache changes of the module scans to disk
+void sigscan_cache_flush();
+
 intptr_t find_pattern(
         std::vector<unsigned char> &data,
         intptr_t base,
@@ -36,3 +68,6 @@ intptr_t replace_pattern(
         const std::string &replacement,
         intptr_t offset,
         intptr_t usage);
+
+// times all scanner kernels against a search per pattern and logs the results
+void sigscan_benchmark();